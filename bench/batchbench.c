@@ -0,0 +1,274 @@
+//////////////////////////////////////////////////////////////////////
+// batchbench.c -- gp -B ops/s vs spawning gp per operation
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "gpsrv.h"
+
+#define CHUNK	256		// Commands in flight when pipelining
+
+extern char **environ;
+
+static const char *gp_path = "../gpio/gp";
+
+static double
+elapsed(const struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,double secs) {
+	printf("%-24s %12.0f ops/s %10.2f us/op\n",
+		what,count / secs,secs * 1e6 / count);
+}
+
+typedef struct {
+	pid_t	pid;
+	int	to;		// Commands to gp
+	int	from;		// Responses from gp
+} batch_t;
+
+static void
+batch_open(batch_t *b,bool binary) {
+	char *args[] = { "gp", "-B", "-", binary ? "-Z" : 0, 0 };
+	posix_spawn_file_actions_t fa;
+	int in[2], out[2];
+
+	if ( pipe(in) || pipe(out) ) {
+		perror("pipe()");
+		exit(2);
+	}
+	posix_spawn_file_actions_init(&fa);
+	posix_spawn_file_actions_adddup2(&fa,in[0],0);
+	posix_spawn_file_actions_adddup2(&fa,out[1],1);
+	posix_spawn_file_actions_addclose(&fa,in[1]);
+	posix_spawn_file_actions_addclose(&fa,out[0]);
+	if ( posix_spawn(&b->pid,gp_path,&fa,0,args,environ) ) {
+		fprintf(stderr,"posix_spawn %s\n",gp_path);
+		exit(2);
+	}
+	posix_spawn_file_actions_destroy(&fa);
+	close(in[0]);
+	close(out[1]);
+	b->to = in[1];
+	b->from = out[0];
+}
+
+static void
+batch_close(batch_t *b) {
+	int status;
+
+	close(b->to);
+	close(b->from);
+	waitpid(b->pid,&status,0);
+}
+
+static void
+put(int fd,const void *buf,size_t bytes) {
+	const char *cp = buf;
+
+	while ( bytes > 0 ) {
+		ssize_t n = write(fd,cp,bytes);
+
+		if ( n <= 0 ) {
+			perror("write(gp)");
+			exit(2);
+		}
+		cp += n;
+		bytes -= n;
+	}
+}
+
+static void
+get(int fd,void *buf,size_t bytes) {
+	char *cp = buf;
+
+	while ( bytes > 0 ) {
+		ssize_t n = read(fd,cp,bytes);
+
+		if ( n <= 0 ) {
+			fprintf(stderr,"gp -B ended early\n");
+			exit(2);
+		}
+		cp += n;
+		bytes -= n;
+	}
+}
+
+/*
+ * Text mode: send n commands, then read until n response lines
+ */
+static long
+text_round(batch_t *b,const char *cmds,size_t bytes,int n) {
+	char buf[4096];
+	long errs = 0;
+	int lines = 0;
+	bool bol = true;
+
+	put(b->to,cmds,bytes);
+	while ( lines < n ) {
+		ssize_t got = read(b->from,buf,sizeof buf);
+
+		if ( got <= 0 ) {
+			fprintf(stderr,"gp -B ended early\n");
+			exit(2);
+		}
+		for ( ssize_t x=0; x<got; ++x ) {
+			if ( bol && buf[x] == 'e' )
+				++errs;
+			bol = buf[x] == '\n';
+			lines += bol;
+		}
+	}
+	return errs;
+}
+
+static void
+run_text(long count,int gpio,int chunk) {
+	char *cmds = malloc(chunk * 32), *cp;
+	struct timespec t0;
+	long errs = 0;
+	batch_t b;
+
+	batch_open(&b,false);
+	cp = cmds + sprintf(cmds,"config %d out\n",gpio);
+	text_round(&b,cmds,cp - cmds,1);
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; x += chunk ) {
+		int n = count - x < chunk ? count - x : chunk;
+
+		cp = cmds;
+		for ( int y=0; y<n; ++y )
+			cp += sprintf(cp,"write %d %ld\n",gpio,(x + y) & 1);
+		errs += text_round(&b,cmds,cp - cmds,n);
+	}
+	report(chunk > 1 ? "gp -B text, pipelined" : "gp -B text, lockstep",count,elapsed(&t0));
+	if ( errs )
+		printf("  %ld commands failed\n",errs);
+	batch_close(&b);
+	free(cmds);
+}
+
+static void
+run_binary(long count,int gpio,int chunk) {
+	gpsrv_cmd_t *cmds = malloc(chunk * sizeof *cmds);
+	gpsrv_rsp_t *rsps = malloc(chunk * sizeof *rsps);
+	struct timespec t0;
+	long errs = 0;
+	batch_t b;
+
+	batch_open(&b,true);
+	cmds[0] = (gpsrv_cmd_t){ 0, GpsrvConfig, gpio, Output, 0 };
+	put(b.to,cmds,sizeof *cmds);
+	get(b.from,rsps,sizeof *rsps);
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; x += chunk ) {
+		int n = count - x < chunk ? count - x : chunk;
+
+		for ( int y=0; y<n; ++y )
+			cmds[y] = (gpsrv_cmd_t){ x + y, GpsrvWrite, gpio, (x + y) & 1, 0 };
+		put(b.to,cmds,n * sizeof *cmds);
+		get(b.from,rsps,n * sizeof *rsps);
+		for ( int y=0; y<n; ++y )
+			if ( rsps[y].rc || rsps[y].seq != (uint32_t)(x + y) )
+				++errs;
+	}
+	report(chunk > 1 ? "gp -B -Z, pipelined" : "gp -B -Z, lockstep",count,elapsed(&t0));
+	if ( errs )
+		printf("  %ld commands failed\n",errs);
+	batch_close(&b);
+	free(cmds);
+	free(rsps);
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-n ops] [-s spawns] [-g gpio] [-G gp_path] [-h]\n"
+		"where:\n"
+		"\t-n ops\tOperations through one gp -B process (100000)\n"
+		"\t-s n\tOperations run as one gp process each (100)\n"
+		"\t-g gpio\tOutput gpio written (18)\n"
+		"\t-G path\tgp executable (../gpio/gp)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hn:s:g:G:";
+	long count = 100000, spawns = 100;
+	int gpio = 18, oc;
+	struct timespec t0;
+	char gbuf[16], vbuf[4];
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'n':
+			count = atol(optarg);
+			break;
+		case 's':
+			spawns = atol(optarg);
+			break;
+		case 'g':
+			gpio = atoi(optarg);
+			break;
+		case 'G':
+			gp_path = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+	if ( count <= 0 || spawns < 0 || gpio < 0 || gpio > 31 ) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	run_text(count,gpio,CHUNK);
+	run_binary(count,gpio,CHUNK);
+	run_text(count / 10 ? count / 10 : 1,gpio,1);
+	run_binary(count / 10 ? count / 10 : 1,gpio,1);
+
+	/*
+	 * One process per operation, as scripts do today:
+	 */
+	snprintf(gbuf,sizeof gbuf,"%d",gpio);
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<spawns; ++x ) {
+		char *args[] = { "gp", "-g", gbuf, "-o", vbuf, 0 };
+		pid_t pid;
+		int status;
+
+		snprintf(vbuf,sizeof vbuf,"%ld",x & 1);
+		if ( posix_spawn(&pid,gp_path,0,0,args,environ) ) {
+			fprintf(stderr,"posix_spawn %s\n",gp_path);
+			exit(2);
+		}
+		waitpid(pid,&status,0);
+	}
+	if ( spawns > 0 )
+		report("spawn gp -o",spawns,elapsed(&t0));
+
+	return 0;
+}
+
+// End batchbench.c
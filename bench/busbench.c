@@ -0,0 +1,218 @@
+/* busbench.c : Parallel bus master transfer rates
+ * Warren W. Gay ve3wwg
+ *
+ * ./busbench [-P profile] [-d pins] [-w strobe] [-r rdwr] [-s rs] [-c cs] [-n count]
+ *
+ * Runs single and bulk writes and reads at a timing profile, and
+ * reports transfers per second against the profile's minimum cycle.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpdelay.h"
+#include "gpbus.h"
+
+static int pins[32] = { 4, 17, 27, 22, 23, 24, 25, 5 };
+static int npins = 8;
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,double secs,uint32_t cycle_ns) {
+	double ns = secs * 1e9 / count;
+
+	printf("%-20s %10ld xfers %8.3f s %12.0f xfers/s %9.1f ns/xfer (min %u ns, %.0f%%)\n",
+		what,count,secs,count / secs,ns,cycle_ns,ns > 0 ? cycle_ns * 100.0 / ns : 0.0);
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < 32; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-P profile] [-d pins] [-w strobe] [-r rdwr] [-s rs] [-c cs] [-n count] [-h]\n"
+		"where:\n"
+		"\t-P profile\tTiming profile (8080)\n"
+		"\t-d pins\tComma separated data gpios (4,17,27,22,23,24,25,5)\n"
+		"\t-w gpio\t/WR or E strobe (6)\n"
+		"\t-r gpio\t/RD or R/W, -1 for none (13)\n"
+		"\t-s gpio\tRS (D/C), -1 for none (19)\n"
+		"\t-c gpio\t/CS, -1 for none (26)\n"
+		"\t-n count\tTransfers per test (100000)\n"
+		"\t-h\tThis help\n"
+		"Profiles:\n",
+		cmd);
+	for ( const gpio_bus_timing_t *p = gpio_bus_profiles(); p->name; ++p )
+		printf("\t%-8s %s setup %u pulse %u hold %u access %u recovery %u ns\n",
+			p->name,p->type == Bus8080 ? "8080" : "6800",
+			p->setup_ns,p->pulse_ns,p->hold_ns,p->access_ns,p->recovery_ns);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hP:d:w:r:s:c:n:";
+	const gpio_bus_timing_t *prof = gpio_bus_profile("8080");
+	int opt_strobe = 6, opt_rdwr = 13, opt_rs = 19, opt_cs = 26;
+	long count = 100000, bad = 0;
+	uint32_t mask, v;
+	gpio_bus_t *bus;
+	struct timespec t0;
+	void *buf;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'P':
+			if ( !(prof = gpio_bus_profile(optarg)) ) {
+				fprintf(stderr,"Unknown profile: -P %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'd':
+			npins = parse_pins(optarg,pins);
+			if ( npins <= 0 ) {
+				fprintf(stderr,"Invalid pins: -d %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'w':
+			opt_strobe = atoi(optarg);
+			break;
+		case 'r':
+			opt_rdwr = atoi(optarg);
+			break;
+		case 's':
+			opt_rs = atoi(optarg);
+			break;
+		case 'c':
+			opt_cs = atoi(optarg);
+			break;
+		case 'n':
+			count = atol(optarg);
+			if ( count <= 0 ) {
+				fprintf(stderr,"Invalid count: -n %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	gpio_delay_init(true);
+
+	bus = malloc(sizeof *bus);
+	if ( !bus || (rc = gpio_bus_init(bus,prof,pins,npins,opt_strobe,opt_rdwr,opt_rs,opt_cs)) != 0 ) {
+		fprintf(stderr,"Invalid bus pins (bank 0, no pin used twice)\n");
+		exit(1);
+	}
+	mask = npins >= 32 ? ~0u : (1u << npins) - 1;
+
+	printf("Profile %s (%s), %d data pins, %d byte elements\n",prof->name,
+		prof->type == Bus8080 ? "8080" : "6800",npins,bus->width);
+	printf("Spins: setup %u pulse %u access %u rest %u after %u\n",
+		bus->spin_setup,bus->spin_pulse,bus->spin_access,bus->spin_rest,bus->spin_after);
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+	gpio_bus_configure(bus);
+
+	buf = calloc(count,bus->width);
+	if ( !buf ) {
+		perror("calloc()");
+		exit(2);
+	}
+	for ( long x=0; x<count; ++x ) {
+		v = (uint32_t)(x * 2654435761u) & mask;
+		switch ( bus->width ) {
+		case 1:
+			((uint8_t *)buf)[x] = v;
+			break;
+		case 2:
+			((uint16_t *)buf)[x] = v;
+			break;
+		default:
+			((uint32_t *)buf)[x] = v;
+		}
+	}
+
+	/*
+	 * Write path check: the data lines keep driving the last value
+	 */
+	for ( uint32_t x=0; x<4096; ++x ) {
+		v = (x * 40503u) & mask;
+		gpio_bus_write(bus,x & 1,v);
+		if ( gpio_vport_gather(&bus->data,gpio_read32()) != v )
+			++bad;
+	}
+	printf("Write check: %ld of 4096 values read back wrong\n",bad);
+
+	/*
+	 * Writes:
+	 */
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		gpio_bus_write(bus,true,(uint32_t)x & mask);
+	report("gpio_bus_write",count,elapsed(&t0),gpio_bus_cycle_ns(prof,false));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	gpio_bus_write_buf(bus,true,buf,count);
+	report("gpio_bus_write_buf",count,elapsed(&t0),gpio_bus_cycle_ns(prof,false));
+
+	/*
+	 * Reads:
+	 */
+	if ( bus->rdwr ) {
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		for ( long x=0; x<count; ++x )
+			gpio_bus_read(bus,true,&v);
+		report("gpio_bus_read",count,elapsed(&t0),gpio_bus_cycle_ns(prof,true));
+
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		gpio_bus_read_buf(bus,true,buf,count);
+		report("gpio_bus_read_buf",count,elapsed(&t0),gpio_bus_cycle_ns(prof,true));
+	}
+
+	gpio_bus_write(bus,false,0);
+	gpio_close();
+	free(buf);
+	free(bus);
+	return bad ? 1 : 0;
+}
+
+// End busbench.c
@@ -0,0 +1,280 @@
+/* debouncebench.c : Bit-sliced debouncer correctness and rate
+ * Warren W. Gay ve3wwg
+ *
+ * ./debouncebench [-n samples] [-t threshold] [-b bounce] [-s seed] [-f trace] [-L secs]
+ *
+ * Generates a trace of GPLEV0 samples (or reads one, a hex word per
+ * line), with every pin changing level through bursts of contact
+ * bounce. The trace is fed to gpio_debounce_sample() and to 32 per
+ * pin reference state machines, which must agree on every sample.
+ * Samples per second are then timed for both. -L also times
+ * gpio_debounce_poll() on live GPLEV0 reads (root, or
+ * LIBGP_BACKEND=sim).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpdebounce.h"
+
+/*
+ * Reference: one state machine per pin
+ */
+typedef struct {
+	uint32_t	stable;
+	unsigned	count[32];
+	unsigned	threshold[32];
+} ref_debounce_t;
+
+static volatile uint32_t sink;		// Keeps results from being optimized out
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,double secs) {
+
+	printf("%-22s %10ld samples %8.3f s %14.0f samples/s %8.2f ns/sample\n",
+		what,count,secs,count / secs,secs * 1e9 / count);
+}
+
+static uint32_t
+ref_sample(ref_debounce_t *ref,uint32_t raw) {
+	uint32_t changed = 0;
+
+	for ( int p=0; p<32; ++p ) {
+		uint32_t bit = 1u << p;
+
+		if ( (raw ^ ref->stable) & bit ) {
+			if ( ++ref->count[p] >= ref->threshold[p] ) {
+				ref->stable ^= bit;
+				ref->count[p] = 0;
+				changed |= bit;
+			}
+		} else	ref->count[p] = 0;
+	}
+	return changed;
+}
+
+/*
+ * Each pin holds a level for a random time, then moves to the other
+ * through up to bounce samples of random noise.
+ */
+static void
+gen_trace(uint32_t *trace,long n,unsigned bounce,unsigned maxhold) {
+	long next[32], noise_end[32];
+	uint32_t level = 0;
+
+	for ( int p=0; p<32; ++p )
+		next[p] = noise_end[p] = rand() % maxhold;
+
+	for ( long x=0; x<n; ++x ) {
+		uint32_t raw = level;
+
+		for ( int p=0; p<32; ++p ) {
+			if ( x == next[p] ) {
+				level ^= 1u << p;
+				noise_end[p] = x + (bounce ? rand() % (bounce + 1) : 0);
+				next[p] = noise_end[p] + 1 + rand() % maxhold;
+			}
+			if ( x < noise_end[p] && (rand() & 1) )
+				raw ^= 1u << p;
+			else	raw = (raw & ~(1u << p)) | (level & (1u << p));
+		}
+		trace[x] = raw;
+	}
+}
+
+static long
+load_trace(const char *path,uint32_t **tracep) {
+	FILE *f = fopen(path,"r");
+	long n = 0, max = 65536;
+	uint32_t *trace = malloc(max * sizeof *trace);
+	char line[128];
+
+	if ( !f ) {
+		perror(path);
+		exit(1);
+	}
+	while ( fgets(line,sizeof line,f) ) {
+		char *ep;
+		uint32_t v = strtoul(line,&ep,16);
+
+		if ( ep == line )
+			continue;		// Blank or comment
+		if ( n >= max )
+			trace = realloc(trace,(max *= 2) * sizeof *trace);
+		trace[n++] = v;
+	}
+	fclose(f);
+	*tracep = trace;
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-n samples] [-t threshold] [-b bounce] [-s seed] [-f trace] [-L secs] [-h]\n"
+		"where:\n"
+		"\t-n samples\tGenerated trace length (1000000)\n"
+		"\t-t threshold\tSamples for every pin (default: random 1..%u per pin)\n"
+		"\t-b bounce\tMost samples of bounce per level change (20)\n"
+		"\t-s seed\tRandom seed (1)\n"
+		"\t-f trace\tRead the trace from a file, one hex GPLEV0 word per line\n"
+		"\t-L secs\tAlso poll live GPLEV0 for secs\n"
+		"\t-h\tThis help\n",
+		cmd,GPIO_DEBOUNCE_MAX);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hn:t:b:s:f:L:";
+	long n = 1000000, bad = 0, changes = 0;
+	unsigned opt_threshold = 0, opt_bounce = 20;
+	const char *opt_file = 0;
+	double opt_live = 0.0;
+	uint32_t *trace = 0, changed, acc;
+	gpio_debounce_t db;
+	ref_debounce_t ref;
+	struct timespec t0;
+	int oc;
+
+	srand(1);
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'n':
+			n = atol(optarg);
+			if ( n <= 0 ) {
+				fprintf(stderr,"Invalid count: -n %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 't':
+			opt_threshold = atoi(optarg);
+			if ( opt_threshold < 1 || opt_threshold > GPIO_DEBOUNCE_MAX ) {
+				fprintf(stderr,"Threshold must be 1 to %u: -t %s\n",GPIO_DEBOUNCE_MAX,optarg);
+				exit(1);
+			}
+			break;
+		case 'b':
+			opt_bounce = atoi(optarg);
+			break;
+		case 's':
+			srand(atoi(optarg));
+			break;
+		case 'f':
+			opt_file = optarg;
+			break;
+		case 'L':
+			opt_live = strtod(optarg,0);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( opt_file ) {
+		n = load_trace(opt_file,&trace);
+		if ( !n ) {
+			fprintf(stderr,"%s: no samples\n",opt_file);
+			exit(1);
+		}
+	} else	{
+		trace = malloc(n * sizeof *trace);
+		gen_trace(trace,n,opt_bounce,opt_bounce * 2 + GPIO_DEBOUNCE_MAX * 3);
+	}
+
+	/*
+	 * Correctness: both must agree on every sample
+	 */
+	gpio_debounce_init(&db,trace[0],1);
+	memset(&ref,0,sizeof ref);
+	ref.stable = trace[0];
+	for ( int p=0; p<32; ++p ) {
+		ref.threshold[p] = opt_threshold ? opt_threshold : 1 + rand() % GPIO_DEBOUNCE_MAX;
+		gpio_debounce_threshold(&db,1u << p,ref.threshold[p]);
+		if ( gpio_debounce_get_threshold(&db,p) != ref.threshold[p] )
+			++bad;
+	}
+	if ( bad )
+		printf("Threshold readback: %ld bad\n",bad);
+
+	for ( long x=0; x<n; ++x ) {
+		uint32_t rc = ref_sample(&ref,trace[x]);
+
+		changed = gpio_debounce_sample(&db,trace[x]);
+		if ( changed != rc || db.stable != ref.stable
+		  || gpio_debounce_rose(&db) != (rc & ref.stable)
+		  || gpio_debounce_fell(&db) != (rc & ~ref.stable) ) {
+			if ( bad++ < 5 )
+				printf("sample %ld raw %08X: changed %08X stable %08X, expected %08X %08X\n",
+					x,trace[x],changed,db.stable,rc,ref.stable);
+		}
+		changes += __builtin_popcount(changed);
+	}
+	printf("Trace check: %ld samples, %ld debounced changes, %ld bad\n",n,changes,bad);
+	if ( bad )
+		exit(1);
+
+	/*
+	 * Rates:
+	 */
+	gpio_debounce_init(&db,trace[0],8);
+	acc = 0;
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<n; ++x )
+		acc ^= gpio_debounce_sample(&db,trace[x]);
+	sink = acc;
+	report("gpio_debounce_sample",n,elapsed(&t0));
+
+	memset(&ref,0,sizeof ref);
+	for ( int p=0; p<32; ++p )
+		ref.threshold[p] = 8;
+	acc = 0;
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<n; ++x )
+		acc ^= ref_sample(&ref,trace[x]);
+	sink = acc;
+	report("32 state machines",n,elapsed(&t0));
+
+	if ( opt_live > 0.0 ) {
+		long count = 0;
+
+		if ( !gpio_open() ) {
+			fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+			exit(2);
+		}
+		gpio_debounce_init(&db,gpio_read32(),8);
+		changes = 0;
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		do	{
+			for ( int x=0; x<1000; ++x )
+				changes += __builtin_popcount(gpio_debounce_poll(&db));
+			count += 1000;
+		} while ( elapsed(&t0) < opt_live );
+		report("gpio_debounce_poll",count,elapsed(&t0));
+		printf("Live: %ld debounced changes, stable %08X\n",changes,db.stable);
+		gpio_close();
+	}
+
+	free(trace);
+	return 0;
+}
+
+// End debouncebench.c
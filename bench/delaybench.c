@@ -0,0 +1,94 @@
+/* delaybench.c : Accuracy of the calibrated busy-wait delays
+ * Warren W. Gay ve3wwg
+ *
+ * ./delaybench [-c] [-n trials]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gpdelay.h"
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-c] [-n trials] [-h]\n"
+		"where:\n"
+		"\t-c\tIgnore the calibration cache (recalibrate)\n"
+		"\t-n trials\tDelays timed per size (200)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hcn:";
+	static const uint32_t sizes[] = {
+		50, 100, 250, 500, 1000, 2000, 5000, 10000,
+		20000, 50000, 100000, 1000000
+	};
+	bool opt_cache = true;
+	int opt_trials = 200;
+	uint64_t t0, t1, clk_ns = ~0ull;
+	int oc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'c':
+			opt_cache = false;
+			break;
+		case 'n':
+			opt_trials = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	t0 = gpio_delay_now();
+	gpio_delay_init(opt_cache);
+	t1 = gpio_delay_now();
+	printf("init took %.3f ms\n",(t1 - t0) / 1e6);
+	gpio_delay_check(20000);
+	gpio_delay_report(stdout);
+
+	for ( int x=0; x<100; ++x ) {
+		t0 = gpio_delay_now();
+		t1 = gpio_delay_now() - t0;
+		if ( t1 < clk_ns )
+			clk_ns = t1;
+	}
+
+	printf("%10s %10s %10s %10s %10s\n","request","min","median","max","mean err");
+	for ( unsigned s=0; s<sizeof sizes/sizeof sizes[0]; ++s ) {
+		uint64_t *v = malloc(opt_trials * sizeof *v), sum = 0, tmp;
+
+		for ( int x=0; x<opt_trials; ++x ) {
+			t0 = gpio_delay_now();
+			gpio_spin_for(sizes[s]);
+			v[x] = gpio_delay_now() - t0 - clk_ns;
+			sum += v[x];
+		}
+		for ( int x=1; x<opt_trials; ++x )	// Insertion sort
+			for ( int y=x; y>0 && v[y-1] > v[y]; --y )
+				tmp = v[y], v[y] = v[y-1], v[y-1] = tmp;
+
+		printf("%10u %10llu %10llu %10llu %+10.1f\n",sizes[s],
+			(unsigned long long)v[0],
+			(unsigned long long)v[opt_trials/2],
+			(unsigned long long)v[opt_trials-1],
+			(double)sum / opt_trials - sizes[s]);
+		free(v);
+	}
+	return 0;
+}
+
+// End delaybench.c
@@ -0,0 +1,191 @@
+/* dmabench.c : Build and verify DMA waveform chains
+ * Warren W. Gay ve3wwg
+ *
+ * ./dmabench [-g gpio] [-t tick_ns] [-p ticks] [-n cycles] [-P pwm|pcm] [-H chan]
+ *
+ * Builds a square wave chain and runs it in the software executor,
+ * checking that every edge lands at its scheduled time, and checks
+ * that a chain reading past its block is refused. With -H the chain
+ * is then run on hardware DMA channel chan.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpdma.h"
+
+typedef struct {
+	uint64_t	edges;		// Stores seen
+	uint64_t	bad;		// Stores at the wrong time or value
+	uint64_t	half_ns;	// Expected time between edges
+	uint32_t	mask;
+} check_t;
+
+static void
+check_edge(void *arg,uint64_t t_ns,uint32_t reg,uint32_t value) {
+	check_t *chk = (check_t *)arg;
+	uint64_t want_t = chk->edges * chk->half_ns;
+	uint32_t want_reg = (chk->edges & 1) ? DMA_BUS_GPCLR0 : DMA_BUS_GPSET0;
+
+	if ( t_ns != want_t || reg != want_reg || value != chk->mask ) {
+		if ( chk->bad++ < 10 )
+			printf("edge %llu: t=%llu ns reg=%08X value=%08X (want t=%llu reg=%08X)\n",
+				(unsigned long long)chk->edges,(unsigned long long)t_ns,
+				reg,value,(unsigned long long)want_t,want_reg);
+	}
+	++chk->edges;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-g gpio] [-t tick_ns] [-p ticks] [-n cycles] [-P pwm|pcm] [-H chan] [-h]\n"
+		"where:\n"
+		"\t-g gpio\tOutput gpio (18 default)\n"
+		"\t-t ns\tPacing tick (1000)\n"
+		"\t-p ticks\tTicks per half period (5)\n"
+		"\t-n cycles\tSquare wave cycles (10000)\n"
+		"\t-P src\tPace with pwm or pcm DREQ (pwm)\n"
+		"\t-H chan\tAlso run on hardware DMA channel chan\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hg:t:p:n:P:H:";
+	int opt_gpio = 18, opt_cycles = 10000, opt_hw = -1;
+	uint32_t opt_tick = 1000, opt_ticks = 5;
+	GpioDmaPace opt_pace = PacePwm;
+	gpio_dma_exec_stats_t st;
+	gpio_dma_chain_t *ch;
+	check_t chk;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'g':
+			opt_gpio = atoi(optarg);
+			if ( opt_gpio < 0 || opt_gpio > 31 ) {
+				fprintf(stderr,"Invalid gpio: -g %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 't':
+			opt_tick = strtoul(optarg,0,0);
+			break;
+		case 'p':
+			opt_ticks = strtoul(optarg,0,0);
+			break;
+		case 'n':
+			opt_cycles = atoi(optarg);
+			break;
+		case 'P':
+			opt_pace = !strcmp(optarg,"pcm") ? PacePcm : PacePwm;
+			break;
+		case 'H':
+			opt_hw = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+	if ( !opt_tick || !opt_ticks || opt_cycles < 1 ) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	/*
+	 * One cycle of the square wave, looped: the executor is stopped
+	 * after opt_cycles cycles worth of control blocks.
+	 */
+	ch = gpio_dma_chain_new(4,2,opt_pace,opt_tick,false);
+	if ( !ch ) {
+		perror("gpio_dma_chain_new()");
+		exit(2);
+	}
+	gpio_dma_add_write(ch,1u << opt_gpio,0,opt_ticks);
+	gpio_dma_add_write(ch,0,1u << opt_gpio,opt_ticks);
+	gpio_dma_loop(ch,0);
+
+	memset(&chk,0,sizeof chk);
+	chk.half_ns = (uint64_t)opt_tick * opt_ticks;
+	chk.mask = 1u << opt_gpio;
+
+	rc = gpio_dma_exec(ch,(uint64_t)opt_cycles * ch->ncbs,check_edge,&chk,&st);
+	if ( rc ) {
+		fprintf(stderr,"%s: executing chain\n",strerror(rc));
+		exit(2);
+	}
+
+	printf("Executor: %llu CBs, %llu words (%llu paced), %llu stores\n",
+		(unsigned long long)st.cbs,(unsigned long long)st.words,
+		(unsigned long long)st.paced,(unsigned long long)st.stores);
+	printf("Simulated %.3f ms in %.3f ms host time (%.1f M CBs/s)\n",
+		st.sim_ns / 1e6,st.host_ns / 1e6,
+		st.host_ns ? st.cbs * 1e3 / st.host_ns : 0.0);
+	printf("Edges: %llu, wrong: %llu\n",
+		(unsigned long long)chk.edges,(unsigned long long)chk.bad);
+	gpio_dma_chain_free(ch);
+
+	/*
+	 * A block whose incrementing source runs off the end of the
+	 * chain memory must be refused, not read:
+	 */
+	ch = gpio_dma_chain_new(2,1,opt_pace,opt_tick,false);
+	if ( !ch ) {
+		perror("gpio_dma_chain_new()");
+		exit(2);
+	}
+	gpio_dma_add_write(ch,1u << opt_gpio,0,0);
+	ch->cbs[0].ti |= DMA_TI_SRC_INC;
+	ch->cbs[0].txfr_len = ch->size;
+	rc = gpio_dma_exec(ch,0,0,0,&st);
+	printf("Overrunning source: %s\n",rc ? strerror(rc) : "executed");
+	gpio_dma_chain_free(ch);
+	if ( rc != EFAULT ) {
+		printf("FAIL: expected %s\n",strerror(EFAULT));
+		exit(1);
+	}
+
+	if ( opt_hw >= 0 ) {
+		if ( !gpio_open() ) {
+			fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+			exit(2);
+		}
+		gpio_configure_io(opt_gpio,Output);
+
+		ch = gpio_dma_chain_new(opt_cycles * 4 + 1,opt_cycles * 2,opt_pace,opt_tick,true);
+		if ( !ch ) {
+			perror("gpio_dma_chain_new(hw)");
+			exit(2);
+		}
+		for ( int x=0; x<opt_cycles; ++x ) {
+			gpio_dma_add_write(ch,1u << opt_gpio,0,opt_ticks);
+			gpio_dma_add_write(ch,0,1u << opt_gpio,opt_ticks);
+		}
+		if ( (rc = gpio_dma_start(ch,opt_hw)) != 0 ) {
+			fprintf(stderr,"%s: starting DMA channel %d\n",strerror(rc),opt_hw);
+			exit(2);
+		}
+		while ( gpio_dma_busy(ch) )
+			usleep(1000);
+		printf("Hardware: channel %d finished %d cycles\n",opt_hw,opt_cycles);
+		gpio_dma_chain_free(ch);
+		gpio_close();
+	}
+
+	return chk.bad ? 1 : 0;
+}
+
+// End dmabench.c
@@ -0,0 +1,146 @@
+/* edgebench.c : Edge capture throughput and missed edge rate
+ * Warren W. Gay ve3wwg
+ *
+ * ./edgebench [-g gpio] [-e edges] [-s secs] [-r ring]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sched.h>
+
+#include "libgp.h"
+#include "gpedge.h"
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-g gpio] [-e edges] [-s secs] [-r ring] [-h]\n"
+		"where:\n"
+		"\t-g gpio\tBank 0 input to capture (27 default)\n"
+		"\t-e edges\tr, f or b (both), prefix a for async (b)\n"
+		"\t-s secs\tSeconds to capture (5)\n"
+		"\t-r ring\tRing entries (4096)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hg:e:s:r:";
+	int opt_gpio = 27, opt_secs = 5;
+	unsigned opt_ring = 4096, flags;
+	const char *opt_edges = "b";
+	gpio_edge_t *eng;
+	gpio_edge_event_t ev;
+	gpio_edge_stats_t st;
+	uint64_t consumed = 0, alternation = 0;
+	int last_level = -1;
+	time_t t0;
+	int oc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'g':
+			opt_gpio = atoi(optarg);
+			if ( opt_gpio < 0 || opt_gpio > 31 ) {
+				fprintf(stderr,"Invalid gpio: -g %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'e':
+			opt_edges = optarg;
+			break;
+		case 's':
+			opt_secs = atoi(optarg);
+			break;
+		case 'r':
+			opt_ring = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !strcmp(opt_edges,"r") )
+		flags = GPIO_EDGE_RISING;
+	else if ( !strcmp(opt_edges,"f") )
+		flags = GPIO_EDGE_FALLING;
+	else if ( !strcmp(opt_edges,"b") )
+		flags = GPIO_EDGE_RISING|GPIO_EDGE_FALLING;
+	else if ( !strcmp(opt_edges,"ar") )
+		flags = GPIO_EDGE_ARISING;
+	else if ( !strcmp(opt_edges,"af") )
+		flags = GPIO_EDGE_AFALLING;
+	else if ( !strcmp(opt_edges,"ab") )
+		flags = GPIO_EDGE_ARISING|GPIO_EDGE_AFALLING;
+	else	{
+		fprintf(stderr,"Invalid edges: -e %s\n",opt_edges);
+		exit(1);
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	gpio_configure_io(opt_gpio,Input);
+
+	eng = gpio_edge_open(1u << opt_gpio,flags,opt_ring);
+	if ( !eng || gpio_edge_start(eng) ) {
+		fprintf(stderr,"Unable to start edge capture\n");
+		exit(2);
+	}
+
+	/*
+	 * Consume events: with both edges armed, each event on the pin
+	 * must alternate in level.
+	 */
+	t0 = time(0);
+	while ( time(0) - t0 < opt_secs ) {
+		if ( !gpio_edge_get(eng,&ev) ) {
+			sched_yield();
+			continue;
+		}
+		++consumed;
+		if ( (flags & 3) == 3 || (flags & 0xC) == 0xC ) {
+			if ( ev.level == last_level )
+				++alternation;
+			last_level = ev.level;
+		}
+	}
+
+	gpio_edge_stop(eng);
+	while ( gpio_edge_get(eng,&ev) )
+		++consumed;
+	gpio_edge_stats(eng,&st);
+
+	double secs = st.ns / 1e9;
+
+	printf("polls    %12llu  %12.0f polls/s\n",
+		(unsigned long long)st.polls,st.polls / secs);
+	printf("events   %12llu  %12.0f edges/s\n",
+		(unsigned long long)st.events,st.events / secs);
+	printf("consumed %12llu\n",(unsigned long long)consumed);
+	printf("merged   %12llu  %12.6f%% edges missed (lower bound)\n",
+		(unsigned long long)st.merged,
+		st.events ? 100.0 * st.merged / (st.events + st.merged) : 0.0);
+	printf("dropped  %12llu  (ring full)\n",(unsigned long long)st.dropped);
+	if ( (flags & 3) == 3 || (flags & 0xC) == 0xC )
+		printf("repeats  %12llu  (same level twice in a row)\n",
+			(unsigned long long)alternation);
+
+	gpio_edge_close(eng);
+	gpio_close();
+	return 0;
+}
+
+// End edgebench.c
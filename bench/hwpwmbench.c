@@ -0,0 +1,183 @@
+/* hwpwmbench.c : Hardware PWM and GPCLK register check
+ * Warren W. Gay ve3wwg
+ *
+ * ./hwpwmbench [-C hz] [-F hz] [-p pct]
+ *
+ * Drives gpio_clock_start() and gpio_pwm_start() against the register
+ * model (LIBGP_BACKEND=sim, with gpsim running) or the hardware (root),
+ * and checks what they leave in CM_GP0CTL/DIV, CM_PWMCTL/DIV and the
+ * PWM CTL, RNG and DAT registers: the divisor gpio_clock_divisor()
+ * picks, MASH only with a fraction, the shared PWM clock left alone
+ * when the second channel starts, and each clock stopped with the
+ * last output using it. A clock below the lowest the divisor reaches
+ * must fail with ERANGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gppwm.h"
+
+static void
+usage(const char *cmd) {
+
+	printf("Usage: %s [-C hz] [-F hz] [-p pct]\n"
+		"where:\n"
+		"\t-C hz\tGPCLK0 frequency on gpio 4 (100000)\n"
+		"\t-F hz\tPWM frequency on gpio 18 and 19 (1000)\n"
+		"\t-p pct\tPWM duty on gpio 18 (25)\n",
+		cmd);
+}
+
+static void
+check(bool ok,const char *what) {
+
+	if ( !ok ) {
+		printf("FAIL: %s\n",what);
+		exit(1);
+	}
+}
+
+static bool
+has_alt(int gpio,IO want) {
+	IO io;
+
+	return !gpio_alt_function(gpio,&io) && io == want;
+}
+
+static void
+check_clock(double hz,bool frac) {
+	uint32_t ctl, div;
+	gpio_clkdiv_t want;
+	double actual;
+	int rc;
+
+	check(!gpio_clock_divisor(hz,frac,frac ? 2 : 1,&want),"no divisor for GPCLK0");
+	if ( (rc = gpio_clock_start(4,hz,frac,&actual)) != 0 ) {
+		printf("FAIL: gpio_clock_start(4,%.0f): %s\n",hz,strerror(rc));
+		exit(1);
+	}
+	ctl = *CMREG(CM_GP0CTL);
+	div = *CMREG(CM_GP0DIV);
+	printf("GPCLK0 %s %.0f Hz: CTL 0x%08X DIV 0x%08X (src %u, %u + %u/4096), %.3f Hz\n",
+		frac ? "fractional" : "integer",hz,
+		(unsigned)ctl,(unsigned)div,(unsigned)want.src,
+		(unsigned)want.divi,(unsigned)want.divf,actual);
+
+	check(ctl & CM_CTL_ENAB,"CM_GP0CTL not enabled");
+	check(CM_CTL_SRC(ctl) == (uint32_t)want.src,"CM_GP0CTL source");
+	check((ctl & CM_CTL_MASH(3)) == CM_CTL_MASH(want.divf ? 1 : 0),"CM_GP0CTL MASH");
+	check((div & 0x00FFFFFF) == CM_DIV(want.divi,want.divf),"CM_GP0DIV divisor");
+	check(actual == want.hz,"reported frequency");
+	check(has_alt(4,Alt0),"gpio 4 not GPCLK0 (Alt0)");
+}
+
+static void
+check_pwm(int gpio,int chan,double hz,double duty,uint32_t *range) {
+	uint32_t ctl, rng, dat, div = *CMREG(CM_PWMDIV);
+	bool other = *PWMREG(PWM_CTL) & PWM_CTL_PWEN(chan ^ 1);
+	double actual;
+	int rc;
+
+	if ( (rc = gpio_pwm_start(gpio,hz,duty,&actual)) != 0 ) {
+		printf("FAIL: gpio_pwm_start(%d,%.0f): %s\n",gpio,hz,strerror(rc));
+		exit(1);
+	}
+	ctl = *PWMREG(PWM_CTL);
+	rng = *PWMREG(chan ? PWM_RNG2 : PWM_RNG1);
+	dat = *PWMREG(chan ? PWM_DAT2 : PWM_DAT1);
+	printf("PWM%d gpio %d %.0f Hz %.0f%%: CTL 0x%08X RNG %u DAT %u, CM 0x%08X/0x%08X, %.3f Hz\n",
+		chan,gpio,hz,duty*100.0,(unsigned)ctl,(unsigned)rng,(unsigned)dat,
+		(unsigned)*CMREG(CM_PWMCTL),(unsigned)*CMREG(CM_PWMDIV),actual);
+
+	check(*CMREG(CM_PWMCTL) & CM_CTL_ENAB,"CM_PWMCTL not enabled");
+	check((ctl & PWM_CTL_CHAN(chan)) == (PWM_CTL_MSEN(chan) | PWM_CTL_PWEN(chan)),"PWM_CTL mark/space enable");
+	check(rng >= 2,"PWM range");
+	check(dat == (uint32_t)(duty * rng + 0.5),"PWM data for duty");
+	check(actual > hz * 0.99 && actual < hz * 1.01,"PWM frequency off by more than 1%");
+	if ( other ) {
+		check(*CMREG(CM_PWMDIV) == div,"shared PWM clock reprogrammed");
+		check(ctl & PWM_CTL_PWEN(chan ^ 1),"other PWM channel stopped");
+	}
+	check(has_alt(gpio,Alt5),"PWM pin not on Alt5");
+	*range = rng;
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hC:F:p:";
+	double opt_clock = 100000.0, opt_hz = 1000.0, opt_duty = 0.25;
+	uint32_t rng0, rng1;
+	double actual;
+	IO io;
+	int oc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'C':
+			opt_clock = strtod(optarg,0);
+			break;
+		case 'F':
+			opt_hz = strtod(optarg,0);
+			break;
+		case 'p':
+			opt_duty = strtod(optarg,0) / 100.0;
+			if ( opt_duty < 0.0 || opt_duty > 1.0 ) {
+				fprintf(stderr,"Duty must be 0 to 100%%: -p %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root, or LIBGP_BACKEND=sim?\n");
+		exit(2);
+	}
+
+	check_clock(opt_clock,false);
+	check_clock(opt_clock * 1.37,true);
+
+	// Below ~4.7 kHz (13.2 kHz on the Pi 4) no divisor reaches
+	check(gpio_clock_start(4,1000.0,false,&actual) == ERANGE,"1 kHz GPCLK not refused with ERANGE");
+	printf("GPCLK0 1000 Hz: %s\n",strerror(ERANGE));
+
+	check(!gpio_clock_stop(4),"gpio_clock_stop(4)");
+	check(!(*CMREG(CM_GP0CTL) & (CM_CTL_ENAB | CM_CTL_BUSY)),"CM_GP0CTL still running");
+	check(!gpio_alt_function(4,&io) && io == Input,"gpio 4 not left an input");
+	printf("GPCLK0 stopped: CTL 0x%08X\n",(unsigned)*CMREG(CM_GP0CTL));
+
+	check_pwm(18,0,opt_hz,opt_duty,&rng0);
+	check_pwm(19,1,opt_hz * 2.0,0.5,&rng1);
+	check(*PWMREG(PWM_RNG1) == rng0,"PWM_RNG1 changed by channel 1");
+
+	check(!gpio_pwm_duty(18,0.5),"gpio_pwm_duty(18)");
+	check(*PWMREG(PWM_DAT1) == (uint32_t)(0.5 * rng0 + 0.5),"PWM_DAT1 after duty change");
+	printf("PWM0 duty 50%%: DAT %u of %u\n",(unsigned)*PWMREG(PWM_DAT1),(unsigned)rng0);
+
+	check(!gpio_pwm_stop(18),"gpio_pwm_stop(18)");
+	check(!(*PWMREG(PWM_CTL) & PWM_CTL_PWEN(0)),"PWM channel 0 still enabled");
+	check(*CMREG(CM_PWMCTL) & CM_CTL_ENAB,"PWM clock stopped under channel 1");
+	check(!gpio_pwm_stop(19),"gpio_pwm_stop(19)");
+	check(!(*PWMREG(PWM_CTL) & PWM_CTL_PWEN(1)),"PWM channel 1 still enabled");
+	check(!(*CMREG(CM_PWMCTL) & (CM_CTL_ENAB | CM_CTL_BUSY)),"PWM clock left running");
+	printf("PWM stopped: CTL 0x%08X, CM 0x%08X\n",
+		(unsigned)*PWMREG(PWM_CTL),(unsigned)*CMREG(CM_PWMCTL));
+
+	gpio_close();
+	return 0;
+}
+
+// End hwpwmbench.c
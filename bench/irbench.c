@@ -0,0 +1,487 @@
+/* irbench.c : IR decoder error rates and latency on edge traces
+ * Warren W. Gay ve3wwg
+ *
+ * ./irbench [-n presses] [-j pct] [-b us] [-e pct] [-T ms] [-s seed] [-w file]
+ * ./irbench -f file -g gpio [-T ms]
+ *
+ * Synthesizes key presses on NEC, RC5 and Sony remotes as receiver
+ * output edges (active low), with timing jitter, mark stretch and
+ * glitches injected into some frames. Feeds them to gpio_ir_edge()
+ * and compares the commands against what was sent. -f replays a
+ * recorded trace instead, in the text form of gp -D (gp -M
+ * recordings); -w writes the synthetic trace in that form.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "gpir.h"
+
+typedef struct {
+	uint64_t	ns;
+	int		level;
+} edge_t;
+
+typedef struct {
+	IrProto		proto;
+	uint32_t	address;
+	uint32_t	command;
+	bool		repeat;
+	bool		corrupt;	// Glitch injected: may be rejected
+	bool		strict;		// Repeat flag must match (press clean so far,
+					// and the frame before was decoded)
+	bool		matched;
+	uint64_t	start_ns;	// First mark
+	uint64_t	end_ns;		// Last edge
+} sent_t;
+
+static edge_t *edges = 0;
+static long nedges = 0, maxedges = 0;
+static sent_t *sent = 0;
+static long nsent = 0, maxsent = 0;
+
+static uint64_t t_ns = 0;		// Synthesis time
+static double opt_jitter = 0.10, opt_bias_us = 50.0, opt_errors = 0.05;
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+add_edge(uint64_t ns,int level) {
+
+	if ( nedges >= maxedges ) {
+		maxedges = maxedges ? maxedges * 2 : 65536;
+		edges = realloc(edges,maxedges * sizeof *edges);
+	}
+	edges[nedges].ns = ns;
+	edges[nedges++].level = level;
+}
+
+static double
+frand() {
+	return rand() / (RAND_MAX + 1.0);
+}
+
+/*
+ * Emit a frame given as alternating mark/space microseconds (starting
+ * with a mark), jittered, then idle until period_us after its start.
+ */
+static void
+send_frame(sent_t *s,const uint32_t *levels,int n,uint32_t period_us) {
+	uint64_t t0 = t_ns;
+	int glitch = s->corrupt ? rand() % n : -1;
+
+	s->start_ns = t_ns;
+	for ( int x=0; x<n; ++x ) {
+		bool mark = !(x & 1);
+		double us = levels[x] * (1.0 + opt_jitter * (2.0 * frand() - 1.0));
+
+		us += mark ? opt_bias_us : -opt_bias_us;
+		add_edge(t_ns,mark ? 0 : 1);
+		if ( x == glitch ) {		// 150 us of the opposite level mid way
+			add_edge(t_ns + (uint64_t)(us * 500),mark ? 1 : 0);
+			add_edge(t_ns + (uint64_t)(us * 500) + 150000,mark ? 0 : 1);
+		}
+		t_ns += (uint64_t)(us * 1000);
+	}
+	add_edge(t_ns,1);			// Idle (space)
+	s->end_ns = t_ns;
+	if ( t_ns < t0 + period_us * 1000ull )
+		t_ns = t0 + period_us * 1000ull;
+}
+
+static sent_t *
+new_sent(IrProto proto,uint32_t address,uint32_t command,bool repeat,bool strict) {
+	sent_t *s;
+
+	if ( nsent >= maxsent ) {
+		maxsent = maxsent ? maxsent * 2 : 4096;
+		sent = realloc(sent,maxsent * sizeof *sent);
+	}
+	s = &sent[nsent++];
+	memset(s,0,sizeof *s);
+	s->proto = proto;
+	s->address = address;
+	s->command = command;
+	s->repeat = repeat;
+	s->corrupt = frand() < opt_errors;
+	s->strict = strict;
+	return s;
+}
+
+static void
+press_nec(int repeats) {
+	uint32_t a = rand() & 0xFF, c = rand() & 0xFF, lv[67];
+	uint32_t bits = a | (~a & 0xFF) << 8 | c << 16 | (~c & 0xFF) << 24;
+	uint32_t rpt[3] = { 9000, 2250, 560 };
+	bool clean;
+	sent_t *s;
+	int n = 0;
+
+	lv[n++] = 9000;
+	lv[n++] = 4500;
+	for ( int b=0; b<32; ++b ) {
+		lv[n++] = 560;
+		lv[n++] = bits >> b & 1 ? 1690 : 560;
+	}
+	lv[n++] = 560;
+	s = new_sent(IrNEC,a,c,false,true);
+	clean = !s->corrupt;
+	send_frame(s,lv,n,108000);
+	for ( int r=0; r<repeats; ++r ) {
+		s = new_sent(IrNEC,a,c,true,clean);
+		if ( !clean )
+			s->corrupt = true;	// Nothing to repeat
+		clean = clean && !s->corrupt;
+		send_frame(s,rpt,3,108000);
+	}
+}
+
+static void
+press_rc5(int repeats) {
+	static int toggle = 0;
+	uint32_t a = rand() & 0x1F, c = rand() & 0x7F, lv[28];
+	uint32_t bits = 1u << 13 | !(c >> 6) << 12 | toggle << 11 | a << 6 | (c & 0x3F);
+	bool clean = true;
+	int n = 0;
+	bool cur = true;			// Level of the half bit being built
+	uint32_t len = 0;
+
+	toggle ^= 1;
+	/*
+	 * Half bits (1 is space, mark), merged into levels. The first
+	 * half of S1 is idle space, so the frame starts with its mark.
+	 */
+	for ( int b=13; b>=0; --b ) {
+		bool one = bits >> b & 1;
+
+		for ( int h=0; h<2; ++h ) {
+			bool mark = one ? h == 1 : h == 0;
+
+			if ( b == 13 && h == 0 )
+				continue;
+			if ( len && mark != cur ) {
+				lv[n++] = len;
+				len = 0;
+			}
+			cur = mark;
+			len += 889;
+		}
+	}
+	if ( cur )
+		lv[n++] = len;			// Final mark (a trailing space is idle)
+
+	for ( int r=0; r<=repeats; ++r ) {
+		sent_t *s = new_sent(IrRC5,a,c,r > 0,clean);
+
+		clean = clean && !s->corrupt;
+		send_frame(s,lv,n,113778);
+	}
+}
+
+static void
+press_sony(int repeats) {
+	static const int lens[3] = { 12, 15, 20 };
+	int nbits = lens[rand() % 3];
+	uint32_t c = rand() & 0x7F, a = rand() & ((1u << (nbits - 7)) - 1), lv[42];
+	uint32_t bits = c | a << 7;
+	bool clean = true;
+	int n = 0;
+
+	lv[n++] = 2400;
+	for ( int b=0; b<nbits; ++b ) {
+		lv[n++] = 600;
+		lv[n++] = bits >> b & 1 ? 1200 : 600;
+	}
+	for ( int r=0; r<=repeats + 2; ++r ) {	// Sony sends at least 3
+		sent_t *s = new_sent(IrSony,a,c,r > 0,clean);
+
+		clean = clean && !s->corrupt;
+		send_frame(s,lv,n,45000);
+	}
+}
+
+static void
+synthesize(long presses) {
+
+	t_ns = 1000000000ull;
+	for ( long p=0; p<presses; ++p ) {
+		int repeats = rand() % 4;
+
+		switch ( rand() % 3 ) {
+		case 0:
+			press_nec(repeats);
+			break;
+		case 1:
+			press_rc5(repeats);
+			break;
+		default:
+			press_sony(repeats);
+		}
+		t_ns += (150 + rand() % 250) * 1000000ull;	// Between presses
+	}
+}
+
+/*
+ * Text trace as written by gp -D: "us gpioN level" lines
+ */
+static void
+load_trace(const char *path,int gpio) {
+	FILE *f = fopen(path,"r");
+	char line[256];
+	unsigned mask, level;
+
+	if ( !f ) {
+		perror(path);
+		exit(1);
+	}
+	while ( fgets(line,sizeof line,f) ) {
+		unsigned long long us;
+		int g, lev;
+
+		if ( sscanf(line,"# mask %x level %x",&mask,&level) == 2 ) {
+			add_edge(0,level >> gpio & 1);
+			continue;
+		}
+		if ( sscanf(line,"%llu gpio%d %d",&us,&g,&lev) == 3 && g == gpio )
+			add_edge(us * 1000ull,lev);
+	}
+	fclose(f);
+}
+
+static void
+write_trace(const char *path,int gpio) {
+	FILE *f = fopen(path,"w");
+
+	if ( !f ) {
+		perror(path);
+		exit(1);
+	}
+	fprintf(f,"# mask %08X level %08X, synthetic\n",1u << gpio,1u << gpio);
+	for ( long x=0; x<nedges; ++x )
+		fprintf(f,"%12llu gpio%-2d %d\n",(unsigned long long)(edges[x].ns / 1000),gpio,edges[x].level);
+	fclose(f);
+}
+
+/*
+ * Feed the edges, with gpio_ir_idle() ticking every tick_ms through
+ * the quiet periods as a polling edge source would.
+ */
+static long
+decode(gpio_ir_t *ir,gpio_ir_cmd_t *cmds,long max,unsigned tick_ms) {
+	gpio_ir_cmd_t cmd;
+	long n = 0;
+
+	for ( long x=0; x<nedges; ++x ) {
+		if ( tick_ms && x ) {
+			for ( uint64_t t = edges[x-1].ns + tick_ms * 1000000ull; t < edges[x].ns; t += tick_ms * 1000000ull )
+				if ( gpio_ir_idle(ir,t) )
+					while ( gpio_ir_get(ir,&cmd) )
+						if ( n < max )
+							cmds[n++] = cmd;
+		}
+		if ( gpio_ir_edge(ir,edges[x].ns,edges[x].level) )
+			while ( gpio_ir_get(ir,&cmd) )
+				if ( n < max )
+					cmds[n++] = cmd;
+	}
+	if ( nedges && gpio_ir_idle(ir,edges[nedges-1].ns + 100000000ull) )
+		while ( gpio_ir_get(ir,&cmd) )
+			if ( n < max )
+				cmds[n++] = cmd;
+	return n;
+}
+
+static void
+print_cmd(const gpio_ir_cmd_t *c) {
+
+	printf("%12.6f %-4s address %04X command %02X%s%s\n",c->start_ns / 1e9,
+		gpio_ir_proto_name(c->proto),c->address,c->command,
+		c->proto == IrRC5 ? c->toggle ? " T1" : " T0" : "",
+		c->repeat ? " repeat" : "");
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-n presses] [-j pct] [-b us] [-e pct] [-T ms] [-s seed] [-w file] [-v] [-h]\n"
+		"\t%s -f file -g gpio [-a] [-T ms]\n"
+		"where:\n"
+		"\t-n presses\tKey presses synthesized (2000)\n"
+		"\t-j pct\tTiming jitter, +/- percent (10)\n"
+		"\t-b us\tMarks stretched (spaces shortened) by us (50)\n"
+		"\t-e pct\tPercentage of frames glitched (5)\n"
+		"\t-T ms\tgpio_ir_idle() tick in quiet periods (1, 0: none)\n"
+		"\t-s seed\tRandom seed (1)\n"
+		"\t-w file\tWrite the synthetic trace (gp -D text form)\n"
+		"\t-f file\tDecode a recorded trace (gp -D text form)\n"
+		"\t-g gpio\tReceiver gpio in the trace (4)\n"
+		"\t-a\tReceiver output is active high\n"
+		"\t-v\tList decoded commands\n"
+		"\t-h\tThis help\n",
+		cmd,cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hn:j:b:e:T:s:w:f:g:av";
+	long presses = 2000, ncmds;
+	const char *opt_write = 0, *opt_file = 0;
+	unsigned opt_tick = 1;
+	int opt_gpio = 4;
+	bool opt_active_high = false, opt_verbose = false;
+	gpio_ir_cmd_t *cmds;
+	struct timespec t0;
+	double secs;
+	gpio_ir_t ir;
+	int oc;
+
+	srand(1);
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'n':
+			presses = atol(optarg);
+			break;
+		case 'j':
+			opt_jitter = atof(optarg) / 100.0;
+			break;
+		case 'b':
+			opt_bias_us = atof(optarg);
+			break;
+		case 'e':
+			opt_errors = atof(optarg) / 100.0;
+			break;
+		case 'T':
+			opt_tick = atoi(optarg);
+			break;
+		case 's':
+			srand(atoi(optarg));
+			break;
+		case 'w':
+			opt_write = optarg;
+			break;
+		case 'f':
+			opt_file = optarg;
+			break;
+		case 'g':
+			opt_gpio = atoi(optarg);
+			if ( opt_gpio < 0 || opt_gpio > 31 ) {
+				fprintf(stderr,"Invalid gpio: -g %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'a':
+			opt_active_high = true;
+			break;
+		case 'v':
+			opt_verbose = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( opt_file )
+		load_trace(opt_file,opt_gpio);
+	else	synthesize(presses);
+	if ( opt_write )
+		write_trace(opt_write,opt_gpio);
+
+	cmds = malloc((nedges / 4 + 16) * sizeof *cmds);
+	gpio_ir_init(&ir,GPIO_IR_ALL,!opt_active_high);
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	ncmds = decode(&ir,cmds,nedges / 4 + 16,opt_tick);
+	secs = elapsed(&t0);
+
+	if ( opt_verbose || opt_file )
+		for ( long x=0; x<ncmds; ++x )
+			print_cmd(&cmds[x]);
+
+	printf("%ld edges decoded in %.3f ms: %.1f ns/edge (idle tick %u ms)\n",
+		nedges,secs * 1e3,secs * 1e9 / (nedges ? nedges : 1),opt_tick);
+	printf("%-5s %10s %10s %10s %10s\n","proto","frames","repeats","errors","stale");
+	for ( int p=0; p<IrProtos; ++p )
+		printf("%-5s %10llu %10llu %10llu %10llu\n",gpio_ir_proto_name(p),
+			(unsigned long long)ir.stats[p].frames,(unsigned long long)ir.stats[p].repeats,
+			(unsigned long long)ir.stats[p].errors,(unsigned long long)ir.stats[p].stale);
+
+	if ( !opt_file ) {
+		long clean[IrProtos] = { 0 }, ok[IrProtos] = { 0 }, missed[IrProtos] = { 0 };
+		long glitched[IrProtos] = { 0 }, survived[IrProtos] = { 0 }, wrong = 0;
+		double lat_sum[IrProtos] = { 0 }, lat_max[IrProtos] = { 0 };
+		long s = 0;
+
+		/*
+		 * Both lists are in time order: match on the frame start
+		 */
+		for ( long x=0; x<ncmds; ++x ) {
+			const gpio_ir_cmd_t *c = &cmds[x];
+			sent_t *m = 0;
+
+			while ( s < nsent && sent[s].start_ns + 2000000ull < c->start_ns )
+				++s;
+			if ( s < nsent && sent[s].start_ns < c->start_ns + 2000000ull )
+				m = &sent[s++];
+			if ( !m || m->proto != c->proto || m->address != c->address || m->command != c->command
+			  || (m->strict && m > sent && m[-1].matched && m->repeat != c->repeat) ) {
+				if ( wrong++ < 5 ) {
+					printf("Wrong: ");
+					print_cmd(c);
+				}
+				continue;
+			}
+			m->matched = true;
+			if ( !m->corrupt ) {
+				double lat = (int64_t)(c->end_ns - m->end_ns) / 1e3;
+
+				++ok[c->proto];
+				lat_sum[c->proto] += lat;
+				if ( ok[c->proto] == 1 || lat > lat_max[c->proto] )
+					lat_max[c->proto] = lat;
+			}
+		}
+		for ( long x=0; x<nsent; ++x ) {
+			if ( sent[x].corrupt ) {
+				++glitched[sent[x].proto];
+				if ( sent[x].matched )
+					++survived[sent[x].proto];
+			} else	{
+				++clean[sent[x].proto];
+				if ( !sent[x].matched )
+					++missed[sent[x].proto];
+			}
+		}
+
+		printf("%-5s %10s %10s %10s %10s %10s %12s %12s\n","proto","clean","decoded","missed",
+			"glitched","survived","latency us","max us");
+		for ( int p=0; p<IrProtos; ++p )
+			printf("%-5s %10ld %10ld %10ld %10ld %10ld %12.1f %12.1f\n",gpio_ir_proto_name(p),
+				clean[p],ok[p],missed[p],glitched[p],survived[p],
+				ok[p] ? lat_sum[p] / ok[p] : 0.0,lat_max[p]);
+		printf("Wrong commands: %ld\n",wrong);
+		if ( wrong )
+			exit(1);
+	}
+
+	free(cmds);
+	free(edges);
+	free(sent);
+	return 0;
+}
+
+// End irbench.c
@@ -0,0 +1,403 @@
+/* matrixbench.c : Key matrix scanner correctness and rate
+ * Warren W. Gay ve3wwg
+ *
+ * ./matrixbench [-n scans] [-t scans] [-b bounce] [-s seed] [-L scans]
+ *
+ * Models an 8x8 matrix of bouncing switches, with or without diodes,
+ * and feeds the column reads it produces to gpio_matrix_sample() and
+ * gpio_matrix_resolve(). Typing with at most two keys down must give
+ * exactly the physical presses and releases; with up to four keys
+ * down, no key may ever be reported down that is not pressed (a
+ * ghost). The same run is repeated with the ghosting check off to
+ * show what it prevents. Scans per second are timed for the scanner
+ * alone, and -L times gpio_matrix_scan() on live pins (root, or
+ * LIBGP_BACKEND=sim), after checking through the register stores that
+ * every row read of every scan has its own row, and only that row, as
+ * an output.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpdelay.h"
+#include "gpmatrix.h"
+
+#define N		8		// Rows and columns of the model
+#define COL0		8		// Model column c is "gpio" COL0 + c
+#define DWELL		24		// Scans between changes of one key
+
+static const int rows[N] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+static const int cols[N] = { 8, 9, 10, 11, 12, 13, 14, 15 };
+
+static int bounce = 3;			// Max scans of bounce per change
+static unsigned threshold = 4;
+
+/*
+ * Physical matrix: phys[r] bit c is switch (r,c) closed
+ */
+typedef struct {
+	uint8_t		phys[N];
+	int		left[N][N];		// Bounce scans left
+	long		since[N][N];		// Scan of the last change
+	long		last_down[N][N];	// Last scan physically down
+} model_t;
+
+typedef struct {
+	long		presses, releases;	// Physical
+	long		ev_presses, ev_releases;	// Reported
+	long		phantoms;		// Reported down, not pressed
+	long		lat_sum, lat_max;	// Press to event, scans
+} result_t;
+
+static volatile uint32_t sink;
+
+/*
+ * Register store watcher: row pins that are outputs after each store
+ */
+static struct {
+	const gpio_matrix_t *m;
+	void		(*store)(uint32_v *reg,uint32_t v);	// Backend's own
+	int		last;			// Row driven last
+	long		drives;			// Rows driven alone, in turn
+	long		order_errs;		// Row driven out of turn
+	long		multi;			// Stores leaving several rows driven
+} watch;
+
+static void
+watch_store(uint32_v *reg,uint32_t v) {
+	const gpio_matrix_t *m = watch.m;
+	int n = 0, row = -1;
+
+	if ( watch.store )
+		watch.store(reg,v);
+	else	*reg = v;
+
+	for ( int r=0; r<m->nrows; ++r ) {
+		IO io;
+
+		if ( !gpio_alt_function(__builtin_ctz(m->rows[r]),&io) && io == Output ) {
+			++n;
+			row = r;
+		}
+	}
+	if ( n > 1 )
+		++watch.multi;
+	else if ( n == 1 && row != watch.last ) {
+		if ( row != (watch.last + 1) % m->nrows )
+			++watch.order_errs;
+		++watch.drives;
+		watch.last = row;
+	}
+}
+
+static long
+scan_watched(gpio_matrix_t *m,long scans) {
+	long bad = 0;
+
+	memset(&watch,0,sizeof watch);
+	watch.m = m;
+	watch.last = m->nrows - 1;
+	watch.store = gpio_store_hook;
+	gpio_store_hook = watch_store;
+
+	for ( long s=0; s<scans; ++s )
+		gpio_matrix_scan(m);
+	gpio_store_hook = watch.store;
+
+	if ( watch.drives != scans * m->nrows ) {
+		printf("%ld rows driven in %ld scans, %ld expected\n",watch.drives,scans,scans * m->nrows);
+		++bad;
+	}
+	if ( watch.order_errs ) {
+		printf("%ld rows driven out of turn\n",watch.order_errs);
+		++bad;
+	}
+	if ( watch.multi ) {
+		printf("%ld stores left several rows driven\n",watch.multi);
+		++bad;
+	}
+	return bad;
+}
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/*
+ * Contacts this scan: closed switches, bouncing ones at random
+ */
+static void
+contacts(model_t *mod,uint8_t *k) {
+
+	for ( int r=0; r<N; ++r ) {
+		k[r] = mod->phys[r];
+		for ( int c=0; c<N; ++c )
+			if ( mod->left[r][c] > 0 ) {
+				--mod->left[r][c];
+				if ( rand() & 1 )
+					k[r] ^= 1u << c;
+			}
+	}
+}
+
+/*
+ * Columns pulled low with row r driven. Without diodes current also
+ * flows backwards through closed switches, joining rows and columns.
+ */
+static uint8_t
+read_row(const uint8_t *k,int r,bool diodes) {
+	uint8_t rset = 1u << r, cset = 0, prev;
+
+	if ( diodes )
+		return k[r];
+	do	{
+		prev = cset;
+		for ( int s=0; s<N; ++s )
+			if ( rset & (1u << s) )
+				cset |= k[s];
+		for ( int s=0; s<N; ++s )
+			if ( k[s] & cset )
+				rset |= 1u << s;
+	} while ( cset != prev );
+	return cset;
+}
+
+static void
+run(result_t *res,long scans,int maxdown,bool diodes,bool check) {
+	gpio_matrix_t m;
+	gpio_matrix_event_t ev;
+	model_t mod;
+	uint8_t k[N];
+	int down = 0;
+
+	memset(res,0,sizeof *res);
+	memset(&mod,0,sizeof mod);
+	for ( int r=0; r<N; ++r )
+		for ( int c=0; c<N; ++c )
+			mod.since[r][c] = mod.last_down[r][c] = -DWELL;
+
+	gpio_matrix_init(&m,rows,N,cols,N);
+	gpio_matrix_debounce(&m,threshold);
+	gpio_matrix_set_diodes(&m,!check);
+
+	for ( long s=0; s<scans; ++s ) {
+		/*
+		 * Change one key now and then, all released at the end:
+		 */
+		if ( s < scans - DWELL * 2 && rand() % 8 == 0 ) {
+			int r = rand() % N, c = rand() % N;
+			bool is_down = !!(mod.phys[r] & (1u << c));
+
+			if ( s - mod.since[r][c] >= DWELL && (is_down || down < maxdown) ) {
+				mod.phys[r] ^= 1u << c;
+				mod.left[r][c] = bounce ? rand() % (bounce + 1) : 0;
+				mod.since[r][c] = s;
+				if ( is_down ) {
+					--down;
+					++res->releases;
+				} else	{
+					++down;
+					++res->presses;
+				}
+			}
+		} else if ( s >= scans - DWELL * 2 ) {
+			for ( int r=0; r<N; ++r )
+				for ( int c=0; c<N; ++c )
+					if ( (mod.phys[r] & (1u << c)) && s - mod.since[r][c] >= DWELL ) {
+						mod.phys[r] &= ~(1u << c);
+						mod.since[r][c] = s;
+						--down;
+						++res->releases;
+					}
+		}
+		for ( int r=0; r<N; ++r )
+			for ( int c=0; c<N; ++c )
+				if ( mod.phys[r] & (1u << c) )
+					mod.last_down[r][c] = s;
+
+		contacts(&mod,k);
+		for ( int r=0; r<N; ++r )
+			gpio_matrix_sample(&m,r,~((uint32_t)read_row(k,r,diodes) << COL0),s);
+		gpio_matrix_resolve(&m);
+
+		while ( gpio_matrix_get(&m,&ev) ) {
+			if ( ev.pressed ) {
+				long lat = s - mod.since[ev.row][ev.col];
+
+				++res->ev_presses;
+				if ( s - mod.last_down[ev.row][ev.col] > (long)threshold + bounce ) {
+					++res->phantoms;
+				} else	{
+					res->lat_sum += lat;
+					if ( lat > res->lat_max )
+						res->lat_max = lat;
+				}
+			} else	++res->ev_releases;
+		}
+	}
+}
+
+static void
+report(const char *what,const result_t *res) {
+	long good = res->ev_presses - res->phantoms;
+
+	printf("%-26s presses %6ld/%-6ld releases %6ld/%-6ld phantoms %5ld latency avg %.2f max %ld scans\n",
+		what,res->ev_presses,res->presses,res->ev_releases,res->releases,res->phantoms,
+		good ? (double)res->lat_sum / good : 0.0,res->lat_max);
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-n scans] [-t scans] [-b bounce] [-s seed] [-L scans] [-h]\n"
+		"where:\n"
+		"\t-n scans\tScans per model run (200000)\n"
+		"\t-t scans\tDebounce threshold (4)\n"
+		"\t-b bounce\tMax scans of bounce per change (3)\n"
+		"\t-s seed\tRandom seed (1)\n"
+		"\t-L scans\tAlso time live gpio_matrix_scan() of 8x8 pins\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hn:t:b:s:L:";
+	static uint32_t raws[4096][N];
+	long opt_scans = 200000, opt_live = 0;
+	unsigned seed = 1;
+	struct timespec t0;
+	result_t res;
+	gpio_matrix_t m;
+	gpio_matrix_event_t ev;
+	double secs;
+	int oc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'n':
+			opt_scans = atol(optarg);
+			break;
+		case 't':
+			threshold = atoi(optarg);
+			if ( threshold < 1 || threshold > GPIO_DEBOUNCE_MAX ) {
+				fprintf(stderr,"Invalid threshold: -t %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'b':
+			bounce = atoi(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg,0,0);
+			break;
+		case 'L':
+			opt_live = atol(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+	if ( bounce < 0 || bounce >= DWELL - (int)threshold ) {
+		fprintf(stderr,"Bounce must be under %d scans\n",DWELL - (int)threshold);
+		exit(1);
+	}
+
+	srand(seed);
+	run(&res,opt_scans,2,false,true);
+	report("Two keys, no diodes",&res);
+	if ( res.phantoms || res.ev_presses != res.presses || res.ev_releases != res.releases ) {
+		printf("FAIL: events differ from the physical presses\n");
+		exit(1);
+	}
+
+	srand(seed);
+	run(&res,opt_scans,4,false,true);
+	report("Four keys, ghosting check",&res);
+	if ( res.phantoms ) {
+		printf("FAIL: ghost keys reported\n");
+		exit(1);
+	}
+
+	srand(seed);
+	run(&res,opt_scans,4,false,false);
+	report("Four keys, no check",&res);
+
+	srand(seed);
+	run(&res,opt_scans,4,true,false);
+	report("Four keys, diodes",&res);
+	if ( res.phantoms || res.ev_presses != res.presses || res.ev_releases != res.releases ) {
+		printf("FAIL: events differ from the physical presses\n");
+		exit(1);
+	}
+
+	/*
+	 * Scanner cost alone, on random column reads:
+	 */
+	for ( int x=0; x<4096; ++x )
+		for ( int r=0; r<N; ++r )
+			raws[x][r] = ~((uint32_t)(rand() % 16 == 0 ? 1u << rand() % N : 0) << COL0);
+
+	gpio_matrix_init(&m,rows,N,cols,N);
+	gpio_matrix_debounce(&m,1);
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long s=0; s<opt_scans * 10; ++s ) {
+		const uint32_t *raw = raws[s & 4095];
+
+		for ( int r=0; r<N; ++r )
+			gpio_matrix_sample(&m,r,raw[r],s);
+		gpio_matrix_resolve(&m);
+		while ( gpio_matrix_get(&m,&ev) )
+			sink += ev.col;
+	}
+	secs = elapsed(&t0);
+	printf("Sample + resolve 8x8: %ld scans %.3f s %.0f scans/s %.1f ns/scan, %llu events\n",
+		opt_scans * 10,secs,opt_scans * 10 / secs,secs * 1e9 / (opt_scans * 10),
+		(unsigned long long)m.stats.events);
+
+	if ( opt_live > 0 ) {
+		static const int lrows[N] = { 4, 5, 6, 12, 13, 16, 17, 18 };
+		static const int lcols[N] = { 20, 21, 22, 23, 24, 25, 26, 27 };
+
+		if ( !gpio_open() ) {
+			fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+			exit(2);
+		}
+		gpio_matrix_init(&m,lrows,N,lcols,N);
+		gpio_matrix_configure(&m,Up);
+		gpio_matrix_set_settle(&m,0);
+		if ( scan_watched(&m,16) ) {
+			printf("FAIL: rows not driven one at a time\n");
+			exit(1);
+		}
+		printf("Live scan 8x8: 16 scans, every row read driving its row alone\n");
+		for ( int settle=0; settle<=2000; settle += 2000 ) {
+			gpio_matrix_set_settle(&m,settle);
+			clock_gettime(CLOCK_MONOTONIC,&t0);
+			for ( long s=0; s<opt_live; ++s )
+				gpio_matrix_scan(&m);
+			secs = elapsed(&t0);
+			printf("Live scan 8x8, settle %4d ns: %ld scans %.3f s %.0f scans/s\n",
+				settle,opt_live,secs,opt_live / secs);
+		}
+		gpio_close();
+	}
+	return 0;
+}
+
+// End matrixbench.c
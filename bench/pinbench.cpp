@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////
+// pinbench.cpp -- Toggles/second: C API vs PinHandle vs Pin<N>
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libgp.hpp"
+
+static constexpr unsigned tpin = 18;	// Pin<> must be a constant
+
+static double
+elapsed(const struct timespec& t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,double secs) {
+	printf("%-24s %12.0f toggles/s %8.2f ns/toggle\n",
+		what,count / secs,secs * 1e9 / count);
+}
+
+int
+main(int argc,char **argv) {
+	long count = argc > 1 ? atol(argv[1]) : 10000000;
+	struct timespec t0;
+
+	if ( count <= 0 ) {
+		fprintf(stderr,"Usage: %s [toggles]  (uses gpio %u)\n",argv[0],tpin);
+		exit(1);
+	}
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	gp::Pin<tpin> pin;
+	gp::PinHandle handle(tpin);
+
+	pin.configure(Output);
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		gpio_write(tpin,x & 1);
+	report("gpio_write()",count,elapsed(t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		handle.write(x & 1);
+	report("PinHandle::write()",count,elapsed(t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		pin.write(x & 1);
+	report("Pin<N>::write()",count,elapsed(t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count/2; ++x ) {
+		pin.set();
+		pin.clear();
+	}
+	report("Pin<N>::set()/clear()",count/2*2,elapsed(t0));
+
+	pin.clear();
+	gpio_close();
+	return 0;
+}
+
+// End pinbench.cpp
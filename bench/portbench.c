@@ -0,0 +1,148 @@
+/* portbench.c : Compare per-pin gpio_write() against port writes
+ * Warren W. Gay ve3wwg
+ *
+ * ./portbench [-p pins] [-n count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <assert.h>
+
+#include "libgp.h"
+
+static int pins[32] = { 4, 5, 6, 7, 8, 9, 10, 11 };
+static int npins = 8;
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,double secs) {
+	double pps = (double)count * npins / secs;
+
+	printf("%-20s %10ld writes %8.3f s %14.0f pins/s %8.2f ns/write\n",
+		what,count,secs,pps,secs * 1e9 / count);
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < 32; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-p pins] [-n count] [-h]\n"
+		"where:\n"
+		"\t-p pins\tComma separated bank 0 gpios (4..11 default)\n"
+		"\t-n count\tNumber of port writes per test (1000000)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hp:n:";
+	long count = 1000000;
+	gpio_group_t grp;
+	struct timespec t0;
+	uint32_t v;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'p':
+			npins = parse_pins(optarg,pins);
+			if ( npins <= 0 ) {
+				fprintf(stderr,"Invalid pins: -p %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'n':
+			count = atol(optarg);
+			if ( count <= 0 ) {
+				fprintf(stderr,"Invalid count: -n %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( gpio_group_init(&grp,pins,npins) ) {
+		fprintf(stderr,"Invalid pin group (bank 0, no duplicates)\n");
+		exit(1);
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	rc = gpio_group_configure_io(&grp,Output);
+	assert(!rc);
+
+	printf("%d pins, %s\n",npins,
+		grp.shift >= 0 ? "contiguous" : "scattered");
+
+	/*
+	 * Baseline: one gpio_write() call per pin:
+	 */
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x ) {
+		v = (uint32_t)x;
+		for ( int p=0; p<npins; ++p, v >>= 1 )
+			gpio_write(pins[p],v & 1);
+	}
+	report("gpio_write loop",count,elapsed(&t0));
+
+	/*
+	 * Port write of precomputed masks:
+	 */
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		gpio_port_put((uint32_t)x << pins[0],grp.mask);
+	report("gpio_port_put",count,elapsed(&t0));
+
+	/*
+	 * Compiled pin group:
+	 */
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		gpio_group_write(&grp,(uint32_t)x);
+	report("gpio_group_write",count,elapsed(&t0));
+
+	gpio_group_write(&grp,0);
+	gpio_close();
+	return 0;
+}
+
+// End portbench.c
@@ -0,0 +1,118 @@
+/* pwmbench.c : Software PWM frequency, duty error and CPU cost
+ * Warren W. Gay ve3wwg
+ *
+ * ./pwmbench [-m mask] [-t tick_ns] [-n ticks] [-s secs]
+ *
+ * Runs the engine with 1, 2, 4 ... channels taken from mask, each at
+ * a different duty, while this thread keeps changing the duties.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpswpwm.h"
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-m mask] [-t tick_ns] [-n ticks] [-s secs] [-h]\n"
+		"where:\n"
+		"\t-m mask\tBank 0 outputs to use (0x0FFF0000)\n"
+		"\t-t ns\tTick (10000)\n"
+		"\t-n ticks\tTicks per period (100)\n"
+		"\t-s secs\tSeconds per channel count (2)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hm:t:n:s:";
+	uint32_t opt_mask = 0x0FFF0000, opt_tick = 10000;
+	unsigned opt_ticks = 100;
+	int opt_secs = 2, pins[32], npins = 0;
+	gpio_swpwm_t *pwm;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'm':
+			opt_mask = strtoul(optarg,0,0);
+			break;
+		case 't':
+			opt_tick = strtoul(optarg,0,0);
+			break;
+		case 'n':
+			opt_ticks = strtoul(optarg,0,0);
+			break;
+		case 's':
+			opt_secs = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	for ( uint32_t m=opt_mask; m; m &= m - 1 )
+		pins[npins++] = __builtin_ctz(m);
+	if ( !npins ) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	printf("Period %u x %u ns\n",opt_ticks,opt_tick);
+
+	for ( int nchan=1; ; nchan = nchan*2 < npins ? nchan*2 : npins ) {
+		time_t t0;
+		unsigned step = 0;
+
+		pwm = gpio_swpwm_open(opt_tick,opt_ticks);
+		if ( !pwm ) {
+			perror("gpio_swpwm_open()");
+			exit(2);
+		}
+		for ( int x=0; x<nchan; ++x )
+			gpio_swpwm_add(pwm,pins[x],(x + 1) * opt_ticks / (nchan + 1));
+
+		if ( (rc = gpio_swpwm_start(pwm)) != 0 ) {
+			fprintf(stderr,"%s: starting engine\n",strerror(rc));
+			exit(2);
+		}
+
+		// Keep updating duties from this thread
+		t0 = time(0);
+		while ( time(0) - t0 < opt_secs ) {
+			++step;
+			for ( int x=0; x<nchan; ++x )
+				gpio_swpwm_set(pwm,pins[x],(x + step) % (opt_ticks + 1));
+			usleep(10000);
+		}
+
+		gpio_swpwm_stop(pwm);
+		gpio_swpwm_report(pwm,stdout);
+		gpio_swpwm_close(pwm);
+
+		if ( nchan == npins )
+			break;
+	}
+
+	gpio_close();
+	return 0;
+}
+
+// End pwmbench.c
@@ -0,0 +1,267 @@
+/* srbench.c : Chained 74HC595 update rates
+ * Warren W. Gay ve3wwg
+ *
+ * ./srbench [-d pins] [-k clock] [-l latch] [-n count]
+ *
+ * First checks gpio_sr_update() against a software model of the
+ * chains fed from the GPSET0/GPCLR0 stores themselves: outputs must
+ * match the image after every update and change only at the latch.
+ * Then reports updates per second for 64 and 256 bit chains, one
+ * chain and all chains in parallel, against per-bit gpio_write().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpsr.h"
+
+static int data[GPIO_SR_CHAINS] = { 17, 27, 22, 23 };
+static int ndata = 4;
+static int clock_pin = 24, latch_pin = 25;
+
+/*
+ * Software 74HC595 chains, driven by the register stores
+ */
+static struct {
+	const gpio_sr_t	*sr;
+	void		(*store)(uint32_v *reg,uint32_t v);	// Backend's own
+	uint32_t	lev;			// Output levels driven
+	uint8_t		shift[GPIO_SR_CHAINS][32];	// Up to 256 bits
+	uint8_t		out[GPIO_SR_CHAINS][32];
+	uint64_t	stores;
+} model;
+
+static void
+model_store(uint32_v *reg,uint32_t v) {
+	uint32_t prev = model.lev;
+	const gpio_sr_t *sr = model.sr;
+
+	if ( model.store )
+		model.store(reg,v);
+	else	*reg = v;
+	++model.stores;
+
+	if ( reg == GPIOREG(GPIO_GPSET0) )
+		model.lev |= v;
+	else if ( reg == GPIOREG(GPIO_GPCLR0) )
+		model.lev &= ~v;
+	else	return;
+
+	if ( (model.lev & ~prev) & sr->clock ) {	// SRCLK rising: shift up one
+		for ( int c=0; c<sr->nchains; ++c ) {
+			uint8_t carry = !!(model.lev & sr->data[c]);
+
+			for ( int k=0; k<sr->nbytes; ++k ) {
+				uint8_t msb = model.shift[c][k] >> 7;
+
+				model.shift[c][k] = model.shift[c][k] << 1 | carry;
+				carry = msb;
+			}
+		}
+	}
+	if ( (model.lev & ~prev) & sr->latch )		// RCLK rising
+		memcpy(model.out,model.shift,sizeof model.out);
+}
+
+static long
+model_check(gpio_sr_t *sr,int rounds) {
+	long bad = 0;
+
+	model.sr = sr;
+	model.store = gpio_store_hook;
+	gpio_store_hook = model_store;
+	model.lev = gpio_read32();
+
+	for ( int r=0; r<rounds; ++r ) {
+		uint64_t stores;
+		bool updated;
+
+		if ( r % 4 == 3 ) {		// Unchanged: must not touch the pins
+			stores = model.stores;
+			updated = gpio_sr_update(sr,false);
+			if ( updated || model.stores != stores )
+				++bad;
+			continue;
+		}
+		if ( r % 4 == 2 ) {		// One bit flipped
+			int c = rand() % sr->nchains, b = rand() % sr->nbits;
+
+			gpio_sr_set(sr,c,b,!gpio_sr_get(sr,c,b));
+		} else	{
+			for ( int c=0; c<sr->nchains; ++c )
+				for ( int k=0; k<sr->nbytes; ++k )
+					gpio_sr_put_byte(sr,c,k,rand());
+		}
+
+		gpio_sr_update(sr,false);
+
+		for ( int c=0; c<sr->nchains; ++c )
+			for ( int b=0; b<sr->nbits; ++b )
+				if ( (model.out[c][b >> 3] >> (b & 7) & 1) != gpio_sr_get(sr,c,b) ) {
+					if ( bad++ < 5 )
+						printf("round %d chain %d bit %d: output %d, image %d\n",r,c,b,
+							model.out[c][b >> 3] >> (b & 7) & 1,gpio_sr_get(sr,c,b));
+				}
+	}
+
+	gpio_store_hook = model.store;
+	return bad;
+}
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,int nbits,int nchains,long count,double secs) {
+
+	printf("%-22s %4d bits x %d %10ld updates %8.3f s %12.0f updates/s %10.0f bits/s\n",
+		what,nbits,nchains,count,secs,count / secs,(double)count * nbits * nchains / secs);
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv,int max) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < max; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-d pins] [-k clock] [-l latch] [-n count] [-h]\n"
+		"where:\n"
+		"\t-d pins\tComma separated SER gpios, one per chain (17,27,22,23)\n"
+		"\t-k clock\tSRCLK gpio (24)\n"
+		"\t-l latch\tRCLK gpio (25)\n"
+		"\t-n count\tUpdates per test (20000)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hd:k:l:n:";
+	static const int sizes[] = { 64, 256 };
+	long count = 20000, bad;
+	struct timespec t0;
+	gpio_sr_t sr;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'd':
+			ndata = parse_pins(optarg,data,GPIO_SR_CHAINS);
+			if ( ndata <= 0 ) {
+				fprintf(stderr,"Invalid pins: -d %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'k':
+			clock_pin = atoi(optarg);
+			break;
+		case 'l':
+			latch_pin = atoi(optarg);
+			break;
+		case 'n':
+			count = atol(optarg);
+			if ( count <= 0 ) {
+				fprintf(stderr,"Invalid count: -n %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	for ( int s=0; s<2; ++s ) {
+		int nbits = sizes[s];
+
+		for ( int nchains=1; nchains<=ndata; nchains = nchains == ndata ? ndata + 1 : ndata ) {
+			rc = gpio_sr_init(&sr,data,nchains,clock_pin,latch_pin,-1,nbits);
+			if ( rc ) {
+				fprintf(stderr,"Invalid chain pins (bank 0, no duplicates)\n");
+				exit(1);
+			}
+			gpio_sr_configure(&sr);
+
+			bad = model_check(&sr,200);
+			printf("Model check, %d bits x %d: %ld bad\n",nbits,nchains,bad);
+			if ( bad )
+				exit(1);
+
+			if ( nchains == 1 ) {
+				/*
+				 * Baseline: a gpio_write() per data and clock edge
+				 */
+				clock_gettime(CLOCK_MONOTONIC,&t0);
+				for ( long x=0; x<count; ++x ) {
+					for ( int b=nbits-1; b>=0; --b ) {
+						gpio_write(clock_pin,0);
+						gpio_write(data[0],(x >> (b & 31)) & 1);
+						gpio_write(clock_pin,1);
+					}
+					gpio_write(latch_pin,1);
+					gpio_write(latch_pin,0);
+				}
+				report("gpio_write per bit",nbits,1,count,elapsed(&t0));
+			}
+
+			clock_gettime(CLOCK_MONOTONIC,&t0);
+			for ( long x=0; x<count; ++x )
+				gpio_sr_update(&sr,true);
+			report("gpio_sr_update forced",nbits,nchains,count,elapsed(&t0));
+
+			clock_gettime(CLOCK_MONOTONIC,&t0);
+			for ( long x=0; x<count; ++x ) {
+				gpio_sr_set(&sr,0,x % nbits,!gpio_sr_get(&sr,0,x % nbits));
+				gpio_sr_update(&sr,false);
+			}
+			report("one bit changed",nbits,nchains,count,elapsed(&t0));
+
+			clock_gettime(CLOCK_MONOTONIC,&t0);
+			for ( long x=0; x<count; ++x )
+				gpio_sr_update(&sr,false);
+			report("unchanged (skipped)",nbits,nchains,count,elapsed(&t0));
+
+			gpio_sr_free(&sr);
+		}
+	}
+
+	gpio_close();
+	return 0;
+}
+
+// End srbench.c
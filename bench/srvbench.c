@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////
+// srvbench.c -- gpsrv client ops/s vs spawning gp per operation
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "gpclient.h"
+
+extern char **environ;
+
+static double
+elapsed(const struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,double secs) {
+	printf("%-24s %12.0f ops/s %10.2f us/op\n",
+		what,count / secs,secs * 1e6 / count);
+}
+
+int
+main(int argc,char **argv) {
+	long count = argc > 1 ? atol(argv[1]) : 100000;
+	long spawns = argc > 2 ? atol(argv[2]) : 100;
+	int gpio = argc > 3 ? atoi(argv[3]) : 18;
+	struct timespec t0;
+	char gbuf[16], vbuf[4];
+	gpc_t *gpc;
+	long x;
+
+	if ( count <= 0 || spawns < 0 ) {
+		fprintf(stderr,"Usage: %s [ops [spawns [gpio]]]  (gpsrv must be running)\n",argv[0]);
+		exit(1);
+	}
+	if ( !(gpc = gpc_open()) ) {
+		fprintf(stderr,"%s: connecting to %s\n",strerror(errno),GPSRV_SHM);
+		exit(2);
+	}
+	if ( gpc_configure_io(gpc,gpio,Output) ) {
+		fprintf(stderr,"gpio %d refused by server\n",gpio);
+		exit(2);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( x=0; x<count; ++x )
+		gpc_write(gpc,gpio,x & 1);
+	report("gpc_write",count,elapsed(&t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( x=0; x<count; ++x )
+		gpc_read32(gpc);
+	report("gpc_read32",count,elapsed(&t0));
+
+	gpc_close(gpc);
+
+	/*
+	 * The alternative for an unprivileged process: run the setuid
+	 * gp command for each operation.
+	 */
+	snprintf(gbuf,sizeof gbuf,"%d",gpio);
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( x=0; x<spawns; ++x ) {
+		char *args[] = { "gp", "-g", gbuf, "-o", vbuf, 0 };
+		pid_t pid;
+		int status;
+
+		snprintf(vbuf,sizeof vbuf,"%ld",x & 1);
+		if ( posix_spawn(&pid,"../gpio/gp",0,0,args,environ) ) {
+			perror("posix_spawn ../gpio/gp");
+			exit(2);
+		}
+		waitpid(pid,&status,0);
+	}
+	if ( spawns > 0 )
+		report("spawn gp -o",spawns,elapsed(&t0));
+
+	return 0;
+}
+
+// End srvbench.c
@@ -0,0 +1,270 @@
+/* stepbench.c : Stepper pulse generator rate and timing error
+ * Warren W. Gay ve3wwg
+ *
+ * ./stepbench [-s gpios] [-d gpios] [-n steps] [-r rate] [-a accel] [-I] [-R prio[:cpu]]
+ *
+ * Plans and runs a move on each axis (the lead axis n steps, the
+ * others n/2, -n/3 ...), synchronized unless -I, watching the
+ * GPSET0/GPCLR0 stores: every axis must make exactly its steps, with
+ * DIR right at every STEP rise, and rises of several axes in one store
+ * must match the combined events planned. Reports the step rate and
+ * timing error, then the same steps done with gpio_write() and
+ * usleep(). Runs on the simulated registers with LIBGP_BACKEND=sim.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpdelay.h"
+#include "gprt.h"
+#include "gpstep.h"
+
+static int step_pins[GPIO_STEP_AXES] = { 17, 27, 22 };
+static int dir_pins[GPIO_STEP_AXES] = { 23, 24, 25 };
+static int naxes = 3;
+
+/*
+ * Register store watcher
+ */
+static struct {
+	const gpio_step_t *st;
+	void		(*store)(uint32_v *reg,uint32_t v);	// Backend's own
+	uint32_t	lev;			// Output levels driven
+	long		rises[GPIO_STEP_AXES];
+	long		dir_errs;		// STEP rising with DIR wrong
+	long		combined;		// Stores raising several STEPs
+} watch;
+
+static void
+watch_store(uint32_v *reg,uint32_t v) {
+	const gpio_step_t *st = watch.st;
+	uint32_t prev = watch.lev, rose;
+	int nrose = 0;
+
+	if ( watch.store )
+		watch.store(reg,v);
+	else	*reg = v;
+
+	if ( reg == GPIOREG(GPIO_GPSET0) )
+		watch.lev |= v;
+	else if ( reg == GPIOREG(GPIO_GPCLR0) )
+		watch.lev &= ~v;
+	else	return;
+
+	rose = watch.lev & ~prev;
+	for ( int a=0; a<st->naxes; ++a ) {
+		const gpio_step_axis_t *ax = &st->axis[a];
+
+		if ( !(rose & ax->step) )
+			continue;
+		++nrose;
+		++watch.rises[a];
+		if ( ax->dir && !!(watch.lev & ax->dir) != (ax->steps > 0) )
+			++watch.dir_errs;
+	}
+	if ( nrose > 1 )
+		++watch.combined;
+}
+
+static long
+run_watched(gpio_step_t *st) {
+	long bad = 0;
+
+	memset(&watch,0,sizeof watch);
+	watch.st = st;
+	watch.store = gpio_store_hook;
+	watch.lev = gpio_read32();
+	gpio_store_hook = watch_store;
+
+	gpio_step_run(st);
+	gpio_store_hook = watch.store;
+
+	for ( int a=0; a<st->naxes; ++a ) {
+		if ( watch.rises[a] != abs(st->axis[a].steps) ) {
+			printf("Axis %d: %ld steps made, %d planned\n",a,watch.rises[a],abs(st->axis[a].steps));
+			++bad;
+		}
+	}
+	if ( watch.dir_errs ) {
+		printf("%ld steps with DIR wrong\n",watch.dir_errs);
+		++bad;
+	}
+	if ( watch.combined != (long)st->report.combined ) {
+		printf("%ld combined stores seen, %llu planned\n",watch.combined,
+			(unsigned long long)st->report.combined);
+		++bad;
+	}
+	return bad;
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv,int max) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < max; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-s gpios] [-d gpios] [-n steps] [-r rate] [-a accel] [-I] [-R prio[:cpu]] [-h]\n"
+		"where:\n"
+		"\t-s gpios\tComma separated STEP gpios, one per axis (17,27,22)\n"
+		"\t-d gpios\tComma separated DIR gpios (23,24,25)\n"
+		"\t-n steps\tSteps of the lead axis (4000)\n"
+		"\t-r rate\tMax steps/s per axis (20000)\n"
+		"\t-a accel\tAcceleration, steps/s/s (200000)\n"
+		"\t-I\tIndependent axes (each its own profile), not synchronized\n"
+		"\t-R p[:c]\tRun at SCHED_FIFO priority p (on cpu c)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hs:d:n:r:a:IR:";
+	gpio_rt_opts_t rt_opts;
+	bool opt_rt = false, opt_sync = true;
+	int32_t opt_steps = 4000, steps[GPIO_STEP_AXES];
+	double opt_rate = 20000.0, opt_accel = 200000.0;
+	uint64_t t0, t1, worst = 0;
+	gpio_step_t st;
+	long bad;
+	int oc, n, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 's':
+			naxes = parse_pins(optarg,step_pins,GPIO_STEP_AXES);
+			if ( naxes <= 0 ) {
+				fprintf(stderr,"Invalid gpios: -s %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'd':
+			if ( parse_pins(optarg,dir_pins,GPIO_STEP_AXES) <= 0 ) {
+				fprintf(stderr,"Invalid gpios: -d %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'n':
+			opt_steps = atoi(optarg);
+			break;
+		case 'r':
+			opt_rate = strtod(optarg,0);
+			break;
+		case 'a':
+			opt_accel = strtod(optarg,0);
+			break;
+		case 'I':
+			opt_sync = false;
+			break;
+		case 'R':
+			if ( gpio_rt_parse(&rt_opts,optarg) ) {
+				fprintf(stderr,"Invalid priority[:cpu]: -R %s\n",optarg);
+				exit(1);
+			}
+			opt_rt = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( gpio_step_init(&st,step_pins,dir_pins,naxes) ) {
+		fprintf(stderr,"Invalid axes (bank 0, no duplicates, at most %d)\n",GPIO_STEP_AXES);
+		exit(1);
+	}
+	for ( int a=0; a<naxes; ++a ) {
+		if ( (rc = gpio_step_limits(&st,a,opt_rate,opt_accel)) != 0 ) {
+			fprintf(stderr,"Invalid rate %g or acceleration %g: %s\n",opt_rate,opt_accel,strerror(rc));
+			exit(1);
+		}
+		steps[a] = a == 0 ? opt_steps : (a & 1 ? 1 : -1) * opt_steps / (a + 1);
+	}
+
+	gpio_delay_init(true);
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+	gpio_step_configure(&st);
+	if ( opt_rt ) {
+		gpio_rt_enter(&rt_opts);
+		gpio_rt_report(stdout);
+	}
+
+	/*
+	 * Out and back again:
+	 */
+	for ( int pass=0; pass<2; ++pass ) {
+		t0 = gpio_delay_now();
+		if ( (rc = gpio_step_plan(&st,steps,opt_sync)) != 0 ) {
+			fprintf(stderr,"Planning failed: %s\n",strerror(rc));
+			exit(1);
+		}
+		t1 = gpio_delay_now();
+		printf("%s move %d: planned %d events in %.3f ms\n",
+			opt_sync ? "Synchronized" : "Independent",pass,st.nev,(t1 - t0) / 1e6);
+
+		bad = run_watched(&st);
+		gpio_step_report(&st,stdout);
+		if ( bad ) {
+			printf("FAIL\n");
+			exit(1);
+		}
+		for ( int a=0; a<naxes; ++a )
+			steps[a] = -steps[a];
+	}
+
+	/*
+	 * Baseline: gpio_write() and usleep() at the same cruise rate
+	 */
+	n = opt_steps < 1000 ? opt_steps : 1000;
+	t0 = t1 = gpio_delay_now();
+	for ( int k=0; k<n; ++k ) {
+		uint64_t now, period;
+
+		gpio_write(step_pins[0],1);
+		usleep(st.pulse_ns / 1000 ? st.pulse_ns / 1000 : 1);
+		gpio_write(step_pins[0],0);
+		usleep((useconds_t)(1e6 / opt_rate));
+		now = gpio_delay_now();
+		period = now - t1;
+		if ( k && period > worst )
+			worst = period;
+		t1 = now;
+	}
+	printf("gpio_write + usleep: %d steps at %.0f steps/s asked: %.0f steps/s, worst period %.1f us (%.1f us asked)\n",
+		n,opt_rate,n * 1e9 / (t1 - t0),worst / 1e3,1e6 / opt_rate);
+
+	if ( opt_rt )
+		gpio_rt_leave();
+	gpio_step_free(&st);
+	gpio_close();
+	return 0;
+}
+
+// End stepbench.c
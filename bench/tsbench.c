@@ -0,0 +1,129 @@
+/* tsbench.c : Cost and resolution of gpio_timestamp() vs clock_gettime()
+ * Warren W. Gay ve3wwg
+ *
+ * ./tsbench [-n count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+
+static inline uint64_t
+now_ns(clockid_t clk) {
+	struct timespec t;
+
+	clock_gettime(clk,&t);
+	return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static void
+report(const char *what,long count,uint64_t ns,uint64_t res_ns) {
+	printf("%-28s %8.2f ns/call  resolution %8llu ns\n",
+		what,(double)ns / count,(unsigned long long)res_ns);
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-n count] [-h]\n"
+		"where:\n"
+		"\t-n count\tCalls timed per method (1000000)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hn:";
+	long count = 1000000;
+	uint64_t t0, res, prev, v;
+	volatile uint64_t sink = 0;
+	int oc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'n':
+			count = atol(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+	if ( !usystimer )
+		printf("System timer not mapped: using the CLOCK_MONOTONIC fallback\n");
+
+	printf("timer rate error: %+d ppm\n",gpio_timestamp_calibrate(100));
+
+	/*
+	 * Cost: back to back calls. Resolution: smallest non-zero step
+	 * seen between consecutive calls.
+	 */
+	res = ~0ull;
+	prev = gpio_timestamp();
+	t0 = now_ns(CLOCK_MONOTONIC);
+	for ( long x=0; x<count; ++x ) {
+		v = gpio_timestamp();
+		if ( (uint32_t)(v - prev) && (uint32_t)(v - prev) * 1000ull < res )
+			res = (uint32_t)(v - prev) * 1000ull;
+		prev = v;
+	}
+	report("gpio_timestamp()",count,now_ns(CLOCK_MONOTONIC) - t0,res);
+
+	res = ~0ull;
+	prev = gpio_timestamp64();
+	t0 = now_ns(CLOCK_MONOTONIC);
+	for ( long x=0; x<count; ++x ) {
+		v = gpio_timestamp64();
+		if ( v != prev && (v - prev) * 1000 < res )
+			res = (v - prev) * 1000;
+		prev = v;
+	}
+	report("gpio_timestamp64()",count,now_ns(CLOCK_MONOTONIC) - t0,res);
+
+	static const struct {
+		clockid_t	clk;
+		const char	*name;
+	} clocks[] = {
+		{ CLOCK_MONOTONIC, "clock_gettime(MONOTONIC)" },
+		{ CLOCK_MONOTONIC_RAW, "clock_gettime(MONOTONIC_RAW)" },
+		{ CLOCK_REALTIME, "clock_gettime(REALTIME)" }
+	};
+
+	for ( unsigned c=0; c<sizeof clocks/sizeof clocks[0]; ++c ) {
+		res = ~0ull;
+		prev = now_ns(clocks[c].clk);
+		t0 = now_ns(CLOCK_MONOTONIC);
+		for ( long x=0; x<count; ++x ) {
+			v = now_ns(clocks[c].clk);
+			if ( v != prev && v - prev < res )
+				res = v - prev;
+			prev = v;
+		}
+		report(clocks[c].name,count,now_ns(CLOCK_MONOTONIC) - t0,res);
+	}
+
+	t0 = now_ns(CLOCK_MONOTONIC);
+	for ( long x=0; x<count; ++x )
+		sink += time(0);
+	report("time(0)",count,now_ns(CLOCK_MONOTONIC) - t0,1000000000ull);
+
+	gpio_close();
+	return 0;
+}
+
+// End tsbench.c
@@ -0,0 +1,240 @@
+/* vportbench.c : Byte rates of scattered-pin virtual ports
+ * Warren W. Gay ve3wwg
+ *
+ * ./vportbench [-p pins] [-n count]
+ *
+ * Compares per-pin gpio_write()/gpio_read() loops and compiled pin
+ * groups against the table driven virtual port, in bytes per second
+ * each way.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <assert.h>
+
+#include "libgp.h"
+#include "gpvport.h"
+
+static int pins[32] = { 4, 17, 27, 22, 23, 24, 25, 5 };
+static int npins = 8;
+
+static volatile uint32_t sink;		// Keeps reads from being optimized out
+
+static double
+elapsed(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *what,long count,int nbytes,double secs) {
+
+	printf("%-22s %10ld ops %8.3f s %14.0f bytes/s %8.2f ns/op\n",
+		what,count,secs,(double)count * nbytes / secs,secs * 1e9 / count);
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < 32; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+/*
+ * Check the tables without hardware: every value must scatter to
+ * masks that gather back to the same value.
+ */
+static long
+self_check(const gpio_vport_t *vp) {
+	uint32_t vmask = npins >= 32 ? ~0u : (1u << npins) - 1;
+	uint32_t set, clr;
+	long bad = 0;
+
+	for ( uint32_t x=0; x<65536; ++x ) {
+		uint32_t v = (x * 2654435761u) & vmask;
+
+		gpio_vport_scatter(vp,v,&set,&clr);
+		if ( (set | clr) != vp->grp.mask || (set & clr)
+		  || gpio_vport_gather(vp,set) != v
+		  || gpio_vport_gather(vp,set | ~vp->grp.mask) != v ) {
+			if ( bad++ < 5 )
+				printf("value %08X: set %08X clr %08X gathers %08X\n",
+					v,set,clr,gpio_vport_gather(vp,set));
+		}
+	}
+	return bad;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-p pins] [-n count] [-h]\n"
+		"where:\n"
+		"\t-p pins\tComma separated bank 0 gpios (4,17,27,22,23,24,25,5 default)\n"
+		"\t-n count\tNumber of port accesses per test (1000000)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hp:n:";
+	long count = 1000000, bad;
+	gpio_vport_t *vp;
+	struct timespec t0;
+	uint8_t *buf = 0;
+	uint32_t v;
+	int oc, rc, nbytes;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'p':
+			npins = parse_pins(optarg,pins);
+			if ( npins <= 0 ) {
+				fprintf(stderr,"Invalid pins: -p %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'n':
+			count = atol(optarg);
+			if ( count <= 0 ) {
+				fprintf(stderr,"Invalid count: -n %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	vp = malloc(sizeof *vp);
+	if ( !vp || gpio_vport_init(vp,pins,npins) ) {
+		fprintf(stderr,"Invalid pin group (bank 0, no duplicates)\n");
+		exit(1);
+	}
+	nbytes = vp->nbytes;
+
+	printf("%d pins, %s, %d GPLEV0 byte lookups, pext %s\n",npins,
+		vp->grp.shift >= 0 ? "contiguous" : vp->ascending ? "ascending" : "scattered",
+		vp->nlev,
+#if defined(__BMI2__)
+		"available"
+#else
+		"not available"
+#endif
+		);
+
+	bad = self_check(vp);
+	printf("Table check: %ld bad\n",bad);
+	if ( bad )
+		exit(1);
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	rc = gpio_vport_configure_io(vp,Output);
+	assert(!rc);
+
+	/*
+	 * Writes:
+	 */
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x ) {
+		v = (uint32_t)x;
+		for ( int p=0; p<npins; ++p, v >>= 1 )
+			gpio_write(pins[p],v & 1);
+	}
+	report("gpio_write loop",count,nbytes,elapsed(&t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		gpio_group_write(&vp->grp,(uint32_t)x);
+	report("gpio_group_write",count,nbytes,elapsed(&t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		gpio_vport_write(vp,(uint32_t)x);
+	report("gpio_vport_write",count,nbytes,elapsed(&t0));
+
+	if ( nbytes == 1 ) {
+		buf = malloc(count);
+		assert(buf);
+		for ( long x=0; x<count; ++x )
+			buf[x] = (uint8_t)(x * 131);
+
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		gpio_vport_write_buf(vp,buf,count);
+		report("gpio_vport_write_buf",count,1,elapsed(&t0));
+
+		/*
+		 * Round trip: outputs read back through GPLEV0
+		 */
+		bad = 0;
+		for ( unsigned x=0; x<256; ++x ) {
+			gpio_vport_write8(vp,x);
+			if ( gpio_vport_read(vp) != x )
+				++bad;
+		}
+		printf("Round trip: %ld of 256 bytes read back wrong\n",bad);
+	}
+
+	/*
+	 * Reads:
+	 */
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x ) {
+		v = 0;
+		for ( int p=0; p<npins; ++p )
+			v |= (uint32_t)gpio_read(pins[p]) << p;
+		sink = v;
+	}
+	report("gpio_read loop",count,nbytes,elapsed(&t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		sink = gpio_group_read(&vp->grp);
+	report("gpio_group_read",count,nbytes,elapsed(&t0));
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	for ( long x=0; x<count; ++x )
+		sink = gpio_vport_read(vp);
+	report("gpio_vport_read",count,nbytes,elapsed(&t0));
+
+	if ( buf ) {
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		gpio_vport_read_buf(vp,buf,count);
+		report("gpio_vport_read_buf",count,1,elapsed(&t0));
+		free(buf);
+	}
+
+	gpio_vport_write(vp,0);
+	gpio_close();
+	free(vp);
+	return 0;
+}
+
+// End vportbench.c
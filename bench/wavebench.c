@@ -0,0 +1,126 @@
+/* wavebench.c : Measure waveform playback timing error
+ * Warren W. Gay ve3wwg
+ *
+ * ./wavebench [-g gpio] [-p period_ns] [-n cycles] [-W leds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpwave.h"
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-g gpio] [-p period_ns] [-n cycles] [-W leds] [-v] [-h]\n"
+		"where:\n"
+		"\t-g gpio\tOutput gpio (18 default)\n"
+		"\t-p ns\tSquare wave period in ns (2000)\n"
+		"\t-n cycles\tSquare wave cycles (1000)\n"
+		"\t-W leds\tInstead, send a WS2812 frame for leds pixels\n"
+		"\t-v\tList the error of every step\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hg:p:n:W:v";
+	int opt_gpio = 18, opt_cycles = 1000, opt_leds = 0;
+	uint32_t opt_period = 2000, mask;
+	bool opt_verbose = false;
+	gpio_wave_report_t rpt;
+	gpio_wave_t *w;
+	int64_t *err;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'g':
+			opt_gpio = atoi(optarg);
+			if ( opt_gpio < 0 || opt_gpio > 31 ) {
+				fprintf(stderr,"Invalid gpio: -g %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'p':
+			opt_period = strtoul(optarg,0,0);
+			break;
+		case 'n':
+			opt_cycles = atoi(optarg);
+			break;
+		case 'W':
+			opt_leds = atoi(optarg);
+			break;
+		case 'v':
+			opt_verbose = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	mask = 1u << opt_gpio;
+	gpio_configure_io(opt_gpio,Output);
+	w = gpio_wave_new(1024);
+
+	if ( opt_leds > 0 ) {
+		uint8_t *grb = malloc(opt_leds * 3);
+
+		for ( int x=0; x<opt_leds*3; ++x )
+			grb[x] = x * 37;		// Any test pattern
+		rc = gpio_wave_add_bits(w,mask,grb,opt_leds*3,400,850,800,450);
+		if ( !rc )
+			rc = gpio_wave_add(w,0,mask,50000);	// Reset/latch
+		free(grb);
+	} else	{
+		rc = 0;
+		for ( int x=0; x<opt_cycles && !rc; ++x ) {
+			rc = gpio_wave_add(w,mask,0,opt_period / 2);
+			if ( !rc )
+				rc = gpio_wave_add(w,0,mask,opt_period - opt_period / 2);
+		}
+	}
+	if ( rc || (rc = gpio_wave_compile(w)) != 0 ) {
+		fprintf(stderr,"%s: building waveform\n",strerror(rc));
+		exit(2);
+	}
+
+	err = malloc(w->nsteps * sizeof *err);
+	rc = gpio_wave_measure(w,err,&rpt);
+	if ( rc ) {
+		fprintf(stderr,"%s: measuring waveform\n",strerror(rc));
+		exit(2);
+	}
+
+	if ( opt_verbose )
+		for ( int x=0; x<w->nsteps; ++x )
+			printf("step %6d  %8u ns  error %+6lld ns\n",
+				x,w->delay_ns[x],(long long)err[x]);
+
+	printf("%d steps, requested %.3f us, measured %.3f us\n",
+		w->nsteps,rpt.request_ns / 1e3,rpt.total_ns / 1e3);
+	printf("step error: mean %+lld ns, max |%lld| ns\n",
+		(long long)rpt.mean_err_ns,(long long)rpt.max_err_ns);
+
+	free(err);
+	gpio_wave_free(w);
+	gpio_close();
+	return 0;
+}
+
+// End wavebench.c
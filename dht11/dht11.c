@@ -18,10 +18,13 @@
 #include <assert.h>
 
 #include "libgp.h"
+#include "gprt.h"
 
 static int gpio_pin = 22;
 
 static volatile bool timeout = false;
+static volatile bool stop = false;
+static gpio_jitter_t *jitter = 0;	// Spin loop periods when -R/-J
 
 static inline void
 set_timer(long usec) {
@@ -54,16 +57,6 @@ ms_diff(struct timespec *t0,struct timespec *t1) {
 	return dms;
 }
 
-static inline long
-ns_diff(struct timespec *t0,struct timespec *t1) {
-	int dsec = (int)(t1->tv_sec - t0->tv_sec);
-	long dns = t1->tv_nsec - t0->tv_nsec;
-
-	assert(dsec >= 0);
-	dns += dsec * 1000000000L;
-	return dns;
-}
-
 static void
 wait_ready(void) {
 	static struct timespec t0 = {0L,0L};
@@ -96,17 +89,23 @@ wait_ms(int ms) {
 static inline int
 wait_change(long *nsec) {
 	int b1;
-	struct timespec t0, t1;
+	uint32_t t0, t1;
 	int b0 = gpio_read(gpio_pin);
 
-	timeofday(&t0);
+	t0 = gpio_timestamp();		// 1 usec system timer
 
-	while ( (b1 = gpio_read(gpio_pin)) == b0 && !timeout )
-		;
-	timeofday(&t1);
+	if ( jitter ) {
+		jitter->last_ns = 0;	// Don't count time between calls
+		do	gpio_jitter_tick(jitter);
+		while ( (b1 = gpio_read(gpio_pin)) == b0 && !timeout );
+	} else	{
+		while ( (b1 = gpio_read(gpio_pin)) == b0 && !timeout )
+			;
+	}
+	t1 = gpio_timestamp();
 
 	if ( !timeout ) {
-		*nsec = ns_diff(&t0,&t1);
+		*nsec = (long)(t1 - t0) * 1000L;
 		return b1;
 	}
 	*nsec = 0;
@@ -146,21 +145,32 @@ sigalrm_handler(int signo) {
 	timeout = true;
 }
 
+static void
+sigint_handler(int signo) {
+	stop = true;
+}
+
 static void
 usage(const char *cmd) {
 	
 	printf(
-		"Usage:\t%s [-g gpio] [-h]\n"
+		"Usage:\t%s [-g gpio] [-R prio[:cpu]] [-J ns] [-h]\n"
 		"where:\n"
 		"\t-g gpio\tSpecify GPIO pin (22 is default)\n"
+		"\t-R p[:c]\tRead at SCHED_FIFO priority p (on cpu c)\n"
+		"\t-J ns\tCount spin loop periods over ns as deadline misses\n"
 		"\t-h\tThis help\n",
 		cmd);	
 }
 
 int
 main(int argc,char **argv) {
-	static char options[] = "hg:";
+	static char options[] = "hg:R:J:";
 	struct sigaction new_action;
+	gpio_rt_opts_t rt_opts;
+	gpio_jitter_t jit;
+	bool opt_rt = false;
+	uint64_t opt_deadline = 0;
 	int reading = 0;
 	long nsec;
 	int oc, b;
@@ -175,6 +185,16 @@ main(int argc,char **argv) {
 				exit(1);
 			}
 			break;
+		case 'R':
+			if ( gpio_rt_parse(&rt_opts,optarg) ) {
+				fprintf(stderr,"Invalid priority[:cpu]: -R %s\n",optarg);
+				exit(1);
+			}
+			opt_rt = true;
+			break;
+		case 'J':
+			opt_deadline = strtoull(optarg,0,0);
+			break;
 		case 'h':
 			usage(argv[0]);
 			exit(0);
@@ -191,10 +211,24 @@ main(int argc,char **argv) {
 
 	gpio_open();
 
+	if ( opt_rt || opt_deadline ) {
+		/*
+		 * Report the spin loop histogram on ^C
+		 */
+		new_action.sa_handler = sigint_handler;
+		sigaction(SIGINT,&new_action,NULL);
+		gpio_jitter_init(&jit,opt_deadline);
+		jitter = &jit;
+	}
+	if ( opt_rt ) {
+		gpio_rt_enter(&rt_opts);
+		gpio_rt_report(stdout);
+	}
+
 	gpio_configure_io(gpio_pin,Output);
 	gpio_write(gpio_pin,1);
 
-	for (;; ++reading) {
+	for (; !stop; ++reading) {
 		wait_ready();
 
 		gpio_write(gpio_pin,1);
@@ -259,6 +293,11 @@ main(int argc,char **argv) {
 		printf("%04d: RH %d%% Temperature %d C\n",reading,rh,temp);
 	}
 
+	if ( opt_rt )
+		gpio_rt_leave();
+	if ( jitter )
+		gpio_jitter_report(jitter,stdout,"Spin loop");
+	gpio_close();
 	return 0;
 }
 
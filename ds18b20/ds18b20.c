@@ -0,0 +1,220 @@
+/* Read DS18x20 thermometers on several 1-Wire buses:
+ * Warren W. Gay ve3wwg
+ *
+ * Each bus is searched once for its devices. Every reading then
+ * starts one conversion on all buses together and reads the
+ * scratchpads back in parallel rounds (gpw1.h), so the whole site
+ * refreshes in about one conversion time. Buses with parasite powered
+ * devices are held high while converting.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gprt.h"
+#include "gpw1.h"
+
+#define MAX_DEVS	256
+
+static int pins[GPIO_W1_BUSES] = { 4 };
+static int npins = 1;
+
+static volatile bool stop = false;
+
+static void
+sigint_handler(int signo) {
+	stop = true;
+}
+
+static double
+elapsed_ms(struct timespec *t0) {
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	return (t1.tv_sec - t0->tv_sec) * 1e3 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < GPIO_W1_BUSES; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-p gpios] [-U] [-n count] [-i secs] [-l] [-R prio[:cpu]] [-h]\n"
+		"where:\n"
+		"\t-p gpios\tComma separated bus gpios, bank 0 (4 is default)\n"
+		"\t-U\tUse the internal pull-ups (short runs only)\n"
+		"\t-n count\tStop after count readings (0: until ^C)\n"
+		"\t-i secs\tSeconds between readings (0)\n"
+		"\t-l\tList the devices found and exit\n"
+		"\t-R p[:c]\tRun at SCHED_FIFO priority p (on cpu c)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hp:Un:i:lR:";
+	static gpio_w1_dev_t devs[MAX_DEVS];
+	static uint8_t pads[MAX_DEVS][9];
+	static int errs[MAX_DEVS];
+	gpio_rt_opts_t rt_opts;
+	bool opt_rt = false, opt_list = false;
+	Pull opt_pull = None;
+	int opt_count = 0, ndevs = 0, rounds = 0;
+	double opt_interval = 0.0;
+	uint32_t all, present, parasite;
+	gpio_w1_t w1;
+	int oc, rc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'p':
+			npins = parse_pins(optarg,pins);
+			if ( npins <= 0 ) {
+				fprintf(stderr,"Invalid gpios: -p %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'U':
+			opt_pull = Up;
+			break;
+		case 'n':
+			opt_count = atoi(optarg);
+			break;
+		case 'i':
+			opt_interval = strtod(optarg,0);
+			break;
+		case 'l':
+			opt_list = true;
+			break;
+		case 'R':
+			if ( gpio_rt_parse(&rt_opts,optarg) ) {
+				fprintf(stderr,"Invalid priority[:cpu]: -R %s\n",optarg);
+				exit(1);
+			}
+			opt_rt = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( gpio_w1_init(&w1,pins,npins) ) {
+		fprintf(stderr,"Invalid buses (bank 0, no duplicates, at most %d)\n",GPIO_W1_BUSES);
+		exit(1);
+	}
+	all = (1u << npins) - 1;
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+	if ( opt_rt ) {
+		gpio_rt_enter(&rt_opts);
+		gpio_rt_report(stdout);
+	}
+	gpio_w1_configure(&w1,opt_pull);
+	usleep(1000);			// Let the pull-ups charge the buses
+
+	/*
+	 * Find the devices of every bus:
+	 */
+	for ( int b=0; b<npins; ++b ) {
+		uint64_t roms[MAX_DEVS];
+		int count, busdevs = 0;
+
+		rc = gpio_w1_search(&w1,b,GPIO_W1_SEARCH_ROM,roms,MAX_DEVS - ndevs,&count);
+		if ( rc )
+			printf("Bus %d (gpio %d): %s after %d devices\n",b,pins[b],strerror(rc),count);
+		for ( int x=0; x<count; ++x ) {
+			devs[ndevs].bus = b;
+			devs[ndevs++].rom = roms[x];
+			printf("Bus %d (gpio %d): %016llX\n",b,pins[b],(unsigned long long)roms[x]);
+			++busdevs;
+		}
+		if ( busdevs > rounds )
+			rounds = busdevs;
+	}
+	printf("%d devices on %d buses, %d read rounds\n",ndevs,npins,rounds);
+
+	parasite = ndevs ? gpio_w1_parasite(&w1,all) : 0;
+	for ( int b=0; b<npins; ++b )
+		if ( parasite & (1u << b) )
+			printf("Bus %d (gpio %d): parasite powered devices\n",b,pins[b]);
+
+	if ( !ndevs || opt_list ) {
+		if ( opt_rt )
+			gpio_rt_leave();
+		gpio_close();
+		return ndevs ? 0 : 1;
+	}
+
+	signal(SIGINT,sigint_handler);
+
+	for ( int reading=0; !stop && (!opt_count || reading < opt_count); ++reading ) {
+		struct timespec t0;
+		double conv_ms;
+
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		if ( (rc = gpio_w1_convert_all(&w1,all,parasite,&present)) != 0 ) {
+			printf("%04d: Fail, no presence on any bus\n",reading);
+			sleep(1);
+			continue;
+		}
+		rc = gpio_w1_wait_converted(&w1,present,parasite,GPIO_W1_CONVERT_MS * 2);
+		conv_ms = elapsed_ms(&t0);
+		if ( rc )
+			printf("%04d: Conversion %s\n",reading,strerror(rc));
+
+		gpio_w1_read_pads(&w1,devs,ndevs,pads,errs);
+
+		for ( int x=0; x<ndevs; ++x ) {
+			if ( errs[x] )
+				printf("%04d: %d:%016llX %s\n",reading,devs[x].bus,
+					(unsigned long long)devs[x].rom,strerror(errs[x]));
+			else	printf("%04d: %d:%016llX %8.3f C\n",reading,devs[x].bus,
+					(unsigned long long)devs[x].rom,gpio_w1_celsius(devs[x].rom,pads[x]));
+		}
+		printf("%04d: %d devices in %.1f ms (conversion %.1f ms)\n",
+			reading,ndevs,elapsed_ms(&t0),conv_ms);
+		fflush(stdout);
+
+		if ( opt_interval > 0.0 )
+			usleep((useconds_t)(opt_interval * 1e6));
+	}
+
+	if ( opt_rt )
+		gpio_rt_leave();
+	gpio_close();
+	return 0;
+}
+
+/* end ds18b20.c */
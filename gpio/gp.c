@@ -13,322 +13,24 @@
 #include <stdbool.h>
 #include <time.h>
 #include <assert.h>
-
-typedef enum IO {   // GPIO Input or Output:
-	Input=0,    // GPIO is to become an input pin
-	Output=1,   // GPIO is to become an output pin
-	Alt0=4,
-	Alt1=5,
-	Alt2=6,
-	Alt3=7,
-	Alt4=3,
-	Alt5=2
-} IO;
-
-typedef enum Pull { // GPIO Input Pullup resistor:
-	None,       // No pull up or down resistor
-	Up,         // Activate pullup resistor
-	Down        // Activate pulldown resistor
-} Pull;
-
-typedef uint32_t volatile uint32_v;
-
-uint32_v *ugpio = 0;
-uint32_v *upads = 0;
-
-#define BCM2708_PERI_BASE    	0x3F000000 	// Assumed for RPi2
-#define GPIO_BASE_OFFSET	0x200000	// 0x7E20_0000
-#define PADS_BASE_OFFSET        0x100000        // 0x7E10_0000
-
-//////////////////////////////////////////////////////////////////////
-// GPIO Macros
-//////////////////////////////////////////////////////////////////////
-
-#define GPIOOFF(o)	(((o)-0x7E000000-GPIO_BASE_OFFSET)/sizeof(uint32_t))
-#define GPIOREG(o)	(ugpio+GPIOOFF(o))
-#define GPIOREG2(o,wo)	(ugpio+GPIOOFF(o)+(wo))
-
-#define GPIO_GPFSEL0	0x7E200000 
-#define GPIO_GPSET0	0x7E20001C
-#define GPIO_GPCLR0	0x7E200028 
-#define GPIO_GPLEV0     0x7E200034 
-
-#define GPIO_GPEDS0 	0x7E200040 
-#define GPIO_GPREN0	0x7E20004C 
-#define GPIO_GPFEN0     0x7E200058 
-#define GPIO_GPHEN0     0x7E200064 
-#define GPIO_GPLEN0     0x7E200070 
-
-#define GPIO_GPAREN0	0x7E20007C 
-#define GPIO_GPAFEN0 	0x7E200088 
-
-#define GPIO_GPPUD	0x7E200094
-#define GPIO_GPUDCLK0	0x7E200098
-#define GPIO_GPUDCLK1	0x7E200098
-
-#define PADSOFF(o)	(((o)-0x7E000000-PADS_BASE_OFFSET)/sizeof(uint32_t))
-#define PADSREG(o,x)	(upads+PADSOFF(o)+x)
-
-#define GPIO_PADS00_27	0x7E10002C
-#define GPIO_PADS28_45	0x7E100030 
-
-//////////////////////////////////////////////////////////////////////
-// Internal helper functions
-//////////////////////////////////////////////////////////////////////
-
-static uint32_v *
-set_gpio10(int gpio,int *shift,uint32_t base) {
-	uint32_t offset = gpio / 10;
-	*shift = gpio % 10 * 3;
-	return GPIOREG2(base,offset);
-}
-
-static uint32_v *
-set_gpio32(int gpio,int *shift,uint32_t base) {
-    uint32_t offset = gpio / 32;
-    *shift = gpio % 32;
-    return GPIOREG2(base,offset);
-}
-
-//////////////////////////////////////////////////////////////////////
-// Configure a GPIO mode
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_configure_io(int gpio,IO io) {
-	int shift;
-	int alt = (int)io & 0x07;
-
-	if ( gpio < 0 )
-		return EINVAL;          // Invalid parameter
-	
-	uint32_v *gpiosel = set_gpio10(gpio,&shift,GPIO_GPFSEL0);
-	*gpiosel = (*gpiosel & ~(7<<shift)) | (alt<<shift);	
-	return 0;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Return currently configured Alternate function for gpio
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_alt_function(int gpio,IO *io) {
-	int shift;
-
-	if ( gpio < 0 )
-		return EINVAL;          // Invalid parameter
-
-	uint32_v *gpiosel = set_gpio10(gpio,&shift,GPIO_GPFSEL0);
-	uint32_t r = (*gpiosel >> shift) & 7;
-
-	*io = (IO)r;
-	return 0;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Return the drive strength of a given gpio pin
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_get_drive_strength(int gpio,bool *slew_limited,bool *hysteresis,int *drive) {
-
-	if ( gpio < 0 || gpio > 53 )
-	        return EINVAL;          // Invalid parameter
-
-	uint32_t padx = gpio / 28;
-	uint32_v *padreg = PADSREG(GPIO_PADS00_27,padx);
-
-	*drive = *padreg & 7;
-	*hysteresis = (*padreg & 0x0008) ? true : false;
-	*slew_limited = (*padreg & 0x0010) ? true : false;
-	return 0;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Set the GPIO drive strength
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_set_drive_strength(int gpio,bool slew_limited,bool hysteresis,int drive) {
-
-	if ( gpio < 0 || gpio > 53 )
-		return EINVAL;          // Invalid parameter
-	
-	uint32_t padx = gpio / 28;
-	uint32_v *padreg = PADSREG(GPIO_PADS00_27,padx);
-	
-	uint32_t config = 0x5A000000;
-	if ( slew_limited )
-		config |= 1 << 4;
-	if ( hysteresis )
-		config |= 1 << 3;
-	config |= drive & 7;
-	
-	*padreg = config;
-	return 0;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Perform small delay
-//////////////////////////////////////////////////////////////////////
-
-void
-gpio_delay() {
-	for ( int i=0; i<150; i++ )
-		asm volatile("nop");
-}
-
-//////////////////////////////////////////////////////////////////////
-// Configure a GPIO pin to have None/Pullup/Pulldown resistor
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_configure_pullup(int gpio,Pull pull) {
-    
-	if ( gpio < 0 || gpio >= 32 )
-		return EINVAL;              // Invalid parameter
-
-	uint32_t mask = 1 << gpio;      // GPIOs 0 to 31 only
-	uint32_t pmask;
-
-	switch ( pull ) {
-	case None :
-		pmask = 0;                  // No pullup/down
-		break;
-	case Up :
-		pmask = 0b10;               // Pullup resistor
-		break;
-	case Down :
-		pmask = 0b01;               // Pulldown resistor
-		break;
-	};
-
-	uint32_v *GPPUD = GPIOREG(GPIO_GPPUD);
-	uint32_v *GPUDCLK0 = GPIOREG(GPIO_GPUDCLK0);
-
-	*GPPUD = pmask;                  // Select pullup setting
-	gpio_delay();
-	*GPUDCLK0 = mask;                // Set the GPIO of interest
-	gpio_delay();
-	*GPPUD = 0;                      // Reset pmask
-	gpio_delay();
-	*GPUDCLK0 = 0;                   // Set the GPIO of interest
-	gpio_delay();
-
-	return 0;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Read a GPIO port (single bit)
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_read(int gpio) {
-    int shift;
-    
-    if ( gpio < 0 || gpio > 31 )
-        return EINVAL;
-
-    uint32_v *gpiolev = set_gpio32(gpio,&shift,GPIO_GPLEV0);
-
-    return !!(*gpiolev & (1<<shift));
-}
-
-//////////////////////////////////////////////////////////////////////
-// Write a GPIO bit
-//////////////////////////////////////////////////////////////////////
-
-int
-gpio_write(int gpio,int bit) {
-	int shift;
-    
-	if ( gpio < 0 || gpio > 31 )
-		return EINVAL;
-
-	if ( bit ) {
-		uint32_v *gpiop = set_gpio32(gpio,&shift,GPIO_GPSET0);
-	        *gpiop = 1u << shift;
-	} else	{
-		uint32_v *gpiop = set_gpio32(gpio,&shift,GPIO_GPCLR0);
-		*gpiop = 1u << shift;
-	}
-	return 0;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Read/Write all GPIO bits at once
-//////////////////////////////////////////////////////////////////////
-
-uint32_t
-gpio_read32() {
-	uint32_v *gpiolev = GPIOREG(GPIO_GPLEV0);
-
-	return *gpiolev;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Map memory for peripheral register access
-//////////////////////////////////////////////////////////////////////
-
-void *
-mailbox_map(off_t offset,size_t bytes) {
-	int fd;
-
-	fd = open("/dev/mem",O_RDWR|O_SYNC);
-	if ( fd < 0 )
-		return 0;		// Failed (see errno)
-	
-	void *map = (char *) mmap(
-		NULL,               	// Any address
-		bytes,              	// # of bytes
-		PROT_READ|PROT_WRITE,
-		MAP_SHARED,         	// Shared
-		fd,                 	// /dev/mem
-		offset
-	);
-	
-	if ( (long)map == -1L ) {
-		int er = errno;		// Save errno
-		close(fd);
-		errno = er;		// Restore errno
-		return 0;
-	}
-	
-	close(fd);
-	return map;
-}
-
-//////////////////////////////////////////////////////////////////////
-// Unmap memory
-//////////////////////////////////////////////////////////////////////
-
-int
-mailbox_unmap(uint32_v *addr,size_t bytes) {
-	return munmap((caddr_t)addr,bytes);
-}
-
-//////////////////////////////////////////////////////////////////////
-// Determine peripheral base address
-//////////////////////////////////////////////////////////////////////
-
-uint32_t
-peripheral_base() {
-	static uint32_t pbase = 0;
-	int fd, rc;
-	unsigned char buf[8];
-	
-	fd = open("/proc/device-tree/soc/ranges",O_RDONLY);
-	if ( fd >= 0 ) {
-		rc = read(fd,buf,sizeof buf);
-		assert(rc==sizeof buf);
-		close(fd);
-		pbase = buf[4] << 24 | buf[5] << 16 | buf[6] << 8 | buf[7] << 0;
-	} else	{
-		// Punt: Assume RPi2
-		pbase = BCM2708_PERI_BASE;
-	}
-	
-	return pbase;
+#include <signal.h>
+
+#include "libgp.h"
+#include "gpcap.h"
+#include "gpmon.h"
+#include "gpdelay.h"
+#include "gprt.h"
+#include "gpswpwm.h"
+#include "gppwm.h"
+#include "gpbatch.h"
+#include "gpuser.h"
+
+/*
+ * ^C ends a capture, keeping what was sampled:
+ */
+static void
+cap_sigint(int signo) {
+	gpcap_stop = 1;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -339,16 +41,24 @@ static void
 usage(const char *cmd) {
 
 	printf("Usage: %s -g gpio { input_opts | output_opts | -a | drive_opts} [-v]\n"
+		"       %s [-g gpio] -L file [capture_opts] [-v]\n"
+		"       %s -f profile [-v]\n"
+		"       %s [-g gpio] -M file [-m mask] [-l n] [-R p[:c]]\n"
+		"       %s -X file | -Y file\n"
+		"       %s -B file [-Z] [-v]\n"
 		"where:\n"
 		"\t-g gpio\tGPIO number to operate on\n"
 		"\t-A n\tSet alternate function n\n"
 		"\t-a\tQuery alt function\n"
 		"\t-q\tQuery drive, slew and hysteresis\n"
 		"\t-v\tVerbose messages\n"
+		"\t-f file\tApply a board profile (lines: gpio mode pull drive=n ...)\n"
 		"\n"
 		"Input options:\n"
 		"\t-i n\tSelects input mode, reading for n seconds\n"
 		"\t-I\tInput mode, but performing one read only\n"
+		"\t-R p[:c]\tRun -i or -M at SCHED_FIFO priority p (on cpu c)\n"
+		"\t-J ns\tCount -i loop periods over ns as deadline misses\n"
 		"\t-u\tSelects pull-up resistor\n"
 		"\t-d\tSelects pull-down resistor\n"
 		"\t-n\tSelects no pull-up/down resistor\n"
@@ -356,12 +66,114 @@ usage(const char *cmd) {
 		"Output options:\n"
 		"\t-o n\tWrite 0 or 1 to gpio output\n"
 		"\t-b n\tBlink for n seconds\n"
+		"\t-p pct\tWith -b, software PWM at pct%% duty instead\n"
+		"\t-F hz\tSoftware or hardware PWM frequency (1000)\n"
+		"\n"
+		"Hardware options (run on after gp exits):\n"
+		"\t-C hz\tSquare wave from GPCLKn on gpio 4-6, 20, 21 ...\n"
+		"\t\t(ERANGE below about 4.7 kHz, 13.2 kHz on the Pi 4)\n"
+		"\t-w pct\tPWM at pct%% duty on gpio 12, 13, 18, 19 ... (-F hz)\n"
+		"\t-K\tStop the hardware clock or PWM on gpio\n"
 		"\n"
 		"Drive Options:\n"
 		"\t-D n\tSet drive level to 0-7\n"
 		"\t-S\tEnable slew rate limiting\n"
 		"\t-H\tEnable hysteresis\n"
-		,cmd);
+		"\n"
+		"Capture (logic analyzer) options:\n"
+		"\t-L file\tCapture run-length encoded samples to file\n"
+		"\t-m mask\tGPIO mask to capture (-g gpio, else 0x0FFFFFFF)\n"
+		"\t-l n\tCapture for n seconds after trigger, wait at most n for it (10)\n"
+		"\t-T m=v\tTrigger when (levels & m) == v\n"
+		"\t-P n\tKeep n samples from before the trigger\n"
+		"\t-X file\tWrite capture file as VCD to stdout\n"
+		"\n"
+		"Change monitor options:\n"
+		"\t-M file\tWrite timestamped pin changes to file (binary)\n"
+		"\t-m mask\tGPIO mask to monitor (-g gpio, else 0x0FFFFFFF)\n"
+		"\t-l n\tMonitor for n seconds (10)\n"
+		"\t-Y file\tList monitor file as text to stdout\n"
+		"\n"
+		"Batch options:\n"
+		"\t-B file\tExecute commands from file, FIFO or - (stdin), one per line:\n"
+		"\t\tconfig g mode [pull], pull g pull, read g, read32, write g v,\n"
+		"\t\tport set clear, wait g v [us], sleep us, query g, stats, quit\n"
+		"\t-Z\tBinary gpsrv_cmd_t commands and gpsrv_rsp_t responses\n"
+		,cmd,cmd,cmd,cmd,cmd,cmd);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Load a board profile into a configuration transaction. Each line
+// names a gpio followed by any of: in out alt0-alt5 up down none
+// drive=n slew hyst. '#' starts a comment. Returns the number of
+// pins configured, or -1 after reporting an error.
+//////////////////////////////////////////////////////////////////////
+
+static int
+load_profile(const char *path,gpio_config_t *cfg) {
+	static const struct {
+		const char	*name;
+		IO		io;
+	} modes[] = {
+		{ "in", Input }, { "out", Output }, { "alt0", Alt0 }, { "alt1", Alt1 },
+		{ "alt2", Alt2 }, { "alt3", Alt3 }, { "alt4", Alt4 }, { "alt5", Alt5 }
+	};
+	FILE *f = gp_user_fopen(path,"r");
+	char line[256], *cp, *tok;
+	int lno = 0, npins = 0;
+
+	if ( !f ) {
+		fprintf(stderr,"%s: opening profile %s\n",strerror(errno),path);
+		return -1;
+	}
+
+	gpio_config_begin(cfg);
+
+	while ( fgets(line,sizeof line,f) ) {
+		int gpio, drive = -1;
+		bool slew = false, hyst = false;
+
+		++lno;
+		if ( (cp = strchr(line,'#')) != 0 )
+			*cp = 0;
+		if ( !(tok = strtok(line," \t\r\n")) )
+			continue;		// Blank line
+
+		gpio = strtol(tok,&cp,10);
+		if ( *cp || gpio < 0 || gpio > 53 )
+			goto bad;
+
+		while ( (tok = strtok(0," \t\r\n")) != 0 ) {
+			unsigned x;
+
+			for ( x=0; x<sizeof modes/sizeof modes[0]; ++x )
+				if ( !strcmp(tok,modes[x].name) )
+					break;
+			if ( x < sizeof modes/sizeof modes[0] )
+				gpio_config_io(cfg,gpio,modes[x].io);
+			else if ( !strcmp(tok,"up") )
+				gpio_config_pull(cfg,gpio,Up);
+			else if ( !strcmp(tok,"down") )
+				gpio_config_pull(cfg,gpio,Down);
+			else if ( !strcmp(tok,"none") )
+				gpio_config_pull(cfg,gpio,None);
+			else if ( !strcmp(tok,"slew") )
+				slew = true;
+			else if ( !strcmp(tok,"hyst") )
+				hyst = true;
+			else if ( sscanf(tok,"drive=%d",&drive) != 1 || drive < 0 || drive > 7 )
+				goto bad;
+		}
+		if ( drive >= 0 )
+			gpio_config_drive(cfg,gpio,slew,hyst,drive);
+		++npins;
+	}
+	fclose(f);
+	return npins;
+
+bad:	fprintf(stderr,"%s:%d: invalid profile entry\n",path,lno);
+	fclose(f);
+	return -1;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -370,18 +182,30 @@ usage(const char *cmd) {
 
 int
 main(int argc,char **argv) {
-	static char options[] = "hg:i:Iudnvo:aA:D:H:S:qb:";
+	static char options[] = "hg:i:Iudnvo:aA:D:H:S:qb:L:m:l:T:P:X:f:R:J:M:Y:p:F:C:w:KB:Z";
 	bool opt_verbose = false;
 	int opt_gpio = -1;
 	int opt_input = -1;
 	int opt_output = -1;
 	int opt_blink = -1;
+	int opt_pwm = -1;
+	double opt_freq = 1000.0;
+	double opt_clock = -1.0, opt_hwpwm = -1.0;
+	bool opt_hwstop = false;
 	bool opt_altq = false;
 	int opt_alt = -1;
 	int opt_Drive = -1;
 	int opt_Hysteresis = -1, opt_Slew = -1;
 	bool opt_query = false;
 	Pull opt_pull = Up;
+	const char *opt_capture = 0, *opt_export = 0, *opt_profile = 0;
+	const char *opt_monitor = 0, *opt_dump = 0;
+	const char *opt_batch = 0;
+	bool opt_binary = false;
+	gpcap_opts_t cap_opts = { 0, 0, 0, 0, 10 };
+	gpio_rt_opts_t rt_opts;
+	bool opt_rt = false;
+	uint64_t opt_deadline = 0;
 	int oc, rc;
 
 	while ( (oc = getopt(argc,argv,options)) != -1 ) {
@@ -408,6 +232,37 @@ main(int argc,char **argv) {
 		case 'b':
 			opt_blink = atoi(optarg);
 			break;
+		case 'p':
+			opt_pwm = atoi(optarg);
+			if ( opt_pwm < 0 || opt_pwm > 100 ) {
+				fprintf(stderr,"Must be 0-100: -p %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'C':
+			opt_clock = strtod(optarg,0);
+			if ( opt_clock <= 0.0 ) {
+				fprintf(stderr,"Invalid frequency: -C %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'w':
+			opt_hwpwm = strtod(optarg,0);
+			if ( opt_hwpwm < 0.0 || opt_hwpwm > 100.0 ) {
+				fprintf(stderr,"Must be 0-100: -w %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'K':
+			opt_hwstop = true;
+			break;
+		case 'F':
+			opt_freq = strtod(optarg,0);
+			if ( opt_freq <= 0.0 ) {
+				fprintf(stderr,"Invalid frequency: -F %s\n",optarg);
+				exit(1);
+			}
+			break;
 		case 'u':
 			opt_pull = Up;
 			break;
@@ -446,6 +301,52 @@ main(int argc,char **argv) {
 		case 'v':
 			opt_verbose = true;
 			break;
+		case 'L':
+			opt_capture = optarg;
+			break;
+		case 'm':
+			cap_opts.mask = strtoul(optarg,0,0);
+			break;
+		case 'l':
+			cap_opts.seconds = atoi(optarg);
+			break;
+		case 'T':
+			if ( sscanf(optarg,"%i=%i",&cap_opts.trig_mask,&cap_opts.trig_value) != 2 ) {
+				fprintf(stderr,"Invalid trigger: -T %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'P':
+			cap_opts.pretrigger = strtoul(optarg,0,0);
+			break;
+		case 'X':
+			opt_export = optarg;
+			break;
+		case 'f':
+			opt_profile = optarg;
+			break;
+		case 'R':
+			if ( gpio_rt_parse(&rt_opts,optarg) ) {
+				fprintf(stderr,"Invalid priority[:cpu]: -R %s\n",optarg);
+				exit(1);
+			}
+			opt_rt = true;
+			break;
+		case 'J':
+			opt_deadline = strtoull(optarg,0,0);
+			break;
+		case 'M':
+			opt_monitor = optarg;
+			break;
+		case 'Y':
+			opt_dump = optarg;
+			break;
+		case 'B':
+			opt_batch = optarg;
+			break;
+		case 'Z':
+			opt_binary = true;
+			break;
 		case 'h':
 			usage(argv[0]);
 			exit(0);
@@ -455,38 +356,155 @@ main(int argc,char **argv) {
 		}		
 	}
 
-	if ( opt_gpio < 0 ) {
-		usage(argv[0]);
-		exit(1);
+	if ( opt_export ) {
+		rc = gpcap_export_vcd(opt_export,stdout);
+		if ( rc ) {
+			fprintf(stderr,"%s: exporting %s\n",strerror(rc),opt_export);
+			exit(2);
+		}
+		exit(0);
 	}
 
-	uint32_t peri_base = peripheral_base();
-	uint32_t page_size = sysconf(_SC_PAGESIZE);
+	if ( opt_dump ) {
+		rc = gpmon_dump(opt_dump,stdout);
+		if ( rc ) {
+			fprintf(stderr,"%s: listing %s\n",strerror(rc),opt_dump);
+			exit(2);
+		}
+		exit(0);
+	}
 
-        ugpio = (uint32_v *)mailbox_map(peri_base+GPIO_BASE_OFFSET,page_size);
-	upads = (uint32_v *)mailbox_map(peri_base+PADS_BASE_OFFSET,page_size);
+	if ( opt_gpio < 0 && !opt_capture && !opt_profile && !opt_monitor && !opt_batch ) {
+		usage(argv[0]);
+		exit(1);
+	}
 
-	if ( !ugpio ) {
+	if ( !gpio_open() ) {
 		fprintf(stderr,
 			"Failed to mmap peripherals: Need root?\n");
 		exit(2);
 	}
 
-	if ( opt_verbose )
-		printf("gpio_peri_base = %08X\n",peri_base);
+	if ( opt_batch ) {
+		gpbatch_stats_t bst;
+
+		rc = gpbatch_run(opt_batch,opt_binary,&bst);
+		if ( opt_verbose )
+			fprintf(stderr,"Batch: %llu ops, %llu errors in %.3f s (%.0f ops/s)\n",
+				(unsigned long long)bst.ops,(unsigned long long)bst.errors,bst.ns / 1e9,
+				bst.ns ? bst.ops * 1e9 / bst.ns : 0.0);
+		gpio_close();
+		if ( rc ) {
+			fprintf(stderr,"%s: batch input %s\n",strerror(rc),opt_batch);
+			exit(2);
+		}
+		exit(0);
+	}
+
+	if ( opt_verbose ) {
+		printf("gpio_peri_base = %08X\n",gpio_peri_base());
+		gpio_delay_report(stdout);
+	}
+
+	if ( opt_profile ) {
+		gpio_config_t cfg;
+		int npins = load_profile(opt_profile,&cfg);
+
+		if ( npins < 0 )
+			exit(1);
+		gpio_config_commit(&cfg);
+		if ( opt_verbose )
+			printf("Profile %s: %d pins configured\n",opt_profile,npins);
+	}
+
+	if ( opt_capture ) {
+		gpcap_hdr_t hdr;
+
+		if ( !cap_opts.mask )
+			cap_opts.mask = opt_gpio >= 0 ? 1u << opt_gpio : 0x0FFFFFFF;
+
+		signal(SIGINT,cap_sigint);
+		rc = gpcap_capture(opt_capture,&cap_opts,&hdr);
+		signal(SIGINT,SIG_DFL);
+		if ( rc ) {
+			fprintf(stderr,"%s: capturing to %s\n",strerror(rc),opt_capture);
+			exit(2);
+		}
+
+		double secs = hdr.duration_ns / 1e9;
+
+		printf("Captured %llu samples in %.3f s (%.0f samples/s), %llu runs\n",
+			(unsigned long long)hdr.samples,secs,
+			secs > 0.0 ? hdr.samples / secs : 0.0,
+			(unsigned long long)hdr.nruns);
+		printf("Sampling gaps: %llu, longest %.3f us\n",
+			(unsigned long long)hdr.gaps,hdr.max_gap_ns / 1e3);
+		if ( hdr.triggered )
+			printf("Triggered at %.6f s\n",hdr.trigger_ns / 1e9);
+		else if ( cap_opts.trig_mask )
+			printf("Not triggered (%s)\n",gpcap_stop ? "interrupted" : "timed out");
+	}
+
+	if ( opt_monitor ) {
+		gpmon_opts_t mon_opts = { cap_opts.mask, cap_opts.seconds, 0 };
+		gpmon_hdr_t hdr;
+
+		if ( !mon_opts.mask )
+			mon_opts.mask = opt_gpio >= 0 ? 1u << opt_gpio : 0x0FFFFFFF;
+
+		if ( opt_rt ) {
+			gpio_rt_enter(&rt_opts);
+			gpio_rt_report(stdout);
+		}
+		rc = gpmon_monitor(opt_monitor,&mon_opts,&hdr);
+		if ( opt_rt )
+			gpio_rt_leave();
+		if ( rc ) {
+			fprintf(stderr,"%s: monitoring to %s\n",strerror(rc),opt_monitor);
+			exit(2);
+		}
+
+		double secs = hdr.duration_us / 1e6;
+
+		printf("Monitored %llu samples in %.3f s (%.0f samples/s), %llu changes\n",
+			(unsigned long long)hdr.samples,secs,
+			secs > 0.0 ? hdr.samples / secs : 0.0,
+			(unsigned long long)hdr.nrecs);
+		printf("Longest gap between samples: %.3f us\n",
+			hdr.max_gap_ns / 1e3);
+		if ( hdr.dropped )
+			printf("Dropped %llu changes (writer fell behind)\n",
+				(unsigned long long)hdr.dropped);
+	}
 
 	if ( opt_input >= 0 ) {
 		gpio_configure_io(opt_gpio,Input);
 		gpio_configure_pullup(opt_gpio,opt_pull);
 	
-		time_t t0 = time(0);
+		uint64_t t0, usecs = (uint64_t)opt_input * 1000000;
 		int gbit = 2, nbit;
+		bool profile = opt_rt || opt_verbose || opt_deadline;
+		gpio_jitter_t jit;
+
+		if ( opt_rt ) {
+			gpio_rt_enter(&rt_opts);
+			gpio_rt_report(stdout);
+		}
+		gpio_jitter_init(&jit,opt_deadline);
 
+		t0 = gpio_timestamp64();
 		do	{
+			if ( profile )
+				gpio_jitter_tick(&jit);
 			nbit = gpio_read(opt_gpio);
 			if ( nbit != gbit )
 				printf("GPIO = %d\n",gbit = nbit);
-		} while ( time(0) - t0 < opt_input );
+		} while ( gpio_timestamp64() - t0 < usecs );
+
+		if ( opt_rt )
+			gpio_rt_leave();
+		if ( profile )
+			gpio_jitter_report(&jit,stdout,"Input loop");
 	}
 
 	if ( opt_output >= 0 ) {
@@ -496,7 +514,27 @@ main(int argc,char **argv) {
 			printf("Wrote %d to gpio %d\n",opt_output,opt_gpio);
 	}
 
-	if ( opt_blink > 0 ) {
+	if ( opt_blink > 0 && opt_pwm >= 0 ) {
+		// 100 ticks per period: duty in percent
+		gpio_swpwm_t *pwm;
+
+		if ( opt_freq > 10000.0 ) {
+			fprintf(stderr,"Software PWM is limited to 10000 Hz: -F %g\n",opt_freq);
+			exit(1);
+		}
+		pwm = gpio_swpwm_open(1e7 / opt_freq,100);
+
+		if ( !pwm || (rc = gpio_swpwm_add(pwm,opt_gpio,opt_pwm)) != 0
+		  || (rc = gpio_swpwm_start(pwm)) != 0 ) {
+			fprintf(stderr,"%s: starting software PWM\n",strerror(pwm ? rc : errno));
+			exit(2);
+		}
+		sleep(opt_blink);
+		gpio_swpwm_stop(pwm);
+		if ( opt_verbose )
+			gpio_swpwm_report(pwm,stdout);
+		gpio_swpwm_close(pwm);
+	} else if ( opt_blink > 0 ) {
 		time_t t0 = time(0);
 		int v = opt_output & 1;
 
@@ -512,6 +550,28 @@ main(int argc,char **argv) {
 		} while ( time(0) - t0 < opt_blink );
 	}
 
+	if ( opt_clock > 0.0 || opt_hwpwm >= 0.0 || opt_hwstop ) {
+		double actual = 0.0;
+
+		if ( opt_hwstop ) {
+			rc = gpio_clock_stop(opt_gpio);
+			if ( rc == EINVAL )
+				rc = gpio_pwm_stop(opt_gpio);
+		} else if ( opt_clock > 0.0 )
+			rc = gpio_clock_start(opt_gpio,opt_clock,false,&actual);
+		else	rc = gpio_pwm_start(opt_gpio,opt_freq,opt_hwpwm / 100.0,&actual);
+
+		if ( rc ) {
+			fprintf(stderr,"%s: hardware %s on gpio %d\n",strerror(rc),
+				opt_clock > 0.0 ? "clock" : "PWM",opt_gpio);
+			exit(2);
+		}
+		if ( opt_clock > 0.0 )
+			printf("GPCLK on gpio %d: %.3f Hz\n",opt_gpio,actual);
+		else if ( opt_hwpwm >= 0.0 )
+			printf("PWM on gpio %d: %.3f Hz, %.1f%% duty\n",opt_gpio,actual,opt_hwpwm);
+	}
+
 	if ( opt_alt >= 0 ) {
 		static IO alts[] = { Alt0, Alt1, Alt2, Alt3, Alt4, Alt5 };
 		IO io = alts[opt_alt];
@@ -586,8 +646,7 @@ main(int argc,char **argv) {
 	}
 
 	/* Unmap memory */
-	mailbox_unmap(ugpio,page_size);
-	mailbox_unmap(upads,page_size);
+	gpio_close();
 
 	return 0;
 }
@@ -0,0 +1,375 @@
+/* Batch command interpreter gpbatch.c
+ * Warren W. Gay ve3wwg
+ *
+ * gp -B executes a stream of commands against the one mapping made by
+ * gpio_open(), instead of paying for a process, the device tree read
+ * and two /dev/mem mappings per operation. Input is read in large
+ * chunks and every complete command in a chunk is executed before the
+ * responses are flushed, so a pipelined client gets whole batches back
+ * while an interactive one still sees each answer before gp blocks.
+ *
+ * Text commands (one per line, '#' starts a comment):
+ *
+ *	config gpio in|out|alt0-alt5 [up|down|none]	-> ok
+ *	pull gpio up|down|none				-> ok
+ *	read gpio					-> 0 or 1
+ *	read32						-> 0xXXXXXXXX
+ *	write gpio 0|1					-> ok
+ *	port set_mask clear_mask			-> ok
+ *	wait gpio 0|1 [timeout_us]			-> ok us_waited
+ *	sleep us					-> ok
+ *	query gpio					-> mode m level n drive n slew n hyst n
+ *	stats						-> ops n errors n secs s
+ *	quit
+ *
+ * Failures answer "err errno text". In binary mode the records are
+ * those of gpsrv.h: gpsrv_cmd_t in, gpsrv_rsp_t out.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "libgp.h"
+#include "gpsrv.h"
+#include "gpdelay.h"
+#include "gpbatch.h"
+#include "gpuser.h"
+
+#define BATCH_BUFSZ	65536
+#define WAIT_SPIN_NS	1000000		// Spin this long before polling with sleeps
+
+static const char *io_names[8] = {	// Indexed by IO (GPFSEL value)
+	"in", "out", "alt5", "alt4", "alt0", "alt1", "alt2", "alt3"
+};
+
+static gpbatch_stats_t *st;
+static uint64_t t_first;
+static bool quit;
+
+//////////////////////////////////////////////////////////////////////
+// Execute one command (text commands are translated first)
+//////////////////////////////////////////////////////////////////////
+
+static int
+op_wait(const gpsrv_cmd_t *cmd,uint32_t *value) {
+	uint64_t t0 = gpio_delay_now(), t = t0;
+	int want = !!cmd->a;
+
+	fflush(stdout);			// Answer earlier commands first
+	while ( gpio_read(cmd->gpio) != want ) {
+		t = gpio_delay_now();
+		if ( cmd->b && t - t0 >= (uint64_t)cmd->b * 1000 )
+			return ETIMEDOUT;
+		if ( t - t0 > WAIT_SPIN_NS )
+			usleep(100);
+	}
+	*value = (t - t0) / 1000;
+	return 0;
+}
+
+static int
+execute(const gpsrv_cmd_t *cmd,uint32_t *value) {
+	bool pin_ok = cmd->gpio >= 0 && cmd->gpio < 32;
+	bool slew, hyst;
+	int drive, rc;
+	IO io;
+
+	*value = 0;
+	switch ( cmd->op ) {
+	case GpsrvRead :
+		if ( !pin_ok )
+			return EINVAL;
+		*value = gpio_read(cmd->gpio);
+		return 0;
+	case GpsrvWrite :
+		return pin_ok ? gpio_write(cmd->gpio,!!cmd->a) : EINVAL;
+	case GpsrvRead32 :
+		*value = gpio_read32();
+		return 0;
+	case GpsrvPort :
+		return gpio_port_write(cmd->a,cmd->b);
+	case GpsrvConfig :
+		if ( cmd->gpio < 0 || cmd->gpio > 53 || cmd->a > 7 )
+			return EINVAL;
+		return gpio_configure_io(cmd->gpio,(IO)cmd->a);
+	case GpsrvPull :
+		if ( cmd->gpio < 0 || cmd->gpio > 53 || cmd->a > Down )
+			return EINVAL;
+		return gpio_configure_pullup(cmd->gpio,(Pull)cmd->a);
+	case GpsrvWait :
+		return pin_ok ? op_wait(cmd,value) : EINVAL;
+	case GpsrvSleep :
+		fflush(stdout);
+		usleep(cmd->a);
+		return 0;
+	case GpsrvQuery :
+		if ( !pin_ok )
+			return EINVAL;
+		if ( (rc = gpio_alt_function(cmd->gpio,&io)) != 0
+		  || (rc = gpio_get_drive_strength(cmd->gpio,&slew,&hyst,&drive)) != 0 )
+			return rc;
+		*value = gpio_read(cmd->gpio) | (uint32_t)io << 1 | (uint32_t)drive << 4
+			| (uint32_t)slew << 7 | (uint32_t)hyst << 8;
+		return 0;
+	default :
+		return ENOSYS;
+	}
+}
+
+static int32_t
+count(int32_t rc) {
+	uint64_t now = gpio_delay_now();
+
+	if ( !st->ops++ )
+		t_first = now;
+	if ( rc )
+		++st->errors;
+	st->ns = now - t_first;
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Text mode
+//////////////////////////////////////////////////////////////////////
+
+static bool
+parse_int(const char *tok,long lo,long hi,long *v) {
+	char *ep;
+
+	if ( !tok )
+		return false;
+	*v = strtol(tok,&ep,0);
+	return !*ep && *v >= lo && *v <= hi;
+}
+
+static bool
+parse_u32(const char *tok,uint32_t *v) {
+	char *ep;
+
+	if ( !tok )
+		return false;
+	*v = strtoul(tok,&ep,0);
+	return !*ep;
+}
+
+static int
+parse_pull(const char *tok) {
+
+	if ( !strcmp(tok,"up") )
+		return Up;
+	if ( !strcmp(tok,"down") )
+		return Down;
+	if ( !strcmp(tok,"none") )
+		return None;
+	return -1;
+}
+
+static void
+text_line(char *line) {
+	gpsrv_cmd_t cmd = { 0, 0, -1, 0, 0 };
+	char *sp, *verb, *tok;
+	uint32_t value = 0;
+	int32_t rc = 0;
+	long v = -1;
+
+	if ( (tok = strchr(line,'#')) != 0 )
+		*tok = 0;
+	if ( !(verb = strtok_r(line," \t\r",&sp)) )
+		return;				// Blank line
+
+	if ( !strcmp(verb,"quit") ) {
+		quit = true;
+		return;
+	}
+	if ( !strcmp(verb,"stats") ) {
+		printf("ops %llu errors %llu secs %.6f\n",(unsigned long long)st->ops,
+			(unsigned long long)st->errors,st->ns / 1e9);
+		return;
+	}
+
+	if ( !strcmp(verb,"read32") ) {
+		cmd.op = GpsrvRead32;
+	} else if ( !strcmp(verb,"port") ) {
+		cmd.op = GpsrvPort;
+		if ( !parse_u32(strtok_r(0," \t\r",&sp),&cmd.a)
+		  || !parse_u32(strtok_r(0," \t\r",&sp),&cmd.b) )
+			rc = EINVAL;
+	} else if ( !strcmp(verb,"sleep") ) {
+		cmd.op = GpsrvSleep;
+		if ( !parse_u32(strtok_r(0," \t\r",&sp),&cmd.a) )
+			rc = EINVAL;
+	} else if ( !strcmp(verb,"read") || !strcmp(verb,"query") || !strcmp(verb,"write")
+	  || !strcmp(verb,"wait") || !strcmp(verb,"pull") || !strcmp(verb,"config") ) {
+		if ( !parse_int(strtok_r(0," \t\r",&sp),0,53,&v) )
+			rc = EINVAL;
+		cmd.gpio = v;
+		tok = strtok_r(0," \t\r",&sp);
+
+		if ( !strcmp(verb,"read") ) {
+			cmd.op = GpsrvRead;
+		} else if ( !strcmp(verb,"query") ) {
+			cmd.op = GpsrvQuery;
+		} else if ( !strcmp(verb,"write") || !strcmp(verb,"wait") ) {
+			cmd.op = verb[1] == 'r' ? GpsrvWrite : GpsrvWait;
+			if ( !parse_int(tok,0,1,&v) )
+				rc = EINVAL;
+			cmd.a = v;
+			if ( cmd.op == GpsrvWait && (tok = strtok_r(0," \t\r",&sp)) != 0
+			  && !parse_u32(tok,&cmd.b) )
+				rc = EINVAL;
+		} else if ( !strcmp(verb,"pull") ) {
+			cmd.op = GpsrvPull;
+			if ( !tok || parse_pull(tok) < 0 )
+				rc = EINVAL;
+			else	cmd.a = parse_pull(tok);
+		} else	{
+			cmd.op = GpsrvConfig;
+			if ( !tok )
+				rc = EINVAL;
+			for ( v=0; tok && v<8 && strcmp(tok,io_names[v]); ++v )
+				;
+			if ( v >= 8 )
+				rc = EINVAL;
+			cmd.a = v;
+			if ( !rc && (tok = strtok_r(0," \t\r",&sp)) != 0 ) {
+				gpsrv_cmd_t pcmd = cmd;		// Pull before the mode
+
+				pcmd.op = GpsrvPull;
+				pcmd.a = parse_pull(tok);
+				rc = pcmd.a > Down ? EINVAL : execute(&pcmd,&value);
+			}
+		}
+	} else	{
+		rc = ENOSYS;
+	}
+
+	if ( !rc )
+		rc = execute(&cmd,&value);
+	if ( count(rc) ) {
+		printf("err %d %s\n",rc,strerror(rc));
+		return;
+	}
+
+	switch ( cmd.op ) {
+	case GpsrvRead :
+		printf("%u\n",value);
+		break;
+	case GpsrvRead32 :
+		printf("0x%08X\n",value);
+		break;
+	case GpsrvWait :
+		printf("ok %u\n",value);
+		break;
+	case GpsrvQuery :
+		printf("mode %s level %u drive %d slew %u hyst %u\n",
+			io_names[GPSRV_QUERY_IO(value)],GPSRV_QUERY_LEVEL(value),
+			GPSRV_QUERY_DRIVE(value),GPSRV_QUERY_SLEW(value),GPSRV_QUERY_HYST(value));
+		break;
+	default :
+		fputs("ok\n",stdout);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Consume complete commands from buf, returning the bytes used
+//////////////////////////////////////////////////////////////////////
+
+static size_t
+consume(char *buf,size_t len,bool binary) {
+	size_t used = 0;
+
+	if ( binary ) {
+		for ( ; len - used >= sizeof(gpsrv_cmd_t) && !quit; used += sizeof(gpsrv_cmd_t) ) {
+			gpsrv_cmd_t cmd;
+			gpsrv_rsp_t rsp = { 0, 0, 0, 0 };
+
+			memcpy(&cmd,buf + used,sizeof cmd);
+			rsp.seq = cmd.seq;
+			rsp.rc = count(execute(&cmd,&rsp.value));
+			fwrite(&rsp,sizeof rsp,1,stdout);
+		}
+		return used;
+	}
+
+	while ( used < len && !quit ) {
+		char *nl = memchr(buf + used,'\n',len - used);
+
+		if ( !nl )
+			break;
+		*nl = 0;
+		text_line(buf + used);
+		used = nl + 1 - buf;
+	}
+	return used;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Run commands from path ("-" for stdin) until end of input or quit.
+// A FIFO is reopened at end of input, to serve the next writer.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpbatch_run(const char *path,bool binary,gpbatch_stats_t *stats) {
+	bool is_stdin = !strcmp(path,"-"), is_fifo;
+	char *buf;
+	size_t len = 0, used;
+	struct stat sb;
+	ssize_t n;
+	int fd, rc = 0;
+
+	memset(stats,0,sizeof *stats);
+	st = stats;
+	quit = false;
+
+	if ( (fd = is_stdin ? 0 : gp_user_open(path,O_RDONLY,0)) < 0 )
+		return errno;
+	is_fifo = !is_stdin && !fstat(fd,&sb) && S_ISFIFO(sb.st_mode);
+
+	if ( !(buf = malloc(BATCH_BUFSZ)) ) {
+		rc = errno;
+		goto out;
+	}
+	while ( !quit ) {
+		fflush(stdout);			// About to block
+		n = read(fd,buf + len,BATCH_BUFSZ - 1 - len);
+		if ( n < 0 ) {
+			if ( errno == EINTR )
+				continue;
+			rc = errno;
+			break;
+		}
+		if ( n == 0 ) {
+			if ( !is_fifo )
+				break;
+			close(fd);		// Writer went away: wait for the next
+			len = 0;
+			if ( (fd = gp_user_open(path,O_RDONLY,0)) < 0 ) {
+				rc = errno;
+				break;
+			}
+			continue;
+		}
+
+		len += n;
+		used = consume(buf,len,binary);
+		memmove(buf,buf + used,len - used);
+		len -= used;
+		if ( !binary && len == BATCH_BUFSZ - 1 ) {
+			printf("err %d %s\n",E2BIG,strerror(E2BIG));
+			len = 0;		// Line too long: drop it
+		}
+	}
+
+	fflush(stdout);
+	free(buf);
+out:	if ( !is_stdin && fd >= 0 )
+		close(fd);
+	return rc;
+}
+
+/* end gpbatch.c */
@@ -0,0 +1,29 @@
+//////////////////////////////////////////////////////////////////////
+// gpbatch.h -- Command stream interpreter for gp -B
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPBATCH_H
+#define GPBATCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//////////////////////////////////////////////////////////////////////
+// Text mode reads one command per line and answers each with one
+// line. Binary mode reads gpsrv_cmd_t records and answers each with a
+// gpsrv_rsp_t record. Responses are flushed whenever gp is about to
+// block (reading more input, waiting or sleeping).
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	uint64_t	ops;		// Commands executed
+	uint64_t	errors;		// Commands answered with an error
+	uint64_t	ns;		// Time from first to last command
+} gpbatch_stats_t;
+
+int gpbatch_run(const char *path,bool binary,gpbatch_stats_t *stats);
+
+#endif // GPBATCH_H
+
+// End gpbatch.h
@@ -0,0 +1,295 @@
+/* Logic analyzer capture gpcap.c
+ * Warren W. Gay ve3wwg
+ *
+ * Samples gpio_read32() in a tight loop and stores one run record per
+ * level change, so a slow bus costs file space only when it changes.
+ * Time is read once per change and once per window of samples; the
+ * windows also reveal stalls (preemption) in the sampling loop.
+ */
+#define _GNU_SOURCE			// mremap(2)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpcap.h"
+#include "gpuser.h"
+
+#define WINDOW		256		// Samples between time checks
+#define GROW		(1024*1024)	// Capture file growth step
+
+volatile sig_atomic_t gpcap_stop = 0;
+
+typedef struct {
+	int		fd;
+	size_t		size;		// Mapped bytes
+	gpcap_hdr_t	*hdr;		// Mapped file
+	gpcap_run_t	*runs;		// Follows header
+	uint64_t	maxruns;	// Runs that fit in the mapping
+} capfile_t;
+
+static inline uint64_t
+now_ns(clockid_t clk) {
+	struct timespec t;
+
+	clock_gettime(clk,&t);
+	return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+/*
+ * Size the capture file and (re)map it:
+ */
+static int
+cap_map(capfile_t *cf,size_t size) {
+	void *map;
+
+	if ( ftruncate(cf->fd,size) < 0 )
+		return errno;
+
+	if ( cf->hdr )
+		map = mremap(cf->hdr,cf->size,size,MREMAP_MAYMOVE);
+	else	map = mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,cf->fd,0);
+	if ( map == MAP_FAILED )
+		return errno;
+
+	cf->size = size;
+	cf->hdr = (gpcap_hdr_t *)map;
+	cf->runs = (gpcap_run_t *)(cf->hdr + 1);
+	cf->maxruns = (size - sizeof *cf->hdr) / sizeof *cf->runs;
+	return 0;
+}
+
+static int
+cap_append(capfile_t *cf,const gpcap_run_t *run) {
+	int rc;
+
+	if ( cf->hdr->nruns >= cf->maxruns )
+		if ( (rc = cap_map(cf,cf->size + GROW)) != 0 )
+			return rc;
+	cf->runs[cf->hdr->nruns++] = *run;
+	cf->hdr->samples += run->count;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Capture to path until opts->seconds after the trigger (or start).
+// A trigger that hasn't fired within opts->seconds, or gpcap_stop,
+// ends the capture early; the file then keeps the pre-trigger runs
+// and its header says triggered = 0.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpcap_capture(const char *path,const gpcap_opts_t *opts,gpcap_hdr_t *hdr) {
+	const uint32_t mask = opts->mask;
+	const uint64_t limit = (uint64_t)opts->seconds * 1000000000ull;
+	uint32_t npre = 0, prehead = 0, presize = 1;
+	gpcap_run_t *pre = 0, run;
+	uint64_t t0, tw, tnow, trig = 0, wins = 0, wsum = 0;
+	capfile_t cf;
+	bool triggered = !opts->trig_mask;
+	uint32_t s;
+	int rc = 0;
+
+	memset(&cf,0,sizeof cf);
+	cf.fd = gp_user_open(path,O_RDWR|O_CREAT|O_TRUNC,0644);
+	if ( cf.fd < 0 )
+		return errno;
+	if ( (rc = cap_map(&cf,GROW)) != 0 ) {
+		close(cf.fd);
+		return rc;
+	}
+
+	memset(cf.hdr,0,sizeof *cf.hdr);
+	memcpy(cf.hdr->magic,GPCAP_MAGIC,sizeof cf.hdr->magic);
+	cf.hdr->mask = mask;
+	cf.hdr->trig_mask = opts->trig_mask;
+	cf.hdr->trig_value = opts->trig_value;
+
+	/*
+	 * Before the trigger, runs go into a ring holding at least
+	 * opts->pretrigger samples worth of runs:
+	 */
+	if ( !triggered ) {
+		presize = opts->pretrigger + 1;
+		pre = malloc(presize * sizeof *pre);
+		if ( !pre ) {
+			rc = ENOMEM;
+			goto xit;
+		}
+	}
+
+	cf.hdr->start_ns = now_ns(CLOCK_REALTIME);
+	t0 = tw = now_ns(CLOCK_MONOTONIC);
+
+	s = gpio_read32() & mask;
+	run.ns = 0;
+	run.level = s;
+	run.count = 1;
+
+	if ( !triggered && (s & opts->trig_mask) == opts->trig_value ) {
+		triggered = true;
+		trig = 0;
+	}
+
+	for (;;) {
+		for ( int k=0; k<WINDOW; ++k ) {
+			s = gpio_read32() & mask;
+			if ( s == run.level && run.count != UINT32_MAX ) {
+				++run.count;
+				continue;
+			}
+
+			// Close the run and start a new one
+			tnow = now_ns(CLOCK_MONOTONIC) - t0;
+			if ( triggered ) {
+				if ( (rc = cap_append(&cf,&run)) != 0 )
+					goto xit;
+			} else	{
+				pre[prehead] = run;
+				prehead = (prehead + 1) % presize;
+				if ( npre < presize )
+					++npre;
+			}
+			run.ns = tnow;
+			run.level = s;
+			run.count = 1;
+
+			if ( !triggered && (s & opts->trig_mask) == opts->trig_value ) {
+				uint64_t keep = 0;
+				uint32_t x, n;
+
+				// Keep the newest runs holding >= pretrigger samples
+				for ( n=0; n<npre && keep < opts->pretrigger; ++n )
+					keep += pre[(prehead + presize - 1 - n) % presize].count;
+				for ( x=n; x>0; --x )
+					if ( (rc = cap_append(&cf,&pre[(prehead + presize - x) % presize])) != 0 )
+						goto xit;
+				triggered = true;
+				trig = tnow;
+			}
+		}
+
+		/*
+		 * Once per window: check the clock for stalls and the end
+		 * of capture.
+		 */
+		tnow = now_ns(CLOCK_MONOTONIC);
+		if ( wins >= 16 ) {
+			uint64_t avg = wsum / wins;
+
+			if ( tnow - tw > 4 * avg ) {
+				++cf.hdr->gaps;
+				if ( tnow - tw - avg > cf.hdr->max_gap_ns )
+					cf.hdr->max_gap_ns = tnow - tw - avg;
+			} else	{
+				wsum += tnow - tw;
+				++wins;
+			}
+		} else	{
+			wsum += tnow - tw;
+			++wins;
+		}
+		tw = tnow;
+
+		if ( triggered ? tnow - t0 - trig >= limit : tnow - t0 >= limit )
+			break;
+		if ( gpcap_stop )
+			break;
+	}
+
+	if ( !triggered ) {
+		for ( uint32_t x=npre; x>0; --x )	// Oldest first
+			if ( (rc = cap_append(&cf,&pre[(prehead + presize - x) % presize])) != 0 )
+				goto xit;
+	}
+	if ( (rc = cap_append(&cf,&run)) != 0 )
+		goto xit;
+
+	cf.hdr->triggered = opts->trig_mask && triggered ? 1 : 0;
+	cf.hdr->trigger_ns = trig;
+	cf.hdr->duration_ns = tnow - t0;
+
+xit:	if ( hdr )
+		*hdr = *cf.hdr;
+	if ( ftruncate(cf.fd,sizeof *cf.hdr + cf.hdr->nruns * sizeof *cf.runs) < 0 && !rc )
+		rc = errno;
+	munmap(cf.hdr,cf.size);
+	close(cf.fd);
+	free(pre);
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write a capture file as a Value Change Dump (1 ns timescale)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpcap_export_vcd(const char *path,FILE *out) {
+	int fd = gp_user_open(path,O_RDONLY,0);
+	gpcap_hdr_t *hdr;
+	gpcap_run_t *runs;
+	off_t size;
+	char ids[32];
+	time_t t;
+	uint32_t prev = 0;
+
+	if ( fd < 0 )
+		return errno;
+	size = lseek(fd,0,SEEK_END);
+	if ( size < (off_t)sizeof *hdr ) {
+		close(fd);
+		return EINVAL;
+	}
+	hdr = (gpcap_hdr_t *)mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if ( hdr == MAP_FAILED )
+		return errno;
+	if ( memcmp(hdr->magic,GPCAP_MAGIC,sizeof hdr->magic) != 0
+	  || size < (off_t)(sizeof *hdr + hdr->nruns * sizeof *runs) ) {
+		munmap(hdr,size);
+		return EINVAL;
+	}
+	runs = (gpcap_run_t *)(hdr + 1);
+
+	t = hdr->start_ns / 1000000000ull;
+	fprintf(out,"$date %s$end\n",ctime(&t));
+	fprintf(out,"$version gp -L %s $end\n",path);
+	fprintf(out,"$timescale 1ns $end\n");
+	fprintf(out,"$scope module gpio $end\n");
+	for ( int b=0; b<32; ++b ) {
+		ids[b] = '!' + b;
+		if ( hdr->mask & (1u << b) )
+			fprintf(out,"$var wire 1 %c gpio%d $end\n",ids[b],b);
+	}
+	fprintf(out,"$upscope $end\n$enddefinitions $end\n");
+
+	for ( uint64_t r=0; r<hdr->nruns; ++r ) {
+		uint32_t changed = r ? runs[r].level ^ prev : hdr->mask;
+
+		if ( !changed )
+			continue;		// Split of a long run
+		fprintf(out,r ? "#%llu\n" : "#%llu\n$dumpvars\n",
+			(unsigned long long)runs[r].ns);
+		for ( int b=0; b<32; ++b )
+			if ( changed & (1u << b) )
+				fprintf(out,"%d%c\n",!!(runs[r].level & (1u << b)),ids[b]);
+		if ( !r )
+			fprintf(out,"$end\n");
+		prev = runs[r].level;
+	}
+	fprintf(out,"#%llu\n",(unsigned long long)hdr->duration_ns);
+
+	munmap(hdr,size);
+	return 0;
+}
+
+/* end gpcap.c */
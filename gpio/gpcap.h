@@ -0,0 +1,52 @@
+//////////////////////////////////////////////////////////////////////
+// gpcap.h -- Logic analyzer capture for gp (RLE capture files)
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPCAP_H
+#define GPCAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+
+#define GPCAP_MAGIC	"GPCAP01"
+
+typedef struct {
+	char		magic[8];	// GPCAP_MAGIC
+	uint32_t	mask;		// Pins captured
+	uint32_t	trig_mask;	// Trigger: (level & trig_mask) == trig_value
+	uint32_t	trig_value;
+	uint32_t	triggered;	// Non-zero if the trigger fired
+	uint64_t	start_ns;	// CLOCK_REALTIME at time zero
+	uint64_t	duration_ns;	// Captured span
+	uint64_t	trigger_ns;	// Trigger time, relative to time zero
+	uint64_t	samples;	// gpio_read32() samples stored
+	uint64_t	nruns;		// Run records following the header
+	uint64_t	gaps;		// Sampling windows that stalled
+	uint64_t	max_gap_ns;	// Longest stall
+} gpcap_hdr_t;
+
+typedef struct {
+	uint64_t	ns;		// Time of first sample in run
+	uint32_t	level;		// gpio_read32() & mask
+	uint32_t	count;		// Samples in run
+} gpcap_run_t;
+
+typedef struct {
+	uint32_t	mask;		// Pins to capture
+	uint32_t	trig_mask;	// Zero for no trigger
+	uint32_t	trig_value;
+	uint32_t	pretrigger;	// Samples kept from before the trigger
+	int		seconds;	// Capture time (after trigger), and the
+					// longest wait for the trigger
+} gpcap_opts_t;
+
+extern volatile sig_atomic_t gpcap_stop;	// Set (e.g. on SIGINT) to end a capture
+
+int gpcap_capture(const char *path,const gpcap_opts_t *opts,gpcap_hdr_t *hdr);
+int gpcap_export_vcd(const char *path,FILE *out);
+
+#endif // GPCAP_H
+
+// End gpcap.h
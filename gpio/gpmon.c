@@ -0,0 +1,220 @@
+/* Pin change monitor gpmon.c
+ * Warren W. Gay ve3wwg
+ *
+ * The sampling loop reads gpio_read32() and gpio_delay_now() once per
+ * iteration: one GPLEV0 load and one CLOCK_MONOTONIC_RAW read, which
+ * the vDSO answers without entering the kernel on an arch timer
+ * clocksource. Gaps between samples are so measured in nanoseconds
+ * rather than in the system timer's microsecond ticks. Changed pins
+ * are found by XOR and walked with ctz, each one becoming an 8 byte
+ * record in a single producer, single consumer ring. A writer thread
+ * drains the ring to the file, so the loop never formats text or
+ * writes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libgp.h"
+#include "gpdelay.h"
+#include "gpmon.h"
+#include "gpuser.h"
+
+#define RING_SIZE	65536		// Default ring entries
+#define CHUNK		4096		// Most records per write(2)
+
+typedef struct {
+	int		fd;
+	unsigned	size;		// Ring entries (power of 2)
+	gpmon_rec_t	*ring;
+	volatile unsigned head;		// Next slot written by sampler
+	volatile unsigned tail;		// Next slot written to file
+	volatile bool	stop;		// Sampling is over
+	int		err;		// First write error
+	uint64_t	nrecs;		// Records written
+} monring_t;
+
+//////////////////////////////////////////////////////////////////////
+// Writer thread: drain the ring to the file until stopped and empty
+//////////////////////////////////////////////////////////////////////
+
+static void *
+writer(void *arg) {
+	monring_t *mr = (monring_t *)arg;
+	unsigned tail = mr->tail, head, n;
+	bool stopping;
+
+	for (;;) {
+		stopping = __atomic_load_n(&mr->stop,__ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&mr->head,__ATOMIC_ACQUIRE);
+		if ( head == tail ) {
+			if ( stopping )
+				break;
+			usleep(1000);
+			continue;
+		}
+
+		// Contiguous records up to the end of the ring
+		n = head - tail;
+		if ( n > mr->size - (tail & (mr->size - 1)) )
+			n = mr->size - (tail & (mr->size - 1));
+		if ( n > CHUNK )
+			n = CHUNK;
+
+		if ( !mr->err ) {
+			ssize_t bytes = n * sizeof *mr->ring;
+
+			if ( write(mr->fd,&mr->ring[tail & (mr->size - 1)],bytes) != bytes )
+				mr->err = errno ? errno : EIO;
+			else	mr->nrecs += n;
+		}
+		tail += n;
+		__atomic_store_n(&mr->tail,tail,__ATOMIC_RELEASE);
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Monitor opts->mask for opts->seconds, writing change records to path
+//////////////////////////////////////////////////////////////////////
+
+int
+gpmon_monitor(const char *path,const gpmon_opts_t *opts,gpmon_hdr_t *hdr) {
+	const uint32_t mask = opts->mask;
+	const uint64_t limit = (uint64_t)opts->seconds * 1000000000ull;
+	uint64_t t, tl, gap, max_gap = 0, elapsed = 0, samples = 0, dropped = 0;
+	uint32_t prev, s, ch;
+	unsigned head, tail;
+	gpmon_hdr_t h;
+	monring_t mr;
+	pthread_t thread;
+	struct timespec rt;
+	int rc;
+
+	memset(&mr,0,sizeof mr);
+	mr.size = opts->ring_size ? opts->ring_size : RING_SIZE;
+	if ( mr.size & (mr.size - 1) )
+		return EINVAL;
+	mr.ring = malloc(mr.size * sizeof *mr.ring);
+	if ( !mr.ring )
+		return ENOMEM;
+
+	mr.fd = gp_user_open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if ( mr.fd < 0 ) {
+		rc = errno;
+		free(mr.ring);
+		return rc;
+	}
+
+	memset(&h,0,sizeof h);
+	memcpy(h.magic,GPMON_MAGIC,sizeof h.magic);
+	h.mask = mask;
+	if ( write(mr.fd,&h,sizeof h) != sizeof h ) {
+		rc = errno;
+		goto xit;
+	}
+
+	if ( (rc = pthread_create(&thread,0,writer,&mr)) != 0 )
+		goto xit;
+
+	clock_gettime(CLOCK_REALTIME,&rt);
+	h.start_ns = (uint64_t)rt.tv_sec * 1000000000ull + rt.tv_nsec;
+	prev = h.level = gpio_read32() & mask;
+	tl = gpio_delay_now();
+	head = mr.head;
+	tail = mr.tail;
+
+	do	{
+		s = gpio_read32() & mask;
+		t = gpio_delay_now();
+		gap = t - tl;
+		tl = t;
+		elapsed += gap;
+		if ( gap > max_gap )
+			max_gap = gap;
+		++samples;
+
+		if ( __builtin_expect((ch = s ^ prev) != 0,0) ) {
+			prev = s;
+			do	{
+				int b = __builtin_ctz(ch);
+
+				ch &= ch - 1;
+				if ( head - tail >= mr.size ) {
+					tail = __atomic_load_n(&mr.tail,__ATOMIC_ACQUIRE);
+					if ( head - tail >= mr.size ) {
+						++dropped;
+						continue;
+					}
+				}
+				mr.ring[head & (mr.size - 1)] = GPMON_REC(elapsed / 1000,b,s >> b & 1);
+				++head;
+			} while ( ch );
+			__atomic_store_n(&mr.head,head,__ATOMIC_RELEASE);
+		}
+	} while ( elapsed < limit );
+
+	__atomic_store_n(&mr.stop,true,__ATOMIC_RELEASE);
+	pthread_join(thread,0);
+
+	h.duration_us = elapsed / 1000;
+	h.samples = samples;
+	h.max_gap_ns = max_gap;
+	h.nrecs = mr.nrecs;
+	h.dropped = dropped;
+	if ( (rc = mr.err) == 0 )
+		if ( pwrite(mr.fd,&h,sizeof h,0) != sizeof h )
+			rc = errno;
+
+xit:	if ( hdr )
+		*hdr = h;
+	close(mr.fd);
+	free(mr.ring);
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// List a monitor file as text
+//////////////////////////////////////////////////////////////////////
+
+int
+gpmon_dump(const char *path,FILE *out) {
+	FILE *f = gp_user_fopen(path,"rb");
+	gpmon_hdr_t h;
+	gpmon_rec_t rec;
+	uint64_t n;
+
+	if ( !f )
+		return errno;
+	if ( fread(&h,sizeof h,1,f) != 1 || memcmp(h.magic,GPMON_MAGIC,sizeof h.magic) != 0 ) {
+		fclose(f);
+		return EINVAL;
+	}
+
+	fprintf(out,"# mask %08X level %08X, %llu samples in %llu us, longest gap %.3f us\n",
+		h.mask,h.level,
+		(unsigned long long)h.samples,
+		(unsigned long long)h.duration_us,
+		h.max_gap_ns / 1e3);
+	for ( n=0; n<h.nrecs && fread(&rec,sizeof rec,1,f) == 1; ++n )
+		fprintf(out,"%12llu gpio%-2d %d\n",
+			(unsigned long long)GPMON_US(rec),
+			GPMON_GPIO(rec),
+			GPMON_LEVEL(rec));
+	if ( h.dropped )
+		fprintf(out,"# %llu changes dropped\n",(unsigned long long)h.dropped);
+
+	fclose(f);
+	return n == h.nrecs ? 0 : EINVAL;
+}
+
+/* end gpmon.c */
@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////
+// gpmon.h -- High-rate 32-pin change monitor for gp (binary records)
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPMON_H
+#define GPMON_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPMON_MAGIC	"GPMON02"
+
+typedef struct {
+	char		magic[8];	// GPMON_MAGIC
+	uint32_t	mask;		// Pins monitored
+	uint32_t	level;		// Levels at time zero
+	uint64_t	start_ns;	// CLOCK_REALTIME at time zero
+	uint64_t	duration_us;	// Monitored span
+	uint64_t	samples;	// gpio_read32() samples taken
+	uint64_t	max_gap_ns;	// Longest time between two samples
+	uint64_t	nrecs;		// Records following the header
+	uint64_t	dropped;	// Changes lost to a full ring
+} gpmon_hdr_t;
+
+//////////////////////////////////////////////////////////////////////
+// One record per pin change: bits 63-8 microseconds since time zero,
+// bit 7 the new level and bits 4-0 the gpio.
+//////////////////////////////////////////////////////////////////////
+
+typedef uint64_t gpmon_rec_t;
+
+#define GPMON_REC(us,gpio,level) \
+	((uint64_t)(us) << 8 | (uint64_t)!!(level) << 7 | (gpio))
+#define GPMON_US(rec)		((rec) >> 8)
+#define GPMON_LEVEL(rec)	((int)((rec) >> 7 & 1))
+#define GPMON_GPIO(rec)		((int)((rec) & 0x1F))
+
+typedef struct {
+	uint32_t	mask;		// Pins to monitor
+	int		seconds;	// Monitoring time
+	unsigned	ring_size;	// Records buffered for the writer (power of 2)
+} gpmon_opts_t;
+
+int gpmon_monitor(const char *path,const gpmon_opts_t *opts,gpmon_hdr_t *hdr);
+int gpmon_dump(const char *path,FILE *out);
+
+#endif // GPMON_H
+
+// End gpmon.h
@@ -0,0 +1,73 @@
+/* User file access for the setuid gp: gpuser.c
+ * Warren W. Gay ve3wwg
+ *
+ * The effective uid is switched to the real uid for the open and then
+ * back again (the saved set-user-ID keeps root available). When it
+ * cannot be restored the file is closed again, since gp could not
+ * carry on as intended.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+
+#include "gpuser.h"
+
+static uid_t
+user_enter() {
+	uid_t euid = geteuid();
+
+	if ( euid != getuid() && seteuid(getuid()) < 0 )
+		return (uid_t)-1;
+	return euid;
+}
+
+static int
+user_leave(uid_t euid) {
+
+	if ( euid != geteuid() && seteuid(euid) < 0 ) {
+		errno = EPERM;
+		return -1;
+	}
+	return 0;
+}
+
+int
+gp_user_open(const char *path,int flags,mode_t mode) {
+	uid_t euid = user_enter();
+	int fd, er;
+
+	if ( euid == (uid_t)-1 )
+		return -1;
+	fd = open(path,flags,mode);
+	er = errno;
+	if ( user_leave(euid) < 0 ) {
+		if ( fd >= 0 )
+			close(fd);
+		return -1;
+	}
+	errno = er;
+	return fd;
+}
+
+FILE *
+gp_user_fopen(const char *path,const char *mode) {
+	uid_t euid = user_enter();
+	FILE *f;
+	int er;
+
+	if ( euid == (uid_t)-1 )
+		return 0;
+	f = fopen(path,mode);
+	er = errno;
+	if ( user_leave(euid) < 0 ) {
+		if ( f )
+			fclose(f);
+		return 0;
+	}
+	errno = er;
+	return f;
+}
+
+/* end gpuser.c */
@@ -0,0 +1,23 @@
+//////////////////////////////////////////////////////////////////////
+// gpuser.h -- Open files named by the user of the setuid gp
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPUSER_H
+#define GPUSER_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+//////////////////////////////////////////////////////////////////////
+// gp is installed setuid root, but the files named on its command
+// line must be opened with the rights of the user running it. These
+// drop the effective uid to the real one around the open, and return
+// as open(2) and fopen(3) do.
+//////////////////////////////////////////////////////////////////////
+
+int gp_user_open(const char *path,int flags,mode_t mode);
+FILE *gp_user_fopen(const char *path,const char *mode);
+
+#endif // GPUSER_H
+
+// End gpuser.h
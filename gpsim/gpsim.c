@@ -0,0 +1,186 @@
+/* Simulated BCM283x GPIO block: gpsim.c
+ * Warren W. Gay ve3wwg
+ *
+ * Creates the shared register block used by libgp's "sim" backend
+ * (LIBGP_BACKEND=sim) and drives external stimulus into it until
+ * interrupted.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+
+#include "gpsim.h"
+#include "gpioreg.h"
+
+#define MAX_WAVES	8
+
+static volatile bool is_signaled = false;
+
+static struct {
+	int		gpio;		// Driven input
+	long		half_ns;	// Half period
+	int		level;		// Present level
+	struct timespec	next;		// Next toggle
+} waves[MAX_WAVES];
+static int nwaves = 0;
+
+static void
+sig_handler(int signo) {
+	is_signaled = true;
+}
+
+static inline long
+ns_until(const struct timespec *now,const struct timespec *t) {
+	return (t->tv_sec - now->tv_sec) * 1000000000L + (t->tv_nsec - now->tv_nsec);
+}
+
+static inline void
+ts_add(struct timespec *t,long ns) {
+	t->tv_nsec += ns;
+	while ( t->tv_nsec >= 1000000000L ) {
+		t->tv_nsec -= 1000000000L;
+		++t->tv_sec;
+	}
+}
+
+static void
+status(gpsim_t *sim) {
+	gpsim_lock(sim);
+	printf("LEV=%014llX OUT=%014llX EDS=%014llX UP=%014llX DN=%014llX stores=%llu\n",
+		(unsigned long long)gpsim_levels(sim),
+		(unsigned long long)sim->s.out,
+		(unsigned long long)sim->s.eds,
+		(unsigned long long)sim->s.pullup,
+		(unsigned long long)sim->s.pulldown,
+		(unsigned long long)sim->s.stores);
+	for ( int x=0; x<3; ++x )
+		if ( sim->cm[CMOFF(CM_GP0CTL) + x*2] & CM_CTL_ENAB )
+			printf("GPCLK%d CTL=%06X DIV=%06X\n",x,
+				sim->cm[CMOFF(CM_GP0CTL) + x*2],
+				sim->cm[CMOFF(CM_GP0DIV) + x*2]);
+	if ( sim->pwm[PWMOFF(PWM_CTL)] )
+		printf("PWM CTL=%04X RNG1=%u DAT1=%u RNG2=%u DAT2=%u CLK CTL=%06X DIV=%06X\n",
+			sim->pwm[PWMOFF(PWM_CTL)],
+			sim->pwm[PWMOFF(PWM_RNG1)],sim->pwm[PWMOFF(PWM_DAT1)],
+			sim->pwm[PWMOFF(PWM_RNG2)],sim->pwm[PWMOFF(PWM_DAT2)],
+			sim->cm[CMOFF(CM_PWMCTL)],sim->cm[CMOFF(CM_PWMDIV)]);
+	gpsim_unlock(sim);
+	fflush(stdout);
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-w from:to] [-d gpio=level] [-q gpio:hz] [-s secs] [-h]\n"
+		"where:\n"
+		"\t-w from:to\tWire gpio from to input gpio to\n"
+		"\t-d gpio=level\tDrive an input gpio externally to 0 or 1\n"
+		"\t-q gpio:hz\tDrive a square wave into an input gpio\n"
+		"\t-s secs\tPrint register status every secs seconds\n"
+		"\t-h\tThis help\n"
+		"\n"
+		"Run clients with LIBGP_BACKEND=sim to use the simulated block.\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hw:d:q:s:";
+	struct sigaction new_action;
+	int status_secs = 0;
+	struct timespec now, tstat;
+	gpsim_t *sim;
+	int oc, a, b;
+	double hz;
+
+	sim = gpsim_attach(true);
+	if ( !sim ) {
+		fprintf(stderr,"%s: creating shm %s\n",strerror(errno),GPSIM_SHM);
+		exit(2);
+	}
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'w':
+			if ( sscanf(optarg,"%d:%d",&a,&b) != 2 || gpsim_wire(sim,a,b) ) {
+				fprintf(stderr,"Invalid wire: -w %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'd':
+			if ( sscanf(optarg,"%d=%d",&a,&b) != 2 || gpsim_drive(sim,a,!!b) ) {
+				fprintf(stderr,"Invalid drive: -d %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'q':
+			if ( nwaves >= MAX_WAVES
+			  || sscanf(optarg,"%d:%lf",&a,&hz) != 2
+			  || a < 0 || a >= GPSIM_NPINS || hz <= 0.0 ) {
+				fprintf(stderr,"Invalid wave: -q %s\n",optarg);
+				exit(1);
+			}
+			waves[nwaves].gpio = a;
+			waves[nwaves].half_ns = (long)(5e8 / hz);
+			++nwaves;
+			break;
+		case 's':
+			status_secs = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	new_action.sa_handler = sig_handler;
+	sigemptyset(&new_action.sa_mask);
+	new_action.sa_flags = 0;
+	sigaction(SIGINT,&new_action,NULL);
+	sigaction(SIGTERM,&new_action,NULL);
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	tstat = now;
+	for ( int x=0; x<nwaves; ++x )
+		waves[x].next = now;
+
+	printf("gpsim: %s ready, pid %d\n",GPSIM_SHM,(int)getpid());
+	fflush(stdout);
+
+	while ( !is_signaled ) {
+		clock_gettime(CLOCK_MONOTONIC,&now);
+
+		for ( int x=0; x<nwaves; ++x ) {
+			if ( ns_until(&now,&waves[x].next) > 0 )
+				continue;
+			waves[x].level ^= 1;
+			gpsim_drive(sim,waves[x].gpio,waves[x].level);
+			ts_add(&waves[x].next,waves[x].half_ns);
+		}
+
+		if ( status_secs > 0 && now.tv_sec - tstat.tv_sec >= status_secs ) {
+			status(sim);
+			tstat = now;
+		}
+
+		if ( !nwaves )
+			usleep(10000);		// Nothing time critical to do
+	}
+
+	status(sim);
+	gpsim_detach(sim);
+	gpsim_unlink();
+	return 0;
+}
+
+// End gpsim.c
@@ -0,0 +1,354 @@
+/* Shared memory GPIO server: gpsrv.c
+ * Warren W. Gay ve3wwg
+ *
+ * Owns the libgp register mapping and serves pin operations to client
+ * processes through lock-free rings in a POSIX shared memory object
+ * (see gpsrv.h and gpclient.c). Access is limited to the owner and
+ * the group given with -G, and to the pins given with -m.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <grp.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpedge.h"
+#include "gpsrv.h"
+
+static volatile bool is_signaled = false;
+static gpsrv_t *srv = 0;
+static gpio_edge_t *edges = 0;		// Union of all subscriptions
+static unsigned long broken = 0;	// Slots dropped for bad indexes
+
+static void
+sig_handler(int signo) {
+	is_signaled = true;
+}
+
+/*
+ * Reset a slot left behind by a client that died:
+ */
+static void
+slot_reset(gpsrv_slot_t *slot) {
+	slot->sub_mask = slot->sub_flags = 0;
+	slot->ev_dropped = 0;
+	slot->cmd_head = slot->cmd_tail = 0;
+	slot->rsp_head = slot->rsp_tail = 0;
+	slot->ev_head = slot->ev_tail = 0;
+	__atomic_store_n(&slot->pid,0,__ATOMIC_RELEASE);
+}
+
+/*
+ * True when GPSRV_SHM is ours and its server is still running:
+ */
+static bool
+server_running() {
+	int fd = shm_open(GPSRV_SHM,O_RDONLY|O_NOFOLLOW,0);
+	const gpsrv_t *old;
+	struct stat sb;
+	bool running = false;
+
+	if ( fd < 0 )
+		return false;
+	if ( !fstat(fd,&sb) && sb.st_uid == geteuid() && sb.st_size >= (off_t)sizeof *old ) {
+		old = (const gpsrv_t *)mmap(NULL,sizeof *old,PROT_READ,MAP_SHARED,fd,0);
+		if ( old != MAP_FAILED ) {
+			running = old->magic == GPSRV_MAGIC && old->server > 0
+				&& (kill(old->server,0) == 0 || errno == EPERM);
+			munmap((void *)old,sizeof *old);
+		}
+	}
+	close(fd);
+	return running;
+}
+
+/*
+ * Re-arm the edge engine for the union of subscriptions. Reopening
+ * clears GPEDS0, losing edges latched for other subscribers, so it
+ * is only done when the union changes.
+ */
+static int
+edges_rearm() {
+	static uint32_t armed_mask = 0;
+	static unsigned armed_flags = 0;
+	uint32_t mask = 0;
+	unsigned flags = 0;
+
+	for ( int x=0; x<GPSRV_SLOTS; ++x ) {
+		mask |= srv->slots[x].sub_mask;
+		flags |= srv->slots[x].sub_flags;
+	}
+	if ( mask == armed_mask && flags == armed_flags && (edges || !mask) )
+		return 0;
+	armed_mask = mask;
+	armed_flags = flags;
+	if ( edges ) {
+		gpio_edge_close(edges);
+		edges = 0;
+	}
+	if ( mask && !(edges = gpio_edge_open(mask,flags,1024)) )
+		return errno;
+	return 0;
+}
+
+/*
+ * Fan captured edges out to subscribers:
+ */
+static void
+edges_dispatch() {
+	gpio_edge_event_t ev;
+
+	gpio_edge_poll(edges);
+	while ( gpio_edge_get(edges,&ev) ) {
+		for ( int x=0; x<GPSRV_SLOTS; ++x ) {
+			gpsrv_slot_t *slot = &srv->slots[x];
+			uint32_t head = slot->ev_head;
+
+			if ( !slot->pid || !(slot->sub_mask & (1u << ev.gpio)) )
+				continue;
+			if ( head - __atomic_load_n(&slot->ev_tail,__ATOMIC_ACQUIRE) >= GPSRV_EVRING ) {
+				++slot->ev_dropped;
+				continue;
+			}
+			slot->ev[head & (GPSRV_EVRING - 1)] = ev;
+			__atomic_store_n(&slot->ev_head,head + 1,__ATOMIC_RELEASE);
+		}
+	}
+}
+
+/*
+ * Execute one command:
+ */
+static int32_t
+execute(gpsrv_slot_t *slot,const gpsrv_cmd_t *cmd,uint32_t *value) {
+	bool pin_ok = cmd->gpio >= 0 && cmd->gpio < 32
+		&& (srv->allowed & (1u << cmd->gpio));
+
+	*value = 0;
+	switch ( cmd->op ) {
+	case GpsrvRead :
+		if ( !pin_ok )
+			return EPERM;
+		*value = gpio_read(cmd->gpio);
+		return 0;
+	case GpsrvWrite :
+		return pin_ok ? gpio_write(cmd->gpio,cmd->a) : EPERM;
+	case GpsrvRead32 :
+		*value = gpio_read32() & srv->allowed;
+		return 0;
+	case GpsrvPort :
+		if ( (cmd->a | cmd->b) & ~srv->allowed )
+			return EPERM;
+		return gpio_port_write(cmd->a,cmd->b);
+	case GpsrvConfig :
+		return pin_ok ? gpio_configure_io(cmd->gpio,(IO)cmd->a) : EPERM;
+	case GpsrvPull :
+		return pin_ok ? gpio_configure_pullup(cmd->gpio,(Pull)cmd->a) : EPERM;
+	case GpsrvSubscribe :
+		if ( cmd->a & ~srv->allowed )
+			return EPERM;
+		slot->sub_mask = cmd->a;
+		slot->sub_flags = cmd->a ? cmd->b : 0;
+		return edges_rearm();
+	default :
+		return ENOSYS;
+	}
+}
+
+/*
+ * Serve pending commands of one slot. Returns count served.
+ *
+ * The ring indexes are written by the client, so a head more than
+ * GPSRV_RING ahead of the tail marks the slot broken, and it is
+ * dropped. Commands wait while the response ring is full.
+ */
+static unsigned
+serve(gpsrv_slot_t *slot) {
+	uint32_t tail = slot->cmd_tail, head;
+	unsigned count = 0;
+
+	head = __atomic_load_n(&slot->cmd_head,__ATOMIC_ACQUIRE);
+	if ( head - tail > GPSRV_RING ) {
+		bool rearm = slot->sub_mask != 0;
+
+		fprintf(stderr,"Dropped broken slot of pid %d\n",(int)slot->pid);
+		++broken;
+		slot_reset(slot);
+		if ( rearm )
+			edges_rearm();
+		return 0;
+	}
+	for ( ; tail != head; ++tail, ++count ) {
+		const gpsrv_cmd_t *cmd = &slot->cmd[tail & (GPSRV_RING - 1)];
+		uint32_t rhead = slot->rsp_head;
+		gpsrv_rsp_t *rsp = &slot->rsp[rhead & (GPSRV_RING - 1)];
+
+		if ( rhead - __atomic_load_n(&slot->rsp_tail,__ATOMIC_ACQUIRE) >= GPSRV_RING )
+			break;			// Response ring full
+		rsp->rc = execute(slot,cmd,&rsp->value);
+		rsp->seq = cmd->seq;
+		__atomic_store_n(&slot->rsp_head,rhead + 1,__ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&slot->cmd_tail,tail,__ATOMIC_RELEASE);
+	return count;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-G group] [-m mask] [-i idle_us] [-h]\n"
+		"where:\n"
+		"\t-G group\tGroup permitted to connect (owner only otherwise)\n"
+		"\t-m mask\tBank 0 pins clients may use (0x0FFFFFFF)\n"
+		"\t-i usecs\tSleep when idle this long (0: always spin)\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hG:m:i:";
+	struct sigaction new_action;
+	const char *opt_group = 0;
+	uint32_t opt_mask = 0x0FFFFFFF;
+	long opt_idle = 1000;
+	struct timespec now, tlast, tcheck;
+	int oc, fd;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'G':
+			opt_group = optarg;
+			break;
+		case 'm':
+			opt_mask = strtoul(optarg,0,0);
+			break;
+		case 'i':
+			opt_idle = atol(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+
+	if ( server_running() ) {
+		fprintf(stderr,"A gpsrv is already serving %s\n",GPSRV_SHM);
+		exit(2);
+	}
+	shm_unlink(GPSRV_SHM);			// Stale, or not ours
+	fd = shm_open(GPSRV_SHM,O_RDWR|O_CREAT|O_EXCL,0600);
+	if ( fd < 0 || ftruncate(fd,sizeof *srv) < 0 ) {
+		fprintf(stderr,"%s: creating shm %s\n",strerror(errno),GPSRV_SHM);
+		exit(2);
+	}
+	if ( opt_group ) {
+		struct group *gr = getgrnam(opt_group);
+
+		if ( !gr || fchown(fd,-1,gr->gr_gid) < 0 || fchmod(fd,0660) < 0 ) {
+			fprintf(stderr,"Unable to grant group %s access\n",opt_group);
+			exit(2);
+		}
+	}
+	srv = (gpsrv_t *)mmap(NULL,sizeof *srv,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if ( srv == MAP_FAILED ) {
+		perror("mmap");
+		exit(2);
+	}
+
+	memset(srv,0,sizeof *srv);
+	srv->version = GPSRV_VERSION;
+	srv->server = getpid();
+	srv->allowed = opt_mask;
+	__atomic_store_n(&srv->magic,GPSRV_MAGIC,__ATOMIC_RELEASE);
+
+	new_action.sa_handler = sig_handler;
+	sigemptyset(&new_action.sa_mask);
+	new_action.sa_flags = 0;
+	sigaction(SIGINT,&new_action,NULL);
+	sigaction(SIGTERM,&new_action,NULL);
+
+	printf("gpsrv: %s ready, pid %d, pins %08X\n",GPSRV_SHM,(int)getpid(),opt_mask);
+	fflush(stdout);
+
+	clock_gettime(CLOCK_MONOTONIC,&tlast);
+	tcheck = tlast;
+
+	while ( !is_signaled ) {
+		unsigned work = 0;
+
+		for ( int x=0; x<GPSRV_SLOTS; ++x )
+			if ( srv->slots[x].pid )
+				work += serve(&srv->slots[x]);
+		if ( edges )
+			edges_dispatch();
+		srv->ops += work;
+
+		if ( work || edges ) {
+			if ( work )
+				clock_gettime(CLOCK_MONOTONIC,&tlast);
+			continue;
+		}
+
+		/*
+		 * Idle: now and then reclaim slots of dead clients, and
+		 * once idle for long enough stop spinning.
+		 */
+		clock_gettime(CLOCK_MONOTONIC,&now);
+		if ( now.tv_sec != tcheck.tv_sec ) {
+			bool rearm = false;
+
+			for ( int x=0; x<GPSRV_SLOTS; ++x ) {
+				pid_t pid = srv->slots[x].pid;
+
+				if ( pid && kill(pid,0) < 0 && errno == ESRCH ) {
+					rearm |= srv->slots[x].sub_mask != 0;
+					slot_reset(&srv->slots[x]);
+				}
+			}
+			if ( rearm )
+				edges_rearm();
+			tcheck = now;
+		}
+		if ( opt_idle > 0 ) {
+			long idle = (now.tv_sec - tlast.tv_sec) * 1000000L
+				+ (now.tv_nsec - tlast.tv_nsec) / 1000;
+
+			if ( idle > opt_idle )
+				usleep(100);
+		} else	sched_yield();
+	}
+
+	if ( edges )
+		gpio_edge_close(edges);
+	if ( broken )
+		fprintf(stderr,"%lu broken slots dropped\n",broken);
+	srv->magic = 0;
+	munmap(srv,sizeof *srv);
+	shm_unlink(GPSRV_SHM);
+	gpio_close();
+	return 0;
+}
+
+// End gpsrv.c
@@ -0,0 +1,253 @@
+/* Live libgp instrumentation reader: gpstat.c
+ * Warren W. Gay ve3wwg
+ *
+ * Attaches to the counter segment of a process using a libgp built
+ * with STATS=1 and prints per operation call rates and times, and the
+ * busiest pins, every interval.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gpstats.h"
+
+#define MAX_SEGS	64
+
+static volatile bool is_signaled = false;
+
+static void
+sig_handler(int signo) {
+	is_signaled = true;
+}
+
+static bool
+alive(pid_t pid) {
+	return kill(pid,0) == 0 || errno == EPERM;
+}
+
+static double
+to_ns(const gpstat_t *s,uint64_t ticks) {
+	return s->tick_hz ? ticks * 1e9 / s->tick_hz : 0.0;
+}
+
+/*
+ * Upper bound (ticks) of the bucket holding the pct percentile
+ */
+static uint64_t
+percentile(const gpstat_op_t *o,double pct) {
+	uint64_t total = 0, want, sum = 0;
+
+	for ( int b=0; b<GPSTAT_BUCKETS; ++b )
+		total += o->hist[b];
+	if ( !total )
+		return 0;
+	want = (uint64_t)(total * pct / 100.0 + 0.5);
+	for ( int b=0; b<GPSTAT_BUCKETS; ++b )
+		if ( (sum += o->hist[b]) >= want ) {
+			uint64_t bound = b ? (1ull << b) - 1 : 0;
+
+			return bound < o->max_ticks ? bound : o->max_ticks;
+		}
+	return o->max_ticks;
+}
+
+static int
+list_segments(bool clean) {
+	pid_t pids[MAX_SEGS];
+	int n = gpstat_list(pids,MAX_SEGS);
+
+	if ( !n )
+		printf("No instrumented processes (libgp built with STATS=1)\n");
+	for ( int x=0; x<n; ++x ) {
+		const gpstat_t *s = gpstat_attach(pids[x]);
+		bool live = alive(pids[x]);
+
+		printf("%8d %-16s %s\n",(int)pids[x],s ? s->comm : "?",
+			live ? "running" : clean ? "stale, removed" : "stale");
+		gpstat_detach(s);
+		if ( !live && clean )
+			gpstat_remove(pids[x]);
+	}
+	return n;
+}
+
+static void
+report(const gpstat_t *prev,const gpstat_t *cur,double secs,int top,bool hist) {
+	struct {
+		int		gpio;
+		uint64_t	d[GpstatPinCounts];
+		uint64_t	sum;
+	} pins[GPSTAT_PINS], tmp;
+	int npins = 0;
+
+	printf("\n%d %s: %.1f s interval\n",(int)cur->pid,cur->comm,secs);
+	printf("%-18s %12s %14s %10s %10s %10s\n",
+		"operation","calls/s","calls","mean ns","p99 ns","max ns");
+
+	for ( int op=0; op<GpstatOps; ++op ) {
+		const gpstat_op_t *o = &cur->ops[op];
+		uint64_t dcalls = o->calls - prev->ops[op].calls;
+
+		if ( !o->calls )
+			continue;
+		printf("%-18s %12.0f %14llu %10.1f %10.0f %10.0f\n",
+			gpstat_op_name(op),dcalls / secs,(unsigned long long)o->calls,
+			to_ns(cur,o->ticks) / o->calls,
+			to_ns(cur,percentile(o,99.0)),to_ns(cur,o->max_ticks));
+
+		if ( hist ) {
+			for ( int b=0; b<GPSTAT_BUCKETS; ++b )
+				if ( o->hist[b] )
+					printf("%20s< %10.0f ns %14llu\n","",
+						to_ns(cur,1ull << b),(unsigned long long)o->hist[b]);
+		}
+	}
+
+	/*
+	 * Busiest pins over the interval (insertion sort, descending):
+	 */
+	for ( int gpio=0; gpio<GPSTAT_PINS; ++gpio ) {
+		int x;
+
+		tmp.gpio = gpio;
+		tmp.sum = 0;
+		for ( int c=0; c<GpstatPinCounts; ++c )
+			tmp.sum += tmp.d[c] = cur->pins[gpio][c] - prev->pins[gpio][c];
+		if ( !tmp.sum )
+			continue;
+		for ( x=npins++; x > 0 && pins[x-1].sum < tmp.sum; --x )
+			pins[x] = pins[x-1];
+		pins[x] = tmp;
+	}
+
+	if ( npins ) {
+		printf("%-6s","gpio");
+		for ( int c=0; c<GpstatPinCounts; ++c )
+			printf(" %10s/s",gpstat_pin_name(c));
+		putchar('\n');
+		for ( int x=0; x<npins && x<top; ++x ) {
+			printf("%-6d",pins[x].gpio);
+			for ( int c=0; c<GpstatPinCounts; ++c )
+				printf(" %12.0f",pins[x].d[c] / secs);
+			putchar('\n');
+		}
+	}
+	fflush(stdout);
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-p pid] [-i secs] [-n count] [-t top] [-H] [-l] [-C] [-h]\n"
+		"where:\n"
+		"\t-p pid\tProcess to watch (default: the only instrumented one)\n"
+		"\t-i secs\tReport interval (1)\n"
+		"\t-n count\tStop after count reports (0: until the process exits)\n"
+		"\t-t top\tBusiest pins listed (10)\n"
+		"\t-H\tAlso list each operation's time histogram\n"
+		"\t-l\tList instrumented processes\n"
+		"\t-C\tList, removing segments of processes that died\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hp:i:n:t:HlC";
+	pid_t opt_pid = 0;
+	double opt_interval = 1.0;
+	int opt_count = 0, opt_top = 10;
+	bool opt_hist = false;
+	const gpstat_t *seg;
+	gpstat_t *prev, *cur;
+	int oc;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'p':
+			opt_pid = atoi(optarg);
+			break;
+		case 'i':
+			opt_interval = strtod(optarg,0);
+			if ( opt_interval <= 0.0 ) {
+				fprintf(stderr,"Invalid interval: -i %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'n':
+			opt_count = atoi(optarg);
+			break;
+		case 't':
+			opt_top = atoi(optarg);
+			break;
+		case 'H':
+			opt_hist = true;
+			break;
+		case 'l':
+			list_segments(false);
+			exit(0);
+		case 'C':
+			list_segments(true);
+			exit(0);
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( !opt_pid ) {
+		pid_t pids[MAX_SEGS];
+		int n = gpstat_list(pids,MAX_SEGS), nlive = 0;
+
+		for ( int x=0; x<n; ++x )
+			if ( alive(pids[x]) ) {
+				opt_pid = pids[x];
+				++nlive;
+			}
+		if ( nlive != 1 ) {
+			list_segments(false);
+			if ( nlive > 1 )
+				fprintf(stderr,"Choose one with -p pid\n");
+			exit(1);
+		}
+	}
+
+	if ( !(seg = gpstat_attach(opt_pid)) ) {
+		fprintf(stderr,"%s: attaching to %s%d\n",strerror(errno),GPSTAT_SHM,(int)opt_pid);
+		exit(2);
+	}
+
+	prev = malloc(sizeof *prev);
+	cur = malloc(sizeof *cur);
+	memcpy(prev,seg,sizeof *prev);
+
+	signal(SIGINT,sig_handler);
+	signal(SIGTERM,sig_handler);
+
+	for ( int n=0; !is_signaled && (!opt_count || n < opt_count); ++n ) {
+		usleep((useconds_t)(opt_interval * 1e6));
+		memcpy(cur,seg,sizeof *cur);
+		report(prev,cur,opt_interval,opt_top,opt_hist);
+		memcpy(prev,cur,sizeof *prev);
+		if ( !alive(opt_pid) ) {
+			printf("Process %d exited\n",(int)opt_pid);
+			break;
+		}
+	}
+
+	gpstat_detach(seg);
+	free(prev);
+	free(cur);
+	return 0;
+}
+
+/* end gpstat.c */
@@ -0,0 +1,330 @@
+/* Scan a key matrix and post its keys through uinput:
+ * Warren W. Gay ve3wwg
+ *
+ * The matrix is scanned at a fixed rate (gpmatrix.h): rows driven low
+ * one at a time, all columns read per row, debounced per row and
+ * checked for ghosting after each scan. Every event is written to a
+ * uinput keyboard, and the time from the row read that completed its
+ * debounce to the end of the uinput write is measured.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "libgp.h"
+#include "gpdelay.h"
+#include "gprt.h"
+#include "gpmatrix.h"
+
+static int rows[GPIO_MATRIX_ROWS] = { 4, 5, 6, 12, 13, 16, 17, 18 };
+static int cols[GPIO_MATRIX_COLS] = { 20, 21, 22, 23, 24, 25, 26, 27 };
+static int nrows = 8, ncols = 8;
+
+/*
+ * Keys of the default 8x8 map, row major:
+ */
+static const unsigned keymap[8][8] = {
+	{ KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8 },
+	{ KEY_Q, KEY_W, KEY_E, KEY_R, KEY_T, KEY_Y, KEY_U, KEY_I },
+	{ KEY_A, KEY_S, KEY_D, KEY_F, KEY_G, KEY_H, KEY_J, KEY_K },
+	{ KEY_Z, KEY_X, KEY_C, KEY_V, KEY_B, KEY_N, KEY_M, KEY_COMMA },
+	{ KEY_9, KEY_0, KEY_O, KEY_P, KEY_L, KEY_DOT, KEY_SLASH, KEY_SEMICOLON },
+	{ KEY_ESC, KEY_TAB, KEY_SPACE, KEY_ENTER, KEY_BACKSPACE, KEY_MINUS, KEY_EQUAL, KEY_APOSTROPHE },
+	{ KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_HOME, KEY_END, KEY_PAGEUP, KEY_PAGEDOWN },
+	{ KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F8 },
+};
+
+static volatile bool is_signaled = false;
+
+static void
+sigint_handler(int signo) {
+	is_signaled = true;
+}
+
+static unsigned
+key_code(int row,int col) {
+	return row < 8 && col < 8 ? keymap[row][col] : KEY_RESERVED;
+}
+
+/*
+ * Open a uinput keyboard with the keys of the map:
+ */
+static int
+uinput_open(void) {
+	struct uinput_user_dev uinp;
+	int fd, rc;
+
+	fd = open("/dev/uinput",O_WRONLY|O_NONBLOCK);
+	if ( fd < 0 ) {
+		perror("Opening /dev/uinput");
+		exit(1);
+	}
+
+	rc = ioctl(fd,UI_SET_EVBIT,EV_KEY);
+	assert(!rc);
+	for ( int r=0; r<nrows; ++r )
+		for ( int c=0; c<ncols; ++c )
+			if ( key_code(r,c) != KEY_RESERVED ) {
+				rc = ioctl(fd,UI_SET_KEYBIT,key_code(r,c));
+				assert(!rc);
+			}
+
+	memset(&uinp,0,sizeof uinp);
+	strncpy(uinp.name,"keypad",UINPUT_MAX_NAME_SIZE);
+	uinp.id.bustype = BUS_HOST;
+	uinp.id.vendor  = 0x1;
+	uinp.id.product = 0x2;
+	uinp.id.version = 1;
+
+	rc = write(fd,&uinp,sizeof(uinp));
+	assert(rc == sizeof(uinp));
+
+	rc = ioctl(fd,UI_DEV_CREATE);
+	assert(!rc);
+	return fd;
+}
+
+/*
+ * Post a key event, or a synchronization point (type EV_SYN):
+ */
+static void
+uinput_post(int fd,unsigned type,unsigned code,int value) {
+	struct input_event ev;
+	int rc;
+
+	memset(&ev,0,sizeof(ev));
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	rc = write(fd,&ev,sizeof(ev));
+	assert(rc == sizeof(ev));
+}
+
+static void
+uinput_close(int fd) {
+	int rc;
+
+	rc = ioctl(fd,UI_DEV_DESTROY);
+	assert(!rc);
+	close(fd);
+}
+
+/*
+ * Parse a comma separated list of gpio numbers:
+ */
+static int
+parse_pins(const char *arg,int *pinv,int max) {
+	char *cp, *ep;
+	int n = 0;
+
+	for ( cp = (char *)arg; *cp && n < max; cp = ep ) {
+		pinv[n++] = strtol(cp,&ep,10);
+		if ( ep == cp )
+			return -1;
+		if ( *ep == ',' )
+			++ep;
+	}
+	return n;
+}
+
+static void
+usage(const char *cmd) {
+
+	printf(
+		"Usage:\t%s [-r gpios] [-c gpios] [-f hz] [-t scans] [-s ns] [-d] [-n] [-v] [-R prio[:cpu]] [-h]\n"
+		"where:\n"
+		"\t-r gpios\tComma separated row gpios (4,5,6,12,13,16,17,18)\n"
+		"\t-c gpios\tComma separated column gpios (20,21,22,23,24,25,26,27)\n"
+		"\t-f hz\tScans per second (1000)\n"
+		"\t-t scans\tDebounce: scans a change must last (4)\n"
+		"\t-s ns\tRow settling time before the column read (2000)\n"
+		"\t-d\tDiode per switch: no ghosting check\n"
+		"\t-n\tNo uinput device: print events only\n"
+		"\t-v\tPrint each event\n"
+		"\t-R p[:c]\tRun at SCHED_FIFO priority p (on cpu c), spinning between scans\n"
+		"\t-h\tThis help\n",
+		cmd);
+}
+
+int
+main(int argc,char **argv) {
+	static char options[] = "hr:c:f:t:s:dnvR:";
+	gpio_rt_opts_t rt_opts;
+	bool opt_rt = false, opt_diodes = false, opt_uinput = true, opt_verbose = false;
+	unsigned opt_debounce = 4;
+	uint32_t opt_settle = 2000;
+	double opt_hz = 1000.0;
+	uint64_t period, next, now, lat_min = ~0ull, lat_max = 0, lat_sum = 0, overruns = 0;
+	uint64_t t_start;
+	unsigned long nlat = 0;
+	gpio_matrix_t m;
+	gpio_matrix_event_t ev;
+	int oc, fd = -1;
+
+	while ( (oc = getopt(argc,argv,options)) != -1 ) {
+		switch ( oc ) {
+		case 'r':
+			nrows = parse_pins(optarg,rows,GPIO_MATRIX_ROWS);
+			if ( nrows <= 0 ) {
+				fprintf(stderr,"Invalid gpios: -r %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'c':
+			ncols = parse_pins(optarg,cols,GPIO_MATRIX_COLS);
+			if ( ncols <= 0 ) {
+				fprintf(stderr,"Invalid gpios: -c %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 'f':
+			opt_hz = strtod(optarg,0);
+			if ( opt_hz < 1.0 || opt_hz > 100000.0 ) {
+				fprintf(stderr,"Invalid scan rate: -f %s\n",optarg);
+				exit(1);
+			}
+			break;
+		case 't':
+			opt_debounce = atoi(optarg);
+			break;
+		case 's':
+			opt_settle = atoi(optarg);
+			break;
+		case 'd':
+			opt_diodes = true;
+			break;
+		case 'n':
+			opt_uinput = false;
+			opt_verbose = true;
+			break;
+		case 'v':
+			opt_verbose = true;
+			break;
+		case 'R':
+			if ( gpio_rt_parse(&rt_opts,optarg) ) {
+				fprintf(stderr,"Invalid priority[:cpu]: -R %s\n",optarg);
+				exit(1);
+			}
+			opt_rt = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if ( gpio_matrix_init(&m,rows,nrows,cols,ncols) ) {
+		fprintf(stderr,"Invalid matrix (bank 0, no duplicates, at most %d x %d)\n",
+			GPIO_MATRIX_ROWS,GPIO_MATRIX_COLS);
+		exit(1);
+	}
+	if ( gpio_matrix_debounce(&m,opt_debounce) ) {
+		fprintf(stderr,"Invalid debounce: -t %u (1 to %u)\n",opt_debounce,GPIO_DEBOUNCE_MAX);
+		exit(1);
+	}
+	gpio_delay_init(true);
+	gpio_matrix_set_settle(&m,opt_settle);
+	gpio_matrix_set_diodes(&m,opt_diodes);
+
+	if ( !gpio_open() ) {
+		fprintf(stderr,"Failed to mmap peripherals: Need root?\n");
+		exit(2);
+	}
+	gpio_matrix_configure(&m,Up);
+	if ( opt_uinput )
+		fd = uinput_open();
+	if ( opt_rt ) {
+		gpio_rt_enter(&rt_opts);
+		gpio_rt_report(stdout);
+	}
+
+	signal(SIGINT,sigint_handler);
+	printf("Scanning %d x %d at %.0f Hz, debounce %u scans (%.2f ms)%s\n",
+		nrows,ncols,opt_hz,opt_debounce,opt_debounce * 1e3 / opt_hz,
+		opt_diodes ? ", diodes" : "");
+	fflush(stdout);
+
+	period = (uint64_t)(1e9 / opt_hz);
+	t_start = next = gpio_delay_now();
+
+	while ( !is_signaled ) {
+		if ( gpio_matrix_scan(&m) ) {
+			uint64_t first = ~0ull;
+
+			while ( gpio_matrix_get(&m,&ev) ) {
+				unsigned code = key_code(ev.row,ev.col);
+
+				if ( ev.ns < first )
+					first = ev.ns;
+
+				if ( fd >= 0 && code != KEY_RESERVED )
+					uinput_post(fd,EV_KEY,code,ev.pressed);
+				if ( opt_verbose )
+					printf("row %d col %d %s (key %u)\n",ev.row,ev.col,
+						ev.pressed ? "down" : "up",code);
+			}
+			if ( fd >= 0 )
+				uinput_post(fd,EV_SYN,SYN_REPORT,0);
+
+			now = gpio_delay_now() - first;	// From the earliest read reported
+			if ( now < lat_min )
+				lat_min = now;
+			if ( now > lat_max )
+				lat_max = now;
+			lat_sum += now;
+			++nlat;
+			if ( opt_verbose )
+				fflush(stdout);
+		}
+
+		next += period;
+		now = gpio_delay_now();
+		if ( next <= now ) {
+			++overruns;
+			next = now;
+			continue;
+		}
+		if ( opt_rt )
+			gpio_spin_until(next);
+		else	{
+			struct timespec ts = { (next - now) / 1000000000, (next - now) % 1000000000 };
+
+			nanosleep(&ts,0);
+		}
+	}
+
+	if ( opt_rt )
+		gpio_rt_leave();
+	if ( fd >= 0 )
+		uinput_close(fd);
+
+	now = gpio_delay_now() - t_start;
+	printf("\n%llu scans in %.3f s (%.0f Hz), %llu overruns\n",
+		(unsigned long long)m.stats.scans,now / 1e9,m.stats.scans * 1e9 / now,
+		(unsigned long long)overruns);
+	printf("%llu events, %llu dropped; ghosting in %llu scans (%llu row scans held presses)\n",
+		(unsigned long long)m.stats.events,(unsigned long long)m.stats.dropped,
+		(unsigned long long)m.stats.ghosted,(unsigned long long)m.stats.held);
+	if ( nlat )
+		printf("Scan to event latency: min %.1f us, avg %.1f us, max %.1f us\n",
+			lat_min / 1e3,lat_sum / 1e3 / nlat,lat_max / 1e3);
+
+	gpio_close();
+	return 0;
+}
+
+/* end keypad.c */
@@ -0,0 +1,325 @@
+/* Parallel bus master gpbus.c
+ * Warren W. Gay ve3wwg
+ *
+ * Each cycle is a handful of GPSET0/GPCLR0 stores: data and RS are
+ * scattered through the virtual port tables into one set and one clear
+ * mask, then the strobe is toggled around calibrated spins. Delays are
+ * minimums: the stores themselves add their own bus latency.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "gpdelay.h"
+#include "gpbus.h"
+
+//////////////////////////////////////////////////////////////////////
+// Timing profiles (datasheet minimums, rounded up)
+//////////////////////////////////////////////////////////////////////
+
+static const gpio_bus_timing_t profiles[] = {
+	// name		type		setup	pulse	hold	access	recovery
+	{ "hd44780",	Bus6800,	60,	450,	20,	360,	500 },	// HD44780 character LCD
+	{ "6800",	Bus6800,	20,	160,	10,	120,	100 },	// Generic 6800 peripheral
+	{ "8080",	Bus8080,	10,	30,	10,	160,	30 },	// ILI9341/SSD1963 class
+	{ "latch",	Bus8080,	5,	20,	5,	0,	10 },	// 74HC573/74HC574 latch
+	{ "fast",	Bus8080,	0,	0,	0,	0,	0 },	// As fast as stores go
+	{ 0 }
+};
+
+const gpio_bus_timing_t *
+gpio_bus_profiles() {
+	return profiles;
+}
+
+const gpio_bus_timing_t *
+gpio_bus_profile(const char *name) {
+
+	for ( const gpio_bus_timing_t *p = profiles; p->name; ++p )
+		if ( !strcmp(p->name,name) )
+			return p;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Minimum time of one cycle for a profile
+//////////////////////////////////////////////////////////////////////
+
+static uint32_t
+after_ns(const gpio_bus_timing_t *tm) {
+	uint32_t rest = tm->recovery_ns > tm->setup_ns ? tm->recovery_ns - tm->setup_ns : 0;
+
+	return tm->hold_ns > rest ? tm->hold_ns : rest;
+}
+
+uint32_t
+gpio_bus_cycle_ns(const gpio_bus_timing_t *tm,bool read) {
+	uint32_t strobe = tm->pulse_ns;
+
+	if ( read && tm->access_ns > strobe )
+		strobe = tm->access_ns;
+	return tm->setup_ns + strobe + after_ns(tm);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compile the timing into spin counts
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_bus_set_timing(gpio_bus_t *bus,const gpio_bus_timing_t *tm) {
+
+	if ( !tm )
+		return EINVAL;
+	bus->timing = *tm;
+	bus->spin_setup = gpio_delay_spins(tm->setup_ns);
+	bus->spin_pulse = gpio_delay_spins(tm->pulse_ns);
+	bus->spin_access = gpio_delay_spins(tm->access_ns);
+	bus->spin_rest = gpio_delay_spins(tm->pulse_ns > tm->access_ns ? tm->pulse_ns - tm->access_ns : 0);
+	bus->spin_after = gpio_delay_spins(after_ns(tm));
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compile a bus: data[x] carries value bit x. rdwr, rs and cs may be
+// -1 when not wired (a bus without rdwr is write only).
+//////////////////////////////////////////////////////////////////////
+
+static int
+ctl_mask(int gpio,uint32_t *used,uint32_t *mask) {
+
+	*mask = 0;
+	if ( gpio < 0 )
+		return 0;
+	if ( gpio > 31 || (*used & (1u << gpio)) )
+		return EINVAL;		// Bank 0 only, no sharing
+	*mask = 1u << gpio;
+	*used |= *mask;
+	return 0;
+}
+
+int
+gpio_bus_init(gpio_bus_t *bus,const gpio_bus_timing_t *tm,const int *data,int ndata,
+  int strobe,int rdwr,int rs,int cs) {
+	uint32_t used;
+	int rc;
+
+	memset(bus,0,sizeof *bus);
+	if ( strobe < 0 )
+		return EINVAL;
+	if ( (rc = gpio_vport_init(&bus->data,data,ndata)) != 0 )
+		return rc;
+
+	used = bus->data.grp.mask;
+	if ( (rc = ctl_mask(strobe,&used,&bus->strobe)) != 0
+	  || (rc = ctl_mask(rdwr,&used,&bus->rdwr)) != 0
+	  || (rc = ctl_mask(rs,&used,&bus->rs)) != 0
+	  || (rc = ctl_mask(cs,&used,&bus->cs)) != 0 )
+		return rc;
+
+	bus->width = bus->data.nbytes == 1 ? 1 : bus->data.nbytes == 2 ? 2 : 4;
+
+	gpio_config_begin(&bus->cfg_in);
+	gpio_config_begin(&bus->cfg_out);
+	for ( int x=0; x<ndata; ++x ) {
+		gpio_config_io(&bus->cfg_in,data[x],Input);
+		gpio_config_io(&bus->cfg_out,data[x],Output);
+	}
+
+	return gpio_bus_set_timing(bus,tm);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Drive the control lines to idle, then make every line an output
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_bus_configure(gpio_bus_t *bus) {
+	gpio_config_t cfg = bus->cfg_out;
+	uint32_t ctl = bus->strobe | bus->rdwr | bus->rs | bus->cs;
+
+	if ( bus->timing.type == Bus8080 )
+		gpio_port_write(bus->strobe | bus->rdwr | bus->cs,bus->rs);
+	else	gpio_port_write(bus->cs,bus->strobe | bus->rdwr | bus->rs);
+
+	for ( int gpio=0; gpio<32; ++gpio )
+		if ( ctl & (1u << gpio) )
+			gpio_config_io(&cfg,gpio,Output);
+
+	bus->data_in = false;
+	return gpio_config_commit(&cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Cycles
+//////////////////////////////////////////////////////////////////////
+
+static inline void
+spin(uint32_t spins) {
+	if ( spins )
+		gpio_spin_n(spins);
+}
+
+static inline void
+bus_dir(gpio_bus_t *bus,bool in) {
+
+	if ( bus->data_in != in ) {
+		gpio_config_t cfg = in ? bus->cfg_in : bus->cfg_out;
+
+		gpio_config_commit(&cfg);
+		bus->data_in = in;
+	}
+}
+
+static inline void
+write_cycle(const gpio_bus_t *bus,uint32_t set,uint32_t clr) {
+
+	if ( bus->timing.type == Bus8080 ) {
+		if ( !bus->timing.setup_ns ) {
+			gpio_port_write(set,clr | bus->strobe);
+		} else	{
+			gpio_port_write(set,clr);
+			spin(bus->spin_setup);
+			gpio_port_write(0,bus->strobe);
+		}
+		spin(bus->spin_pulse);
+		gpio_port_write(bus->strobe,0);		// Data latched on /WR rising
+	} else	{
+		gpio_port_write(set,clr | bus->rdwr);	// R/W low: write
+		spin(bus->spin_setup);
+		gpio_port_write(bus->strobe,0);
+		spin(bus->spin_pulse);
+		gpio_port_write(0,bus->strobe);		// Data latched on E falling
+	}
+	spin(bus->spin_after);
+}
+
+static inline uint32_t
+read_cycle(const gpio_bus_t *bus,uint32_t set,uint32_t clr) {
+	uint32_t lev;
+
+	if ( bus->timing.type == Bus8080 ) {
+		gpio_port_write(set,clr);
+		spin(bus->spin_setup);
+		gpio_port_write(0,bus->rdwr);
+		spin(bus->spin_access);
+		lev = gpio_read32();
+		spin(bus->spin_rest);
+		gpio_port_write(bus->rdwr,0);
+	} else	{
+		gpio_port_write(set | bus->rdwr,clr);	// R/W high: read
+		spin(bus->spin_setup);
+		gpio_port_write(bus->strobe,0);
+		spin(bus->spin_access);
+		lev = gpio_read32();
+		spin(bus->spin_rest);
+		gpio_port_write(0,bus->strobe);
+	}
+	spin(bus->spin_after);
+	return gpio_vport_gather(&bus->data,lev);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Single transfers: /CS is asserted around each one
+//////////////////////////////////////////////////////////////////////
+
+typedef union {			// One element of width bytes
+	uint8_t		u8;
+	uint16_t	u16;
+	uint32_t	u32;
+} bus_elem_t;
+
+int
+gpio_bus_write(gpio_bus_t *bus,bool rs,uint32_t value) {
+	bus_elem_t e;
+
+	if ( bus->width == 1 )
+		e.u8 = value;
+	else if ( bus->width == 2 )
+		e.u16 = value;
+	else	e.u32 = value;
+	return gpio_bus_write_buf(bus,rs,&e,1);
+}
+
+int
+gpio_bus_read(gpio_bus_t *bus,bool rs,uint32_t *value) {
+	bus_elem_t e;
+	int rc;
+
+	if ( (rc = gpio_bus_read_buf(bus,rs,&e,1)) != 0 )
+		return rc;
+	*value = bus->width == 1 ? e.u8 : bus->width == 2 ? e.u16 : e.u32;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Bulk transfers: /CS stays asserted for the whole buffer
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_bus_write_buf(gpio_bus_t *bus,bool rs,const void *buf,size_t count) {
+	uint32_t rs_set = rs ? bus->rs : 0;
+	uint32_t rs_clr = (rs ? 0 : bus->rs) | bus->cs;
+	uint32_t set, clr;
+
+	if ( !count )
+		return 0;
+	bus_dir(bus,false);
+
+	switch ( bus->width ) {
+	case 1:
+		for ( size_t x=0; x<count; ++x ) {
+			const gpio_vport_wr_t *wr = &bus->data.wr[0][((const uint8_t *)buf)[x]];
+
+			write_cycle(bus,wr->set | rs_set,wr->clr | rs_clr);
+		}
+		break;
+	case 2:
+		for ( size_t x=0; x<count; ++x ) {
+			gpio_vport_scatter(&bus->data,((const uint16_t *)buf)[x],&set,&clr);
+			write_cycle(bus,set | rs_set,clr | rs_clr);
+		}
+		break;
+	default:
+		for ( size_t x=0; x<count; ++x ) {
+			gpio_vport_scatter(&bus->data,((const uint32_t *)buf)[x],&set,&clr);
+			write_cycle(bus,set | rs_set,clr | rs_clr);
+		}
+	}
+
+	if ( bus->cs )
+		gpio_port_write(bus->cs,0);
+	return 0;
+}
+
+int
+gpio_bus_read_buf(gpio_bus_t *bus,bool rs,void *buf,size_t count) {
+	uint32_t rs_set = rs ? bus->rs : 0;
+	uint32_t rs_clr = (rs ? 0 : bus->rs) | bus->cs;
+
+	if ( !bus->rdwr )
+		return EINVAL;		// Write only bus
+	if ( !count )
+		return 0;
+	bus_dir(bus,true);
+
+	for ( size_t x=0; x<count; ++x ) {
+		uint32_t v = read_cycle(bus,rs_set,rs_clr);
+
+		switch ( bus->width ) {
+		case 1:
+			((uint8_t *)buf)[x] = v;
+			break;
+		case 2:
+			((uint16_t *)buf)[x] = v;
+			break;
+		default:
+			((uint32_t *)buf)[x] = v;
+		}
+	}
+
+	if ( bus->cs )
+		gpio_port_write(bus->cs,0);
+	return 0;
+}
+
+/* end gpbus.c */
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////
+// gpbus.h -- Parallel 8080/6800 style bus master on GPSET0/GPCLR0
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPBUS_H
+#define GPBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libgp.h"
+#include "gpvport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum BusType {	// Strobe protocol:
+	Bus8080,	// Active low /WR and /RD strobes
+	Bus6800		// R/W level plus active high E strobe
+} BusType;
+
+//////////////////////////////////////////////////////////////////////
+// Cycle timing. setup_ns runs from data/RS valid to the strobe, and
+// pulse_ns is the strobe width. Writes hold data hold_ns after the
+// strobe ends; reads sample GPLEV0 access_ns into the strobe. The
+// strobe stays inactive at least recovery_ns between cycles.
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	const char	*name;		// Profile name
+	BusType		type;		// Strobe protocol
+	uint32_t	setup_ns;	// Address/data setup to strobe
+	uint32_t	pulse_ns;	// Strobe active width
+	uint32_t	hold_ns;	// Data hold after strobe
+	uint32_t	access_ns;	// Strobe to read data valid
+	uint32_t	recovery_ns;	// Strobe inactive between cycles
+} gpio_bus_timing_t;
+
+const gpio_bus_timing_t *gpio_bus_profile(const char *name);
+const gpio_bus_timing_t *gpio_bus_profiles();	// Ends with name == 0
+
+typedef struct {
+	gpio_bus_timing_t timing;	// Active profile
+	gpio_vport_t	data;		// Data lines
+	int		width;		// Buffer element bytes (1, 2 or 4)
+	uint32_t	strobe;		// /WR (8080) or E (6800) mask
+	uint32_t	rdwr;		// /RD (8080) or R/W (6800) mask, or 0
+	uint32_t	rs;		// RS (D/C) mask, or 0
+	uint32_t	cs;		// Active low /CS mask, or 0
+	bool		data_in;	// Data lines are inputs
+	gpio_config_t	cfg_in;		// Data lines to inputs
+	gpio_config_t	cfg_out;	// Data lines to outputs
+	uint32_t	spin_setup;	// Compiled spin counts
+	uint32_t	spin_pulse;
+	uint32_t	spin_access;
+	uint32_t	spin_rest;	// Read strobe remaining after sample
+	uint32_t	spin_after;	// After strobe end: hold and recovery
+} gpio_bus_t;
+
+int gpio_bus_init(gpio_bus_t *bus,const gpio_bus_timing_t *timing,const int *data,int ndata,
+	int strobe,int rdwr,int rs,int cs);
+int gpio_bus_set_timing(gpio_bus_t *bus,const gpio_bus_timing_t *timing);
+int gpio_bus_configure(gpio_bus_t *bus);
+uint32_t gpio_bus_cycle_ns(const gpio_bus_timing_t *timing,bool read);
+
+int gpio_bus_write(gpio_bus_t *bus,bool rs,uint32_t value);
+int gpio_bus_read(gpio_bus_t *bus,bool rs,uint32_t *value);
+
+// Buffers hold width byte elements: uint8_t, uint16_t or uint32_t
+int gpio_bus_write_buf(gpio_bus_t *bus,bool rs,const void *buf,size_t count);
+int gpio_bus_read_buf(gpio_bus_t *bus,bool rs,void *buf,size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPBUS_H
+
+// End gpbus.h
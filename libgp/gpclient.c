@@ -0,0 +1,180 @@
+/* gpsrv client side gpclient.c
+ * Warren W. Gay ve3wwg
+ *
+ * A client claims a slot in the server's shared memory block once, and
+ * from then on every operation is a store into its command ring and a
+ * spin on its response ring: no system calls in the steady state.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gpclient.h"
+
+#define SPINS_BEFORE_YIELD	4096
+
+//////////////////////////////////////////////////////////////////////
+// Attach to the server and claim a free slot
+//////////////////////////////////////////////////////////////////////
+
+gpc_t *
+gpc_open() {
+	int fd = shm_open(GPSRV_SHM,O_RDWR,0);
+	gpc_t *gpc;
+	gpsrv_t *srv;
+
+	if ( fd < 0 )
+		return 0;			// No server or no permission
+	srv = (gpsrv_t *)mmap(NULL,sizeof *srv,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if ( srv == MAP_FAILED )
+		return 0;
+	if ( srv->magic != GPSRV_MAGIC || srv->version != GPSRV_VERSION ) {
+		munmap(srv,sizeof *srv);
+		errno = EPROTO;
+		return 0;
+	}
+
+	if ( !(gpc = calloc(1,sizeof *gpc)) ) {
+		munmap(srv,sizeof *srv);
+		return 0;
+	}
+	gpc->srv = srv;
+
+	for ( int x=0; x<GPSRV_SLOTS; ++x ) {
+		int32_t expect = 0;
+
+		if ( __atomic_compare_exchange_n(&srv->slots[x].pid,&expect,(int32_t)getpid(),
+		  false,__ATOMIC_ACQ_REL,__ATOMIC_RELAXED) ) {
+			gpc->slot = &srv->slots[x];
+			gpc->seq = gpc->slot->cmd_head;
+			return gpc;
+		}
+	}
+
+	munmap(srv,sizeof *srv);
+	free(gpc);
+	errno = EBUSY;				// All slots taken
+	return 0;
+}
+
+void
+gpc_close(gpc_t *gpc) {
+
+	if ( gpc->slot->sub_mask )
+		gpc_subscribe(gpc,0,0);
+	__atomic_store_n(&gpc->slot->pid,0,__ATOMIC_RELEASE);
+	munmap(gpc->srv,sizeof *gpc->srv);
+	free(gpc);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Issue one command and wait for its response
+//////////////////////////////////////////////////////////////////////
+
+int
+gpc_call(gpc_t *gpc,gpsrv_op_t op,int gpio,uint32_t a,uint32_t b,uint32_t *value) {
+	gpsrv_slot_t *slot = gpc->slot;
+	uint32_t head = slot->cmd_head;
+	gpsrv_cmd_t *cmd = &slot->cmd[head & (GPSRV_RING - 1)];
+	unsigned spins = 0;
+
+	cmd->seq = ++gpc->seq;
+	cmd->op = op;
+	cmd->gpio = gpio;
+	cmd->a = a;
+	cmd->b = b;
+	__atomic_store_n(&slot->cmd_head,head + 1,__ATOMIC_RELEASE);
+
+	for (;;) {
+		uint32_t tail = slot->rsp_tail;
+
+		if ( tail != __atomic_load_n(&slot->rsp_head,__ATOMIC_ACQUIRE) ) {
+			gpsrv_rsp_t rsp = slot->rsp[tail & (GPSRV_RING - 1)];
+
+			__atomic_store_n(&slot->rsp_tail,tail + 1,__ATOMIC_RELEASE);
+			if ( rsp.seq != gpc->seq )
+				continue;		// Stale answer
+			if ( value )
+				*value = rsp.value;
+			return rsp.rc;
+		}
+		if ( ++spins % SPINS_BEFORE_YIELD == 0 ) {
+			if ( kill(gpc->srv->server,0) < 0 && errno == ESRCH )
+				return EPIPE;		// Server has gone
+			sched_yield();
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// libgp style wrappers
+//////////////////////////////////////////////////////////////////////
+
+int
+gpc_read(gpc_t *gpc,int gpio) {
+	uint32_t v;
+	int rc = gpc_call(gpc,GpsrvRead,gpio,0,0,&v);
+
+	return rc ? -rc : (int)v;
+}
+
+int
+gpc_write(gpc_t *gpc,int gpio,int bit) {
+	return gpc_call(gpc,GpsrvWrite,gpio,!!bit,0,0);
+}
+
+uint32_t
+gpc_read32(gpc_t *gpc) {
+	uint32_t v = 0;
+
+	gpc_call(gpc,GpsrvRead32,0,0,0,&v);
+	return v;
+}
+
+int
+gpc_port_write(gpc_t *gpc,uint32_t set,uint32_t clear) {
+	return gpc_call(gpc,GpsrvPort,0,set,clear,0);
+}
+
+int
+gpc_configure_io(gpc_t *gpc,int gpio,IO io) {
+	return gpc_call(gpc,GpsrvConfig,gpio,(uint32_t)io,0,0);
+}
+
+int
+gpc_configure_pullup(gpc_t *gpc,int gpio,Pull pull) {
+	return gpc_call(gpc,GpsrvPull,gpio,(uint32_t)pull,0,0);
+}
+
+int
+gpc_subscribe(gpc_t *gpc,uint32_t mask,unsigned flags) {
+	return gpc_call(gpc,GpsrvSubscribe,0,mask,flags,0);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Fetch the next edge event for this client, if any
+//////////////////////////////////////////////////////////////////////
+
+bool
+gpc_event(gpc_t *gpc,gpio_edge_event_t *ev) {
+	gpsrv_slot_t *slot = gpc->slot;
+	uint32_t tail = slot->ev_tail;
+
+	if ( tail == __atomic_load_n(&slot->ev_head,__ATOMIC_ACQUIRE) )
+		return false;
+	*ev = slot->ev[tail & (GPSRV_EVRING - 1)];
+	__atomic_store_n(&slot->ev_tail,tail + 1,__ATOMIC_RELEASE);
+	return true;
+}
+
+/* end gpclient.c */
@@ -0,0 +1,45 @@
+//////////////////////////////////////////////////////////////////////
+// gpclient.h -- Unprivileged GPIO access through gpsrv
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPCLIENT_H
+#define GPCLIENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpedge.h"
+#include "gpsrv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	gpsrv_t		*srv;		// Mapped server block
+	gpsrv_slot_t	*slot;		// Our slot
+	uint32_t	seq;		// Last sequence number sent
+} gpc_t;
+
+gpc_t *gpc_open();
+void gpc_close(gpc_t *gpc);
+
+int gpc_call(gpc_t *gpc,gpsrv_op_t op,int gpio,uint32_t a,uint32_t b,uint32_t *value);
+
+int gpc_read(gpc_t *gpc,int gpio);
+int gpc_write(gpc_t *gpc,int gpio,int bit);
+uint32_t gpc_read32(gpc_t *gpc);
+int gpc_port_write(gpc_t *gpc,uint32_t set,uint32_t clear);
+int gpc_configure_io(gpc_t *gpc,int gpio,IO io);
+int gpc_configure_pullup(gpc_t *gpc,int gpio,Pull pull);
+int gpc_subscribe(gpc_t *gpc,uint32_t mask,unsigned flags);
+bool gpc_event(gpc_t *gpc,gpio_edge_event_t *ev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPCLIENT_H
+
+// End gpclient.h
@@ -0,0 +1,57 @@
+/* Bit-sliced debouncer gpdebounce.c
+ * Warren W. Gay ve3wwg
+ *
+ * gpio_debounce_sample() (gpdebounce.h) does the work: a ripple-carry
+ * add across the count planes and an equality test against the
+ * threshold planes, for all 32 pins at once. These set up the state.
+ */
+#include <string.h>
+#include <errno.h>
+
+#include "gpdebounce.h"
+
+//////////////////////////////////////////////////////////////////////
+// Start with every pin stable at its initial level
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_debounce_init(gpio_debounce_t *db,uint32_t initial,unsigned threshold) {
+
+	memset(db,0,sizeof *db);
+	db->stable = initial;
+	gpio_debounce_threshold(db,~0u,threshold ? threshold : 1);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Set the threshold (samples) of the pins in mask. Counts in progress
+// for those pins restart.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_debounce_threshold(gpio_debounce_t *db,uint32_t mask,unsigned threshold) {
+
+	if ( threshold < 1 || threshold > GPIO_DEBOUNCE_MAX )
+		return ERANGE;
+
+	for ( int k=0; k<GPIO_DEBOUNCE_BITS; ++k ) {
+		if ( threshold & (1u << k) )
+			db->thr[k] |= mask;
+		else	db->thr[k] &= ~mask;
+		db->cnt[k] &= ~mask;
+	}
+	return 0;
+}
+
+unsigned
+gpio_debounce_get_threshold(const gpio_debounce_t *db,int gpio) {
+	unsigned threshold = 0;
+
+	if ( gpio < 0 || gpio > 31 )
+		return 0;
+	for ( int k=0; k<GPIO_DEBOUNCE_BITS; ++k )
+		if ( db->thr[k] & (1u << gpio) )
+			threshold |= 1u << k;
+	return threshold;
+}
+
+/* end gpdebounce.c */
@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////
+// gpdebounce.h -- Bit-sliced debouncer for the 32 bank 0 inputs
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPDEBOUNCE_H
+#define GPDEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Vertical counters: bit x of cnt[k] is bit k of pin x's count of
+// consecutive samples disagreeing with its stable level. A sample
+// that agrees resets the count; the count reaching the pin's
+// threshold (1 to GPIO_DEBOUNCE_MAX samples) flips the stable level.
+// Thresholds are held the same way, as bit planes in thr[k].
+//////////////////////////////////////////////////////////////////////
+
+#define GPIO_DEBOUNCE_BITS	5
+#define GPIO_DEBOUNCE_MAX	((1u << GPIO_DEBOUNCE_BITS) - 1)
+
+typedef struct {
+	uint32_t	stable;				// Debounced levels
+	uint32_t	changed;			// Pins flipped by the last sample
+	uint32_t	cnt[GPIO_DEBOUNCE_BITS];	// Count bit planes
+	uint32_t	thr[GPIO_DEBOUNCE_BITS];	// Threshold bit planes
+	uint64_t	samples;			// Samples taken
+} gpio_debounce_t;
+
+void gpio_debounce_init(gpio_debounce_t *db,uint32_t initial,unsigned threshold);
+int gpio_debounce_threshold(gpio_debounce_t *db,uint32_t mask,unsigned threshold);
+unsigned gpio_debounce_get_threshold(const gpio_debounce_t *db,int gpio);
+
+//////////////////////////////////////////////////////////////////////
+// Feed one GPLEV0 sample; returns the mask of pins that changed
+//////////////////////////////////////////////////////////////////////
+
+static inline uint32_t
+gpio_debounce_sample(gpio_debounce_t *db,uint32_t raw) {
+	uint32_t diff = raw ^ db->stable;
+	uint32_t carry = diff, ne = 0, c;
+
+	for ( int k=0; k<GPIO_DEBOUNCE_BITS; ++k ) {
+		c = db->cnt[k];
+		db->cnt[k] = (c ^ carry) & diff;	// Count up, or reset when equal
+		carry &= c;
+		ne |= db->cnt[k] ^ db->thr[k];
+	}
+	diff &= ~ne;					// Reached the threshold
+	for ( int k=0; k<GPIO_DEBOUNCE_BITS; ++k )
+		db->cnt[k] &= ~diff;
+	db->stable ^= diff;
+	db->changed = diff;
+	++db->samples;
+	return diff;
+}
+
+static inline uint32_t
+gpio_debounce_poll(gpio_debounce_t *db) {
+	return gpio_debounce_sample(db,gpio_read32());
+}
+
+static inline uint32_t
+gpio_debounce_rose(const gpio_debounce_t *db) {
+	return db->changed & db->stable;
+}
+
+static inline uint32_t
+gpio_debounce_fell(const gpio_debounce_t *db) {
+	return db->changed & ~db->stable;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPDEBOUNCE_H
+
+// End gpdebounce.h
@@ -0,0 +1,295 @@
+/* Calibrated busy-wait delays gpdelay.c
+ * Warren W. Gay ve3wwg
+ *
+ * The spin loop rate is measured against CLOCK_MONOTONIC_RAW and cached
+ * on disk, keyed by CPU model and current frequency, so later runs start
+ * without recalibrating. Short delays count spins; delays longer than
+ * GPIO_SPIN_CLOCK_NS spin on the clock itself to avoid accumulating
+ * rate error. gpio_delay_check() measures drift and recalibrates.
+ */
+#define _GNU_SOURCE			// secure_getenv(3)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "gpdelay.h"
+
+#define CAL_VERSION	1		// Bump when gpio_spin_n() changes
+
+static gpio_delay_info_t info;
+static bool calibrated = false;
+
+//////////////////////////////////////////////////////////////////////
+// Primitives
+//////////////////////////////////////////////////////////////////////
+
+uint64_t
+gpio_delay_now() {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW,&t);
+	return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+/*
+ * The calibrated loop. Kept out of line so that its speed does not
+ * depend on the caller's compiler flags.
+ */
+void __attribute__((noinline))
+gpio_spin_n(uint32_t spins) {
+	while ( spins-- > 0 )
+		asm volatile("");
+}
+
+//////////////////////////////////////////////////////////////////////
+// Build the cache key: CPU model and current frequency
+//////////////////////////////////////////////////////////////////////
+
+static void
+delay_key(char *key,size_t keysz) {
+	char line[256], model[96] = "unknown";
+	unsigned long khz = 0;
+	FILE *f;
+
+	if ( (f = fopen("/proc/cpuinfo","r")) != 0 ) {
+		while ( fgets(line,sizeof line,f) ) {
+			char *colon = strchr(line,':');
+			char *name = line, *val;
+			size_t n;
+
+			if ( !colon )
+				continue;
+			for ( n = colon - line; n > 0 && isspace((unsigned char)line[n-1]); --n )
+				;
+			for ( val = colon + 1; isspace((unsigned char)*val); ++val )
+				;
+			val[strcspn(val,"\n")] = 0;
+
+			// Pi "Model" is best; else the first "model name"
+			if ( n == 5 && !strncmp(name,"Model",5) ) {
+				snprintf(model,sizeof model,"%s",val);
+				break;
+			}
+			if ( n == 10 && !strncmp(name,"model name",10) && !strcmp(model,"unknown") )
+				snprintf(model,sizeof model,"%s",val);
+		}
+		fclose(f);
+	}
+
+	if ( (f = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq","r")) != 0 ) {
+		if ( fscanf(f,"%lu",&khz) != 1 )
+			khz = 0;
+		fclose(f);
+	}
+
+	snprintf(key,keysz,"v%d|%s|%lukHz",CAL_VERSION,model,khz);
+	for ( char *cp = key; *cp; ++cp )
+		if ( isspace((unsigned char)*cp) )
+			*cp = '_';
+}
+
+/*
+ * LIBGP_DELAY_CACHE is ignored in setuid programs, which run the cache
+ * code as root:
+ */
+static const char *
+cache_path() {
+	const char *path = secure_getenv("LIBGP_DELAY_CACHE");
+
+	return path && *path ? path : GPIO_DELAY_CACHE;
+}
+
+static bool
+cache_load() {
+	FILE *f = fopen(cache_path(),"r");
+	char key[128];
+	double rate;
+	unsigned ovh;
+	bool found = false;
+
+	if ( !f )
+		return false;
+	while ( fscanf(f,"%127s %lf %u",key,&rate,&ovh) == 3 ) {
+		if ( !strcmp(key,info.key) && rate > 0.0 ) {
+			info.spins_per_ns = rate;
+			info.overhead_ns = ovh;
+			found = true;
+		}
+	}
+	fclose(f);
+	return found;
+}
+
+/*
+ * Rewrite the cache with this key's entry replaced. The new copy is
+ * a fresh mkstemp() file, renamed over the cache only once complete:
+ */
+static void
+cache_save() {
+	const char *path = cache_path();
+	char tmp[256], line[256];
+	FILE *in, *out;
+	int fd, failed;
+
+	if ( snprintf(tmp,sizeof tmp,"%s.XXXXXX",path) >= (int)sizeof tmp )
+		return;
+	if ( (fd = mkstemp(tmp)) < 0 )
+		return;			// Cache is only an optimization
+	if ( fchmod(fd,0644) || !(out = fdopen(fd,"w")) ) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+
+	if ( (in = fopen(path,"r")) != 0 ) {
+		size_t klen = strlen(info.key);
+
+		while ( fgets(line,sizeof line,in) )
+			if ( strncmp(line,info.key,klen) || line[klen] != ' ' )
+				fputs(line,out);
+		fclose(in);
+	}
+	fprintf(out,"%s %.9f %u\n",info.key,info.spins_per_ns,info.overhead_ns);
+
+	failed = ferror(out);
+	if ( fclose(out) || failed || rename(tmp,path) )
+		unlink(tmp);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Measure the spin rate (best of several runs filters preemption)
+//////////////////////////////////////////////////////////////////////
+
+static void
+delay_calibrate() {
+	const uint32_t n = 2000000;
+	uint64_t t0, best = ~0ull;
+
+	for ( int x=0; x<5; ++x ) {
+		t0 = gpio_delay_now();
+		gpio_spin_n(n);
+		t0 = gpio_delay_now() - t0;
+		if ( t0 < best )
+			best = t0;
+	}
+	info.spins_per_ns = (double)n / (best ? best : 1);
+
+	best = ~0ull;
+	for ( int x=0; x<5; ++x ) {
+		t0 = gpio_delay_now();
+		for ( int k=0; k<1000; ++k )
+			gpio_spin_n(0);
+		t0 = gpio_delay_now() - t0;
+		if ( t0 < best )
+			best = t0;
+	}
+	info.overhead_ns = best / 1000;
+	info.from_cache = false;
+	++info.calibrations;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Calibrate (or load the cached calibration). Called implicitly by
+// the first delay, but early calls keep that cost out of timed code.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_delay_init(bool use_cache) {
+
+	delay_key(info.key,sizeof info.key);
+	if ( use_cache && cache_load() ) {
+		info.from_cache = true;
+	} else	{
+		delay_calibrate();
+		cache_save();
+	}
+	calibrated = true;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Measure a counted spin against the clock. If the error exceeds
+// tolerance_ppm, recalibrate and update the cache. Returns the
+// error found in ppm.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_delay_check(int32_t tolerance_ppm) {
+	const uint32_t ns = 200000;
+	uint64_t t0, best = ~0ull;
+	int32_t ppm;
+
+	if ( !calibrated )
+		gpio_delay_init(true);
+
+	for ( int x=0; x<3; ++x ) {
+		uint32_t spins = gpio_delay_spins(ns);
+
+		t0 = gpio_delay_now();
+		gpio_spin_n(spins);
+		t0 = gpio_delay_now() - t0;
+		if ( t0 < best )
+			best = t0;
+	}
+
+	ppm = (int32_t)(((int64_t)best - ns) * 1000000 / ns);
+	info.last_error_ppm = ppm;
+
+	if ( (ppm < 0 ? -ppm : ppm) > tolerance_ppm ) {
+		delay_key(info.key,sizeof info.key);	// Frequency may have moved
+		delay_calibrate();
+		cache_save();
+	}
+	return ppm;
+}
+
+const gpio_delay_info_t *
+gpio_delay_info() {
+	return &info;
+}
+
+void
+gpio_delay_report(FILE *out) {
+	fprintf(out,"delay: %s %.4f spins/ns, overhead %u ns, %s, %u calibrations, last error %+d ppm\n",
+		info.key,info.spins_per_ns,info.overhead_ns,
+		info.from_cache ? "cached" : "measured",
+		info.calibrations,info.last_error_ppm);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Delays
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_delay_spins(uint32_t ns) {
+
+	if ( !calibrated )
+		gpio_delay_init(true);
+	if ( ns <= info.overhead_ns )
+		return 0;
+	return (uint32_t)((ns - info.overhead_ns) * info.spins_per_ns);
+}
+
+void
+gpio_spin_until(uint64_t t_ns) {
+	while ( gpio_delay_now() < t_ns )
+		;
+}
+
+void
+gpio_spin_for(uint32_t ns) {
+
+	if ( ns > GPIO_SPIN_CLOCK_NS )
+		gpio_spin_until(gpio_delay_now() + ns);
+	else	gpio_spin_n(gpio_delay_spins(ns));
+}
+
+/* end gpdelay.c */
@@ -0,0 +1,45 @@
+//////////////////////////////////////////////////////////////////////
+// gpdelay.h -- Calibrated nanosecond busy-wait delays
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPDELAY_H
+#define GPDELAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIO_DELAY_CACHE	"/var/cache/libgp-delay.cache"	// Root owned directory
+#define GPIO_SPIN_CLOCK_NS	10000	// Longer spins follow the clock
+
+typedef struct {
+	char		key[128];	// CPU model @ frequency
+	double		spins_per_ns;	// Spin loop rate
+	uint32_t	overhead_ns;	// Cost of a zero length spin
+	bool		from_cache;	// Loaded rather than measured
+	unsigned	calibrations;	// Times measured in this process
+	int32_t		last_error_ppm;	// Result of last gpio_delay_check()
+} gpio_delay_info_t;
+
+int gpio_delay_init(bool use_cache);
+int gpio_delay_check(int32_t tolerance_ppm);
+const gpio_delay_info_t *gpio_delay_info();
+void gpio_delay_report(FILE *out);
+
+uint64_t gpio_delay_now();
+uint32_t gpio_delay_spins(uint32_t ns);
+void gpio_spin_n(uint32_t spins);
+void gpio_spin_for(uint32_t ns);
+void gpio_spin_until(uint64_t t_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPDELAY_H
+
+// End gpdelay.h
@@ -0,0 +1,494 @@
+/* DMA waveform chains gpdma.c
+ * Warren W. Gay ve3wwg
+ *
+ * A waveform step becomes up to three control blocks: copy the set
+ * mask to GPSET0, copy the clear mask to GPCLR0, then write ticks
+ * words to the PWM or PCM FIFO with DEST_DREQ set. The FIFO accepts
+ * one word per pacing period, so the DMA engine stalls for exactly
+ * ticks periods without the CPU. Samples are a copy of GPLEV0 into
+ * the chain's data words followed by one paced word.
+ *
+ * The software executor interprets the same control blocks, so a
+ * chain can be checked on any Linux host before it meets hardware.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gppwm.h"
+#include "gpdma.h"
+
+#define BUS_GPIO_PAGE	(DMA_BUS_PERI + GPIO_BASE_OFFSET)
+
+#define TI_STORE	(DMA_TI_NO_WIDE_BURSTS | DMA_TI_WAIT_RESP)
+
+static uint32_v *udma = 0;		// DMA controller page
+
+//////////////////////////////////////////////////////////////////////
+// VideoCore mailbox: uncached memory with a known bus address
+//////////////////////////////////////////////////////////////////////
+
+#define MBOX_IOCTL	_IOWR(100,0,char *)
+
+static uint32_t
+mbox_call(uint32_t tag,uint32_t n,const uint32_t *args) {
+	uint32_t buf[32];
+	int fd, rc;
+
+	memset(buf,0,sizeof buf);
+	buf[0] = (6 + n) * sizeof buf[0];	// Message bytes
+	buf[2] = tag;
+	buf[3] = n * sizeof buf[0];		// Value buffer bytes
+	buf[4] = n * sizeof buf[0];
+	memcpy(buf+5,args,n * sizeof *args);
+
+	if ( (fd = open("/dev/vcio",0)) < 0 )
+		return 0;
+	rc = ioctl(fd,MBOX_IOCTL,buf);
+	close(fd);
+	return rc < 0 ? 0 : buf[5];
+}
+
+static bool
+vc_alloc(gpio_dma_chain_t *ch) {
+	// Pi 1: L1 non-allocating alias, else direct (0xC alias)
+	uint32_t flags = gpio_peri_base() == 0x20000000 ? 0x0C : 0x04;
+	uint32_t args[3] = { ch->size, 4096, flags };
+	int fd;
+
+	if ( !(ch->handle = mbox_call(0x3000C,3,args)) )		// Allocate
+		return false;
+	if ( !(ch->bus = mbox_call(0x3000D,1,&ch->handle)) )		// Lock
+		return false;
+
+	if ( (fd = open("/dev/mem",O_RDWR|O_SYNC)) < 0 )
+		return false;
+	ch->virt = mmap(NULL,ch->size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,ch->bus & ~0xC0000000);
+	close(fd);
+	if ( ch->virt == MAP_FAILED ) {
+		ch->virt = 0;
+		return false;
+	}
+	return true;
+}
+
+static void
+vc_free(gpio_dma_chain_t *ch) {
+
+	if ( ch->virt )
+		munmap(ch->virt,ch->size);
+	if ( ch->bus )
+		mbox_call(0x3000E,1,&ch->handle);			// Unlock
+	if ( ch->handle )
+		mbox_call(0x3000F,1,&ch->handle);			// Release
+}
+
+//////////////////////////////////////////////////////////////////////
+// Create a chain with room for max_cbs control blocks and max_words
+// data words. tick_ns is the pacing period.
+//////////////////////////////////////////////////////////////////////
+
+gpio_dma_chain_t *
+gpio_dma_chain_new(int max_cbs,int max_words,GpioDmaPace pace,uint32_t tick_ns,bool hw) {
+	gpio_dma_chain_t *ch;
+	size_t cb_bytes = max_cbs * sizeof(gpio_dma_cb_t);
+
+	if ( max_cbs < 1 || max_words < 0 || !tick_ns ) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	ch = calloc(1,sizeof *ch);
+	if ( !ch )
+		return 0;
+	ch->pace = pace;
+	ch->tick_ns = tick_ns;
+	ch->hw = hw;
+	ch->size = (cb_bytes + (max_words + 1) * sizeof(uint32_t) + 4095) & ~(size_t)4095;
+	ch->loop_to = -1;
+	ch->channel = -1;
+
+	if ( hw ) {
+		if ( !vc_alloc(ch) ) {
+			int er = errno ? errno : ENOMEM;
+
+			vc_free(ch);
+			free(ch);
+			errno = er;
+			return 0;
+		}
+	} else	{
+		void *p;
+
+		if ( posix_memalign(&p,4096,ch->size) ) {
+			free(ch);
+			errno = ENOMEM;
+			return 0;
+		}
+		ch->virt = p;
+		ch->bus = DMA_BUS_SIM;
+	}
+
+	memset(ch->virt,0,ch->size);
+	ch->cbs = (gpio_dma_cb_t *)ch->virt;
+	ch->max_cbs = max_cbs;
+	ch->words = (uint32_t *)(ch->virt + cb_bytes);
+	ch->max_words = max_words + 1;
+	ch->nwords = 1;				// words[0]: pacing dummy
+	return ch;
+}
+
+void
+gpio_dma_chain_free(gpio_dma_chain_t *ch) {
+
+	gpio_dma_stop(ch);
+	if ( ch->hw )
+		vc_free(ch);
+	else	free(ch->virt);
+	free(ch);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Chain building
+//////////////////////////////////////////////////////////////////////
+
+static int
+cb_add(gpio_dma_chain_t *ch,uint32_t ti,uint32_t src,uint32_t dst,uint32_t len) {
+	gpio_dma_cb_t *cb;
+
+	if ( ch->ncbs >= ch->max_cbs )
+		return -1;
+
+	cb = &ch->cbs[ch->ncbs];
+	cb->ti = ti;
+	cb->source_ad = src;
+	cb->dest_ad = dst;
+	cb->txfr_len = len;
+	cb->stride = 0;
+	cb->nextconbk = 0;
+	if ( ch->ncbs > 0 )
+		ch->cbs[ch->ncbs-1].nextconbk = gpio_dma_bus(ch,cb);
+	return ch->ncbs++;
+}
+
+static uint32_t *
+word_add(gpio_dma_chain_t *ch,int n) {
+	uint32_t *w;
+
+	if ( ch->nwords + n > ch->max_words )
+		return 0;
+	w = ch->words + ch->nwords;
+	ch->nwords += n;
+	return w;
+}
+
+/*
+ * Stall for ticks pacing periods:
+ */
+static int
+cb_pace(gpio_dma_chain_t *ch,uint32_t ticks) {
+	uint32_t fifo = ch->pace == PacePwm ? PWM_FIF1 : PCM_FIFO_A;
+
+	return cb_add(ch,TI_STORE | DMA_TI_DEST_DREQ | DMA_TI_PERMAP(ch->pace),
+		gpio_dma_bus(ch,ch->words),fifo,ticks * sizeof(uint32_t));
+}
+
+//////////////////////////////////////////////////////////////////////
+// Append: store set to GPSET0, clear to GPCLR0, then wait ticks
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_dma_add_write(gpio_dma_chain_t *ch,uint32_t set,uint32_t clear,uint32_t ticks) {
+	int need = !!set + !!clear + !!ticks;
+	uint32_t *w;
+
+	if ( ch->ncbs + need > ch->max_cbs )
+		return ENOSPC;
+	if ( ticks > 0x3FFFFFFF / sizeof(uint32_t) )
+		return EINVAL;
+
+	if ( set ) {
+		if ( !(w = word_add(ch,1)) )
+			return ENOSPC;
+		*w = set;
+		cb_add(ch,TI_STORE,gpio_dma_bus(ch,w),DMA_BUS_GPSET0,sizeof *w);
+	}
+	if ( clear ) {
+		if ( !(w = word_add(ch,1)) )
+			return ENOSPC;
+		*w = clear;
+		cb_add(ch,TI_STORE,gpio_dma_bus(ch,w),DMA_BUS_GPCLR0,sizeof *w);
+	}
+	if ( ticks )
+		cb_pace(ch,ticks);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Append nsamples copies of GPLEV0, one per tick. *buf receives
+// the address the samples will be written to.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_dma_add_samples(gpio_dma_chain_t *ch,int nsamples,uint32_t **buf) {
+	uint32_t *w;
+
+	if ( ch->ncbs + nsamples * 2 > ch->max_cbs )
+		return ENOSPC;
+	if ( !(w = word_add(ch,nsamples)) )
+		return ENOSPC;
+
+	for ( int x=0; x<nsamples; ++x ) {
+		cb_add(ch,TI_STORE,DMA_BUS_GPLEV0,gpio_dma_bus(ch,w+x),sizeof *w);
+		cb_pace(ch,1);
+	}
+	if ( buf )
+		*buf = w;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Append a gpwave waveform, rounding each delay to whole ticks
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_dma_add_wave(gpio_dma_chain_t *ch,const gpio_wave_t *w) {
+	int rc;
+
+	for ( int x=0; x<w->nsteps; ++x ) {
+		uint32_t ticks = (w->delay_ns[x] + ch->tick_ns / 2) / ch->tick_ns;
+
+		if ( (rc = gpio_dma_add_write(ch,w->set[x],w->clear[x],ticks)) != 0 )
+			return rc;
+	}
+	return 0;
+}
+
+/*
+ * Make the last control block continue at first_cb (repeat forever):
+ */
+void
+gpio_dma_loop(gpio_dma_chain_t *ch,int first_cb) {
+
+	if ( ch->ncbs < 1 || first_cb < 0 || first_cb >= ch->ncbs )
+		return;
+	ch->cbs[ch->ncbs-1].nextconbk = gpio_dma_bus(ch,&ch->cbs[first_cb]);
+	ch->loop_to = first_cb;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Hardware DMA
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_dma_start(gpio_dma_chain_t *ch,int channel) {
+	const gpio_backend_t *be = gpio_get_backend();
+	uint32_v *regs;
+	int rc;
+
+	if ( !ch->hw || !ch->ncbs || channel < 0 || channel > 14 )
+		return EINVAL;
+	if ( !be || !ugpio )
+		return ENXIO;
+	if ( !udma && !(udma = (uint32_v *)be->map(DMA_BASE_OFFSET,4096)) )
+		return errno ? errno : ENODEV;
+
+	if ( ch->pace == PacePwm )
+		rc = gpio_pwm_pace(1e9 / ch->tick_ns,0);
+	else	rc = gpio_pcm_pace(1e9 / ch->tick_ns,0);
+	if ( rc )
+		return rc;
+
+	regs = udma + DMA_CHAN(channel);
+	gpio_store(regs + DMA_CS,DMA_CS_RESET);
+	usleep(10);
+	gpio_store(regs + DMA_CS,DMA_CS_INT | DMA_CS_END);	// Write 1 to clear
+	gpio_store(regs + DMA_CONBLK_AD,gpio_dma_bus(ch,ch->cbs));
+	gpio_store(regs + DMA_DEBUG,7);				// Clear errors
+	gpio_store(regs + DMA_CS,DMA_CS_WAIT_WRITES | DMA_CS_PRIORITY(8)
+		| DMA_CS_PANIC(8) | DMA_CS_ACTIVE);
+	ch->channel = channel;
+	return 0;
+}
+
+bool
+gpio_dma_busy(const gpio_dma_chain_t *ch) {
+
+	if ( ch->channel < 0 || !udma )
+		return false;
+	return !!(udma[DMA_CHAN(ch->channel) + DMA_CS] & DMA_CS_ACTIVE);
+}
+
+void
+gpio_dma_stop(gpio_dma_chain_t *ch) {
+
+	if ( ch->channel < 0 || !udma )
+		return;
+	gpio_store(udma + DMA_CHAN(ch->channel) + DMA_CS,DMA_CS_RESET);
+	gpio_pace_stop();
+	ch->channel = -1;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Software executor
+//////////////////////////////////////////////////////////////////////
+
+static uint32_t simgpio[1024];		// Private GPIO page (no backend)
+
+static inline uint64_t
+now_ns() {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+/*
+ * Host address of a chain or GPIO page word, else 0:
+ */
+static uint32_t *
+exec_addr(gpio_dma_chain_t *ch,uint32_t bus,bool *gpio) {
+
+	*gpio = false;
+	if ( bus & 3 )
+		return 0;
+	if ( bus >= ch->bus && bus - ch->bus + 4 <= ch->size )
+		return (uint32_t *)(ch->virt + (bus - ch->bus));
+	if ( bus >= BUS_GPIO_PAGE && bus - BUS_GPIO_PAGE < 4096 ) {
+		*gpio = true;
+		if ( ugpio )
+			return (uint32_t *)ugpio + (bus - BUS_GPIO_PAGE) / 4;
+		return simgpio + (bus - BUS_GPIO_PAGE) / 4;
+	}
+	return 0;
+}
+
+static void
+exec_store(uint32_t *reg,uint32_t bus,uint32_t v) {
+
+	if ( ugpio ) {
+		gpio_store((uint32_v *)reg,v);
+		return;
+	}
+
+	// Private file: model GPSET0/GPCLR0 on the GPLEV0 word
+	if ( bus == DMA_BUS_GPSET0 )
+		simgpio[GPIOOFF(GPIO_GPLEV0)] |= v;
+	else if ( bus == DMA_BUS_GPCLR0 )
+		simgpio[GPIOOFF(GPIO_GPLEV0)] &= ~v;
+	else if ( bus != DMA_BUS_GPLEV0 )
+		*reg = v;
+}
+
+/*
+ * Levels as seen by the executor:
+ */
+uint32_t
+gpio_dma_exec_levels() {
+	return ugpio ? *GPIOREG(GPIO_GPLEV0) : simgpio[GPIOOFF(GPIO_GPLEV0)];
+}
+
+//////////////////////////////////////////////////////////////////////
+// Interpret the chain from its first control block until nextconbk
+// is 0 or max_cbs blocks (0 = no limit) have run. trace (optional)
+// sees every GPIO register store with its simulated time.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_dma_exec(gpio_dma_chain_t *ch,uint64_t max_cbs,gpio_dma_trace_t trace,void *arg,gpio_dma_exec_stats_t *stats) {
+	const uint32_t fifo = ch->pace == PacePwm ? PWM_FIF1 : PCM_FIFO_A;
+	gpio_dma_exec_stats_t st;
+	uint32_t cb_bus = ch->ncbs ? gpio_dma_bus(ch,ch->cbs) : 0;
+	uint64_t t0 = now_ns();
+	int rc = 0;
+
+	memset(&st,0,sizeof st);
+
+	while ( cb_bus ) {
+		const gpio_dma_cb_t *cb;
+		uint32_t *src, *dst, ti, n;
+		bool src_gpio, dst_gpio, paced;
+
+		if ( max_cbs && st.cbs >= max_cbs ) {
+			st.looped = true;
+			break;
+		}
+		if ( (cb_bus & 31) || cb_bus < ch->bus
+		  || cb_bus - ch->bus >= (uint32_t)(ch->ncbs * sizeof *cb) ) {
+			rc = EFAULT;			// Not one of our blocks
+			break;
+		}
+		cb = (const gpio_dma_cb_t *)(ch->virt + (cb_bus - ch->bus));
+		ti = cb->ti;
+		if ( (ti & DMA_TI_TDMODE) || (cb->txfr_len & 3) ) {
+			rc = EINVAL;			// 2D and byte transfers not modelled
+			break;
+		}
+
+		paced = !!(ti & (DMA_TI_DEST_DREQ|DMA_TI_SRC_DREQ));
+		src = (ti & DMA_TI_SRC_IGNORE) ? 0 : exec_addr(ch,cb->source_ad,&src_gpio);
+		dst = exec_addr(ch,cb->dest_ad,&dst_gpio);
+		if ( (!src && !(ti & DMA_TI_SRC_IGNORE))
+		  || (!dst && cb->dest_ad != fifo && !(ti & DMA_TI_DEST_IGNORE)) ) {
+			rc = EFAULT;			// Unmodelled bus address
+			break;
+		}
+
+		n = cb->txfr_len / 4;
+		for ( uint32_t x=0; x<n; ++x ) {
+			uint32_t sbus = cb->source_ad + ((ti & DMA_TI_SRC_INC) ? x * 4 : 0);
+			uint32_t dbus = cb->dest_ad + ((ti & DMA_TI_DEST_INC) ? x * 4 : 0);
+			uint32_t v = 0;
+
+			if ( paced ) {
+				st.sim_ns += ch->tick_ns;	// Wait for the DREQ
+				++st.paced;
+			}
+			if ( src ) {
+				const uint32_t *sp = exec_addr(ch,sbus,&src_gpio);
+
+				if ( !sp ) {
+					rc = EFAULT;	// Ran off the block or page
+					goto xit;
+				}
+				v = *sp;
+			}
+			if ( dst && !(ti & DMA_TI_DEST_IGNORE) ) {
+				uint32_t *d = exec_addr(ch,dbus,&dst_gpio);
+
+				if ( !d ) {
+					rc = EFAULT;
+					goto xit;
+				}
+				if ( dst_gpio ) {
+					exec_store(d,dbus,v);
+					++st.stores;
+					if ( trace )
+						trace(arg,st.sim_ns,dbus,v);
+				} else	*d = v;
+			}
+			++st.words;
+		}
+
+		++st.cbs;
+		cb_bus = cb->nextconbk;
+	}
+
+xit:	st.host_ns = now_ns() - t0;
+	if ( stats )
+		*stats = st;
+	return rc;
+}
+
+/* end gpdma.c */
@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////
+// gpdma.h -- DMA control-block chains writing GPSET0/GPCLR0
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPDMA_H
+#define GPDMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libgp.h"
+#include "gpwave.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// BCM283x DMA control block (32 byte aligned, bus addresses)
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	uint32_t	ti;		// Transfer information
+	uint32_t	source_ad;	// Source bus address
+	uint32_t	dest_ad;	// Destination bus address
+	uint32_t	txfr_len;	// Bytes to transfer
+	uint32_t	stride;		// 2D mode strides (unused)
+	uint32_t	nextconbk;	// Next control block (0 ends the chain)
+	uint32_t	reserved[2];
+} gpio_dma_cb_t;
+
+#define DMA_TI_INTEN		0x00000001
+#define DMA_TI_TDMODE		0x00000002
+#define DMA_TI_WAIT_RESP	0x00000008
+#define DMA_TI_DEST_INC		0x00000010
+#define DMA_TI_DEST_DREQ	0x00000040
+#define DMA_TI_DEST_IGNORE	0x00000080
+#define DMA_TI_SRC_INC		0x00000100
+#define DMA_TI_SRC_DREQ		0x00000400
+#define DMA_TI_SRC_IGNORE	0x00000800
+#define DMA_TI_PERMAP(p)	(((p) & 0x1F) << 16)
+#define DMA_TI_NO_WIDE_BURSTS	0x04000000
+
+#define DMA_BUS_PERI		0x7E000000	// Peripheral bus addresses
+#define DMA_BUS_SIM		0xC0000000	// Chain memory in the executor
+#define DMA_BUS_GPSET0		0x7E20001C
+#define DMA_BUS_GPCLR0		0x7E200028
+#define DMA_BUS_GPLEV0		0x7E200034
+
+typedef enum GpioDmaPace {	// DREQ used to pace the chain
+	PacePwm=5,		// PWM FIFO (DREQ 5)
+	PacePcm=2		// PCM TX FIFO (DREQ 2)
+} GpioDmaPace;
+
+//////////////////////////////////////////////////////////////////////
+// A chain with its data words in one block of memory. For hardware
+// the block is VideoCore memory from the mailbox (uncached, known bus
+// address); otherwise it is ordinary memory at bus DMA_BUS_SIM.
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	GpioDmaPace	pace;		// DREQ source
+	uint32_t	tick_ns;	// Pacing period
+	bool		hw;		// Block is VideoCore memory
+	size_t		size;		// Block bytes
+	uint8_t		*virt;		// Block mapping
+	uint32_t	bus;		// Block bus address
+	uint32_t	handle;		// Mailbox handle (hw)
+	gpio_dma_cb_t	*cbs;		// Control blocks
+	int		ncbs, max_cbs;
+	uint32_t	*words;		// Masks, sample buffer, pacing word
+	int		nwords, max_words;
+	int		loop_to;	// First CB of the loop, or -1
+	int		channel;	// DMA channel running it, or -1
+} gpio_dma_chain_t;
+
+gpio_dma_chain_t *gpio_dma_chain_new(int max_cbs,int max_words,GpioDmaPace pace,uint32_t tick_ns,bool hw);
+void gpio_dma_chain_free(gpio_dma_chain_t *ch);
+
+int gpio_dma_add_write(gpio_dma_chain_t *ch,uint32_t set,uint32_t clear,uint32_t ticks);
+int gpio_dma_add_samples(gpio_dma_chain_t *ch,int nsamples,uint32_t **buf);
+int gpio_dma_add_wave(gpio_dma_chain_t *ch,const gpio_wave_t *w);
+void gpio_dma_loop(gpio_dma_chain_t *ch,int first_cb);
+
+static inline uint32_t
+gpio_dma_bus(const gpio_dma_chain_t *ch,const void *p) {
+	return ch->bus + (uint32_t)((const uint8_t *)p - ch->virt);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Run on a hardware DMA channel (needs gpio_open() and root)
+//////////////////////////////////////////////////////////////////////
+
+int gpio_dma_start(gpio_dma_chain_t *ch,int channel);
+bool gpio_dma_busy(const gpio_dma_chain_t *ch);
+void gpio_dma_stop(gpio_dma_chain_t *ch);
+
+//////////////////////////////////////////////////////////////////////
+// Software executor: interprets the control blocks. GPIO page stores
+// go through gpio_store() when gpio_open() has mapped a backend (e.g.
+// the sim backend), else to a private register file. Each paced word
+// advances simulated time by tick_ns instead of waiting.
+//////////////////////////////////////////////////////////////////////
+
+typedef void (*gpio_dma_trace_t)(void *arg,uint64_t t_ns,uint32_t reg,uint32_t value);
+
+typedef struct {
+	uint64_t	cbs;		// Control blocks executed
+	uint64_t	words;		// Words transferred
+	uint64_t	paced;		// Words that waited for a DREQ
+	uint64_t	stores;		// GPIO register stores
+	uint64_t	sim_ns;		// Simulated time at the end
+	uint64_t	host_ns;	// Host time taken to interpret
+	bool		looped;		// Stopped by max_cbs
+} gpio_dma_exec_stats_t;
+
+int gpio_dma_exec(gpio_dma_chain_t *ch,uint64_t max_cbs,gpio_dma_trace_t trace,void *arg,gpio_dma_exec_stats_t *stats);
+uint32_t gpio_dma_exec_levels();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPDMA_H
+
+// End gpdma.h
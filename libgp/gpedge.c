@@ -0,0 +1,223 @@
+/* Edge capture engine gpedge.c
+ * Warren W. Gay ve3wwg
+ *
+ * Arms the hardware edge detectors for a bank 0 pin mask and polls
+ * GPEDS0. A latched edge stays latched until written back, so an edge
+ * is never missed between polls. Only multiple edges on one pin within
+ * a single poll interval can merge; with both polarities armed that is
+ * detected by the level not having changed.
+ *
+ * Note: the GPIO bank interrupt must not be claimed by a kernel driver
+ * for the armed pins, or the kernel will race to clear GPEDS0.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpedge.h"
+
+static inline uint64_t
+now_ns() {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+/*
+ * Set or clear mask bits in one edge enable register:
+ */
+static void
+edge_enable(uint32_t reg,uint32_t mask,bool enable) {
+	uint32_v *r = GPIOREG(reg);
+
+	if ( enable )
+		gpio_store(r,*r | mask);
+	else	gpio_store(r,*r & ~mask);
+}
+
+static void
+edge_arm(gpio_edge_t *eng,bool arm) {
+	uint32_t mask = eng->mask;
+
+	edge_enable(GPIO_GPREN0,mask,arm && (eng->flags & GPIO_EDGE_RISING));
+	edge_enable(GPIO_GPFEN0,mask,arm && (eng->flags & GPIO_EDGE_FALLING));
+	edge_enable(GPIO_GPAREN0,mask,arm && (eng->flags & GPIO_EDGE_ARISING));
+	edge_enable(GPIO_GPAFEN0,mask,arm && (eng->flags & GPIO_EDGE_AFALLING));
+	gpio_store(GPIOREG(GPIO_GPEDS0),mask);	// Discard stale events
+}
+
+//////////////////////////////////////////////////////////////////////
+// Create an engine for mask (bank 0). ring_size is rounded up to a
+// power of 2, at most GPIO_EDGE_RING_MAX. The detectors are armed
+// immediately.
+//////////////////////////////////////////////////////////////////////
+
+gpio_edge_t *
+gpio_edge_open(uint32_t mask,unsigned flags,unsigned ring_size) {
+	gpio_edge_t *eng;
+	unsigned size = 16;
+
+	if ( !mask || !(flags & 0x0F) || !ugpio || ring_size > GPIO_EDGE_RING_MAX ) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	while ( size < ring_size )
+		size <<= 1;
+
+	eng = calloc(1,sizeof *eng);
+	if ( !eng )
+		return 0;
+	eng->ring = calloc(size,sizeof *eng->ring);
+	if ( !eng->ring ) {
+		free(eng);
+		return 0;
+	}
+
+	eng->mask = mask;
+	eng->flags = flags;
+	eng->size = size;
+	eng->both = (flags & (GPIO_EDGE_RISING|GPIO_EDGE_ARISING))
+		&& (flags & (GPIO_EDGE_FALLING|GPIO_EDGE_AFALLING));
+	eng->level = gpio_read32() & mask;
+
+	edge_arm(eng,true);
+	return eng;
+}
+
+void
+gpio_edge_close(gpio_edge_t *eng) {
+
+	gpio_edge_stop(eng);
+	edge_arm(eng,false);
+	free(eng->ring);
+	free(eng);
+}
+
+//////////////////////////////////////////////////////////////////////
+// One poll of GPEDS0: returns the number of events queued
+//////////////////////////////////////////////////////////////////////
+
+unsigned
+gpio_edge_poll(gpio_edge_t *eng) {
+	uint32_t eds, lev, changed;
+	unsigned head, count = 0;
+	uint64_t t;
+
+	++eng->stats.polls;
+	eds = *GPIOREG(GPIO_GPEDS0) & eng->mask;
+	if ( !eds )
+		return 0;
+
+	lev = *GPIOREG(GPIO_GPLEV0) & eng->mask;
+	gpio_store(GPIOREG(GPIO_GPEDS0),eds);	// Write 1 to clear
+	t = now_ns();
+
+	changed = lev ^ eng->level;
+	eng->level = lev;
+	head = eng->head;
+
+	do	{
+		int gpio = __builtin_ctz(eds);
+		uint32_t bit = 1u << gpio;
+		gpio_edge_event_t *ev;
+
+		eds &= eds - 1;
+
+		if ( head - __atomic_load_n(&eng->tail,__ATOMIC_ACQUIRE) >= eng->size ) {
+			++eng->stats.dropped;
+			continue;
+		}
+
+		ev = &eng->ring[head & (eng->size - 1)];
+		ev->ns = t;
+		ev->gpio = gpio;
+		ev->level = !!(lev & bit);
+		ev->flags = 0;
+		if ( eng->both && !(changed & bit) ) {
+			ev->flags |= GPIO_EV_MERGED;
+			++eng->stats.merged;
+		}
+		++head;
+		++count;
+	} while ( eds );
+
+	__atomic_store_n(&eng->head,head,__ATOMIC_RELEASE);
+	eng->stats.events += count;
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Poll thread
+//////////////////////////////////////////////////////////////////////
+
+static void *
+edge_thread(void *arg) {
+	gpio_edge_t *eng = (gpio_edge_t *)arg;
+	uint64_t t0 = now_ns();
+
+	while ( !eng->stop )
+		gpio_edge_poll(eng);
+
+	eng->stats.ns += now_ns() - t0;
+	return 0;
+}
+
+int
+gpio_edge_start(gpio_edge_t *eng) {
+	int rc;
+
+	if ( eng->running )
+		return EBUSY;
+
+	eng->stop = false;
+	rc = pthread_create(&eng->thread,NULL,edge_thread,eng);
+	if ( !rc )
+		eng->running = true;
+	return rc;
+}
+
+void
+gpio_edge_stop(gpio_edge_t *eng) {
+
+	if ( !eng->running )
+		return;
+	eng->stop = true;
+	pthread_join(eng->thread,NULL);
+	eng->running = false;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Consumer side: fetch the next event, if any
+//////////////////////////////////////////////////////////////////////
+
+bool
+gpio_edge_get(gpio_edge_t *eng,gpio_edge_event_t *ev) {
+	unsigned tail = eng->tail;
+
+	if ( tail == __atomic_load_n(&eng->head,__ATOMIC_ACQUIRE) )
+		return false;
+
+	*ev = eng->ring[tail & (eng->size - 1)];
+	__atomic_store_n(&eng->tail,tail + 1,__ATOMIC_RELEASE);
+	return true;
+}
+
+/*
+ * Snapshot of the producer counters (exact once stopped):
+ */
+void
+gpio_edge_stats(gpio_edge_t *eng,gpio_edge_stats_t *stats) {
+	*stats = eng->stats;
+}
+
+/* end gpedge.c */
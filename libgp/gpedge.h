@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////
+// gpedge.h -- Edge capture from the GPEDS0 event detect latches
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPEDGE_H
+#define GPEDGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libgp.h"
+
+#define GPIO_EDGE_RISING	0x01	// GPREN0: synchronous rising edge
+#define GPIO_EDGE_FALLING	0x02	// GPFEN0: synchronous falling edge
+#define GPIO_EDGE_ARISING	0x04	// GPAREN0: asynchronous rising edge
+#define GPIO_EDGE_AFALLING	0x08	// GPAFEN0: asynchronous falling edge
+
+#define GPIO_EV_MERGED		0x0001	// Level unchanged: edge(s) were lost
+
+#define GPIO_EDGE_RING_MAX	(1u << 24)	// Most ring entries (256 MB)
+
+typedef struct {
+	uint64_t	ns;		// CLOCK_MONOTONIC time latch was seen
+	uint8_t		gpio;		// Bank 0 gpio
+	uint8_t		level;		// GPLEV0 level after the edge
+	uint16_t	flags;		// GPIO_EV_*
+} gpio_edge_event_t;
+
+typedef struct {
+	uint64_t	polls;		// GPEDS0 loads
+	uint64_t	events;		// Events queued
+	uint64_t	merged;		// Events flagged GPIO_EV_MERGED
+	uint64_t	dropped;	// Events lost to a full ring
+	uint64_t	ns;		// Time spent polling
+} gpio_edge_stats_t;
+
+typedef struct {
+	uint32_t	mask;		// Pins armed
+	unsigned	flags;		// GPIO_EDGE_*
+	uint32_t	level;		// Last known levels of armed pins
+	bool		both;		// Both edge polarities armed
+	unsigned	size;		// Ring entries (power of 2)
+	gpio_edge_event_t *ring;	// Single producer, single consumer
+	volatile unsigned head;		// Next slot written by producer
+	volatile unsigned tail;		// Next slot read by consumer
+	gpio_edge_stats_t stats;	// Producer side counters
+	volatile bool	stop;		// Ask poll thread to exit
+	bool		running;	// Poll thread exists
+	pthread_t	thread;
+} gpio_edge_t;
+
+gpio_edge_t *gpio_edge_open(uint32_t mask,unsigned flags,unsigned ring_size);
+void gpio_edge_close(gpio_edge_t *eng);
+
+int gpio_edge_start(gpio_edge_t *eng);
+void gpio_edge_stop(gpio_edge_t *eng);
+unsigned gpio_edge_poll(gpio_edge_t *eng);
+
+bool gpio_edge_get(gpio_edge_t *eng,gpio_edge_event_t *ev);
+void gpio_edge_stats(gpio_edge_t *eng,gpio_edge_stats_t *stats);
+
+#endif // GPEDGE_H
+
+// End gpedge.h
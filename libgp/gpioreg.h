@@ -0,0 +1,188 @@
+//////////////////////////////////////////////////////////////////////
+// gpioreg.h -- Peripheral register map (libgp modules and libgp.hpp)
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPIOREG_H
+#define GPIOREG_H
+
+#include "libgp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_v *ugpio;
+extern uint32_v *upads;
+extern uint32_v *ucm;
+extern uint32_v *upwm;
+extern uint32_v *upcm;
+
+#define BCM2708_PERI_BASE    	0x3F000000 	// Assumed for RPi2
+#define GPIO_BASE_OFFSET	0x200000	// 0x7E20_0000
+#define PADS_BASE_OFFSET        0x100000        // 0x7E10_0000
+#define ST_BASE_OFFSET		0x003000	// 0x7E00_3000
+#define CM_BASE_OFFSET		0x101000	// 0x7E10_1000
+#define PWM_BASE_OFFSET		0x20C000	// 0x7E20_C000
+#define PCM_BASE_OFFSET		0x203000	// 0x7E20_3000
+#define DMA_BASE_OFFSET		0x007000	// 0x7E00_7000
+
+//////////////////////////////////////////////////////////////////////
+// GPIO Macros
+//////////////////////////////////////////////////////////////////////
+
+#define GPIOOFF(o)	(((o)-0x7E000000-GPIO_BASE_OFFSET)/sizeof(uint32_t))
+#define GPIOREG(o)	(ugpio+GPIOOFF(o))
+#define GPIOREG2(o,wo)	(ugpio+GPIOOFF(o)+(wo))
+
+#define GPIO_GPFSEL0	0x7E200000 
+#define GPIO_GPSET0	0x7E20001C
+#define GPIO_GPCLR0	0x7E200028 
+#define GPIO_GPLEV0     0x7E200034 
+
+#define GPIO_GPEDS0 	0x7E200040 
+#define GPIO_GPREN0	0x7E20004C 
+#define GPIO_GPFEN0     0x7E200058 
+#define GPIO_GPHEN0     0x7E200064 
+#define GPIO_GPLEN0     0x7E200070 
+
+#define GPIO_GPAREN0	0x7E20007C 
+#define GPIO_GPAFEN0 	0x7E200088 
+
+#define GPIO_GPPUD	0x7E200094
+#define GPIO_GPUDCLK0	0x7E200098
+#define GPIO_GPUDCLK1	0x7E20009C
+
+#define PADSOFF(o)	(((o)-0x7E000000-PADS_BASE_OFFSET)/sizeof(uint32_t))
+#define PADSREG(o,x)	(upads+PADSOFF(o)+x)
+
+#define GPIO_PADS00_27	0x7E10002C
+#define GPIO_PADS28_45	0x7E100030 
+#define GPIO_PADS46_53	0x7E100034 
+
+#define STOFF(o)	(((o)-0x7E000000-ST_BASE_OFFSET)/sizeof(uint32_t))
+#define STREG(o)	(usystimer+STOFF(o))
+
+#define ST_CS		0x7E003000
+#define ST_CLO		0x7E003004
+#define ST_CHI		0x7E003008
+
+//////////////////////////////////////////////////////////////////////
+// Clock manager (GPCLK0-2 and the PWM clock). Stores need CM_PASSWD.
+//////////////////////////////////////////////////////////////////////
+
+#define CMOFF(o)	(((o)-0x7E000000-CM_BASE_OFFSET)/sizeof(uint32_t))
+#define CMREG(o)	(ucm+CMOFF(o))
+
+#define CM_GP0CTL	0x7E101070
+#define CM_GP0DIV	0x7E101074
+#define CM_GP1CTL	0x7E101078
+#define CM_GP1DIV	0x7E10107C
+#define CM_GP2CTL	0x7E101080
+#define CM_GP2DIV	0x7E101084
+#define CM_PWMCTL	0x7E1010A0
+#define CM_PWMDIV	0x7E1010A4
+#define CM_PCMCTL	0x7E101098
+#define CM_PCMDIV	0x7E10109C
+
+#define CM_PASSWD	0x5A000000
+#define CM_CTL_SRC(s)	((s) & 0x0F)
+#define CM_CTL_ENAB	0x00000010
+#define CM_CTL_KILL	0x00000020
+#define CM_CTL_BUSY	0x00000080
+#define CM_CTL_MASH(m)	(((m) & 3) << 9)
+#define CM_DIV(i,f)	(((i) & 0xFFF) << 12 | ((f) & 0xFFF))
+
+//////////////////////////////////////////////////////////////////////
+// PWM controller (two channels sharing the PWM clock)
+//////////////////////////////////////////////////////////////////////
+
+#define PWMOFF(o)	(((o)-0x7E000000-PWM_BASE_OFFSET)/sizeof(uint32_t))
+#define PWMREG(o)	(upwm+PWMOFF(o))
+
+#define PWM_CTL		0x7E20C000
+#define PWM_STA		0x7E20C004
+#define PWM_DMAC	0x7E20C008
+#define PWM_RNG1	0x7E20C010
+#define PWM_DAT1	0x7E20C014
+#define PWM_FIF1	0x7E20C018
+#define PWM_RNG2	0x7E20C020
+#define PWM_DAT2	0x7E20C024
+
+#define PWM_CTL_PWEN(c)	(0x01u << (c) * 8)	// Channel enable
+#define PWM_CTL_MODE(c)	(0x02u << (c) * 8)	// Serializer mode
+#define PWM_CTL_POLA(c)	(0x10u << (c) * 8)	// Invert output
+#define PWM_CTL_USEF(c)	(0x20u << (c) * 8)	// Use the FIFO
+#define PWM_CTL_MSEN(c)	(0x80u << (c) * 8)	// Mark/space mode
+#define PWM_CTL_CHAN(c)	(0xFFu << (c) * 8)	// All of a channel's bits
+#define PWM_CTL_CLRF	0x00000040
+
+#define PWM_DMAC_ENAB	0x80000000
+#define PWM_DMAC_PANIC(n) (((n) & 0xFF) << 8)
+#define PWM_DMAC_DREQ(n) ((n) & 0xFF)
+
+//////////////////////////////////////////////////////////////////////
+// PCM/I2S transmitter, used only as a DMA pacing source
+//////////////////////////////////////////////////////////////////////
+
+#define PCMOFF(o)	(((o)-0x7E000000-PCM_BASE_OFFSET)/sizeof(uint32_t))
+#define PCMREG(o)	(upcm+PCMOFF(o))
+
+#define PCM_CS_A	0x7E203000
+#define PCM_FIFO_A	0x7E203004
+#define PCM_MODE_A	0x7E203008
+#define PCM_TXC_A	0x7E203010
+#define PCM_DREQ_A	0x7E203014
+
+#define PCM_CS_EN	0x00000001
+#define PCM_CS_TXON	0x00000004
+#define PCM_CS_TXCLR	0x00000008
+#define PCM_CS_DMAEN	0x00000200
+#define PCM_MODE_FLEN(n) (((n) & 0x3FF) << 10)
+#define PCM_MODE_FSLEN(n) ((n) & 0x3FF)
+#define PCM_TXC_CH1WEX	0x80000000
+#define PCM_TXC_CH1EN	0x40000000
+#define PCM_TXC_CH1WID(n) (((n) & 0x0F) << 16)
+#define PCM_DREQ_TX(n)	(((n) & 0x7F) << 8)
+#define PCM_DREQ_TXPANIC(n) (((n) & 0x7F) << 16)
+
+//////////////////////////////////////////////////////////////////////
+// DMA controller: channel n registers at DMA_CHAN(n)
+//////////////////////////////////////////////////////////////////////
+
+#define DMA_CHAN(n)	((n) * 0x100 / sizeof(uint32_t))
+#define DMA_CS		0		// Word offsets within a channel
+#define DMA_CONBLK_AD	1
+#define DMA_DEBUG	8
+#define DMA_ENABLE	(0xFF0 / sizeof(uint32_t))
+
+#define DMA_CS_ACTIVE	0x00000001
+#define DMA_CS_END	0x00000002
+#define DMA_CS_INT	0x00000004
+#define DMA_CS_ERROR	0x00000100
+#define DMA_CS_PRIORITY(n) (((n) & 0x0F) << 16)
+#define DMA_CS_PANIC(n)	(((n) & 0x0F) << 20)
+#define DMA_CS_WAIT_WRITES 0x10000000
+#define DMA_CS_ABORT	0x40000000
+#define DMA_CS_RESET	0x80000000
+
+//////////////////////////////////////////////////////////////////////
+// Register stores go through the backend when it models side effects
+// (write-1-to-set/clear, pull sequencing). Loads are always direct.
+//////////////////////////////////////////////////////////////////////
+
+extern void (*gpio_store_hook)(uint32_v *reg,uint32_t v);
+
+static inline void
+gpio_store(uint32_v *reg,uint32_t v) {
+	if ( __builtin_expect(gpio_store_hook != 0,0) )
+		gpio_store_hook(reg,v);
+	else	*reg = v;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPIOREG_H
+
+// End gpioreg.h
@@ -0,0 +1,421 @@
+/* IR remote decoder gpir.c
+ * Warren W. Gay ve3wwg
+ *
+ * Every protocol is two tables: duration classes turning a mark or
+ * space into a symbol, and state x symbol steps. The engine only
+ * knows the steps' actions and the two states all tables share: IDLE
+ * (waiting for the gap that precedes a frame) and TAIL (a frame was
+ * decoded on a space, and its stop mark is still to end). Requiring
+ * a gap before a frame keeps one protocol's bits from starting
+ * another protocol's frames.
+ */
+#include <string.h>
+
+#include "gpir.h"
+
+#define IR_SYMS		8
+#define SYM_NONE	(IR_SYMS - 1)	// Matches no class
+
+#define ST_IDLE		0
+#define ST_TAIL		1
+#define ST_READY	2		// Gap seen: a frame may start
+
+enum {
+	ActErr = 0,			// No step (the default table entry)
+	ActNext,			// Change state only
+	ActStart,			// Start a frame
+	ActStart1,			// Start a frame with a 1 bit (RC5 S1)
+	ActStart10,			// Start a frame with bits 1, 0 (RC5X)
+	ActBit0,
+	ActBit1,
+	ActRepeat,			// Repeat code: resend the last command
+	ActFrame			// Frame ends here
+};
+
+typedef struct {
+	bool		mark;
+	uint32_t	min_us;
+	uint32_t	max_us;		// 0: no upper limit
+	uint8_t		sym;
+} ir_class_t;
+
+typedef struct {
+	uint8_t		next;
+	uint8_t		act;
+} ir_step_t;
+
+typedef struct {
+	const char	*name;
+	const ir_class_t *classes;
+	int		nclasses;
+	const ir_step_t	(*steps)[IR_SYMS];
+	uint8_t		nbits;		// Frame complete at nbits (0: ends with ActFrame)
+	uint8_t		maxbits;
+	bool		msb_first;
+	uint32_t	gap_us;		// Shortest space before a frame
+	uint32_t	repeat_ms;	// Same command again within this is a repeat
+	bool		(*finish)(const gpio_ir_dec_t *d,gpio_ir_cmd_t *cmd);
+} ir_proto_t;
+
+//////////////////////////////////////////////////////////////////////
+// NEC: 9 ms mark, 4.5 ms space, 32 pulse distance bits (address,
+// ~address, command, ~command, LSB first), stop mark. A key held
+// sends 9 ms, 2.25 ms, stop mark every 108 ms.
+//////////////////////////////////////////////////////////////////////
+
+enum { NecLeadM, NecBitM, NecLeadS, NecRptS, NecZeroS, NecOneS, NecGap };
+enum { NecLead = 3, NecDMark, NecDSpace, NecRpt, NecStates };
+
+static const ir_class_t nec_classes[] = {
+	{ true,		7000,	11000,	NecLeadM },
+	{ true,		300,	850,	NecBitM },
+	{ false,	3500,	5500,	NecLeadS },
+	{ false,	1970,	2800,	NecRptS },	// Split from a 1 at the midpoint
+	{ false,	300,	850,	NecZeroS },
+	{ false,	1200,	1969,	NecOneS },
+	{ false,	6000,	0,	NecGap }
+};
+
+static const ir_step_t nec_steps[NecStates][IR_SYMS] = {
+	[ST_IDLE] = {	[NecGap] = { ST_READY, ActNext } },
+	[ST_READY] = {	[NecLeadM] = { NecLead, ActStart },
+			[NecGap] = { ST_READY, ActNext } },
+	[NecLead] = {	[NecLeadS] = { NecDMark, ActNext },
+			[NecRptS] = { NecRpt, ActNext } },
+	[NecDMark] = {	[NecBitM] = { NecDSpace, ActNext } },
+	[NecDSpace] = {	[NecZeroS] = { NecDMark, ActBit0 },
+			[NecOneS] = { NecDMark, ActBit1 } },
+	[NecRpt] = {	[NecBitM] = { ST_IDLE, ActRepeat } }
+};
+
+static bool
+nec_finish(const gpio_ir_dec_t *d,gpio_ir_cmd_t *cmd) {
+	uint32_t a = d->bits & 0xFF, na = d->bits >> 8 & 0xFF;
+	uint32_t c = d->bits >> 16 & 0xFF, nc = d->bits >> 24 & 0xFF;
+
+	if ( (c ^ nc) != 0xFF )
+		return false;
+	cmd->address = (a ^ na) == 0xFF ? a : na << 8 | a;	// Else extended NEC
+	cmd->command = c;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// RC5: 14 Manchester bits of 1.778 ms, MSB first: S1, S2 (inverted
+// command bit 6 in RC5X), toggle, 5 address and 6 command bits. A 1
+// is space then mark. Decoded on the level that ends, from four
+// positions: the middle of a 1 (in mark) or of a 0 (in space), and a
+// bit boundary before a 1 (in space) or a 0 (in mark).
+//////////////////////////////////////////////////////////////////////
+
+enum { Rc5ShortM, Rc5LongM, Rc5ShortS, Rc5LongS, Rc5Gap };
+enum { Rc5Mid1 = 3, Rc5Mid0, Rc5Bnd1, Rc5Bnd0, Rc5States };
+
+static const ir_class_t rc5_classes[] = {
+	{ true,		600,	1200,	Rc5ShortM },
+	{ true,		1400,	2100,	Rc5LongM },
+	{ false,	600,	1200,	Rc5ShortS },
+	{ false,	1400,	2100,	Rc5LongS },
+	{ false,	6000,	0,	Rc5Gap }		// Longer than an NEC lead space
+};
+
+static const ir_step_t rc5_steps[Rc5States][IR_SYMS] = {
+	[ST_IDLE] = {	[Rc5Gap] = { ST_READY, ActNext } },
+	[ST_READY] = {	[Rc5ShortM] = { Rc5Bnd1, ActStart1 },	// Mark began mid S1
+			[Rc5LongM] = { Rc5Mid0, ActStart10 },
+			[Rc5Gap] = { ST_READY, ActNext } },
+	[Rc5Mid1] = {	[Rc5ShortM] = { Rc5Bnd1, ActNext },
+			[Rc5LongM] = { Rc5Mid0, ActBit0 } },
+	[Rc5Mid0] = {	[Rc5ShortS] = { Rc5Bnd0, ActNext },
+			[Rc5LongS] = { Rc5Mid1, ActBit1 } },
+	[Rc5Bnd1] = {	[Rc5ShortS] = { Rc5Mid1, ActBit1 } },
+	[Rc5Bnd0] = {	[Rc5ShortM] = { Rc5Mid0, ActBit0 } }
+};
+
+static bool
+rc5_finish(const gpio_ir_dec_t *d,gpio_ir_cmd_t *cmd) {
+	uint32_t s2 = d->bits >> 12 & 1;
+
+	cmd->toggle = d->bits >> 11 & 1;
+	cmd->address = d->bits >> 6 & 0x1F;
+	cmd->command = (d->bits & 0x3F) | !s2 << 6;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Sony SIRC: 2.4 ms mark, then pulse width bits (1.2 ms mark is a 1,
+// 0.6 ms a 0) each after a 0.6 ms space, LSB first: 7 command bits,
+// then 5, 8 or 13 address bits. Frames repeat every 45 ms; the gap
+// after the last mark ends the frame.
+//////////////////////////////////////////////////////////////////////
+
+enum { SonyLeadM, SonyZeroM, SonyOneM, SonySpace, SonyGap };
+enum { SonyLead = 3, SonyBMark, SonyBSpace, SonyStates };
+
+static const ir_class_t sony_classes[] = {
+	{ true,		2100,	2900,	SonyLeadM },	// Longer than an RC5 long mark
+	{ true,		950,	1500,	SonyOneM },
+	{ true,		350,	850,	SonyZeroM },
+	{ false,	350,	850,	SonySpace },
+	{ false,	2000,	0,	SonyGap }
+};
+
+static const ir_step_t sony_steps[SonyStates][IR_SYMS] = {
+	[ST_IDLE] = {	[SonyGap] = { ST_READY, ActNext } },
+	[ST_READY] = {	[SonyLeadM] = { SonyLead, ActStart },
+			[SonyGap] = { ST_READY, ActNext } },
+	[SonyLead] = {	[SonySpace] = { SonyBMark, ActNext } },
+	[SonyBMark] = {	[SonyZeroM] = { SonyBSpace, ActBit0 },
+			[SonyOneM] = { SonyBSpace, ActBit1 } },
+	[SonyBSpace] = { [SonySpace] = { SonyBMark, ActNext },
+			[SonyGap] = { ST_READY, ActFrame } }
+};
+
+static bool
+sony_finish(const gpio_ir_dec_t *d,gpio_ir_cmd_t *cmd) {
+
+	if ( d->nbits != 12 && d->nbits != 15 && d->nbits != 20 )
+		return false;
+	cmd->command = d->bits & 0x7F;
+	cmd->address = d->bits >> 7;
+	return true;
+}
+
+#define NCLASSES(c)	(int)(sizeof c / sizeof c[0])
+
+static const ir_proto_t protos[IrProtos] = {
+	[IrNEC] = { "nec", nec_classes, NCLASSES(nec_classes), nec_steps, 32, 32, false, 6000, 0, nec_finish },
+	[IrRC5] = { "rc5", rc5_classes, NCLASSES(rc5_classes), rc5_steps, 14, 14, true, 6000, 200, rc5_finish },
+	[IrSony] = { "sony", sony_classes, NCLASSES(sony_classes), sony_steps, 0, 20, false, 2000, 100, sony_finish }
+};
+
+#define NEC_REPEAT_MS	150		// Frame or repeat end to repeat code start
+
+const char *
+gpio_ir_proto_name(IrProto proto) {
+	return proto >= 0 && proto < IrProtos ? protos[proto].name : "?";
+}
+
+//////////////////////////////////////////////////////////////////////
+// Start with no known level: the first edge is taken to end a gap
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_ir_init(gpio_ir_t *ir,unsigned protos,bool active_low) {
+
+	memset(ir,0,sizeof *ir);
+	ir->protos = protos & GPIO_IR_ALL;
+	ir->active_low = active_low;
+	ir->level = -1;
+}
+
+bool
+gpio_ir_get(gpio_ir_t *ir,gpio_ir_cmd_t *cmd) {
+
+	if ( ir->tail == ir->head )
+		return false;
+	*cmd = ir->queue[ir->tail++ % GPIO_IR_QUEUE];
+	return true;
+}
+
+static void
+ir_emit(gpio_ir_t *ir,gpio_ir_dec_t *d,const gpio_ir_cmd_t *cmd) {
+
+	d->last = *cmd;
+	d->have_last = true;
+	++ir->stats[cmd->proto].frames;
+	if ( cmd->repeat )
+		++ir->stats[cmd->proto].repeats;
+	if ( ir->head - ir->tail >= GPIO_IR_QUEUE )
+		++ir->dropped;
+	else	ir->queue[ir->head++ % GPIO_IR_QUEUE] = *cmd;
+}
+
+static void
+ir_frame(gpio_ir_t *ir,IrProto proto,uint64_t ns) {
+	const ir_proto_t *p = &protos[proto];
+	gpio_ir_dec_t *d = &ir->dec[proto];
+	gpio_ir_cmd_t cmd;
+
+	memset(&cmd,0,sizeof cmd);
+	cmd.proto = proto;
+	cmd.nbits = d->nbits;
+	cmd.start_ns = d->start_ns;
+	cmd.end_ns = ns;
+	if ( !p->finish(d,&cmd) ) {
+		++ir->stats[proto].errors;
+		return;
+	}
+	cmd.repeat = d->have_last && p->repeat_ms
+		&& (int64_t)(d->start_ns - d->last.end_ns) < p->repeat_ms * 1000000ll
+		&& cmd.address == d->last.address && cmd.command == d->last.command
+		&& cmd.toggle == d->last.toggle && cmd.nbits == d->last.nbits;
+	ir_emit(ir,d,&cmd);
+}
+
+static void
+ir_repeat(gpio_ir_t *ir,IrProto proto,uint64_t ns) {
+	gpio_ir_dec_t *d = &ir->dec[proto];
+	gpio_ir_cmd_t cmd;
+
+	if ( !d->have_last || (int64_t)(d->start_ns - d->last.end_ns) > NEC_REPEAT_MS * 1000000ll ) {
+		++ir->stats[proto].stale;
+		return;
+	}
+	cmd = d->last;
+	cmd.repeat = true;
+	cmd.nbits = 0;
+	cmd.start_ns = d->start_ns;
+	cmd.end_ns = ns;
+	ir_emit(ir,d,&cmd);
+}
+
+//////////////////////////////////////////////////////////////////////
+// One mark or space of us, which ended at ns, through one protocol
+//////////////////////////////////////////////////////////////////////
+
+static void
+ir_symbol(gpio_ir_t *ir,IrProto proto,bool mark,uint32_t us,uint64_t ns) {
+	const ir_proto_t *p = &protos[proto];
+	gpio_ir_dec_t *d = &ir->dec[proto];
+	uint8_t sym = SYM_NONE;
+	ir_step_t step;
+	int bit;
+
+	for ( int x=0; x<p->nclasses; ++x ) {
+		const ir_class_t *c = &p->classes[x];
+
+		if ( c->mark == mark && us >= c->min_us && (!c->max_us || us <= c->max_us) ) {
+			sym = c->sym;
+			break;
+		}
+	}
+
+	if ( d->state == ST_TAIL ) {
+		d->state = ST_IDLE;
+		if ( mark )
+			return;			// The stop mark
+	}
+
+	step = p->steps[d->state][sym];
+	if ( step.act == ActErr ) {
+		if ( d->state > ST_READY ) {
+			++ir->stats[proto].errors;
+			d->state = ST_IDLE;
+			step = p->steps[ST_IDLE][sym];	// It may still end a gap
+		}
+		if ( step.act == ActErr ) {
+			d->state = ST_IDLE;
+			return;
+		}
+	}
+	d->state = step.next;
+
+	switch ( step.act ) {
+	case ActStart:
+	case ActStart1:
+	case ActStart10:
+		d->bits = 0;
+		d->nbits = 0;
+		d->start_ns = ns - (uint64_t)us * 1000;
+		if ( step.act == ActStart )
+			return;
+		bit = 1;
+		break;
+	case ActBit0:
+		bit = 0;
+		break;
+	case ActBit1:
+		bit = 1;
+		break;
+	case ActRepeat:
+		ir_repeat(ir,proto,ns);
+		return;
+	case ActFrame:
+		ir_frame(ir,proto,ns);
+		return;
+	default:
+		return;
+	}
+
+	for ( int x = step.act == ActStart10 ? 2 : 1; x > 0; --x, bit = 0 ) {
+		if ( d->nbits >= p->maxbits ) {
+			++ir->stats[proto].errors;
+			d->state = ST_IDLE;
+			return;
+		}
+		if ( p->msb_first )
+			d->bits = d->bits << 1 | bit;
+		else	d->bits |= (uint64_t)bit << d->nbits;
+		++d->nbits;
+	}
+
+	if ( p->nbits && d->nbits == p->nbits ) {
+		ir_frame(ir,proto,ns);
+		d->state = mark ? ST_IDLE : ST_TAIL;
+	}
+}
+
+static void
+ir_level(gpio_ir_t *ir,bool mark,uint64_t dur_ns,uint64_t ns,unsigned which) {
+	uint32_t us = dur_ns / 1000 > UINT32_MAX ? UINT32_MAX : (uint32_t)(dur_ns / 1000);
+
+	which &= ir->protos;
+	for ( int proto=0; proto<IrProtos; ++proto )
+		if ( which & (1u << proto) )
+			ir_symbol(ir,(IrProto)proto,mark,us,ns);
+}
+
+//////////////////////////////////////////////////////////////////////
+// An edge at ns left the pin at level. Returns commands queued.
+//////////////////////////////////////////////////////////////////////
+
+unsigned
+gpio_ir_edge(gpio_ir_t *ir,uint64_t ns,int level) {
+	bool was_mark;
+
+	level = !!level;
+	if ( level == ir->level )
+		return ir->head - ir->tail;	// Not an edge (merged events)
+
+	++ir->edges;
+	if ( ir->level < 0 ) {
+		was_mark = (level == 0) != ir->active_low;
+		if ( !was_mark )
+			ir_level(ir,false,UINT64_MAX,ns,GPIO_IR_ALL);	// Idle before the first mark
+	} else	{
+		was_mark = (ir->level == 0) == ir->active_low;
+		ir_level(ir,was_mark,ns - ir->last_ns,ns,was_mark ? GPIO_IR_ALL : ~ir->idled);
+	}
+
+	ir->level = level;
+	ir->last_ns = ns;
+	ir->idled = 0;
+	return ir->head - ir->tail;
+}
+
+//////////////////////////////////////////////////////////////////////
+// No edge until now_ns: a space this long ends frames waiting on
+// their gap. Call it when an edge source times out.
+//////////////////////////////////////////////////////////////////////
+
+unsigned
+gpio_ir_idle(gpio_ir_t *ir,uint64_t now_ns) {
+	bool mark = (ir->level == 0) == ir->active_low;
+	uint64_t dur = now_ns - ir->last_ns;
+
+	if ( ir->level < 0 || mark )
+		return ir->head - ir->tail;
+
+	for ( int proto=0; proto<IrProtos; ++proto ) {
+		unsigned bit = 1u << proto;
+
+		if ( (ir->protos & bit) && !(ir->idled & bit) && dur >= protos[proto].gap_us * 1000ull ) {
+			ir_level(ir,false,dur,now_ns,bit);
+			ir->idled |= bit;
+		}
+	}
+	return ir->head - ir->tail;
+}
+
+/* end gpir.c */
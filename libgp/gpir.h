@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////
+// gpir.h -- IR remote decoder fed by timestamped edges
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPIR_H
+#define GPIR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Feed gpio_ir_edge() the time and new level of every edge of a
+// demodulating receiver (gpedge.h events, gp -M recordings, cdev or
+// sysfs edge events). Each mark or space that ends is classified by
+// a per-protocol duration table into a symbol, and a per-protocol
+// state x symbol table drives the decoder. All enabled protocols see
+// every symbol. Frames that end in a long space (Sony) are finished by
+// the next edge or by gpio_ir_idle().
+//////////////////////////////////////////////////////////////////////
+
+typedef enum IrProto {
+	IrNEC,				// NEC and extended NEC, repeat codes
+	IrRC5,				// Philips RC5 / RC5X
+	IrSony,				// Sony SIRC 12, 15 and 20 bit
+	IrProtos			// Number of protocols
+} IrProto;
+
+#define GPIO_IR_ALL		((1u << IrProtos) - 1)
+#define GPIO_IR_QUEUE		8	// Decoded commands held (power of 2)
+
+typedef struct {
+	IrProto		proto;
+	uint32_t	address;
+	uint32_t	command;
+	bool		repeat;		// Key held: repeat code or same frame again
+	uint8_t		toggle;		// RC5 toggle bit
+	uint8_t		nbits;		// Frame bits (0 for an NEC repeat code)
+	uint64_t	start_ns;	// First edge of the frame
+	uint64_t	end_ns;		// Edge that completed the decode
+} gpio_ir_cmd_t;
+
+typedef struct {
+	uint64_t	frames;		// Commands decoded (including repeats)
+	uint64_t	repeats;	// Of which repeats
+	uint64_t	errors;		// Frames abandoned part way or failing checks
+	uint64_t	stale;		// NEC repeat codes with no frame to repeat
+} gpio_ir_stats_t;
+
+typedef struct {
+	uint8_t		state;
+	uint8_t		nbits;
+	uint64_t	bits;
+	uint64_t	start_ns;
+	gpio_ir_cmd_t	last;		// Last command, for repeats
+	bool		have_last;
+} gpio_ir_dec_t;
+
+typedef struct {
+	unsigned	protos;		// Enabled: bit (1 << IrProto)
+	bool		active_low;	// Receiver output low during a mark
+	int		level;		// Present level (-1: unknown)
+	uint64_t	last_ns;	// Time of the last edge
+	unsigned	idled;		// Protocols whose gap gpio_ir_idle() ended
+	uint64_t	edges;
+	gpio_ir_dec_t	dec[IrProtos];
+	gpio_ir_stats_t	stats[IrProtos];
+	gpio_ir_cmd_t	queue[GPIO_IR_QUEUE];
+	unsigned	head, tail;
+	uint64_t	dropped;	// Commands lost to a full queue
+} gpio_ir_t;
+
+void gpio_ir_init(gpio_ir_t *ir,unsigned protos,bool active_low);
+unsigned gpio_ir_edge(gpio_ir_t *ir,uint64_t ns,int level);
+unsigned gpio_ir_idle(gpio_ir_t *ir,uint64_t now_ns);
+bool gpio_ir_get(gpio_ir_t *ir,gpio_ir_cmd_t *cmd);
+const char *gpio_ir_proto_name(IrProto proto);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPIR_H
+
+// End gpir.h
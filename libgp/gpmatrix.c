@@ -0,0 +1,218 @@
+/* Keypad and switch matrix scanner gpmatrix.c
+ * Warren W. Gay ve3wwg
+ *
+ * A scan is nrows + 1 configuration commits, each one GPFSEL write
+ * (two when neighbouring rows fall in different GPFSEL registers),
+ * and nrows GPLEV0 reads. The commits are built by gpio_matrix_init()
+ * so a scan only stores them. Debouncing happens per row as the
+ * samples come in; the ghosting check and the events wait for the
+ * whole scan, since ambiguity is a property of the matrix and not of
+ * a row.
+ */
+#include <string.h>
+#include <errno.h>
+
+#include "gpdelay.h"
+#include "gpmatrix.h"
+
+#define GPIO_MATRIX_SETTLE_NS	2000	// Column pull-up recovery
+
+static int
+pin_mask(int gpio,uint32_t *used,uint32_t *mask) {
+
+	if ( gpio < 0 || gpio > 31 || (*used & (1u << gpio)) )
+		return EINVAL;		// Bank 0 only, no sharing
+	*mask = 1u << gpio;
+	*used |= *mask;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Define the matrix. Debounce defaults to 4 scans, settling to 2 us.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_matrix_init(gpio_matrix_t *m,const int *rows,int nrows,const int *cols,int ncols) {
+	uint32_t used = 0;
+
+	memset(m,0,sizeof *m);
+	memset(m->colx,-1,sizeof m->colx);
+	if ( nrows < 1 || nrows > GPIO_MATRIX_ROWS || ncols < 1 || ncols > GPIO_MATRIX_COLS )
+		return EINVAL;
+
+	for ( int r=0; r<nrows; ++r ) {
+		if ( pin_mask(rows[r],&used,&m->rows[r]) )
+			return EINVAL;
+		m->rmask |= m->rows[r];
+	}
+	for ( int c=0; c<ncols; ++c ) {
+		if ( pin_mask(cols[c],&used,&m->cols[c]) )
+			return EINVAL;
+		m->cmask |= m->cols[c];
+		m->colx[cols[c]] = c;
+	}
+	m->nrows = nrows;
+	m->ncols = ncols;
+
+	for ( int r=0; r<=nrows; ++r ) {
+		gpio_config_begin(&m->drive[r]);
+		if ( r > 0 )
+			gpio_config_io(&m->drive[r],rows[r-1],Input);
+		if ( r < nrows )
+			gpio_config_io(&m->drive[r],rows[r],Output);
+	}
+
+	for ( int r=0; r<nrows; ++r )
+		gpio_debounce_init(&m->db[r],0,4);
+	gpio_matrix_set_settle(m,GPIO_MATRIX_SETTLE_NS);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Scans a change must persist for (1 to GPIO_DEBOUNCE_MAX)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_matrix_debounce(gpio_matrix_t *m,unsigned samples) {
+
+	if ( samples < 1 || samples > GPIO_DEBOUNCE_MAX )
+		return ERANGE;
+	for ( int r=0; r<m->nrows; ++r )
+		gpio_debounce_threshold(&m->db[r],m->cmask,samples);
+	return 0;
+}
+
+void
+gpio_matrix_set_settle(gpio_matrix_t *m,uint32_t ns) {
+	m->spin_settle = ns ? gpio_delay_spins(ns) : 0;
+}
+
+void
+gpio_matrix_set_diodes(gpio_matrix_t *m,bool diodes) {
+	m->diodes = diodes;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Rows released: latches low, pins inputs. Columns to inputs with
+// pull (normally Up).
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_matrix_configure(gpio_matrix_t *m,Pull pull) {
+	gpio_config_t cfg;
+
+	gpio_config_begin(&cfg);
+	for ( int gpio=0; gpio<32; ++gpio ) {
+		if ( m->rmask & (1u << gpio) )
+			gpio_config_io(&cfg,gpio,Input);
+		else if ( m->cmask & (1u << gpio) ) {
+			gpio_config_io(&cfg,gpio,Input);
+			gpio_config_pull(&cfg,gpio,pull);
+		}
+	}
+	gpio_port_write(0,m->rmask);
+	return gpio_config_commit(&cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+// One full scan, then resolve. Returns the number of events queued.
+//////////////////////////////////////////////////////////////////////
+
+unsigned
+gpio_matrix_scan(gpio_matrix_t *m) {
+	gpio_config_t cfg;
+
+	for ( int r=0; r<m->nrows; ++r ) {
+		cfg = m->drive[r];			// Commit clears its transaction
+		gpio_config_commit(&cfg);		// Release the last row, drive this one
+		if ( m->spin_settle )
+			gpio_spin_n(m->spin_settle);
+		gpio_matrix_sample(m,r,gpio_read32(),gpio_delay_now());
+	}
+	cfg = m->drive[m->nrows];
+	gpio_config_commit(&cfg);
+	return gpio_matrix_resolve(m);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Rows r and s are ambiguous when they share a closed column and
+// between them close at least two columns: any one of the keys in
+// the rectangle could then be a ghost of the other three.
+//////////////////////////////////////////////////////////////////////
+
+static uint32_t
+ghost_rows(const gpio_matrix_t *m) {
+	uint32_t ambiguous = 0;
+
+	for ( int r=0; r<m->nrows; ++r ) {
+		uint32_t kr = m->db[r].stable;
+
+		if ( !kr )
+			continue;
+		for ( int s=r+1; s<m->nrows; ++s ) {
+			uint32_t ks = m->db[s].stable, both = kr | ks;
+
+			if ( (kr & ks) && (both & (both - 1)) )
+				ambiguous |= (1u << r) | (1u << s);
+		}
+	}
+	return ambiguous;
+}
+
+static void
+post(gpio_matrix_t *m,int row,uint32_t pin,bool pressed) {
+	gpio_matrix_event_t *ev;
+
+	if ( m->head - m->tail >= GPIO_MATRIX_QUEUE ) {
+		++m->stats.dropped;
+		return;
+	}
+	ev = &m->queue[m->head++ & (GPIO_MATRIX_QUEUE - 1)];
+	ev->row = row;
+	ev->col = m->colx[__builtin_ctz(pin)];
+	ev->pressed = pressed;
+	ev->ns = m->row_ns[row];
+	++m->stats.events;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compare the debounced matrix with what was reported and queue the
+// differences, holding back presses in ambiguous rows.
+//////////////////////////////////////////////////////////////////////
+
+unsigned
+gpio_matrix_resolve(gpio_matrix_t *m) {
+	uint64_t events = m->stats.events;
+
+	++m->stats.scans;
+	m->ambiguous = m->diodes ? 0 : ghost_rows(m);
+	if ( m->ambiguous )
+		++m->stats.ghosted;
+
+	for ( int r=0; r<m->nrows; ++r ) {
+		uint32_t keys = m->db[r].stable, diff, pin;
+
+		if ( m->ambiguous & (1u << r) ) {
+			if ( keys & ~m->keys[r] )
+				++m->stats.held;
+			keys &= m->keys[r];		// Releases only
+		}
+		for ( diff = keys ^ m->keys[r]; diff; diff &= diff - 1 ) {
+			pin = diff & -diff;
+			post(m,r,pin,!!(keys & pin));
+		}
+		m->keys[r] = keys;
+	}
+	return m->stats.events - events;
+}
+
+bool
+gpio_matrix_get(gpio_matrix_t *m,gpio_matrix_event_t *ev) {
+
+	if ( m->head == m->tail )
+		return false;
+	*ev = m->queue[m->tail++ & (GPIO_MATRIX_QUEUE - 1)];
+	return true;
+}
+
+/* end gpmatrix.c */
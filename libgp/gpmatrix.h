@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////
+// gpmatrix.h -- Keypad and switch matrix scanner
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPMATRIX_H
+#define GPMATRIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpdebounce.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Rows are open drain, as on a 1-Wire bus (gpw1.h): their output
+// latches are held low and idle rows are inputs, so a row is never
+// driven high. A scan makes one row at a time an output (one
+// configuration commit per row) and reads every column in one GPLEV0
+// read. Columns are inputs pulled up, so a closed switch reads low.
+// Each row has a bit-sliced debouncer (gpdebounce.h) over its column
+// pins, so all columns of a row debounce at once.
+//
+// Without diodes, three closed corners of a rectangle make the fourth
+// read closed too (ghosting). After every scan rows whose debounced
+// keys overlap another row's in a way that could hide a ghost are
+// marked ambiguous: their releases are reported but new presses are
+// held back until the ambiguity clears. Since idle rows float, keys
+// sharing a column never join a driven row to a high one.
+//////////////////////////////////////////////////////////////////////
+
+#define GPIO_MATRIX_ROWS	16
+#define GPIO_MATRIX_COLS	16
+#define GPIO_MATRIX_QUEUE	64	// Events held (power of 2)
+
+typedef struct {
+	uint8_t		row;
+	uint8_t		col;
+	bool		pressed;
+	uint64_t	ns;		// Row read that completed the debounce
+} gpio_matrix_event_t;
+
+typedef struct {
+	uint64_t	scans;		// Full matrix scans
+	uint64_t	events;		// Presses and releases reported
+	uint64_t	ghosted;	// Scans with ambiguous rows
+	uint64_t	held;		// Row scans holding presses back
+	uint64_t	dropped;	// Events lost to a full queue
+} gpio_matrix_stats_t;
+
+typedef struct {
+	int		nrows;
+	int		ncols;
+	uint32_t	rows[GPIO_MATRIX_ROWS];	// Row pin masks
+	uint32_t	cols[GPIO_MATRIX_COLS];	// Column pin masks
+	uint32_t	rmask;		// All row pins
+	uint32_t	cmask;		// All column pins
+	int8_t		colx[32];	// Column index of a gpio, else -1
+	bool		diodes;		// Diode per switch: no ghosting
+	uint32_t	spin_settle;	// Spins from row drive to column read
+	gpio_config_t	drive[GPIO_MATRIX_ROWS + 1];	// Row r output, row r - 1 input
+	gpio_debounce_t	db[GPIO_MATRIX_ROWS];	// Stable: column pins closed
+	uint64_t	row_ns[GPIO_MATRIX_ROWS];	// Time of each row's last read
+	uint32_t	keys[GPIO_MATRIX_ROWS];	// Reported: column pins down
+	uint32_t	ambiguous;	// Rows held by ghosting (bit per row)
+	gpio_matrix_event_t queue[GPIO_MATRIX_QUEUE];
+	unsigned	head, tail;
+	gpio_matrix_stats_t stats;
+} gpio_matrix_t;
+
+int gpio_matrix_init(gpio_matrix_t *m,const int *rows,int nrows,const int *cols,int ncols);
+int gpio_matrix_debounce(gpio_matrix_t *m,unsigned samples);
+void gpio_matrix_set_settle(gpio_matrix_t *m,uint32_t ns);
+void gpio_matrix_set_diodes(gpio_matrix_t *m,bool diodes);
+int gpio_matrix_configure(gpio_matrix_t *m,Pull pull);
+
+unsigned gpio_matrix_scan(gpio_matrix_t *m);
+unsigned gpio_matrix_resolve(gpio_matrix_t *m);
+bool gpio_matrix_get(gpio_matrix_t *m,gpio_matrix_event_t *ev);
+
+//////////////////////////////////////////////////////////////////////
+// Feed one row's GPLEV0 sample (read while that row was driven low)
+//////////////////////////////////////////////////////////////////////
+
+static inline uint32_t
+gpio_matrix_sample(gpio_matrix_t *m,int row,uint32_t raw,uint64_t ns) {
+	m->row_ns[row] = ns;
+	return gpio_debounce_sample(&m->db[row],~raw & m->cmask);
+}
+
+static inline bool
+gpio_matrix_down(const gpio_matrix_t *m,int row,int col) {
+	return !!(m->keys[row] & m->cols[col]);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPMATRIX_H
+
+// End gpmatrix.h
@@ -0,0 +1,415 @@
+/* Hardware PWM and GPCLK outputs gppwm.c
+ * Warren W. Gay ve3wwg
+ *
+ * The clock manager divides a source clock by DIVI + DIVF/4096. With
+ * MASH 0 only DIVI is used and the output is an exact square wave;
+ * MASH 1 dithers between DIVI and DIVI+1 to hit the average frequency.
+ * The two PWM channels share the PWM clock, so the second channel
+ * started keeps the clock chosen for the first.
+ *
+ * Once started, the waveforms run in hardware with no CPU involvement
+ * and outlive the process that set them up.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gppwm.h"
+
+#define PWM_RANGE	4096		// Preferred PWM steps per period
+#define BUSY_TRIES	100000		// Polls of CM_CTL_BUSY before KILL
+
+static const struct {
+	int8_t		gpio;
+	bool		pwm;		// PWM channel, else GPCLK
+	int8_t		channel;	// PWM 0-1 or GPCLK 0-2
+	IO		alt;
+} hwpins[] = {
+	{ 4, false, 0, Alt0 }, { 5, false, 1, Alt0 }, { 6, false, 2, Alt0 },
+	{ 20, false, 0, Alt5 }, { 21, false, 1, Alt5 },
+	{ 32, false, 0, Alt0 }, { 34, false, 0, Alt0 },
+	{ 42, false, 1, Alt0 }, { 43, false, 2, Alt0 }, { 44, false, 1, Alt0 },
+	{ 12, true, 0, Alt0 }, { 13, true, 1, Alt0 },
+	{ 18, true, 0, Alt5 }, { 19, true, 1, Alt5 },
+	{ 40, true, 0, Alt0 }, { 41, true, 1, Alt0 }, { 45, true, 1, Alt0 }
+};
+
+/*
+ * Rounding for positive values (keeps libgp free of -lm):
+ */
+static inline long
+round_pos(double v) {
+	return (long)(v + 0.5);
+}
+
+static inline double
+abs_diff(double a,double b) {
+	return a > b ? a - b : b - a;
+}
+
+static const uint32_t gpclk_ctl[] = { CM_GP0CTL, CM_GP1CTL, CM_GP2CTL };
+static const uint32_t gpclk_div[] = { CM_GP0DIV, CM_GP1DIV, CM_GP2DIV };
+static const uint32_t pwm_rng[] = { PWM_RNG1, PWM_RNG2 };
+static const uint32_t pwm_dat[] = { PWM_DAT1, PWM_DAT2 };
+
+//////////////////////////////////////////////////////////////////////
+// Which GPCLK or PWM channel gpio can carry, and its alt function
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_hw_channel(int gpio,bool *is_pwm,int *channel,IO *alt) {
+
+	for ( unsigned x=0; x<sizeof hwpins/sizeof hwpins[0]; ++x ) {
+		if ( hwpins[x].gpio != gpio )
+			continue;
+		*is_pwm = hwpins[x].pwm;
+		*channel = hwpins[x].channel;
+		*alt = hwpins[x].alt;
+		return 0;
+	}
+	return EINVAL;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Source clock rates (the Pi 4 has its peripherals at 0xFE000000)
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_clock_source_hz(ClkSrc src) {
+	bool pi4 = gpio_peri_base() == 0xFE000000;
+
+	switch ( src ) {
+	case ClkOsc :
+		return pi4 ? 54000000 : 19200000;
+	case ClkPlld :
+		return pi4 ? 750000000 : 500000000;
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Choose the source and divisor closest to hz. Without frac, only
+// integer divisors are used. Returns ERANGE when no source can
+// produce hz with a divisor of min_divi to 4095.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_clock_divisor(double hz,bool frac,uint32_t min_divi,gpio_clkdiv_t *div) {
+	static const ClkSrc srcs[] = { ClkOsc, ClkPlld };
+	double best_err = -1.0;
+
+	if ( hz <= 0.0 )
+		return EINVAL;
+
+	for ( unsigned x=0; x<sizeof srcs/sizeof srcs[0]; ++x ) {
+		double src_hz = gpio_clock_source_hz(srcs[x]);
+		double d = src_hz / hz, err;
+		uint32_t divi, divf = 0;
+
+		if ( frac ) {
+			divi = (uint32_t)d;
+			divf = (uint32_t)round_pos((d - divi) * 4096.0);
+			if ( divf >= 4096 ) {
+				++divi;
+				divf = 0;
+			}
+		} else	divi = (uint32_t)round_pos(d);
+
+		if ( d > 4095.0 + 4095.0 / 4096.0 || divi < min_divi || divi > 4095 )
+			continue;
+
+		err = abs_diff(src_hz / (divi + divf / 4096.0),hz);
+		if ( best_err < 0.0 || err < best_err ) {	// Ties keep the oscillator
+			best_err = err;
+			div->src = srcs[x];
+			div->divi = divi;
+			div->divf = divf;
+			div->hz = src_hz / (divi + divf / 4096.0);
+		}
+	}
+	return best_err < 0.0 ? ERANGE : 0;
+}
+
+/*
+ * Disable a clock and wait for it to stop:
+ */
+static void
+clock_off(uint32_t ctl_reg) {
+	uint32_v *ctl = CMREG(ctl_reg);
+
+	gpio_store(ctl,CM_PASSWD | (*ctl & 0x00FFFFFF & ~CM_CTL_ENAB));
+	for ( int x=0; *ctl & CM_CTL_BUSY; ++x ) {
+		if ( x >= BUSY_TRIES ) {
+			gpio_store(ctl,CM_PASSWD | CM_CTL_KILL);
+			gpio_store(ctl,CM_PASSWD);
+			break;
+		}
+	}
+}
+
+/*
+ * Reprogram a clock (divisors may only change while it is stopped):
+ */
+static void
+clock_set(uint32_t ctl_reg,uint32_t div_reg,const gpio_clkdiv_t *div) {
+	uint32_t ctl = CM_CTL_SRC(div->src) | CM_CTL_MASH(div->divf ? 1 : 0);
+
+	clock_off(ctl_reg);
+	gpio_store(CMREG(div_reg),CM_PASSWD | CM_DIV(div->divi,div->divf));
+	gpio_store(CMREG(ctl_reg),CM_PASSWD | ctl);
+	gpio_store(CMREG(ctl_reg),CM_PASSWD | ctl | CM_CTL_ENAB);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Square wave on a GPCLK pin
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_clock_start(int gpio,double hz,bool frac,double *actual) {
+	gpio_clkdiv_t div;
+	bool is_pwm;
+	int chan, rc;
+	IO alt;
+
+	if ( gpio_hw_channel(gpio,&is_pwm,&chan,&alt) || is_pwm )
+		return EINVAL;
+	if ( !ucm )
+		return ENODEV;
+	if ( (rc = gpio_clock_divisor(hz,frac,frac ? 2 : 1,&div)) != 0 )
+		return rc;
+
+	clock_set(gpclk_ctl[chan],gpclk_div[chan],&div);
+	gpio_configure_io(gpio,alt);
+	if ( actual )
+		*actual = div.hz;
+	return 0;
+}
+
+int
+gpio_clock_stop(int gpio) {
+	bool is_pwm;
+	int chan;
+	IO alt;
+
+	if ( gpio_hw_channel(gpio,&is_pwm,&chan,&alt) || is_pwm )
+		return EINVAL;
+	if ( !ucm )
+		return ENODEV;
+
+	gpio_configure_io(gpio,Input);
+	clock_off(gpclk_ctl[chan]);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// PWM in mark/space mode: high for duty (0.0-1.0) of each period
+//////////////////////////////////////////////////////////////////////
+
+/*
+ * Frequency of the running PWM clock, else 0:
+ */
+static double
+pwm_clock_hz() {
+	uint32_t ctl = *CMREG(CM_PWMCTL), div = *CMREG(CM_PWMDIV);
+	uint32_t divi = div >> 12 & 0xFFF;
+
+	if ( !(ctl & CM_CTL_ENAB) || !divi )
+		return 0.0;
+	return (double)gpio_clock_source_hz((ClkSrc)(ctl & 0x0F)) / divi;
+}
+
+/*
+ * Start the PWM clock near hz * PWM_RANGE, trying each source with an
+ * integer divisor of 2 to 4095. Both PWM channels are stopped.
+ */
+static int
+pwm_clock(double hz,double *clk_hz) {
+	gpio_clkdiv_t best;
+	double best_err = -1.0, err;
+	uint32_t range;
+
+	for ( ClkSrc src=ClkOsc; ; src=ClkPlld ) {
+		double src_hz = gpio_clock_source_hz(src);
+		long divi = round_pos(src_hz / (hz * PWM_RANGE));
+
+		if ( divi < 2 )
+			divi = 2;
+		else if ( divi > 4095 )
+			divi = 4095;
+		range = round_pos(src_hz / divi / hz);
+		if ( range >= 2 ) {
+			err = abs_diff(src_hz / divi / range,hz);
+			if ( best_err < 0.0 || err < best_err ) {
+				best_err = err;
+				best.src = src;
+				best.divi = divi;
+				best.divf = 0;
+				best.hz = src_hz / divi;
+			}
+		}
+		if ( src == ClkPlld )
+			break;
+	}
+	if ( best_err < 0.0 )
+		return ERANGE;
+
+	gpio_store(PWMREG(PWM_CTL),0);		// Both channels off
+	clock_set(CM_PWMCTL,CM_PWMDIV,&best);
+	*clk_hz = best.hz;
+	return 0;
+}
+
+int
+gpio_pwm_start(int gpio,double hz,double duty,double *actual) {
+	double clk_hz = 0.0;
+	uint32_t range;
+	bool is_pwm;
+	int chan, rc;
+	IO alt;
+
+	if ( gpio_hw_channel(gpio,&is_pwm,&chan,&alt) || !is_pwm )
+		return EINVAL;
+	if ( !ucm || !upwm )
+		return ENODEV;
+	if ( hz <= 0.0 || duty < 0.0 || duty > 1.0 )
+		return EINVAL;
+
+	if ( *PWMREG(PWM_CTL) & PWM_CTL_PWEN(chan ^ 1) )
+		clk_hz = pwm_clock_hz();		// Shared with the other channel
+	if ( clk_hz <= 0.0 && (rc = pwm_clock(hz,&clk_hz)) != 0 )
+		return rc;
+
+	range = round_pos(clk_hz / hz);
+	if ( range < 2 )
+		return ERANGE;
+
+	gpio_store(PWMREG(PWM_CTL),*PWMREG(PWM_CTL) & ~PWM_CTL_CHAN(chan));
+	gpio_store(PWMREG(pwm_rng[chan]),range);
+	gpio_store(PWMREG(pwm_dat[chan]),(uint32_t)round_pos(duty * range));
+	gpio_store(PWMREG(PWM_CTL),*PWMREG(PWM_CTL) | PWM_CTL_MSEN(chan) | PWM_CTL_PWEN(chan));
+	gpio_configure_io(gpio,alt);
+
+	if ( actual )
+		*actual = clk_hz / range;
+	return 0;
+}
+
+/*
+ * Change the duty of a running channel (takes effect next period):
+ */
+int
+gpio_pwm_duty(int gpio,double duty) {
+	bool is_pwm;
+	int chan;
+	IO alt;
+
+	if ( gpio_hw_channel(gpio,&is_pwm,&chan,&alt) || !is_pwm )
+		return EINVAL;
+	if ( !upwm )
+		return ENODEV;
+	if ( duty < 0.0 || duty > 1.0 || !(*PWMREG(PWM_CTL) & PWM_CTL_PWEN(chan)) )
+		return EINVAL;
+
+	gpio_store(PWMREG(pwm_dat[chan]),(uint32_t)round_pos(duty * *PWMREG(pwm_rng[chan])));
+	return 0;
+}
+
+int
+gpio_pwm_stop(int gpio) {
+	bool is_pwm;
+	int chan;
+	IO alt;
+
+	if ( gpio_hw_channel(gpio,&is_pwm,&chan,&alt) || !is_pwm )
+		return EINVAL;
+	if ( !ucm || !upwm )
+		return ENODEV;
+
+	gpio_configure_io(gpio,Input);
+	gpio_store(PWMREG(PWM_CTL),*PWMREG(PWM_CTL) & ~PWM_CTL_CHAN(chan));
+	if ( !(*PWMREG(PWM_CTL) & PWM_CTL_PWEN(chan ^ 1)) )
+		clock_off(CM_PWMCTL);			// Last channel: stop the clock
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// DMA pacing: a DREQ every 1/hz seconds. PWM channel 1 serializes one
+// FIFO word per period (no pin is routed to it); the PCM transmitter
+// takes one FIFO word per frame. Either takes over its peripheral.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_pwm_pace(double hz,double *actual) {
+	double clk_hz;
+	uint32_t range;
+	int rc;
+
+	if ( !ucm || !upwm )
+		return ENODEV;
+	if ( hz <= 0.0 )
+		return EINVAL;
+	if ( (rc = pwm_clock(hz,&clk_hz)) != 0 )
+		return rc;
+
+	range = round_pos(clk_hz / hz);
+	gpio_store(PWMREG(PWM_RNG1),range);
+	gpio_store(PWMREG(PWM_DMAC),PWM_DMAC_ENAB | PWM_DMAC_PANIC(7) | PWM_DMAC_DREQ(3));
+	gpio_store(PWMREG(PWM_CTL),PWM_CTL_CLRF);
+	gpio_store(PWMREG(PWM_CTL),PWM_CTL_USEF(0) | PWM_CTL_MODE(0) | PWM_CTL_PWEN(0));
+
+	if ( actual )
+		*actual = clk_hz / range;
+	return 0;
+}
+
+int
+gpio_pcm_pace(double hz,double *actual) {
+	const unsigned flen = 10;		// PCM clocks per frame
+	gpio_clkdiv_t div;
+	int rc;
+
+	if ( !ucm || !upcm )
+		return ENODEV;
+	if ( hz <= 0.0 )
+		return EINVAL;
+	if ( (rc = gpio_clock_divisor(hz * flen,false,2,&div)) != 0 )
+		return rc;
+
+	gpio_store(PCMREG(PCM_CS_A),0);
+	clock_set(CM_PCMCTL,CM_PCMDIV,&div);
+	gpio_store(PCMREG(PCM_CS_A),PCM_CS_EN);
+	gpio_store(PCMREG(PCM_MODE_A),PCM_MODE_FLEN(flen - 1) | PCM_MODE_FSLEN(1));
+	gpio_store(PCMREG(PCM_TXC_A),PCM_TXC_CH1WEX | PCM_TXC_CH1EN | PCM_TXC_CH1WID(0));
+	gpio_store(PCMREG(PCM_DREQ_A),PCM_DREQ_TX(2) | PCM_DREQ_TXPANIC(10));
+	gpio_store(PCMREG(PCM_CS_A),PCM_CS_EN | PCM_CS_TXCLR);
+	gpio_store(PCMREG(PCM_CS_A),PCM_CS_EN | PCM_CS_DMAEN | PCM_CS_TXON);
+
+	if ( actual )
+		*actual = div.hz / flen;
+	return 0;
+}
+
+/*
+ * Stop whichever pacing source was started:
+ */
+void
+gpio_pace_stop() {
+
+	if ( upwm && (*PWMREG(PWM_CTL) & PWM_CTL_USEF(0)) ) {
+		gpio_store(PWMREG(PWM_CTL),0);
+		gpio_store(PWMREG(PWM_DMAC),0);
+		clock_off(CM_PWMCTL);
+	}
+	if ( upcm && (*PCMREG(PCM_CS_A) & PCM_CS_TXON) ) {
+		gpio_store(PCMREG(PCM_CS_A),0);
+		clock_off(CM_PCMCTL);
+	}
+}
+
+/* end gppwm.c */
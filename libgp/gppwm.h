@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////
+// gppwm.h -- Hardware PWM and general purpose clock (GPCLK) outputs
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPPWM_H
+#define GPPWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum ClkSrc {	// Clock manager sources
+	ClkOsc=1,	// Crystal oscillator (19.2 MHz, 54 MHz on the Pi 4)
+	ClkPlld=6	// PLLD (500 MHz, 750 MHz on the Pi 4)
+} ClkSrc;
+
+typedef struct {
+	ClkSrc		src;		// Source selected
+	uint32_t	divi;		// Integer divisor
+	uint32_t	divf;		// Fractional divisor (/4096), MASH 1
+	double		hz;		// Resulting clock frequency
+} gpio_clkdiv_t;
+
+uint32_t gpio_clock_source_hz(ClkSrc src);
+int gpio_clock_divisor(double hz,bool frac,uint32_t min_divi,gpio_clkdiv_t *div);
+
+int gpio_clock_start(int gpio,double hz,bool frac,double *actual);
+int gpio_clock_stop(int gpio);
+
+int gpio_pwm_start(int gpio,double hz,double duty,double *actual);
+int gpio_pwm_duty(int gpio,double duty);
+int gpio_pwm_stop(int gpio);
+
+int gpio_pwm_pace(double hz,double *actual);
+int gpio_pcm_pace(double hz,double *actual);
+void gpio_pace_stop();
+
+int gpio_hw_channel(int gpio,bool *is_pwm,int *channel,IO *alt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPPWM_H
+
+// End gppwm.h
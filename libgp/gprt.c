@@ -0,0 +1,196 @@
+/* Real-time execution profile: gprt.c
+ * Warren W. Gay ve3wwg
+ *
+ * Each step of the profile is best effort: when mlockall(),
+ * SCHED_FIFO or the CPU affinity is not permitted, the reason is
+ * recorded and the program carries on without it.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "gprt.h"
+
+static gpio_rt_status_t status;
+
+static struct {
+	bool		saved;
+	int		policy;
+	struct sched_param param;
+	cpu_set_t	cpus;
+} prior;
+
+//////////////////////////////////////////////////////////////////////
+// Parse "prio[:cpu]" as used by the -R options
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_rt_parse(gpio_rt_opts_t *opts,const char *arg) {
+	char *ep;
+
+	opts->priority = strtol(arg,&ep,10);
+	opts->cpu = -1;
+	opts->lock_memory = true;
+
+	if ( *ep == ':' )
+		opts->cpu = strtol(ep+1,&ep,10);
+	if ( *ep || opts->priority < 1 || opts->priority > 99 )
+		return EINVAL;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Pre-fault some stack so the sampling loop takes no page faults
+//////////////////////////////////////////////////////////////////////
+
+static void
+prefault_stack() {
+	volatile char stack[64*1024];
+
+	memset((char *)stack,0,sizeof stack);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Apply the profile. Returns the GPIO_RT_* steps that took effect.
+//////////////////////////////////////////////////////////////////////
+
+unsigned
+gpio_rt_enter(const gpio_rt_opts_t *opts) {
+	struct sched_param param;
+
+	memset(&status,0,sizeof status);
+
+	if ( !prior.saved ) {
+		prior.policy = sched_getscheduler(0);
+		sched_getparam(0,&prior.param);
+		sched_getaffinity(0,sizeof prior.cpus,&prior.cpus);
+		prior.saved = true;
+	}
+
+	if ( opts->lock_memory ) {
+		if ( !mlockall(MCL_CURRENT|MCL_FUTURE) ) {
+			status.applied |= GPIO_RT_MLOCK;
+			prefault_stack();
+		} else	status.err_mlock = errno;
+	}
+
+	if ( opts->cpu >= 0 ) {
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(opts->cpu,&cpus);
+		if ( !sched_setaffinity(0,sizeof cpus,&cpus) )
+			status.applied |= GPIO_RT_AFFINITY;
+		else	status.err_affinity = errno;
+	}
+
+	param.sched_priority = opts->priority;
+	if ( !sched_setscheduler(0,SCHED_FIFO,&param) )
+		status.applied |= GPIO_RT_FIFO;
+	else	status.err_fifo = errno;
+
+	return status.applied;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Undo the profile (back to the scheduling in effect before)
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_rt_leave() {
+
+	if ( status.applied & GPIO_RT_FIFO )
+		sched_setscheduler(0,prior.policy,&prior.param);
+	if ( status.applied & GPIO_RT_AFFINITY )
+		sched_setaffinity(0,sizeof prior.cpus,&prior.cpus);
+	if ( status.applied & GPIO_RT_MLOCK )
+		munlockall();
+	status.applied = 0;
+}
+
+const gpio_rt_status_t *
+gpio_rt_status() {
+	return &status;
+}
+
+void
+gpio_rt_report(FILE *out) {
+	static const struct {
+		unsigned	flag;
+		const char	*what;
+	} steps[] = {
+		{ GPIO_RT_MLOCK, "mlockall" },
+		{ GPIO_RT_AFFINITY, "affinity" },
+		{ GPIO_RT_FIFO, "SCHED_FIFO" }
+	};
+	int errs[] = { status.err_mlock, status.err_affinity, status.err_fifo };
+
+	fprintf(out,"Real-time profile:");
+	for ( int x=0; x<3; ++x ) {
+		if ( status.applied & steps[x].flag )
+			fprintf(out," %s",steps[x].what);
+		else if ( errs[x] )
+			fprintf(out," %s(%s)",steps[x].what,strerror(errs[x]));
+	}
+	fprintf(out,"\n");
+}
+
+//////////////////////////////////////////////////////////////////////
+// Loop period histograms
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_jitter_init(gpio_jitter_t *jit,uint64_t deadline_ns) {
+
+	memset(jit,0,sizeof *jit);
+	jit->min_ns = ~0ull;
+	jit->deadline_ns = deadline_ns;
+}
+
+static const char *
+fmt_ns(char *buf,size_t bytes,uint64_t ns) {
+
+	if ( ns < 1000 )
+		snprintf(buf,bytes,"%llu ns",(unsigned long long)ns);
+	else if ( ns < 1000000 )
+		snprintf(buf,bytes,"%.1f us",ns / 1e3);
+	else	snprintf(buf,bytes,"%.1f ms",ns / 1e6);
+	return buf;
+}
+
+void
+gpio_jitter_report(const gpio_jitter_t *jit,FILE *out,const char *title) {
+	char b1[32], b2[32], b3[32];
+
+	if ( !jit->periods ) {
+		fprintf(out,"%s: no periods\n",title);
+		return;
+	}
+
+	fprintf(out,"%s: %llu periods, min %s, mean %s, max %s",
+		title,
+		(unsigned long long)jit->periods,
+		fmt_ns(b1,sizeof b1,jit->min_ns),
+		fmt_ns(b2,sizeof b2,jit->sum_ns / jit->periods),
+		fmt_ns(b3,sizeof b3,jit->max_ns));
+	if ( jit->deadline_ns )
+		fprintf(out,", %llu over %s",
+			(unsigned long long)jit->misses,
+			fmt_ns(b1,sizeof b1,jit->deadline_ns));
+	fprintf(out,"\n");
+
+	for ( int x=0; x<GPIO_JITTER_BINS; ++x ) {
+		if ( !jit->bins[x] )
+			continue;
+		fprintf(out,"  < %-10s %12llu  %8.4f%%\n",
+			fmt_ns(b1,sizeof b1,1ull << x),
+			(unsigned long long)jit->bins[x],
+			jit->bins[x] * 100.0 / jit->periods);
+	}
+}
+
+// End gprt.c
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////
+// gprt.h -- Opt-in real-time profile and loop jitter histograms
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPRT_H
+#define GPRT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gpdelay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIO_RT_MLOCK		0x01	// mlockall() took effect
+#define GPIO_RT_FIFO		0x02	// Running SCHED_FIFO
+#define GPIO_RT_AFFINITY	0x04	// Pinned to cpu
+
+typedef struct {
+	int		priority;	// SCHED_FIFO priority (1-99)
+	int		cpu;		// CPU to pin to, or -1
+	bool		lock_memory;	// mlockall(MCL_CURRENT|MCL_FUTURE)
+} gpio_rt_opts_t;
+
+typedef struct {
+	unsigned	applied;	// GPIO_RT_* that took effect
+	int		err_mlock;	// errno when not applied
+	int		err_fifo;
+	int		err_affinity;
+} gpio_rt_status_t;
+
+int gpio_rt_parse(gpio_rt_opts_t *opts,const char *arg);
+unsigned gpio_rt_enter(const gpio_rt_opts_t *opts);
+void gpio_rt_leave();
+const gpio_rt_status_t *gpio_rt_status();
+void gpio_rt_report(FILE *out);
+
+//////////////////////////////////////////////////////////////////////
+// Loop period histogram: bin x counts periods of [2^(x-1),2^x) ns
+//////////////////////////////////////////////////////////////////////
+
+#define GPIO_JITTER_BINS	40
+
+typedef struct {
+	uint64_t	last_ns;	// Time of previous tick (0 = none)
+	uint64_t	periods;	// Periods measured
+	uint64_t	min_ns, max_ns;
+	uint64_t	sum_ns;
+	uint64_t	deadline_ns;	// Periods above this are misses (0 = none)
+	uint64_t	misses;
+	uint64_t	bins[GPIO_JITTER_BINS];
+} gpio_jitter_t;
+
+void gpio_jitter_init(gpio_jitter_t *jit,uint64_t deadline_ns);
+void gpio_jitter_report(const gpio_jitter_t *jit,FILE *out,const char *title);
+
+static inline void
+gpio_jitter_tick(gpio_jitter_t *jit) {
+	uint64_t now = gpio_delay_now();
+
+	if ( __builtin_expect(jit->last_ns != 0,1) ) {
+		uint64_t d = now - jit->last_ns;
+		unsigned bin = d ? 64 - __builtin_clzll(d) : 0;
+
+		++jit->bins[bin < GPIO_JITTER_BINS ? bin : GPIO_JITTER_BINS - 1];
+		++jit->periods;
+		jit->sum_ns += d;
+		if ( d < jit->min_ns )
+			jit->min_ns = d;
+		if ( d > jit->max_ns )
+			jit->max_ns = d;
+		if ( jit->deadline_ns && d > jit->deadline_ns )
+			++jit->misses;
+	}
+	jit->last_ns = now;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPRT_H
+
+// End gprt.h
@@ -0,0 +1,405 @@
+/* Simulated peripheral backend gpsim.c
+ * Warren W. Gay ve3wwg
+ *
+ * The register pages live in a POSIX shared memory object created by
+ * the gpsim process. Loads by libgp are plain loads from the pages;
+ * stores are routed through gpsim_write(), which applies the register
+ * side effects (GPSET/GPCLR to GPLEV, pull sequencing, event latching,
+ * the PADS and clock manager passwords, clock BUSY and PWM status
+ * clearing) under the block's spinlock. Clock and PWM outputs are
+ * modelled at the register level only: they do not toggle GPLEV.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpsim.h"
+
+#define PINMASK		((1ull << GPSIM_NPINS) - 1)
+
+// Word offsets into the GPIO page
+#define W_FSEL0		0
+#define W_SET0		GPIOOFF(GPIO_GPSET0)
+#define W_CLR0		GPIOOFF(GPIO_GPCLR0)
+#define W_LEV0		GPIOOFF(GPIO_GPLEV0)
+#define W_EDS0		GPIOOFF(GPIO_GPEDS0)
+#define W_REN0		GPIOOFF(GPIO_GPREN0)
+#define W_FEN0		GPIOOFF(GPIO_GPFEN0)
+#define W_HEN0		GPIOOFF(GPIO_GPHEN0)
+#define W_LEN0		GPIOOFF(GPIO_GPLEN0)
+#define W_AREN0		GPIOOFF(GPIO_GPAREN0)
+#define W_AFEN0		GPIOOFF(GPIO_GPAFEN0)
+#define W_PUD		GPIOOFF(GPIO_GPPUD)
+#define W_UDCLK0	GPIOOFF(GPIO_GPUDCLK0)
+
+// Word offsets into the CM and PWM pages
+#define W_CMCTL(o)	CMOFF(o)
+#define W_PWMSTA	PWMOFF(PWM_STA)
+
+static gpsim_t *simblk = 0;	// Block attached by the "sim" backend
+
+//////////////////////////////////////////////////////////////////////
+// Internal helper functions
+//////////////////////////////////////////////////////////////////////
+
+static inline uint64_t
+get64(const uint32_t *page,unsigned w) {
+	return ((uint64_t)page[w+1] << 32 | page[w]) & PINMASK;
+}
+
+static inline void
+put64(uint32_t *page,unsigned w,uint64_t v) {
+	page[w] = (uint32_t)v;
+	page[w+1] = (uint32_t)(v >> 32);
+}
+
+/*
+ * Mask of pins whose GPFSEL field selects Output:
+ */
+static uint64_t
+output_mask(const gpsim_t *sim) {
+	uint64_t mask = 0;
+
+	for ( int gpio=0; gpio<GPSIM_NPINS; ++gpio )
+		if ( ((sim->gpio[W_FSEL0 + gpio / 10] >> (gpio % 10 * 3)) & 7) == Output )
+			mask |= 1ull << gpio;
+	return mask;
+}
+
+/*
+ * Apply the latched GPPUD control to newly clocked pins:
+ */
+static void
+pud_clock(gpsim_t *sim,int bank,uint32_t v) {
+	uint64_t clocked = (uint64_t)(v & ~sim->s.udclk[bank]) << (bank * 32);
+
+	sim->s.udclk[bank] = v;
+	if ( !clocked )
+		return;
+
+	sim->s.pullup &= ~clocked;
+	sim->s.pulldown &= ~clocked;
+	switch ( sim->s.pud ) {
+	case 0b10 :
+		sim->s.pullup |= clocked;
+		break;
+	case 0b01 :
+		sim->s.pulldown |= clocked;
+		break;
+	}
+	sim->s.pud_clocks += __builtin_popcountll(clocked);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Attach (and optionally create) the shared register block. Creating
+// fails with EBUSY while another gpsim is running; a stale object is
+// replaced by a new one, readable and writable by its owner only.
+//////////////////////////////////////////////////////////////////////
+
+gpsim_t *
+gpsim_attach(bool create) {
+	gpsim_t *sim;
+	struct stat sb;
+	int fd;
+
+	if ( create ) {
+		if ( (sim = gpsim_attach(false)) != 0 ) {
+			pid_t owner = sim->s.owner;
+
+			gpsim_detach(sim);
+			if ( owner > 0 && (kill(owner,0) == 0 || errno == EPERM) ) {
+				errno = EBUSY;
+				return 0;
+			}
+		}
+		shm_unlink(GPSIM_SHM);
+		fd = shm_open(GPSIM_SHM,O_RDWR|O_CREAT|O_EXCL,0600);
+	} else	fd = shm_open(GPSIM_SHM,O_RDWR,0);
+
+	if ( fd < 0 )
+		return 0;		// See errno
+	if ( create && ftruncate(fd,sizeof *sim) < 0 ) {
+		int er = errno;
+		close(fd);
+		errno = er;
+		return 0;
+	}
+	if ( fstat(fd,&sb) < 0 || (size_t)sb.st_size < sizeof *sim ) {
+		close(fd);
+		errno = EPROTO;		// Short object: mapping it would fault
+		return 0;
+	}
+
+	sim = (gpsim_t *)mmap(NULL,sizeof *sim,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if ( sim == MAP_FAILED )
+		return 0;
+
+	if ( create ) {
+		memset(sim,0,sizeof *sim);
+		sim->s.version = GPSIM_VERSION;
+		sim->s.owner = getpid();
+		for ( int x=0; x<3; ++x )	// 8 mA, hysteresis, slew limited
+			sim->pads[PADSOFF(GPIO_PADS00_27) + x] = 0x1B;
+		__atomic_store_n(&sim->s.magic,GPSIM_MAGIC,__ATOMIC_RELEASE);
+	} else if ( sim->s.magic != GPSIM_MAGIC || sim->s.version != GPSIM_VERSION ) {
+		munmap(sim,sizeof *sim);
+		errno = EPROTO;		// Stale or foreign object
+		return 0;
+	}
+	return sim;
+}
+
+void
+gpsim_detach(gpsim_t *sim) {
+	munmap(sim,sizeof *sim);
+}
+
+int
+gpsim_unlink() {
+	return shm_unlink(GPSIM_SHM);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Spinlock over the model (shared between processes)
+//////////////////////////////////////////////////////////////////////
+
+void
+gpsim_lock(gpsim_t *sim) {
+	while ( __atomic_exchange_n(&sim->s.lock,1,__ATOMIC_ACQUIRE) )
+		while ( sim->s.lock )
+			;
+}
+
+void
+gpsim_unlock(gpsim_t *sim) {
+	__atomic_store_n(&sim->s.lock,0,__ATOMIC_RELEASE);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Recompute GPLEV and latch events (caller holds the lock)
+//////////////////////////////////////////////////////////////////////
+
+void
+gpsim_update(gpsim_t *sim) {
+	uint64_t old = get64(sim->gpio,W_LEV0);
+	uint64_t outs = output_mask(sim);
+	uint64_t inp, lev;
+
+	// Undriven, unpulled inputs float at their last level
+	inp = (old & ~(sim->s.pullup|sim->s.pulldown)) | sim->s.pullup;
+	inp = (inp & ~sim->s.extmask) | (sim->s.ext & sim->s.extmask);
+	lev = ((sim->s.out & outs) | (inp & ~outs)) & PINMASK;
+
+	for ( int x=0; x<sim->s.nwires; ++x ) {
+		uint64_t to = 1ull << sim->s.wires[x].to;
+
+		if ( !(outs & to) ) {
+			if ( lev >> sim->s.wires[x].from & 1 )
+				lev |= to;
+			else	lev &= ~to;
+		}
+	}
+
+	uint64_t rise = ~old & lev, fall = old & ~lev;
+
+	sim->s.eds |= rise & (get64(sim->gpio,W_REN0) | get64(sim->gpio,W_AREN0));
+	sim->s.eds |= fall & (get64(sim->gpio,W_FEN0) | get64(sim->gpio,W_AFEN0));
+	sim->s.eds |= lev & get64(sim->gpio,W_HEN0);
+	sim->s.eds |= ~lev & get64(sim->gpio,W_LEN0);
+	sim->s.eds &= PINMASK;
+
+	put64(sim->gpio,W_LEV0,lev);
+	put64(sim->gpio,W_EDS0,sim->s.eds);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Model one register store (caller holds the lock)
+//////////////////////////////////////////////////////////////////////
+
+void
+gpsim_write(gpsim_t *sim,uint32_v *reg,uint32_t v) {
+	uint32_t *r = (uint32_t *)reg;
+
+	++sim->s.stores;
+
+	if ( r >= sim->pads && r < sim->pads + GPSIM_PAGE/4 ) {
+		if ( (v >> 24) == 0x5A )		// Password
+			*r = v & 0x1F;
+		return;
+	}
+	if ( r >= sim->cm && r < sim->cm + GPSIM_PAGE/4 ) {
+		unsigned w = r - sim->cm;
+
+		if ( (v & 0xFF000000) != CM_PASSWD )
+			return;				// Ignored without password
+		v &= 0x00FFFFFF;
+		if ( w == W_CMCTL(CM_GP0CTL) || w == W_CMCTL(CM_GP1CTL)
+		  || w == W_CMCTL(CM_GP2CTL) || w == W_CMCTL(CM_PWMCTL) ) {
+			// BUSY follows ENAB at once; KILL stops the clock
+			v &= ~CM_CTL_BUSY;
+			if ( (v & CM_CTL_ENAB) && !(v & CM_CTL_KILL) )
+				v |= CM_CTL_BUSY;
+		}
+		*r = v;
+		return;
+	}
+	if ( r >= sim->pwm && r < sim->pwm + GPSIM_PAGE/4 ) {
+		if ( r - sim->pwm == W_PWMSTA )
+			*r &= ~v;			// Write 1 to clear
+		else	*r = v;
+		return;
+	}
+	if ( r < sim->gpio || r >= sim->gpio + GPSIM_PAGE/4 )
+		return;					// Not modelled
+
+	unsigned w = r - sim->gpio;
+
+	if ( w == W_SET0 || w == W_SET0+1 )
+		sim->s.out |= (uint64_t)v << ((w - W_SET0) * 32);
+	else if ( w == W_CLR0 || w == W_CLR0+1 )
+		sim->s.out &= ~((uint64_t)v << ((w - W_CLR0) * 32));
+	else if ( w == W_EDS0 || w == W_EDS0+1 )
+		sim->s.eds &= ~((uint64_t)v << ((w - W_EDS0) * 32));
+	else if ( w == W_LEV0 || w == W_LEV0+1 )
+		return;					// Read-only
+	else if ( w == W_PUD ) {
+		sim->s.pud = v & 3;
+		*r = v & 3;
+	} else if ( w == W_UDCLK0 || w == W_UDCLK0+1 ) {
+		pud_clock(sim,w - W_UDCLK0,v);
+		*r = v;
+	} else	*r = v;
+
+	gpsim_update(sim);
+}
+
+//////////////////////////////////////////////////////////////////////
+// External stimulus: drive gpio to level (< 0 releases it)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpsim_drive(gpsim_t *sim,int gpio,int level) {
+	uint64_t bit;
+
+	if ( gpio < 0 || gpio >= GPSIM_NPINS )
+		return EINVAL;
+
+	bit = 1ull << gpio;
+	gpsim_lock(sim);
+	if ( level < 0 ) {
+		sim->s.extmask &= ~bit;
+	} else	{
+		sim->s.extmask |= bit;
+		if ( level )
+			sim->s.ext |= bit;
+		else	sim->s.ext &= ~bit;
+	}
+	gpsim_update(sim);
+	gpsim_unlock(sim);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Wire gpio from to input gpio to (a loopback jumper)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpsim_wire(gpsim_t *sim,int from,int to) {
+
+	if ( from < 0 || from >= GPSIM_NPINS || to < 0 || to >= GPSIM_NPINS )
+		return EINVAL;
+
+	gpsim_lock(sim);
+	if ( sim->s.nwires >= GPSIM_WIRES ) {
+		gpsim_unlock(sim);
+		return ENOSPC;
+	}
+	sim->s.wires[sim->s.nwires].from = from;
+	sim->s.wires[sim->s.nwires].to = to;
+	++sim->s.nwires;
+	gpsim_update(sim);
+	gpsim_unlock(sim);
+	return 0;
+}
+
+uint64_t
+gpsim_levels(gpsim_t *sim) {
+	return get64(sim->gpio,W_LEV0);
+}
+
+//////////////////////////////////////////////////////////////////////
+// The "sim" libgp backend
+//////////////////////////////////////////////////////////////////////
+
+static bool
+sim_open(void) {
+	if ( !simblk )
+		simblk = gpsim_attach(false);
+	return simblk != 0;
+}
+
+static void
+sim_close(void) {
+	if ( simblk ) {
+		gpsim_detach(simblk);
+		simblk = 0;
+	}
+}
+
+static void *
+sim_map(uint32_t offset,size_t bytes) {
+
+	if ( !simblk || bytes > GPSIM_PAGE ) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	switch ( offset ) {
+	case GPIO_BASE_OFFSET :
+		return simblk->gpio;
+	case PADS_BASE_OFFSET :
+		return simblk->pads;
+	case CM_BASE_OFFSET :
+		return simblk->cm;
+	case PWM_BASE_OFFSET :
+		return simblk->pwm;
+	default :
+		errno = ENODEV;		// Peripheral not simulated
+		return 0;
+	}
+}
+
+static void
+sim_unmap(void *addr,size_t bytes) {
+	// The block is released by sim_close()
+}
+
+static void
+sim_store(uint32_v *reg,uint32_t v) {
+	gpsim_lock(simblk);
+	gpsim_write(simblk,reg,v);
+	gpsim_unlock(simblk);
+}
+
+const gpio_backend_t gpio_backend_sim = {
+	"sim",
+	sim_open,
+	sim_close,
+	sim_map,
+	sim_unmap,
+	sim_store
+};
+
+/* end gpsim.c */
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////
+// gpsim.h -- Simulated BCM283x GPIO/PADS block in shared memory
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPSIM_H
+#define GPSIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "libgp.h"
+
+#define GPSIM_SHM	"/libgp-sim"	// shm_open(3) name
+#define GPSIM_MAGIC	0x4D495347	// "GSIM"
+#define GPSIM_VERSION	2
+#define GPSIM_PAGE	4096
+#define GPSIM_NPINS	54
+#define GPSIM_WIRES	16
+
+//////////////////////////////////////////////////////////////////////
+// Model state that is not visible in the register pages
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	uint32_t	magic;		// GPSIM_MAGIC when initialized
+	uint32_t	version;	// GPSIM_VERSION
+	volatile uint32_t lock;		// Spinlock over the whole block
+	pid_t		owner;		// gpsim process id
+	uint64_t	out;		// Output latches (GPSET/GPCLR)
+	uint64_t	ext;		// Externally driven input levels
+	uint64_t	extmask;	// Pins being driven externally
+	uint64_t	pullup;		// Pins with pull-up enabled
+	uint64_t	pulldown;	// Pins with pull-down enabled
+	uint64_t	eds;		// Latched event detect status
+	uint32_t	pud;		// Control latched from GPPUD
+	uint32_t	udclk[2];	// Last GPUDCLK0/1 values
+	int		nwires;		// Active wires
+	struct {
+		int8_t	from;		// Driving gpio (any mode)
+		int8_t	to;		// Driven gpio (input)
+	} wires[GPSIM_WIRES];
+	uint64_t	stores;		// Register stores modelled
+	uint64_t	pud_clocks;	// Pins clocked by GPUDCLKn
+} gpsim_state_t;
+
+typedef struct {
+	union {
+		gpsim_state_t	s;
+		uint8_t		pad[GPSIM_PAGE];
+	};
+	uint32_t	gpio[GPSIM_PAGE/4];	// 0x7E20_0000
+	uint32_t	pads[GPSIM_PAGE/4];	// 0x7E10_0000
+	uint32_t	cm[GPSIM_PAGE/4];	// 0x7E10_1000
+	uint32_t	pwm[GPSIM_PAGE/4];	// 0x7E20_C000
+} gpsim_t;
+
+gpsim_t *gpsim_attach(bool create);
+void gpsim_detach(gpsim_t *sim);
+int gpsim_unlink();
+
+void gpsim_lock(gpsim_t *sim);
+void gpsim_unlock(gpsim_t *sim);
+
+void gpsim_write(gpsim_t *sim,uint32_v *reg,uint32_t v);
+void gpsim_update(gpsim_t *sim);
+int gpsim_drive(gpsim_t *sim,int gpio,int level);
+int gpsim_wire(gpsim_t *sim,int from,int to);
+uint64_t gpsim_levels(gpsim_t *sim);
+
+#endif // GPSIM_H
+
+// End gpsim.h
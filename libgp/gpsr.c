@@ -0,0 +1,195 @@
+/* Chained 74HC595 outputs gpsr.c
+ * Warren W. Gay ve3wwg
+ *
+ * The edges[] array is the compiled image: one set/clr pair per
+ * clock, all chains merged. An update compares the image with what
+ * was last shifted out a byte position at a time and recompiles only
+ * the 8 clocks of positions that changed; the shift loop itself is
+ * nothing but stores and spins.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "gpdelay.h"
+#include "gpsr.h"
+
+static int
+pin_mask(int gpio,uint32_t *used,uint32_t *mask) {
+
+	*mask = 0;
+	if ( gpio < 0 )
+		return 0;
+	if ( gpio > 31 || (*used & (1u << gpio)) )
+		return EINVAL;		// Bank 0 only, no sharing
+	*mask = 1u << gpio;
+	*used |= *mask;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compile the 8 clocks of byte position k. The last bit of the chain
+// goes first, so position k's bit 7 is clock nbits - 1 - (8k + 7).
+//////////////////////////////////////////////////////////////////////
+
+static void
+compile_byte(gpio_sr_t *sr,int k) {
+	const uint8_t *bytes = &sr->image[k * sr->nchains];
+	gpio_sr_edge_t *e = &sr->edges[sr->nbits - 8 - k * 8];
+
+	for ( int b=7; b>=0; --b, ++e ) {
+		uint32_t set = 0;
+
+		for ( int c=0; c<sr->nchains; ++c )
+			set |= -(uint32_t)(bytes[c] >> b & 1) & sr->data[c];
+		e->set = set;
+		e->clr = (sr->dmask & ~set) | sr->clock;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compile the chains: data[c] is chain c's SER pin. oe may be -1
+// (/OE tied low).
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_sr_init(gpio_sr_t *sr,const int *data,int nchains,int clock,int latch,int oe,int nbits) {
+	uint32_t used = 0;
+	int rc;
+
+	memset(sr,0,sizeof *sr);
+	if ( nchains < 1 || nchains > GPIO_SR_CHAINS || nbits < 8 || (nbits & 7)
+	  || clock < 0 || latch < 0 )
+		return EINVAL;
+
+	for ( int c=0; c<nchains; ++c ) {
+		if ( (rc = pin_mask(data[c],&used,&sr->data[c])) != 0 || !sr->data[c] )
+			return EINVAL;
+		sr->dmask |= sr->data[c];
+	}
+	if ( (rc = pin_mask(clock,&used,&sr->clock)) != 0
+	  || (rc = pin_mask(latch,&used,&sr->latch)) != 0
+	  || (rc = pin_mask(oe,&used,&sr->oe)) != 0 )
+		return rc;
+
+	sr->nchains = nchains;
+	sr->nbits = nbits;
+	sr->nbytes = nbits / 8;
+	sr->image = calloc(sr->nbytes,nchains);
+	sr->latched = calloc(sr->nbytes,nchains);
+	sr->edges = malloc(nbits * sizeof *sr->edges);
+	if ( !sr->image || !sr->latched || !sr->edges ) {
+		gpio_sr_free(sr);
+		return ENOMEM;
+	}
+	for ( int k=0; k<sr->nbytes; ++k )
+		compile_byte(sr,k);		// The all zero image
+	return 0;
+}
+
+void
+gpio_sr_free(gpio_sr_t *sr) {
+
+	free(sr->image);
+	free(sr->latched);
+	free(sr->edges);
+	sr->image = sr->latched = 0;
+	sr->edges = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Minimum clock high and low times (74HC595 at 3.3 V: about 25 ns)
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_sr_set_timing(gpio_sr_t *sr,uint32_t half_ns) {
+	sr->spin_half = half_ns ? gpio_delay_spins(half_ns) : 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Pins to outputs with /OE high, shift out an all zero image and
+// latch it, then enable the outputs.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_sr_configure(gpio_sr_t *sr) {
+	gpio_config_t cfg;
+
+	gpio_port_write(sr->oe,sr->dmask | sr->clock | sr->latch);
+	gpio_config_begin(&cfg);
+	for ( int gpio=0; gpio<32; ++gpio )
+		if ( (sr->dmask | sr->clock | sr->latch | sr->oe) & (1u << gpio) )
+			gpio_config_io(&cfg,gpio,Output);
+	gpio_config_commit(&cfg);
+
+	memset(sr->image,0,sr->nbytes * sr->nchains);
+	gpio_sr_update(sr,true);
+	return gpio_sr_enable(sr,true);
+}
+
+int
+gpio_sr_enable(const gpio_sr_t *sr,bool on) {
+
+	if ( !sr->oe )
+		return on ? 0 : ENOSYS;
+	return on ? gpio_port_write(0,sr->oe) : gpio_port_write(sr->oe,0);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Replace chain's whole image (nbytes bytes, register 0 first)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_sr_put(gpio_sr_t *sr,int chain,const uint8_t *bytes) {
+
+	if ( chain < 0 || chain >= sr->nchains )
+		return EINVAL;
+	for ( int k=0; k<sr->nbytes; ++k )
+		sr->image[k * sr->nchains + chain] = bytes[k];
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Shift and latch if the image changed (or force). Returns true when
+// the outputs were updated.
+//////////////////////////////////////////////////////////////////////
+
+static inline void
+spin(uint32_t spins) {
+	if ( spins )
+		gpio_spin_n(spins);
+}
+
+bool
+gpio_sr_update(gpio_sr_t *sr,bool force) {
+	const int n = sr->nchains;
+	bool changed = false;
+
+	for ( int k=0; k<sr->nbytes; ++k ) {
+		if ( memcmp(&sr->image[k * n],&sr->latched[k * n],n) ) {
+			compile_byte(sr,k);
+			memcpy(&sr->latched[k * n],&sr->image[k * n],n);
+			changed = true;
+		}
+	}
+	if ( !changed && !force ) {
+		++sr->stats.skipped;
+		return false;
+	}
+
+	for ( int x=0; x<sr->nbits; ++x ) {
+		gpio_port_write(sr->edges[x].set,sr->edges[x].clr);
+		spin(sr->spin_half);
+		gpio_port_write(sr->clock,0);
+		spin(sr->spin_half);
+	}
+	gpio_port_write(sr->latch,0);
+	spin(sr->spin_half);
+	gpio_port_write(0,sr->latch);
+
+	sr->stats.clocks += sr->nbits;
+	++sr->stats.updates;
+	return true;
+}
+
+/* end gpsr.c */
@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////
+// gpsr.h -- Chained 74HC595 shift register outputs
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPSR_H
+#define GPSR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Up to GPIO_SR_CHAINS chains of equal length, each on its own data
+// pin (SER), share one shift clock (SRCLK) and one latch (RCLK).
+// Programs change a shadow image; gpio_sr_update() recompiles the
+// clock masks of the bytes that changed and, only if anything did,
+// shifts all chains in parallel and latches. Each clock is one
+// GPSET0/GPCLR0 pair (data of every chain with the clock falling)
+// and one GPSET0 store (clock rising). Outputs hold their old state
+// until the latch, so nothing glitches while shifting.
+//
+// Bit x of a chain is output Q(x % 8) (QA = 0) of register x / 8,
+// register 0 being the one wired to the data pin.
+//////////////////////////////////////////////////////////////////////
+
+#define GPIO_SR_CHAINS		8
+
+typedef struct {
+	uint32_t	set;		// Data ones
+	uint32_t	clr;		// Data zeros and the clock
+} gpio_sr_edge_t;
+
+typedef struct {
+	uint64_t	updates;	// Images shifted and latched
+	uint64_t	skipped;	// Updates with nothing changed
+	uint64_t	clocks;		// Shift clocks issued
+} gpio_sr_stats_t;
+
+typedef struct {
+	int		nchains;
+	int		nbits;		// Bits per chain (a multiple of 8)
+	int		nbytes;		// nbits / 8
+	uint32_t	data[GPIO_SR_CHAINS];	// SER masks
+	uint32_t	dmask;		// All SER pins
+	uint32_t	clock;		// SRCLK mask
+	uint32_t	latch;		// RCLK mask
+	uint32_t	oe;		// /OE mask, or 0
+	uint8_t		*image;		// Shadow: [byte][chain]
+	uint8_t		*latched;	// Image as last shifted out
+	gpio_sr_edge_t	*edges;		// [nbits] in shift order
+	uint32_t	spin_half;	// Spins per half clock
+	gpio_sr_stats_t	stats;
+} gpio_sr_t;
+
+int gpio_sr_init(gpio_sr_t *sr,const int *data,int nchains,int clock,int latch,int oe,int nbits);
+void gpio_sr_free(gpio_sr_t *sr);
+void gpio_sr_set_timing(gpio_sr_t *sr,uint32_t half_ns);
+int gpio_sr_configure(gpio_sr_t *sr);
+int gpio_sr_enable(const gpio_sr_t *sr,bool on);
+bool gpio_sr_update(gpio_sr_t *sr,bool force);
+int gpio_sr_put(gpio_sr_t *sr,int chain,const uint8_t *bytes);
+
+//////////////////////////////////////////////////////////////////////
+// Shadow image access
+//////////////////////////////////////////////////////////////////////
+
+static inline void
+gpio_sr_set(gpio_sr_t *sr,int chain,int bit,int value) {
+	uint8_t *p = &sr->image[(bit >> 3) * sr->nchains + chain];
+
+	if ( value )
+		*p |= 1u << (bit & 7);
+	else	*p &= ~(1u << (bit & 7));
+}
+
+static inline int
+gpio_sr_get(const gpio_sr_t *sr,int chain,int bit) {
+	return sr->image[(bit >> 3) * sr->nchains + chain] >> (bit & 7) & 1;
+}
+
+static inline void
+gpio_sr_put_byte(gpio_sr_t *sr,int chain,int reg,uint8_t value) {
+	sr->image[reg * sr->nchains + chain] = value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPSR_H
+
+// End gpsr.h
@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////
+// gpsrv.h -- Shared memory layout between gpsrv and its clients
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPSRV_H
+#define GPSRV_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "libgp.h"
+#include "gpedge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPSRV_SHM	"/libgp-srv"	// shm_open(3) name
+#define GPSRV_MAGIC	0x56525347	// "GSRV"
+#define GPSRV_VERSION	1
+#define GPSRV_SLOTS	16		// Concurrent clients
+#define GPSRV_RING	64		// Commands/responses in flight (power of 2)
+#define GPSRV_EVRING	256		// Edge events per client (power of 2)
+
+typedef enum {
+	GpsrvRead=1,	// gpio -> value
+	GpsrvWrite,	// gpio, a=bit
+	GpsrvRead32,	// -> value = GPLEV0
+	GpsrvPort,	// a=set mask, b=clear mask
+	GpsrvConfig,	// gpio, a=IO
+	GpsrvPull,	// gpio, a=Pull
+	GpsrvSubscribe,	// a=pin mask, b=GPIO_EDGE_* (a=0 unsubscribes)
+	GpsrvWait,	// gpio, a=level, b=timeout us (0 none) -> value = us waited
+	GpsrvSleep,	// a=microseconds
+	GpsrvQuery	// gpio -> value = GPSRV_QUERY_* fields
+} gpsrv_op_t;
+
+// GpsrvWait, GpsrvSleep and GpsrvQuery are served by gp -B only
+
+#define GPSRV_QUERY_LEVEL(v)	((v) & 1)
+#define GPSRV_QUERY_IO(v)	((IO)((v) >> 1 & 7))
+#define GPSRV_QUERY_DRIVE(v)	((int)((v) >> 4 & 7))
+#define GPSRV_QUERY_SLEW(v)	((v) >> 7 & 1)
+#define GPSRV_QUERY_HYST(v)	((v) >> 8 & 1)
+
+typedef struct {
+	uint32_t	seq;		// Echoed in the response
+	uint16_t	op;		// gpsrv_op_t
+	int16_t		gpio;
+	uint32_t	a, b;
+} gpsrv_cmd_t;
+
+typedef struct {
+	uint32_t	seq;		// Command answered
+	int32_t		rc;		// 0 or errno value
+	uint32_t	value;		// Read result
+	uint32_t	pad;
+} gpsrv_rsp_t;
+
+#define GPSRV_ALIGN	__attribute__((aligned(64)))
+
+/*
+ * One client. Each ring has a single producer and single consumer:
+ * commands client->server, responses and events server->client.
+ */
+typedef struct {
+	volatile int32_t	pid;		// Owner, 0 when free
+	uint32_t		sub_mask;	// Edge subscription (server side)
+	uint32_t		sub_flags;
+	uint32_t		ev_dropped;	// Events lost to a full ring
+
+	volatile uint32_t	cmd_head GPSRV_ALIGN;
+	volatile uint32_t	cmd_tail GPSRV_ALIGN;
+	gpsrv_cmd_t		cmd[GPSRV_RING];
+
+	volatile uint32_t	rsp_head GPSRV_ALIGN;
+	volatile uint32_t	rsp_tail GPSRV_ALIGN;
+	gpsrv_rsp_t		rsp[GPSRV_RING];
+
+	volatile uint32_t	ev_head GPSRV_ALIGN;
+	volatile uint32_t	ev_tail GPSRV_ALIGN;
+	gpio_edge_event_t	ev[GPSRV_EVRING];
+} gpsrv_slot_t;
+
+typedef struct {
+	uint32_t		magic;		// GPSRV_MAGIC once ready
+	uint32_t		version;
+	pid_t			server;		// Server pid
+	uint32_t		allowed;	// Pins clients may operate on
+	volatile uint64_t	ops;		// Commands executed
+	gpsrv_slot_t		slots[GPSRV_SLOTS] GPSRV_ALIGN;
+} gpsrv_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPSRV_H
+
+// End gpsrv.h
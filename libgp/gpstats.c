@@ -0,0 +1,226 @@
+/* Instrumentation counters gpstats.c
+ * Warren W. Gay ve3wwg
+ *
+ * Each instrumented process owns one segment, so counters are only
+ * shared between its own threads (relaxed atomic adds). The segment is
+ * unlinked by gpio_close(); one left behind by a process that died is
+ * reported stale by gpstat and removed with gpstat -C.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gpstats.h"
+
+static const char *op_names[GpstatOps] = {
+	"configure_io", "alt_function", "get_drive", "set_drive",
+	"configure_pullup", "config_commit", "read", "write",
+	"read32", "port_write", "group_write", "group_read"
+};
+
+static const char *pin_names[GpstatPinCounts] = {
+	"read", "write", "mode", "pull"
+};
+
+const char *
+gpstat_op_name(GpstatOp op) {
+	return op >= 0 && op < GpstatOps ? op_names[op] : "?";
+}
+
+const char *
+gpstat_pin_name(GpstatPin counter) {
+	return counter >= 0 && counter < GpstatPinCounts ? pin_names[counter] : "?";
+}
+
+static void
+shm_name(char *buf,size_t bufsz,pid_t pid) {
+	snprintf(buf,bufsz,"%s%d",GPSTAT_SHM,(int)pid);
+}
+
+#ifdef LIBGP_STATS
+
+gpstat_t *gpstat_seg = 0;
+
+//////////////////////////////////////////////////////////////////////
+// Tick counter frequency
+//////////////////////////////////////////////////////////////////////
+
+static uint64_t
+tick_hz() {
+#if defined(__aarch64__)
+	uint64_t hz;
+
+	asm volatile("mrs %0, cntfrq_el0" : "=r"(hz));
+	return hz;
+#elif defined(__arm__) && __ARM_ARCH >= 7
+	uint32_t hz;
+
+	asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(hz));
+	return hz;
+#elif defined(__x86_64__) || defined(__i386__)
+	struct timespec t0, t1, req = { 0, 20000000 };
+	uint64_t c0, c1, ns;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW,&t0);
+	c0 = gpstat_ticks();
+	nanosleep(&req,0);
+	clock_gettime(CLOCK_MONOTONIC_RAW,&t1);
+	c1 = gpstat_ticks();
+	ns = (t1.tv_sec - t0.tv_sec) * 1000000000ull + t1.tv_nsec - t0.tv_nsec;
+	return ns ? (c1 - c0) * 1000000000ull / ns : 1;
+#else
+	return 1000000000ull;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+// Create this process's segment (called by gpio_open())
+//////////////////////////////////////////////////////////////////////
+
+int
+gpstat_open() {
+	char name[64];
+	struct timespec ts;
+	gpstat_t *seg;
+	FILE *f;
+	int fd;
+
+	if ( gpstat_seg )
+		return 0;
+
+	/*
+	 * Always a new object: a stale one left by an earlier process
+	 * with this pid is removed and the create tried once more.
+	 */
+	shm_name(name,sizeof name,getpid());
+	fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,0644);
+	if ( fd < 0 && errno == EEXIST && shm_unlink(name) == 0 )
+		fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,0644);
+	if ( fd < 0 )
+		return errno;
+	if ( ftruncate(fd,sizeof *seg) < 0 ) {
+		int er = errno;
+
+		close(fd);
+		shm_unlink(name);
+		return er;
+	}
+	seg = (gpstat_t *)mmap(NULL,sizeof *seg,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if ( seg == MAP_FAILED ) {
+		int er = errno;
+
+		shm_unlink(name);
+		return er;
+	}
+
+	seg->version = GPSTAT_VERSION;
+	seg->pid = getpid();
+	if ( (f = fopen("/proc/self/comm","r")) != 0 ) {
+		if ( fgets(seg->comm,sizeof seg->comm,f) )
+			seg->comm[strcspn(seg->comm,"\n")] = 0;
+		fclose(f);
+	}
+	seg->tick_hz = tick_hz();
+	clock_gettime(CLOCK_REALTIME,&ts);
+	seg->start_ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	__atomic_store_n(&seg->magic,GPSTAT_MAGIC,__ATOMIC_RELEASE);
+
+	gpstat_seg = seg;
+	return 0;
+}
+
+void
+gpstat_close() {
+	char name[64];
+
+	if ( !gpstat_seg )
+		return;
+	munmap(gpstat_seg,sizeof *gpstat_seg);
+	gpstat_seg = 0;
+	shm_name(name,sizeof name,getpid());
+	shm_unlink(name);
+}
+
+#endif // LIBGP_STATS
+
+//////////////////////////////////////////////////////////////////////
+// Readers: list, attach (read only) and remove segments
+//////////////////////////////////////////////////////////////////////
+
+int
+gpstat_list(pid_t *pids,int max) {
+	DIR *dir = opendir("/dev/shm");
+	const char *prefix = GPSTAT_SHM + 1;	// Without the '/'
+	size_t plen = strlen(prefix);
+	struct dirent *ent;
+	int n = 0;
+
+	if ( !dir )
+		return 0;
+	while ( n < max && (ent = readdir(dir)) != 0 ) {
+		char *ep;
+		long pid;
+
+		if ( strncmp(ent->d_name,prefix,plen) )
+			continue;
+		pid = strtol(ent->d_name + plen,&ep,10);
+		if ( !*ep && pid > 0 )
+			pids[n++] = (pid_t)pid;
+	}
+	closedir(dir);
+	return n;
+}
+
+const gpstat_t *
+gpstat_attach(pid_t pid) {
+	char name[64];
+	gpstat_t *seg;
+	struct stat sb;
+	int fd;
+
+	shm_name(name,sizeof name,pid);
+	if ( (fd = shm_open(name,O_RDONLY,0)) < 0 )
+		return 0;
+	if ( fstat(fd,&sb) < 0 || (size_t)sb.st_size < sizeof *seg ) {
+		close(fd);
+		errno = EPROTO;
+		return 0;
+	}
+	seg = (gpstat_t *)mmap(NULL,sizeof *seg,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if ( seg == MAP_FAILED )
+		return 0;
+	if ( __atomic_load_n(&seg->magic,__ATOMIC_ACQUIRE) != GPSTAT_MAGIC
+	  || seg->version != GPSTAT_VERSION ) {
+		munmap(seg,sizeof *seg);
+		errno = EPROTO;
+		return 0;
+	}
+	return seg;
+}
+
+void
+gpstat_detach(const gpstat_t *seg) {
+
+	if ( seg )
+		munmap((void *)seg,sizeof *seg);
+}
+
+int
+gpstat_remove(pid_t pid) {
+	char name[64];
+
+	shm_name(name,sizeof name,pid);
+	return shm_unlink(name) < 0 ? errno : 0;
+}
+
+/* end gpstats.c */
@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////
+// gpstats.h -- Build time instrumentation counters for libgp
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPSTATS_H
+#define GPSTATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Built with -DLIBGP_STATS (make -C libgp clean all STATS=1),
+// gpio_open() creates a shared memory segment GPSTAT_SHM<pid> and the
+// libgp.c API counts every call into it: per operation calls, ticks
+// and a log2 tick histogram, and per pin reads, writes, mode and pull
+// changes. Without LIBGP_STATS the GPSTAT_* macros expand to nothing.
+// Times include nested libgp calls (gpio_group_write() includes
+// gpio_port_write()). The gpstat tool reads the segments of running
+// processes.
+//////////////////////////////////////////////////////////////////////
+
+#define GPSTAT_SHM	"/libgp-stats."	// shm_open(3) name prefix, pid follows
+#define GPSTAT_MAGIC	0x54535047	// "GPST"
+#define GPSTAT_VERSION	1
+#define GPSTAT_PINS	54
+#define GPSTAT_BUCKETS	32		// Bucket b: ticks in [2^(b-1),2^b)
+
+typedef enum GpstatOp {
+	GpstatConfigureIo,
+	GpstatAltFunction,
+	GpstatGetDrive,
+	GpstatSetDrive,
+	GpstatConfigurePullup,
+	GpstatConfigCommit,
+	GpstatRead,
+	GpstatWrite,
+	GpstatRead32,
+	GpstatPortWrite,
+	GpstatGroupWrite,
+	GpstatGroupRead,
+	GpstatOps			// Number of operations
+} GpstatOp;
+
+typedef enum GpstatPin {
+	GpstatPinRead,			// gpio_read()
+	GpstatPinWrite,			// gpio_write(), port and group writes
+	GpstatPinMode,			// Function select changes
+	GpstatPinPull,			// Pull resistor changes
+	GpstatPinCounts			// Counters per pin
+} GpstatPin;
+
+typedef struct {
+	uint64_t	calls;
+	uint64_t	ticks;		// Sum of call times
+	uint64_t	max_ticks;	// Longest call
+	uint64_t	hist[GPSTAT_BUCKETS];
+} gpstat_op_t;
+
+typedef struct {
+	uint32_t	magic;		// GPSTAT_MAGIC once ready
+	uint32_t	version;
+	pid_t		pid;		// Instrumented process
+	char		comm[16];	// Its name
+	uint64_t	tick_hz;	// Tick counter frequency
+	uint64_t	start_ns;	// CLOCK_REALTIME at gpio_open()
+	gpstat_op_t	ops[GpstatOps];
+	uint64_t	pins[GPSTAT_PINS][GpstatPinCounts];
+} gpstat_t;
+
+const char *gpstat_op_name(GpstatOp op);
+const char *gpstat_pin_name(GpstatPin counter);
+
+// Readers (built regardless of LIBGP_STATS)
+int gpstat_list(pid_t *pids,int max);
+const gpstat_t *gpstat_attach(pid_t pid);
+void gpstat_detach(const gpstat_t *seg);
+int gpstat_remove(pid_t pid);
+
+//////////////////////////////////////////////////////////////////////
+// Tick counter: the generic timer's virtual count on ARMv7/ARMv8, the
+// TSC on x86, else CLOCK_MONOTONIC_RAW nanoseconds.
+//////////////////////////////////////////////////////////////////////
+
+static inline uint64_t
+gpstat_ticks() {
+#if defined(__aarch64__)
+	uint64_t v;
+
+	asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+	return v;
+#elif defined(__arm__) && __ARM_ARCH >= 7
+	uint64_t v;
+
+	asm volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r"(v));
+	return v;
+#elif defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW,&ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+#ifdef LIBGP_STATS
+
+extern gpstat_t *gpstat_seg;		// Null until gpio_open()
+
+int gpstat_open();
+void gpstat_close();
+
+static inline void
+gpstat_record(GpstatOp op,uint64_t t0) {
+	gpstat_op_t *o;
+	uint64_t t;
+	int b;
+
+	if ( !gpstat_seg )
+		return;
+	t = gpstat_ticks() - t0;
+	b = t ? 64 - __builtin_clzll(t) : 0;
+	o = &gpstat_seg->ops[op];
+	__atomic_fetch_add(&o->calls,1,__ATOMIC_RELAXED);
+	__atomic_fetch_add(&o->ticks,t,__ATOMIC_RELAXED);
+	__atomic_fetch_add(&o->hist[b < GPSTAT_BUCKETS ? b : GPSTAT_BUCKETS - 1],1,__ATOMIC_RELAXED);
+	if ( t > o->max_ticks )
+		o->max_ticks = t;		// Racy, but only ever grows
+}
+
+static inline void
+gpstat_pin(int gpio,GpstatPin counter) {
+
+	if ( gpstat_seg && gpio >= 0 && gpio < GPSTAT_PINS )
+		__atomic_fetch_add(&gpstat_seg->pins[gpio][counter],1,__ATOMIC_RELAXED);
+}
+
+static inline void
+gpstat_pins(uint32_t mask,int bank,GpstatPin counter) {
+
+	for ( ; mask && gpstat_seg; mask &= mask - 1 )
+		gpstat_pin(bank * 32 + __builtin_ctz(mask),counter);
+}
+
+#define GPSTAT_BEGIN()			uint64_t gpstat_t0_ = gpstat_ticks()
+#define GPSTAT_END(op)			gpstat_record(op,gpstat_t0_)
+#define GPSTAT_PIN(gpio,counter)	gpstat_pin(gpio,counter)
+#define GPSTAT_PINS_MASK(mask,bank,counter) gpstat_pins(mask,bank,counter)
+
+#else
+
+#define GPSTAT_BEGIN()			do { } while (0)
+#define GPSTAT_END(op)			do { } while (0)
+#define GPSTAT_PIN(gpio,counter)	do { } while (0)
+#define GPSTAT_PINS_MASK(mask,bank,counter) do { } while (0)
+
+#endif // LIBGP_STATS
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPSTATS_H
+
+// End gpstats.h
@@ -0,0 +1,375 @@
+/* Multi-axis STEP/DIR pulse generator gpstep.c
+ * Warren W. Gay ve3wwg
+ *
+ * All of the arithmetic happens when a move is planned: square roots
+ * for the ramps, rounding to the tick, sorting and merging the edges
+ * of all axes. Running the move is a loop of spin to an absolute time,
+ * one GPSET0/GPCLR0 pair and one clock read per event; the error and
+ * rate statistics are worked out from the timestamps afterwards.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "gpdelay.h"
+#include "gpstep.h"
+
+static int
+pin_mask(int gpio,uint32_t *used,uint32_t *mask) {
+
+	*mask = 0;
+	if ( gpio < 0 )
+		return 0;
+	if ( gpio > 31 || (*used & (1u << gpio)) )
+		return EINVAL;		// Bank 0 only, no sharing
+	*mask = 1u << gpio;
+	*used |= *mask;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Axes: step[x] and dir[x] are axis x's pins (dir[x] may be -1, and
+// dir may be null). Defaults: 1000 steps/s, 4000 steps/s/s, 2 us
+// pulses, 5 us DIR setup, 1 us tick.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_step_init(gpio_step_t *st,const int *step,const int *dir,int naxes) {
+	uint32_t used = 0;
+
+	memset(st,0,sizeof *st);
+	if ( naxes < 1 || naxes > GPIO_STEP_AXES )
+		return EINVAL;
+
+	for ( int x=0; x<naxes; ++x ) {
+		gpio_step_axis_t *ax = &st->axis[x];
+
+		if ( step[x] < 0 || pin_mask(step[x],&used,&ax->step)
+		  || pin_mask(dir ? dir[x] : -1,&used,&ax->dir) )
+			return EINVAL;
+		ax->max_rate = 1000.0;
+		ax->accel = 4000.0;
+	}
+	st->naxes = naxes;
+	st->pulse_ns = 2000;
+	st->dir_setup_ns = 5000;
+	st->tick_ns = 1000;
+	return 0;
+}
+
+void
+gpio_step_free(gpio_step_t *st) {
+
+	free(st->ev);
+	st->ev = 0;
+	st->nev = st->evcap = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// The fastest rate the timing allows: a STEP pulse, an equal low
+// time, and a tick for rounding.
+//////////////////////////////////////////////////////////////////////
+
+static uint32_t
+pulse_ticks(const gpio_step_t *st) {
+	return (st->pulse_ns + st->tick_ns - 1) / st->tick_ns * st->tick_ns;
+}
+
+static double
+rate_limit(const gpio_step_t *st) {
+	return 1e9 / (2.0 * pulse_ticks(st) + st->tick_ns);
+}
+
+int
+gpio_step_limits(gpio_step_t *st,int axis,double max_rate,double accel) {
+
+	if ( axis < 0 || axis >= st->naxes )
+		return EINVAL;
+	if ( max_rate <= 0.0 || accel <= 0.0 || max_rate > rate_limit(st) )
+		return ERANGE;
+	st->axis[axis].max_rate = max_rate;
+	st->axis[axis].accel = accel;
+	return 0;
+}
+
+int
+gpio_step_timing(gpio_step_t *st,uint32_t pulse_ns,uint32_t dir_setup_ns,uint32_t tick_ns) {
+	gpio_step_t trial = *st;
+
+	if ( !pulse_ns || !tick_ns )
+		return EINVAL;
+	trial.pulse_ns = pulse_ns;
+	trial.tick_ns = tick_ns;
+	for ( int x=0; x<st->naxes; ++x )
+		if ( st->axis[x].max_rate > rate_limit(&trial) )
+			return ERANGE;		// Lower the axis rates first
+	st->pulse_ns = pulse_ns;
+	st->dir_setup_ns = dir_setup_ns;
+	st->tick_ns = tick_ns;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// STEP and DIR pins to outputs, low
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_step_configure(const gpio_step_t *st) {
+	gpio_config_t cfg;
+	uint32_t pins = 0;
+
+	for ( int x=0; x<st->naxes; ++x )
+		pins |= st->axis[x].step | st->axis[x].dir;
+
+	gpio_port_write(0,pins);
+	gpio_config_begin(&cfg);
+	for ( int gpio=0; gpio<32; ++gpio )
+		if ( pins & (1u << gpio) )
+			gpio_config_io(&cfg,gpio,Output);
+	return gpio_config_commit(&cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Seconds from rest to position pos of a trapezoidal move of nsteps,
+// cruising at rate with acceleration accel: the inverse of the
+// position curve.
+//////////////////////////////////////////////////////////////////////
+
+double
+gpio_step_profile_time(double pos,double nsteps,double rate,double accel) {
+	double n_acc = rate * rate / (2.0 * accel);
+	double t_acc, t_total;
+
+	if ( 2.0 * n_acc > nsteps ) {		// Triangle: never reaches rate
+		n_acc = nsteps / 2.0;
+		rate = sqrt(accel * nsteps);
+	}
+	t_acc = rate / accel;
+	t_total = 2.0 * t_acc + (nsteps - 2.0 * n_acc) / rate;
+
+	if ( pos <= n_acc )
+		return sqrt(2.0 * pos / accel);
+	if ( pos <= nsteps - n_acc )
+		return t_acc + (pos - n_acc) / rate;
+	return t_total - sqrt(2.0 * (nsteps - pos) / accel);
+}
+
+static double
+profile_peak(double nsteps,double rate,double accel) {
+
+	if ( rate * rate / accel > nsteps )
+		return sqrt(accel * nsteps);
+	return rate;
+}
+
+static int
+cmp_event(const void *a,const void *b) {
+	uint64_t ta = ((const gpio_step_event_t *)a)->t_ns;
+	uint64_t tb = ((const gpio_step_event_t *)b)->t_ns;
+
+	return ta < tb ? -1 : ta > tb;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Plan a relative move of steps[x] on each axis (0: axis stays put)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_step_plan(gpio_step_t *st,const int32_t *steps,bool sync) {
+	const uint64_t tick = st->tick_ns;
+	const uint64_t setup = (st->dir_setup_ns + tick - 1) / tick * tick;
+	const uint32_t pulse = pulse_ticks(st);
+	double lead = 0.0, lead_rate = 0.0, lead_accel = 0.0;
+	uint64_t total = 0;
+	uint32_t dir_set = 0, dir_clr = 0, stepmask = 0;
+	gpio_step_event_t *ev;
+	int n;
+
+	memset(&st->report,0,sizeof st->report);
+	st->nev = 0;
+
+	for ( int x=0; x<st->naxes; ++x ) {
+		gpio_step_axis_t *ax = &st->axis[x];
+		double nx = abs(steps[x]);
+
+		ax->steps = steps[x];
+		ax->peak_rate = 0.0;
+		ax->planned_span_ns = ax->span_ns = 0;
+		total += (uint64_t)nx;
+		if ( nx > lead )
+			lead = nx;
+		if ( steps[x] > 0 )
+			dir_set |= ax->dir;
+		else if ( steps[x] < 0 )
+			dir_clr |= ax->dir;
+		stepmask |= ax->step;
+	}
+	if ( !total )
+		return 0;
+
+	if ( sync ) {
+		/*
+		 * The lead profile, as fast as the most limited axis allows
+		 */
+		lead_rate = lead_accel = HUGE_VAL;
+		for ( int x=0; x<st->naxes; ++x ) {
+			double r = abs(steps[x]) / lead;
+
+			if ( r > 0.0 ) {
+				lead_rate = fmin(lead_rate,st->axis[x].max_rate / r);
+				lead_accel = fmin(lead_accel,st->axis[x].accel / r);
+			}
+		}
+	}
+
+	n = 1 + (int)(total * 2);
+	if ( n > st->evcap ) {
+		gpio_step_event_t *p = realloc(st->ev,n * sizeof *p);
+
+		if ( !p )
+			return ENOMEM;
+		st->ev = p;
+		st->evcap = n;
+	}
+
+	ev = st->ev;
+	ev->t_ns = 0;
+	ev->set = dir_set;
+	ev->clr = dir_clr | stepmask;
+	++ev;
+
+	for ( int x=0; x<st->naxes; ++x ) {
+		gpio_step_axis_t *ax = &st->axis[x];
+		int32_t nx = abs(steps[x]);
+		double scale = sync ? lead / nx : 1.0;
+		double rate = sync ? lead_rate : ax->max_rate;
+		double accel = sync ? lead_accel : ax->accel;
+		double len = sync ? lead : nx;
+
+		if ( !nx )
+			continue;
+		ax->peak_rate = profile_peak(len,rate,accel) / scale;
+		ax->planned_span_ns = (uint64_t)((gpio_step_profile_time(len,len,rate,accel)
+			- gpio_step_profile_time(scale,len,rate,accel)) * 1e9);
+
+		for ( int32_t k=1; k<=nx; ++k ) {
+			double t = gpio_step_profile_time(k * scale,len,rate,accel) * 1e9;
+			uint64_t q = (uint64_t)llround(t / tick) * tick;
+			uint32_t err = (uint32_t)fabs(t - (double)q);
+
+			if ( err > st->report.quant_ns )
+				st->report.quant_ns = err;
+			ev[0].t_ns = setup + q;
+			ev[0].set = ax->step;
+			ev[0].clr = 0;
+			ev[1].t_ns = setup + q + pulse;
+			ev[1].set = 0;
+			ev[1].clr = ax->step;
+			ev += 2;
+		}
+	}
+
+	/*
+	 * Time order, then one event per tick:
+	 */
+	qsort(st->ev + 1,n - 1,sizeof *st->ev,cmp_event);
+	ev = st->ev;
+	for ( int x=1; x<n; ++x ) {
+		if ( st->ev[x].t_ns == ev->t_ns ) {
+			ev->set |= st->ev[x].set;
+			ev->clr |= st->ev[x].clr;
+		} else	*++ev = st->ev[x];
+	}
+	st->nev = ev - st->ev + 1;
+
+	for ( int x=0; x<st->nev; ++x )
+		if ( __builtin_popcount(st->ev[x].set & stepmask) > 1 )
+			++st->report.combined;
+	st->report.steps = total;
+	st->report.events = st->nev;
+	st->report.planned_ns = st->ev[st->nev - 1].t_ns;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Run the planned move (real-time priority recommended, see gprt.h)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_step_run(gpio_step_t *st) {
+	gpio_step_report_t *rpt = &st->report;
+	uint64_t *ts, t0, first[GPIO_STEP_AXES] = { 0 };
+	const gpio_step_event_t *ev = st->ev;
+	const int nev = st->nev;
+	int64_t sum = 0;
+
+	if ( !nev )
+		return 0;
+	if ( !(ts = malloc(nev * sizeof *ts)) )
+		return ENOMEM;
+
+	t0 = gpio_delay_now() + st->tick_ns;
+	for ( int x=0; x<nev; ++x ) {
+		gpio_spin_until(t0 + ev[x].t_ns);
+		gpio_port_write(ev[x].set,ev[x].clr);
+		ts[x] = gpio_delay_now();
+	}
+
+	rpt->max_err_ns = 0;
+	rpt->late = 0;
+	for ( int x=0; x<nev; ++x ) {
+		int64_t err = (int64_t)(ts[x] - t0 - ev[x].t_ns);
+
+		sum += err;
+		if ( llabs(err) > rpt->max_err_ns )
+			rpt->max_err_ns = llabs(err);
+		if ( err > (int64_t)st->tick_ns )
+			++rpt->late;
+
+		for ( int a=0; a<st->naxes; ++a ) {
+			gpio_step_axis_t *ax = &st->axis[a];
+
+			if ( !(ev[x].set & ax->step) )
+				continue;
+			if ( !first[a] )
+				first[a] = ts[x];
+			ax->span_ns = ts[x] - first[a];
+		}
+	}
+	rpt->mean_err_ns = sum / nev;
+	rpt->duration_ns = ts[nev - 1] - ts[0];
+	rpt->step_rate = rpt->duration_ns ? rpt->steps * 1e9 / rpt->duration_ns : 0.0;
+	free(ts);
+
+	for ( int a=0; a<st->naxes; ++a )
+		st->axis[a].position += st->axis[a].steps;
+	return 0;
+}
+
+void
+gpio_step_report(const gpio_step_t *st,FILE *out) {
+	const gpio_step_report_t *rpt = &st->report;
+
+	fprintf(out,"%llu steps, %llu events (%llu combined), planned %.3f ms, ran %.3f ms, %.0f steps/s\n",
+		(unsigned long long)rpt->steps,(unsigned long long)rpt->events,
+		(unsigned long long)rpt->combined,rpt->planned_ns / 1e6,rpt->duration_ns / 1e6,
+		rpt->step_rate);
+	fprintf(out,"Timing error: max %lld ns, mean %lld ns, %llu late by over %u ns; rounding %u ns\n",
+		(long long)rpt->max_err_ns,(long long)rpt->mean_err_ns,
+		(unsigned long long)rpt->late,st->tick_ns,rpt->quant_ns);
+	for ( int a=0; a<st->naxes; ++a ) {
+		const gpio_step_axis_t *ax = &st->axis[a];
+
+		if ( !ax->steps )
+			continue;
+		fprintf(out,"  axis %d: %7d steps, peak %8.1f steps/s, mean %8.1f planned, %8.1f measured, at %lld\n",
+			a,ax->steps,ax->peak_rate,
+			ax->planned_span_ns ? (abs(ax->steps) - 1) * 1e9 / ax->planned_span_ns : 0.0,
+			ax->span_ns ? (abs(ax->steps) - 1) * 1e9 / ax->span_ns : 0.0,
+			(long long)ax->position);
+	}
+}
+
+/* end gpstep.c */
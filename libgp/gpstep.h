@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////
+// gpstep.h -- Multi-axis STEP/DIR pulse generator
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPSTEP_H
+#define GPSTEP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Planning a move computes each axis' step times from a trapezoidal
+// profile (accelerate, cruise, decelerate; a triangle when the move
+// is too short to reach the cruise rate), rounds them to the tick,
+// and merges every rising and falling STEP edge of every axis into one
+// time ordered event table. Edges that land on the same tick share an
+// event, so coinciding steps go out as one GPSET0/GPCLR0 pair. Running
+// the move spins to each event's absolute time (no drift) and then
+// stores its masks, timestamping every event to measure the error.
+//
+// With sync, every axis follows the lead axis' profile scaled to its
+// own step count (straight line moves), within all axes' limits.
+//////////////////////////////////////////////////////////////////////
+
+#define GPIO_STEP_AXES		8
+
+typedef struct {
+	uint64_t	t_ns;		// From the start of the move
+	uint32_t	set;		// STEP rises (and DIR ones at t = 0)
+	uint32_t	clr;		// STEP falls (and DIR zeros at t = 0)
+} gpio_step_event_t;
+
+typedef struct {
+	uint32_t	step;		// STEP pin mask
+	uint32_t	dir;		// DIR pin mask, or 0
+	double		max_rate;	// Steps per second
+	double		accel;		// Steps per second per second
+	int64_t		position;	// Steps, after completed moves
+	int32_t		steps;		// Planned move (sign: direction)
+	double		peak_rate;	// Planned cruise (or triangle peak)
+	uint64_t	planned_span_ns; // Planned: first to last STEP
+	uint64_t	span_ns;	// Measured: first to last STEP
+} gpio_step_axis_t;
+
+typedef struct {
+	uint64_t	steps;		// Steps of all axes
+	uint64_t	events;		// Register store pairs
+	uint64_t	combined;	// Events stepping more than one axis
+	uint64_t	duration_ns;	// Measured: first to last event
+	uint64_t	planned_ns;	// Planned: first to last event
+	double		step_rate;	// Measured: steps / duration (all axes)
+	uint32_t	quant_ns;	// Largest rounding of a step to the tick
+	int64_t		max_err_ns;	// Largest |late or early| of any event
+	int64_t		mean_err_ns;	// Mean signed error
+	uint64_t	late;		// Events more than a tick late
+} gpio_step_report_t;
+
+typedef struct {
+	int		naxes;
+	gpio_step_axis_t axis[GPIO_STEP_AXES];
+	uint32_t	pulse_ns;	// STEP high time
+	uint32_t	dir_setup_ns;	// DIR to first STEP
+	uint32_t	tick_ns;	// Event time resolution
+	gpio_step_event_t *ev;		// Planned move
+	int		nev;
+	int		evcap;
+	gpio_step_report_t report;
+} gpio_step_t;
+
+int gpio_step_init(gpio_step_t *st,const int *step,const int *dir,int naxes);
+void gpio_step_free(gpio_step_t *st);
+int gpio_step_limits(gpio_step_t *st,int axis,double max_rate,double accel);
+int gpio_step_timing(gpio_step_t *st,uint32_t pulse_ns,uint32_t dir_setup_ns,uint32_t tick_ns);
+int gpio_step_configure(const gpio_step_t *st);
+
+int gpio_step_plan(gpio_step_t *st,const int32_t *steps,bool sync);
+int gpio_step_run(gpio_step_t *st);
+void gpio_step_report(const gpio_step_t *st,FILE *out);
+
+double gpio_step_profile_time(double pos,double nsteps,double rate,double accel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPSTEP_H
+
+// End gpstep.h
@@ -0,0 +1,281 @@
+/* Software PWM engine gpswpwm.c
+ * Warren W. Gay ve3wwg
+ *
+ * All channels share one timing wheel of nticks slots per period. Slot 0
+ * holds the rising edges of every channel, and slot d holds the falling
+ * edges of every channel with duty d. Each occupied slot therefore costs
+ * one GPSET0 and/or one GPCLR0 store, however many channels change in it.
+ *
+ * Duty updates from other threads go into pending[] and set a bit in
+ * dirty. The engine thread folds them into the wheel at the start of
+ * each period, so a period never mixes old and new edges.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libgp.h"
+#include "gpswpwm.h"
+
+#define SLEEP_MARGIN	100000		// Spin the last 100 us of a wait
+
+static inline uint64_t
+now_ns() {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+/*
+ * Sleep most of the way to t, then spin:
+ */
+static inline uint64_t
+wait_until(uint64_t t) {
+	uint64_t now = now_ns();
+
+	if ( now + SLEEP_MARGIN < t ) {
+		struct timespec ts;
+
+		ts.tv_sec = (t - SLEEP_MARGIN) / 1000000000ull;
+		ts.tv_nsec = (t - SLEEP_MARGIN) % 1000000000ull;
+		clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+	}
+	while ( (now = now_ns()) < t )
+		;
+	return now;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Create an engine with a period of nticks ticks of tick_ns each
+//////////////////////////////////////////////////////////////////////
+
+gpio_swpwm_t *
+gpio_swpwm_open(uint32_t tick_ns,unsigned nticks) {
+	gpio_swpwm_t *pwm;
+
+	if ( !tick_ns || nticks < 2 ) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	pwm = calloc(1,sizeof *pwm);
+	if ( !pwm )
+		return 0;
+	pwm->set = calloc(nticks,sizeof *pwm->set);
+	pwm->clear = calloc(nticks,sizeof *pwm->clear);
+	if ( !pwm->set || !pwm->clear ) {
+		gpio_swpwm_close(pwm);
+		errno = ENOMEM;
+		return 0;
+	}
+	pwm->tick_ns = tick_ns;
+	pwm->nticks = nticks;
+	return pwm;
+}
+
+void
+gpio_swpwm_close(gpio_swpwm_t *pwm) {
+
+	gpio_swpwm_stop(pwm);
+	free(pwm->set);
+	free(pwm->clear);
+	free(pwm);
+}
+
+/*
+ * Move gpio's edges in the wheel from its current duty to duty:
+ */
+static void
+wheel_move(gpio_swpwm_t *pwm,int gpio,unsigned duty) {
+	uint32_t bit = 1u << gpio;
+	unsigned old = pwm->duty[gpio];
+
+	if ( old )
+		pwm->set[0] &= ~bit;
+	if ( old < pwm->nticks )
+		pwm->clear[old] &= ~bit;
+
+	if ( duty )
+		pwm->set[0] |= bit;
+	if ( duty < pwm->nticks )
+		pwm->clear[duty] |= bit;		// duty 0: held low
+	pwm->duty[gpio] = duty;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Add a bank 0 gpio as an output channel (engine stopped)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_swpwm_add(gpio_swpwm_t *pwm,int gpio,unsigned duty) {
+
+	if ( gpio < 0 || gpio > 31 || duty > pwm->nticks )
+		return EINVAL;
+	if ( pwm->running )
+		return EBUSY;
+
+	if ( !(pwm->mask & (1u << gpio)) ) {
+		gpio_write(gpio,0);
+		gpio_configure_io(gpio,Output);
+		pwm->mask |= 1u << gpio;
+		pwm->duty[gpio] = pwm->nticks;	// Nothing in the wheel yet
+	}
+	wheel_move(pwm,gpio,duty);
+	pwm->pending[gpio] = duty;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Request a new duty (ticks high per period). Lock-free: may be
+// called from any thread while the engine runs. Takes effect at the
+// start of the next period.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_swpwm_set(gpio_swpwm_t *pwm,int gpio,unsigned duty) {
+
+	if ( gpio < 0 || gpio > 31 || !(pwm->mask & (1u << gpio)) || duty > pwm->nticks )
+		return EINVAL;
+
+	__atomic_store_n(&pwm->pending[gpio],duty,__ATOMIC_RELAXED);
+	__atomic_or_fetch(&pwm->dirty,1u << gpio,__ATOMIC_RELEASE);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Engine thread
+//////////////////////////////////////////////////////////////////////
+
+static void *
+swpwm_thread(void *arg) {
+	gpio_swpwm_t *pwm = (gpio_swpwm_t *)arg;
+	const uint64_t period = (uint64_t)pwm->tick_ns * pwm->nticks;
+	gpio_swpwm_stats_t *st = &pwm->stats;
+	uint64_t start, t0, t, now;
+	int64_t late0, err;
+	struct timespec cpu0, cpu1;
+	uint32_t dirty;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID,&cpu0);
+	start = t0 = now_ns();
+
+	while ( !pwm->stop ) {
+		dirty = __atomic_exchange_n(&pwm->dirty,0,__ATOMIC_ACQUIRE);
+		while ( dirty ) {
+			int gpio = __builtin_ctz(dirty);
+
+			dirty &= dirty - 1;
+			wheel_move(pwm,gpio,__atomic_load_n(&pwm->pending[gpio],__ATOMIC_RELAXED));
+		}
+
+		wait_until(t0);
+		gpio_port_write(pwm->set[0],pwm->clear[0]);
+		late0 = now_ns() - t0;
+		++st->writes;
+
+		for ( unsigned k=1; k<pwm->nticks; ++k ) {
+			uint32_t clear = pwm->clear[k];
+
+			if ( !clear )
+				continue;
+			t = t0 + (uint64_t)k * pwm->tick_ns;
+			wait_until(t);
+			gpio_port_write(0,clear);
+			now = now_ns();
+			++st->writes;
+			if ( now - t > pwm->tick_ns )
+				++st->late;
+
+			// High time error of the channels falling here
+			err = (int64_t)(now - t) - late0;
+			if ( err < 0 )
+				err = -err;
+			st->edges += __builtin_popcount(clear);
+			st->sum_err_ns += err * __builtin_popcount(clear);
+			if ( err > st->max_err_ns )
+				st->max_err_ns = err;
+		}
+
+		++st->periods;
+		t0 += period;
+		now = now_ns();
+		if ( now > t0 + pwm->tick_ns ) {
+			++st->overruns;			// Fell behind: restart now
+			t0 = now;
+		}
+	}
+
+	st->ns += now_ns() - start;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID,&cpu1);
+	st->cpu_ns += (uint64_t)(cpu1.tv_sec - cpu0.tv_sec) * 1000000000ull
+		+ cpu1.tv_nsec - cpu0.tv_nsec;
+	return 0;
+}
+
+int
+gpio_swpwm_start(gpio_swpwm_t *pwm) {
+	int rc;
+
+	if ( pwm->running )
+		return EBUSY;
+	if ( !pwm->mask )
+		return EINVAL;
+
+	pwm->stop = false;
+	rc = pthread_create(&pwm->thread,NULL,swpwm_thread,pwm);
+	if ( !rc )
+		pwm->running = true;
+	return rc;
+}
+
+/*
+ * Stop the engine, leaving all channels low:
+ */
+void
+gpio_swpwm_stop(gpio_swpwm_t *pwm) {
+
+	if ( !pwm->running )
+		return;
+	pwm->stop = true;
+	pthread_join(pwm->thread,NULL);
+	pwm->running = false;
+	gpio_port_write(0,pwm->mask);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Counters (exact once stopped) and a one line summary
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_swpwm_stats(gpio_swpwm_t *pwm,gpio_swpwm_stats_t *stats) {
+	*stats = pwm->stats;
+}
+
+void
+gpio_swpwm_report(gpio_swpwm_t *pwm,FILE *out) {
+	const gpio_swpwm_stats_t *st = &pwm->stats;
+	double period = (double)pwm->tick_ns * pwm->nticks;
+	double secs = st->ns / 1e9;
+	double mean = st->edges ? (double)st->sum_err_ns / st->edges : 0.0;
+
+	fprintf(out,"%2d channels: %.2f Hz (%.2f Hz wanted), "
+		"duty error mean %.0f ns (%.3f%%) max %lld ns, "
+		"cpu %.1f%%, %llu late ticks, %llu overruns\n",
+		__builtin_popcount(pwm->mask),
+		secs > 0.0 ? st->periods / secs : 0.0,
+		1e9 / period,
+		mean,mean * 100.0 / period,
+		(long long)st->max_err_ns,
+		st->ns ? st->cpu_ns * 100.0 / st->ns : 0.0,
+		(unsigned long long)st->late,
+		(unsigned long long)st->overruns);
+}
+
+/* end gpswpwm.c */
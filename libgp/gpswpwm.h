@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////
+// gpswpwm.h -- Multi-channel software PWM on GPSET0/GPCLR0
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPSWPWM_H
+#define GPSWPWM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libgp.h"
+
+typedef struct {
+	uint64_t	periods;	// PWM periods run
+	uint64_t	ns;		// Time the thread ran
+	uint64_t	cpu_ns;		// Thread CPU time
+	uint64_t	writes;		// Ticks with register stores
+	uint64_t	late;		// Ticks stored over a tick late
+	uint64_t	overruns;	// Periods that restarted late
+	uint64_t	edges;		// Falling edges measured
+	int64_t		sum_err_ns;	// Sum of |high time error|
+	int64_t		max_err_ns;	// Largest |high time error|
+} gpio_swpwm_stats_t;
+
+typedef struct {
+	uint32_t	tick_ns;	// Wheel resolution
+	unsigned	nticks;		// Ticks per PWM period
+	uint32_t	mask;		// Bank 0 gpios driven
+	uint32_t	*set;		// GPSET0 mask per tick
+	uint32_t	*clear;		// GPCLR0 mask per tick
+	unsigned	duty[32];	// Duty (ticks) in the wheel
+	volatile unsigned pending[32];	// Duty (ticks) requested
+	volatile uint32_t dirty;	// gpios with a pending duty
+	gpio_swpwm_stats_t stats;	// Engine thread counters
+	volatile bool	stop;		// Ask engine thread to exit
+	bool		running;	// Engine thread exists
+	pthread_t	thread;
+} gpio_swpwm_t;
+
+gpio_swpwm_t *gpio_swpwm_open(uint32_t tick_ns,unsigned nticks);
+void gpio_swpwm_close(gpio_swpwm_t *pwm);
+
+int gpio_swpwm_add(gpio_swpwm_t *pwm,int gpio,unsigned duty);
+int gpio_swpwm_set(gpio_swpwm_t *pwm,int gpio,unsigned duty);
+
+int gpio_swpwm_start(gpio_swpwm_t *pwm);
+void gpio_swpwm_stop(gpio_swpwm_t *pwm);
+
+void gpio_swpwm_stats(gpio_swpwm_t *pwm,gpio_swpwm_stats_t *stats);
+void gpio_swpwm_report(gpio_swpwm_t *pwm,FILE *out);
+
+#endif // GPSWPWM_H
+
+// End gpswpwm.h
@@ -0,0 +1,119 @@
+/* Virtual ports over scattered bank 0 pins gpvport.c
+ * Warren W. Gay ve3wwg
+ *
+ * The tables are built once by gpio_vport_init(): 4 KiB of gather
+ * entries and 8 KiB of set/clear pairs at most, so a byte wide port
+ * costs one L1 resident lookup per access.
+ */
+#include <string.h>
+#include <errno.h>
+
+#include "gpvport.h"
+
+//////////////////////////////////////////////////////////////////////
+// Compile a virtual port: value bit x is carried by gpio pins[x]
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_vport_init(gpio_vport_t *vp,const int *pins,int npins) {
+	uint32_t bytes_used = 0;
+	int rc;
+
+	memset(vp,0,sizeof *vp);
+	if ( (rc = gpio_group_init(&vp->grp,pins,npins)) != 0 )
+		return rc;
+
+	vp->nbytes = (npins + 7) / 8;
+	vp->ascending = true;
+	for ( int x=1; x<npins; ++x )
+		if ( pins[x] < pins[x-1] )
+			vp->ascending = false;
+
+	/*
+	 * Read tables: one per GPLEV0 byte that holds port pins, mapping
+	 * the eight level bits of that byte to their value bits.
+	 */
+	for ( int x=0; x<npins; ++x )
+		bytes_used |= 1u << (pins[x] / 8);
+
+	for ( int b=0; b<4; ++b ) {
+		uint32_t *rd;
+
+		if ( !(bytes_used & (1u << b)) )
+			continue;
+		vp->lev_shift[vp->nlev] = b * 8;
+		rd = vp->rd[vp->nlev++];
+
+		for ( unsigned lev=0; lev<256; ++lev ) {
+			uint32_t lev32 = lev << (b * 8);
+
+			for ( int x=0; x<npins; ++x )
+				if ( lev32 & vp->grp.bits[x] )
+					rd[lev] |= 1u << x;
+		}
+	}
+
+	/*
+	 * Write tables: for each value byte, the set and clear masks of
+	 * the (up to eight) pins it carries.
+	 */
+	for ( int b=0; b<vp->nbytes; ++b ) {
+		uint32_t bmask = 0;
+
+		for ( int x=b*8; x<npins && x<b*8+8; ++x )
+			bmask |= vp->grp.bits[x];
+
+		for ( unsigned v=0; v<256; ++v ) {
+			uint32_t set = 0;
+
+			for ( int x=b*8; x<npins && x<b*8+8; ++x )
+				if ( v & (1u << (x - b*8)) )
+					set |= vp->grp.bits[x];
+			vp->wr[b][v].set = set;
+			vp->wr[b][v].clr = bmask & ~set;
+		}
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Configure all port pins for the same mode
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_vport_configure_io(const gpio_vport_t *vp,IO io) {
+
+	return gpio_group_configure_io(&vp->grp,io);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write a buffer of bytes to a port of up to 8 pins, one per access
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_vport_write_buf(const gpio_vport_t *vp,const uint8_t *buf,size_t bytes) {
+
+	if ( vp->nbytes != 1 )
+		return EINVAL;
+
+	for ( size_t x=0; x<bytes; ++x )
+		gpio_vport_write8(vp,buf[x]);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read a buffer of bytes from a port of up to 8 pins
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_vport_read_buf(const gpio_vport_t *vp,uint8_t *buf,size_t bytes) {
+
+	if ( vp->nbytes != 1 )
+		return EINVAL;
+
+	for ( size_t x=0; x<bytes; ++x )
+		buf[x] = (uint8_t)gpio_vport_read(vp);
+	return 0;
+}
+
+/* end gpvport.c */
@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////
+// gpvport.h -- Virtual ports: scattered bank 0 pins as an N-bit value
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPVPORT_H
+#define GPVPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Value bit x is carried by gpio pins[x]. Reads gather with one
+// GPLEV0 load and a lookup per GPLEV0 byte holding port pins; writes
+// scatter with a lookup per value byte and one GPSET0 plus one GPCLR0
+// store. Contiguous pins use a shift, and ascending pins use pext
+// where the target has BMI2.
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	uint32_t	set;		// GPSET0 mask for this byte value
+	uint32_t	clr;		// GPCLR0 mask for this byte value
+} gpio_vport_wr_t;
+
+typedef struct {
+	gpio_group_t	grp;		// Pins, mask and shift
+	bool		ascending;	// Pins ascend: pext/pdep order
+	int		nbytes;		// Value bytes (npins+7)/8
+	int		nlev;		// GPLEV0 bytes holding port pins
+	uint8_t		lev_shift[4];	// Shift of each such GPLEV0 byte
+	uint32_t	rd[4][256];	// [nlev][lev byte] -> value bits
+	gpio_vport_wr_t	wr[4][256];	// [value byte][byte] -> set/clr
+} gpio_vport_t;
+
+int gpio_vport_init(gpio_vport_t *vp,const int *pins,int npins);
+int gpio_vport_configure_io(const gpio_vport_t *vp,IO io);
+
+//////////////////////////////////////////////////////////////////////
+// Gather the port value from a GPLEV0 word
+//////////////////////////////////////////////////////////////////////
+
+static inline uint32_t
+gpio_vport_gather(const gpio_vport_t *vp,uint32_t lev) {
+	uint32_t value;
+
+	if ( vp->grp.shift >= 0 )
+		return (lev & vp->grp.mask) >> vp->grp.shift;
+#if defined(__BMI2__)
+	if ( vp->ascending )
+		return _pext_u32(lev,vp->grp.mask);
+#endif
+	value = vp->rd[0][(lev >> vp->lev_shift[0]) & 0xFF];
+	for ( int x=1; x<vp->nlev; ++x )
+		value |= vp->rd[x][(lev >> vp->lev_shift[x]) & 0xFF];
+	return value;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Scatter value into GPSET0/GPCLR0 masks
+//////////////////////////////////////////////////////////////////////
+
+static inline void
+gpio_vport_scatter(const gpio_vport_t *vp,uint32_t value,uint32_t *set,uint32_t *clr) {
+	uint32_t s, c;
+
+	if ( vp->grp.shift >= 0 ) {
+		s = (value << vp->grp.shift) & vp->grp.mask;
+		c = vp->grp.mask & ~s;
+	} else	{
+		s = vp->wr[0][value & 0xFF].set;
+		c = vp->wr[0][value & 0xFF].clr;
+		for ( int x=1; x<vp->nbytes; ++x ) {
+			value >>= 8;
+			s |= vp->wr[x][value & 0xFF].set;
+			c |= vp->wr[x][value & 0xFF].clr;
+		}
+	}
+	*set = s;
+	*clr = c;
+}
+
+static inline uint32_t
+gpio_vport_read(const gpio_vport_t *vp) {
+	return gpio_vport_gather(vp,gpio_read32());
+}
+
+static inline int
+gpio_vport_write(const gpio_vport_t *vp,uint32_t value) {
+	uint32_t set, clr;
+
+	gpio_vport_scatter(vp,value,&set,&clr);
+	return gpio_port_write(set,clr);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Single byte ports (npins <= 8): one table entry per access
+//////////////////////////////////////////////////////////////////////
+
+static inline int
+gpio_vport_write8(const gpio_vport_t *vp,uint8_t byte) {
+	const gpio_vport_wr_t *wr = &vp->wr[0][byte];
+
+	return gpio_port_write(wr->set,wr->clr);
+}
+
+int gpio_vport_write_buf(const gpio_vport_t *vp,const uint8_t *buf,size_t bytes);
+int gpio_vport_read_buf(const gpio_vport_t *vp,uint8_t *buf,size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPVPORT_H
+
+// End gpvport.h
@@ -0,0 +1,487 @@
+/* 1-Wire bus master gpw1.c
+ * Warren W. Gay ve3wwg
+ *
+ * Standard speed timing (Maxim AN126 recommended values). The bus is
+ * pulled low and released by GPFSEL writes through configuration
+ * transactions, which are built before each slot starts so only the
+ * commits fall inside the timed part. Slot edges are deadlines from
+ * the slot start, so commit latency is absorbed rather than added.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "gpdelay.h"
+#include "gpw1.h"
+
+#define W1_A_NS		6000		// Write 1 / read: low time
+#define W1_C_NS		60000		// Write 0: low time
+#define W1_SLOT_NS	70000		// Whole write or read slot
+#define W1_SAMPLE_NS	15000		// Read sample from slot start
+#define W1_RESET_NS	480000		// Reset low time
+#define W1_PRESENCE_NS	70000		// Presence sample after release
+#define W1_RECOVER_NS	410000		// Rest of the presence window
+
+//////////////////////////////////////////////////////////////////////
+// Compile the buses: pins[x] becomes bus index x
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_w1_init(gpio_w1_t *w1,const int *pins,int npins) {
+
+	memset(w1,0,sizeof *w1);
+	if ( npins < 1 || npins > GPIO_W1_BUSES )
+		return EINVAL;
+
+	for ( int x=0; x<npins; ++x ) {
+		if ( pins[x] < 0 || pins[x] > 31 || (w1->mask & (1u << pins[x])) )
+			return EINVAL;		// Bank 0 only, no sharing
+		w1->gpio[x] = pins[x];
+		w1->mask |= 1u << pins[x];
+	}
+	w1->nbuses = npins;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Release every bus: latches low, pins inputs with the given pull
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_w1_configure(const gpio_w1_t *w1,Pull pull) {
+	gpio_config_t cfg;
+
+	gpio_config_begin(&cfg);
+	for ( int x=0; x<w1->nbuses; ++x ) {
+		gpio_config_io(&cfg,w1->gpio[x],Input);
+		gpio_config_pull(&cfg,w1->gpio[x],pull);
+	}
+	gpio_port_write(0,w1->mask);
+	return gpio_config_commit(&cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Internal: bus index masks to and from gpio masks
+//////////////////////////////////////////////////////////////////////
+
+static inline uint32_t
+w1_gpios(const gpio_w1_t *w1,uint32_t buses) {
+	uint32_t mask = 0;
+
+	for ( ; buses; buses &= buses - 1 ) {
+		int b = __builtin_ctz(buses);
+
+		if ( b < w1->nbuses )
+			mask |= 1u << w1->gpio[b];
+	}
+	return mask;
+}
+
+static inline uint32_t
+w1_buses(const gpio_w1_t *w1,uint32_t buses,uint32_t lev) {
+	uint32_t high = 0;
+
+	for ( ; buses; buses &= buses - 1 ) {
+		int b = __builtin_ctz(buses);
+
+		if ( b < w1->nbuses && (lev & (1u << w1->gpio[b])) )
+			high |= 1u << b;
+	}
+	return high;
+}
+
+static inline void
+w1_config(gpio_config_t *cfg,uint32_t gpios,IO io) {
+
+	gpio_config_begin(cfg);
+	for ( ; gpios; gpios &= gpios - 1 )
+		gpio_config_io(cfg,__builtin_ctz(gpios),io);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Reset pulse: returns the buses answering with a presence pulse.
+// A bus still low at the end of the window (shorted, or no pull-up)
+// is not counted.
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_w1_reset(const gpio_w1_t *w1,uint32_t buses) {
+	uint32_t gpios = w1_gpios(w1,buses), presence, idle;
+	gpio_config_t low, rel;
+	uint64_t t0;
+
+	w1_config(&low,gpios,Output);
+	w1_config(&rel,gpios,Input);
+
+	gpio_config_commit(&low);
+	t0 = gpio_delay_now();
+	gpio_spin_until(t0 + W1_RESET_NS);
+	gpio_config_commit(&rel);
+	t0 += W1_RESET_NS;
+	gpio_spin_until(t0 + W1_PRESENCE_NS);
+	presence = ~gpio_read32() & gpios;
+	gpio_spin_until(t0 + W1_PRESENCE_NS + W1_RECOVER_NS);
+	idle = gpio_read32() & gpios;
+
+	return w1_buses(w1,buses,presence & idle);
+}
+
+//////////////////////////////////////////////////////////////////////
+// One write slot on each bus: a 1 on the buses in ones, else a 0
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_w1_write_slots(const gpio_w1_t *w1,uint32_t buses,uint32_t ones) {
+	uint32_t gpios = w1_gpios(w1,buses), gpios1 = w1_gpios(w1,buses & ones);
+	gpio_config_t low, rel1, rel0;
+	uint64_t t0;
+
+	w1_config(&low,gpios,Output);
+	w1_config(&rel1,gpios1,Input);
+	w1_config(&rel0,gpios & ~gpios1,Input);
+
+	gpio_config_commit(&low);
+	t0 = gpio_delay_now();
+	gpio_spin_until(t0 + W1_A_NS);
+	gpio_config_commit(&rel1);
+	gpio_spin_until(t0 + W1_C_NS);
+	gpio_config_commit(&rel0);
+	gpio_spin_until(t0 + W1_SLOT_NS);
+}
+
+//////////////////////////////////////////////////////////////////////
+// One read slot on each bus: returns the buses that read a 1
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_w1_read_slots(const gpio_w1_t *w1,uint32_t buses) {
+	uint32_t gpios = w1_gpios(w1,buses), lev;
+	gpio_config_t low, rel;
+	uint64_t t0;
+
+	w1_config(&low,gpios,Output);
+	w1_config(&rel,gpios,Input);
+
+	gpio_config_commit(&low);
+	t0 = gpio_delay_now();
+	gpio_spin_until(t0 + W1_A_NS);
+	gpio_config_commit(&rel);
+	gpio_spin_until(t0 + W1_SAMPLE_NS);
+	lev = gpio_read32();
+	gpio_spin_until(t0 + W1_SLOT_NS);
+
+	return w1_buses(w1,buses,lev);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Bytes, LSB first. _each sends or receives data[b] on bus b.
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_w1_write_byte(const gpio_w1_t *w1,uint32_t buses,uint8_t byte) {
+
+	for ( int bit=0; bit<8; ++bit, byte >>= 1 )
+		gpio_w1_write_slots(w1,buses,byte & 1 ? buses : 0);
+}
+
+void
+gpio_w1_write_each(const gpio_w1_t *w1,uint32_t buses,const uint8_t *const *data,size_t len) {
+
+	for ( size_t x=0; x<len; ++x ) {
+		for ( int bit=0; bit<8; ++bit ) {
+			uint32_t ones = 0;
+
+			for ( uint32_t m = buses; m; m &= m - 1 ) {
+				int b = __builtin_ctz(m);
+
+				if ( data[b][x] & (1u << bit) )
+					ones |= 1u << b;
+			}
+			gpio_w1_write_slots(w1,buses,ones);
+		}
+	}
+}
+
+void
+gpio_w1_read_each(const gpio_w1_t *w1,uint32_t buses,uint8_t *const *data,size_t len) {
+
+	for ( size_t x=0; x<len; ++x ) {
+		for ( uint32_t m = buses; m; m &= m - 1 )
+			data[__builtin_ctz(m)][x] = 0;
+		for ( int bit=0; bit<8; ++bit ) {
+			uint32_t ones = gpio_w1_read_slots(w1,buses);
+
+			for ( ; ones; ones &= ones - 1 )
+				data[__builtin_ctz(ones)][x] |= 1u << bit;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Maxim CRC-8 (x^8 + x^5 + x^4 + 1, LSB first). A block ending in its
+// own CRC checks to zero.
+//////////////////////////////////////////////////////////////////////
+
+uint8_t
+gpio_w1_crc8(const uint8_t *data,size_t len) {
+	uint8_t crc = 0;
+
+	for ( size_t x=0; x<len; ++x ) {
+		crc ^= data[x];
+		for ( int bit=0; bit<8; ++bit )
+			crc = crc & 1 ? (crc >> 1) ^ 0x8C : crc >> 1;
+	}
+	return crc;
+}
+
+static void
+rom_bytes(uint64_t rom,uint8_t *bytes) {
+
+	for ( int x=0; x<8; ++x, rom >>= 8 )
+		bytes[x] = (uint8_t)rom;
+}
+
+//////////////////////////////////////////////////////////////////////
+// ROM search of one bus (Maxim AN187). cmd is GPIO_W1_SEARCH_ROM or
+// GPIO_W1_ALARM_SEARCH. Finds up to max devices; *count is set to the
+// number found. Returns EIO when the bus stops answering or a ROM fails
+// its CRC.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_w1_search(const gpio_w1_t *w1,int bus,uint8_t cmd,uint64_t *roms,int max,int *count) {
+	uint32_t bm;
+	uint64_t rom = 0;
+	int last_discrepancy = 0, n = 0;
+	uint8_t bytes[8];
+
+	*count = 0;
+	if ( bus < 0 || bus >= w1->nbuses )
+		return EINVAL;
+	bm = 1u << bus;
+
+	while ( n < max ) {
+		int last_zero = 0;
+
+		if ( !gpio_w1_reset(w1,bm) )
+			return n ? EIO : 0;	// No devices
+		gpio_w1_write_byte(w1,bm,cmd);
+
+		for ( int id=1; id<=64; ++id ) {
+			bool bit = gpio_w1_read_slots(w1,bm) != 0;
+			bool cmp = gpio_w1_read_slots(w1,bm) != 0;
+			bool dir;
+
+			if ( bit && cmp ) {
+				if ( id == 1 && !n && cmd == GPIO_W1_ALARM_SEARCH )
+					return 0;	// No device in alarm
+				return EIO;
+			}
+			if ( bit != cmp ) {
+				dir = bit;
+			} else	{
+				if ( id < last_discrepancy )
+					dir = (rom >> (id - 1)) & 1;
+				else	dir = id == last_discrepancy;
+				if ( !dir )
+					last_zero = id;
+			}
+			if ( dir )
+				rom |= 1ull << (id - 1);
+			else	rom &= ~(1ull << (id - 1));
+			gpio_w1_write_slots(w1,bm,dir ? bm : 0);
+		}
+
+		rom_bytes(rom,bytes);
+		if ( gpio_w1_crc8(bytes,8) )
+			return EIO;
+		roms[n++] = rom;
+		*count = n;
+		if ( !(last_discrepancy = last_zero) )
+			break;			// Last device
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Strong pull-up: drive the buses high, or release them again. The
+// latch is only set while the pin is an input, and cleared once it is
+// one again, so the other slots still see it low.
+//////////////////////////////////////////////////////////////////////
+
+static void
+w1_strong(const gpio_w1_t *w1,uint32_t buses,bool on) {
+	uint32_t gpios = w1_gpios(w1,buses);
+	gpio_config_t cfg;
+
+	if ( !gpios )
+		return;
+	w1_config(&cfg,gpios,on ? Output : Input);
+	if ( on ) {
+		gpio_port_write(gpios,0);
+		gpio_config_commit(&cfg);
+	} else	{
+		gpio_config_commit(&cfg);
+		gpio_port_write(0,gpios);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read Power Supply: returns the buses with at least one parasite
+// powered device (it answers the read slot with a 0).
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_w1_parasite(const gpio_w1_t *w1,uint32_t buses) {
+	uint32_t found = gpio_w1_reset(w1,buses);
+
+	if ( !found )
+		return 0;
+	gpio_w1_write_byte(w1,found,GPIO_W1_SKIP_ROM);
+	gpio_w1_write_byte(w1,found,GPIO_W1_READ_POWER);
+	return found & ~gpio_w1_read_slots(w1,found);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Start a temperature conversion on every device of every bus. The
+// buses answering the reset are returned in *present. Buses in
+// parasite are held high from the end of Convert T, until released
+// by gpio_w1_wait_converted().
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_w1_convert_all(const gpio_w1_t *w1,uint32_t buses,uint32_t parasite,uint32_t *present) {
+	uint32_t found = gpio_w1_reset(w1,buses);
+
+	if ( present )
+		*present = found;
+	if ( !found )
+		return ENODEV;
+	gpio_w1_write_byte(w1,found,GPIO_W1_SKIP_ROM);
+	gpio_w1_write_byte(w1,found,GPIO_W1_CONVERT_T);
+	w1_strong(w1,found & parasite,true);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Poll with read slots until every bus reports its conversions done.
+// Parasite powered buses cannot answer while held high: they are held
+// for GPIO_W1_CONVERT_MS from the call and then released.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_w1_wait_converted(const gpio_w1_t *w1,uint32_t buses,uint32_t parasite,unsigned timeout_ms) {
+	uint64_t t0 = gpio_delay_now(), now;
+	uint64_t t_end = t0 + (uint64_t)timeout_ms * 1000000ull;
+	uint64_t t_held = t0 + GPIO_W1_CONVERT_MS * 1000000ull;
+	uint32_t polled = buses & ~parasite, done = 0;
+	int rc = 0;
+
+	while ( done != polled ) {
+		done |= gpio_w1_read_slots(w1,polled & ~done);
+		if ( done == polled )
+			break;
+		if ( gpio_delay_now() >= t_end ) {
+			rc = ETIMEDOUT;
+			break;
+		}
+		usleep(5000);
+	}
+
+	if ( buses & parasite ) {
+		if ( (now = gpio_delay_now()) < t_held )
+			usleep((t_held - now) / 1000);
+		w1_strong(w1,buses & parasite,false);
+	}
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read the scratchpads of devs[] into pads[]. Round r addresses the
+// r-th device of every bus at once (Match ROM with each bus's own ROM
+// code), so the rounds needed are the most devices on any one bus.
+// errs[x] is 0, ENODEV (no presence) or EIO (bad CRC). Returns EIO
+// if any device failed.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_w1_read_pads(const gpio_w1_t *w1,const gpio_w1_dev_t *devs,int ndevs,uint8_t (*pads)[9],int *errs) {
+	int cursor[GPIO_W1_BUSES], sel[GPIO_W1_BUSES];
+	uint8_t roms[GPIO_W1_BUSES][8];
+	const uint8_t *romp[GPIO_W1_BUSES];
+	uint8_t *padp[GPIO_W1_BUSES];
+	int rc = 0;
+
+	for ( int b=0; b<GPIO_W1_BUSES; ++b ) {
+		cursor[b] = 0;
+		romp[b] = roms[b];
+	}
+
+	for (;;) {
+		uint32_t buses = 0, present;
+
+		for ( int b=0; b<w1->nbuses; ++b ) {
+			while ( cursor[b] < ndevs && devs[cursor[b]].bus != b )
+				++cursor[b];
+			if ( cursor[b] < ndevs ) {
+				sel[b] = cursor[b]++;
+				rom_bytes(devs[sel[b]].rom,roms[b]);
+				padp[b] = pads[sel[b]];
+				buses |= 1u << b;
+			}
+		}
+		if ( !buses )
+			break;			// All rounds done
+
+		present = gpio_w1_reset(w1,buses);
+		if ( present ) {
+			gpio_w1_write_byte(w1,present,GPIO_W1_MATCH_ROM);
+			gpio_w1_write_each(w1,present,romp,8);
+			gpio_w1_write_byte(w1,present,GPIO_W1_READ_PAD);
+			gpio_w1_read_each(w1,present,padp,9);
+		}
+
+		for ( uint32_t m = buses; m; m &= m - 1 ) {
+			int b = __builtin_ctz(m), x = sel[b], er = 0;
+
+			if ( !(present & (1u << b)) ) {
+				er = ENODEV;
+			} else	{
+				uint8_t any = 0;
+
+				for ( int y=0; y<9; ++y )
+					any |= pads[x][y];
+				if ( !any || gpio_w1_crc8(pads[x],9) )
+					er = EIO;	// All zeros passes the CRC
+			}
+			if ( errs )
+				errs[x] = er;
+			if ( er )
+				rc = EIO;
+		}
+	}
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Scratchpad temperature. DS18S20 (family 0x10) counts half degrees
+// with a count remain refinement; the others (DS18B20, DS1822,
+// DS1825) count sixteenths, with the bits below their resolution
+// undefined.
+//////////////////////////////////////////////////////////////////////
+
+double
+gpio_w1_celsius(uint64_t rom,const uint8_t *pad) {
+	int16_t raw = (int16_t)(pad[1] << 8 | pad[0]);
+
+	if ( (rom & 0xFF) == 0x10 ) {
+		if ( !pad[7] )
+			return raw / 2.0;
+		return (raw >> 1) - 0.25 + (double)(pad[7] - pad[6]) / pad[7];
+	}
+	raw &= ~((1 << (3 - ((pad[4] >> 5) & 3))) - 1);
+	return raw / 16.0;
+}
+
+/* end gpw1.c */
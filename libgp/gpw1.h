@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////
+// gpw1.h -- 1-Wire bus master with parallel slots across buses
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPW1_H
+#define GPW1_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libgp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Each bus is one bank 0 gpio with a pull-up (4.7k external, or the
+// internal one for short runs). Its output latch is held low, so
+// making the pin an output pulls the bus low and making it an input
+// releases it. Slot functions take a mask of bus indexes and run the
+// same slot on all of them at once: every bus in the mask is pulled
+// low together and sampled with one GPLEV0 read. Slots are timed
+// against the clock, and must not be preempted (see gprt.h).
+//
+// ROM codes are uint64_t with the family code in the low byte, the
+// order the bytes travel on the bus.
+//
+// Parasite powered devices draw their power from the bus, and need a
+// strong pull-up while converting: those buses are driven high (latch
+// set, pin an output) for GPIO_W1_CONVERT_MS after Convert T.
+//////////////////////////////////////////////////////////////////////
+
+#define GPIO_W1_BUSES		16
+
+#define GPIO_W1_SEARCH_ROM	0xF0
+#define GPIO_W1_READ_ROM	0x33
+#define GPIO_W1_MATCH_ROM	0x55
+#define GPIO_W1_SKIP_ROM	0xCC
+#define GPIO_W1_ALARM_SEARCH	0xEC
+#define GPIO_W1_CONVERT_T	0x44	// DS18x20 function commands
+#define GPIO_W1_READ_PAD	0xBE
+#define GPIO_W1_READ_POWER	0xB4
+
+#define GPIO_W1_CONVERT_MS	750	// DS18B20 12 bit conversion
+
+typedef struct {
+	int		nbuses;
+	int		gpio[GPIO_W1_BUSES];	// Bus index to gpio
+	uint32_t	mask;			// GPIO mask of all buses
+} gpio_w1_t;
+
+typedef struct {
+	int		bus;			// Bus index
+	uint64_t	rom;			// ROM code
+} gpio_w1_dev_t;
+
+int gpio_w1_init(gpio_w1_t *w1,const int *pins,int npins);
+int gpio_w1_configure(const gpio_w1_t *w1,Pull pull);
+
+// Slots: buses is a mask of bus indexes
+uint32_t gpio_w1_reset(const gpio_w1_t *w1,uint32_t buses);
+void gpio_w1_write_slots(const gpio_w1_t *w1,uint32_t buses,uint32_t ones);
+uint32_t gpio_w1_read_slots(const gpio_w1_t *w1,uint32_t buses);
+
+void gpio_w1_write_byte(const gpio_w1_t *w1,uint32_t buses,uint8_t byte);
+void gpio_w1_write_each(const gpio_w1_t *w1,uint32_t buses,const uint8_t *const *data,size_t len);
+void gpio_w1_read_each(const gpio_w1_t *w1,uint32_t buses,uint8_t *const *data,size_t len);
+
+uint8_t gpio_w1_crc8(const uint8_t *data,size_t len);
+int gpio_w1_search(const gpio_w1_t *w1,int bus,uint8_t cmd,uint64_t *roms,int max,int *count);
+
+//////////////////////////////////////////////////////////////////////
+// DS18x20 thermometers: one Convert T broadcast to every bus, then
+// scratchpads read in rounds, round r reading the r-th device of every
+// bus in parallel.
+//////////////////////////////////////////////////////////////////////
+
+uint32_t gpio_w1_parasite(const gpio_w1_t *w1,uint32_t buses);
+int gpio_w1_convert_all(const gpio_w1_t *w1,uint32_t buses,uint32_t parasite,uint32_t *present);
+int gpio_w1_wait_converted(const gpio_w1_t *w1,uint32_t buses,uint32_t parasite,unsigned timeout_ms);
+int gpio_w1_read_pads(const gpio_w1_t *w1,const gpio_w1_dev_t *devs,int ndevs,uint8_t (*pads)[9],int *errs);
+double gpio_w1_celsius(uint64_t rom,const uint8_t *pad);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPW1_H
+
+// End gpw1.h
@@ -0,0 +1,238 @@
+/* Waveform playback engine gpwave.c
+ * Warren W. Gay ve3wwg
+ *
+ * A waveform is a list of (set mask, clear mask, delay) steps. Compiling
+ * it converts each delay into a gpdelay spin count, less the measured
+ * cost of the two register stores. Playback is then a straight loop of two
+ * stores and a countdown per step: no per-step branching on the data,
+ * no clock reads and no system calls.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpwave.h"
+#include "gpdelay.h"
+
+static bool calibrated = false;
+static uint32_t store_ns = 0;		// Cost of a GPSET0+GPCLR0 pair
+
+//////////////////////////////////////////////////////////////////////
+// Measure the register store cost (once per process)
+//////////////////////////////////////////////////////////////////////
+
+static void
+wave_calibrate() {
+	uint32_v *set = GPIOREG(GPIO_GPSET0), *clr = GPIOREG(GPIO_GPCLR0);
+	uint64_t t0, best = ~0ull;
+
+	// Best of several runs filters out preemption
+	for ( int x=0; x<5; ++x ) {
+		t0 = gpio_delay_now();
+		for ( int k=0; k<1000; ++k ) {
+			gpio_store(set,0);	// Zero masks: no effect
+			gpio_store(clr,0);
+		}
+		t0 = gpio_delay_now() - t0;
+		if ( t0 < best )
+			best = t0;
+	}
+	store_ns = best / 1000;
+	calibrated = true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Create and destroy waveforms
+//////////////////////////////////////////////////////////////////////
+
+gpio_wave_t *
+gpio_wave_new(int capacity) {
+	gpio_wave_t *w = calloc(1,sizeof *w);
+
+	if ( !w )
+		return 0;
+	if ( capacity < 16 )
+		capacity = 16;
+	w->capacity = capacity;
+	w->set = malloc(capacity * sizeof *w->set);
+	w->clear = malloc(capacity * sizeof *w->clear);
+	w->delay_ns = malloc(capacity * sizeof *w->delay_ns);
+	w->spins = malloc(capacity * sizeof *w->spins);
+	if ( !w->set || !w->clear || !w->delay_ns || !w->spins ) {
+		gpio_wave_free(w);
+		return 0;
+	}
+	return w;
+}
+
+void
+gpio_wave_free(gpio_wave_t *w) {
+	free(w->set);
+	free(w->clear);
+	free(w->delay_ns);
+	free(w->spins);
+	free(w);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Append one step: store set, store clear, then wait delay_ns
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_wave_add(gpio_wave_t *w,uint32_t set,uint32_t clear,uint32_t delay_ns) {
+
+	if ( w->nsteps >= w->capacity ) {
+		int cap = w->capacity * 2;
+		uint32_t *s = realloc(w->set,cap * sizeof *s);
+		uint32_t *c = s ? realloc(w->clear,cap * sizeof *c) : 0;
+		uint32_t *d = c ? realloc(w->delay_ns,cap * sizeof *d) : 0;
+		uint32_t *n = d ? realloc(w->spins,cap * sizeof *n) : 0;
+
+		if ( s ) w->set = s;
+		if ( c ) w->clear = c;
+		if ( d ) w->delay_ns = d;
+		if ( n ) w->spins = n;
+		if ( !n )
+			return ENOMEM;
+		w->capacity = cap;
+	}
+
+	w->set[w->nsteps] = set;
+	w->clear[w->nsteps] = clear;
+	w->delay_ns[w->nsteps] = delay_ns;
+	++w->nsteps;
+	w->compiled = false;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Append NRZ pulse-width coded bits, MSB first (WS2812 style): each
+// bit raises mask for t1h (one) or t0h (zero) and then lowers it for
+// t1l or t0l nanoseconds.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_wave_add_bits(gpio_wave_t *w,uint32_t mask,const uint8_t *data,int nbytes,
+  uint32_t t0h,uint32_t t0l,uint32_t t1h,uint32_t t1l) {
+	int rc;
+
+	for ( int x=0; x<nbytes; ++x ) {
+		for ( int b=7; b>=0; --b ) {
+			bool one = data[x] >> b & 1;
+
+			if ( (rc = gpio_wave_add(w,mask,0,one ? t1h : t0h)) != 0 )
+				return rc;
+			if ( (rc = gpio_wave_add(w,0,mask,one ? t1l : t0l)) != 0 )
+				return rc;
+		}
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Convert delays to spin counts (needs gpio_open())
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_wave_compile(gpio_wave_t *w) {
+
+	if ( !ugpio )
+		return ENXIO;
+	if ( !calibrated )
+		wave_calibrate();
+
+	for ( int x=0; x<w->nsteps; ++x ) {
+		uint32_t d = w->delay_ns[x];
+
+		w->spins[x] = d > store_ns ? gpio_delay_spins(d - store_ns) : 0;
+	}
+	w->compiled = true;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Play the waveform repeat times
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_wave_play(const gpio_wave_t *w,int repeat) {
+	uint32_v *set = GPIOREG(GPIO_GPSET0), *clr = GPIOREG(GPIO_GPCLR0);
+	const uint32_t *s = w->set, *c = w->clear, *n = w->spins;
+	const int nsteps = w->nsteps;
+
+	if ( !w->compiled )
+		return EINVAL;
+
+	while ( repeat-- > 0 ) {
+		for ( int x=0; x<nsteps; ++x ) {
+			gpio_store(set,s[x]);
+			gpio_store(clr,c[x]);
+			gpio_spin_n(n[x]);
+		}
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Play once, timestamping each step. err_ns[x] (optional, nsteps
+// entries) receives the measured minus requested duration of step x.
+// The cost of reading the clock is measured and removed.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_wave_measure(const gpio_wave_t *w,int64_t *err_ns,gpio_wave_report_t *rpt) {
+	uint32_v *set = GPIOREG(GPIO_GPSET0), *clr = GPIOREG(GPIO_GPCLR0);
+	uint64_t *ts, clk_ns, t0;
+	int64_t sum = 0, worst = 0;
+
+	if ( !w->compiled )
+		return EINVAL;
+	if ( !(ts = malloc((w->nsteps + 1) * sizeof *ts)) )
+		return ENOMEM;
+
+	clk_ns = ~0ull;
+	for ( int x=0; x<100; ++x ) {
+		t0 = gpio_delay_now();
+		t0 = gpio_delay_now() - t0;
+		if ( t0 < clk_ns )
+			clk_ns = t0;
+	}
+
+	for ( int x=0; x<w->nsteps; ++x ) {
+		ts[x] = gpio_delay_now();
+		gpio_store(set,w->set[x]);
+		gpio_store(clr,w->clear[x]);
+		gpio_spin_n(w->spins[x]);
+	}
+	ts[w->nsteps] = gpio_delay_now();
+
+	for ( int x=0; x<w->nsteps; ++x ) {
+		int64_t e = (int64_t)(ts[x+1] - ts[x] - clk_ns) - w->delay_ns[x];
+
+		if ( err_ns )
+			err_ns[x] = e;
+		sum += e;
+		if ( (e < 0 ? -e : e) > worst )
+			worst = e < 0 ? -e : e;
+	}
+
+	if ( rpt ) {
+		rpt->max_err_ns = worst;
+		rpt->mean_err_ns = w->nsteps ? sum / w->nsteps : 0;
+		rpt->total_ns = ts[w->nsteps] - ts[0];
+		rpt->request_ns = 0;
+		for ( int x=0; x<w->nsteps; ++x )
+			rpt->request_ns += w->delay_ns[x];
+	}
+	free(ts);
+	return 0;
+}
+
+/* end gpwave.c */
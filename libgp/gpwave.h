@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////////////////////
+// gpwave.h -- Precompiled waveform playback on GPSET0/GPCLR0
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPWAVE_H
+#define GPWAVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libgp.h"
+
+typedef struct {
+	int		nsteps;		// Steps added
+	int		capacity;	// Steps allocated
+	bool		compiled;	// Spin counts are current
+	uint32_t	*set;		// GPSET0 mask per step
+	uint32_t	*clear;		// GPCLR0 mask per step
+	uint32_t	*delay_ns;	// Requested time to next step
+	uint32_t	*spins;		// Compiled spin count per step
+} gpio_wave_t;
+
+typedef struct {
+	int64_t		max_err_ns;	// Largest |error| of any step
+	int64_t		mean_err_ns;	// Mean signed error
+	uint64_t	total_ns;	// Measured playback time
+	uint64_t	request_ns;	// Sum of requested delays
+} gpio_wave_report_t;
+
+gpio_wave_t *gpio_wave_new(int capacity);
+void gpio_wave_free(gpio_wave_t *w);
+
+int gpio_wave_add(gpio_wave_t *w,uint32_t set,uint32_t clear,uint32_t delay_ns);
+int gpio_wave_add_bits(gpio_wave_t *w,uint32_t mask,const uint8_t *data,int nbytes,
+	uint32_t t0h,uint32_t t0l,uint32_t t1h,uint32_t t1l);
+int gpio_wave_compile(gpio_wave_t *w);
+
+int gpio_wave_play(const gpio_wave_t *w,int repeat);
+int gpio_wave_measure(const gpio_wave_t *w,int64_t *err_ns,gpio_wave_report_t *rpt);
+
+#endif // GPWAVE_H
+
+// End gpwave.h
@@ -0,0 +1,764 @@
+/* Direct GPIO routines libgp.c
+ * Warren W. Gay ve3wwg
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "libgp.h"
+#include "gpioreg.h"
+#include "gpdelay.h"
+#include "gpstats.h"
+
+uint32_v *ugpio = 0;
+uint32_v *upads = 0;
+uint32_v *usystimer = 0;
+uint32_v *ucm = 0;
+uint32_v *upwm = 0;
+uint32_v *upcm = 0;
+
+void (*gpio_store_hook)(uint32_v *reg,uint32_t v) = 0;
+
+static const gpio_backend_t *backend = 0;
+
+//////////////////////////////////////////////////////////////////////
+// Internal helper functions
+//////////////////////////////////////////////////////////////////////
+
+static uint32_v *
+set_gpio10(int gpio,int *shift,uint32_t base) {
+	uint32_t offset = gpio / 10;
+	*shift = gpio % 10 * 3;
+	return GPIOREG2(base,offset);
+}
+
+static uint32_v *
+set_gpio32(int gpio,int *shift,uint32_t base) {
+    uint32_t offset = gpio / 32;
+    *shift = gpio % 32;
+    return GPIOREG2(base,offset);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Configure a GPIO mode
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_configure_io(int gpio,IO io) {
+	int shift;
+	int alt = (int)io & 0x07;
+
+	if ( gpio < 0 )
+		return EINVAL;          // Invalid parameter
+	
+	GPSTAT_BEGIN();
+	uint32_v *gpiosel = set_gpio10(gpio,&shift,GPIO_GPFSEL0);
+	gpio_store(gpiosel,(*gpiosel & ~(7<<shift)) | (alt<<shift));	
+	GPSTAT_PIN(gpio,GpstatPinMode);
+	GPSTAT_END(GpstatConfigureIo);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return currently configured Alternate function for gpio
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_alt_function(int gpio,IO *io) {
+	int shift;
+
+	if ( gpio < 0 )
+		return EINVAL;          // Invalid parameter
+
+	GPSTAT_BEGIN();
+	uint32_v *gpiosel = set_gpio10(gpio,&shift,GPIO_GPFSEL0);
+	uint32_t r = (*gpiosel >> shift) & 7;
+
+	*io = (IO)r;
+	GPSTAT_END(GpstatAltFunction);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return the drive strength of a given gpio pin
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_get_drive_strength(int gpio,bool *slew_limited,bool *hysteresis,int *drive) {
+
+	if ( gpio < 0 || gpio > 53 )
+	        return EINVAL;          // Invalid parameter
+
+	GPSTAT_BEGIN();
+	uint32_t padx = gpio / 28;
+	uint32_v *padreg = PADSREG(GPIO_PADS00_27,padx);
+
+	*drive = *padreg & 7;
+	*hysteresis = (*padreg & 0x0008) ? true : false;
+	*slew_limited = (*padreg & 0x0010) ? true : false;
+	GPSTAT_END(GpstatGetDrive);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Set the GPIO drive strength
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_set_drive_strength(int gpio,bool slew_limited,bool hysteresis,int drive) {
+
+	if ( gpio < 0 || gpio > 53 )
+		return EINVAL;          // Invalid parameter
+	
+	GPSTAT_BEGIN();
+	uint32_t padx = gpio / 28;
+	uint32_v *padreg = PADSREG(GPIO_PADS00_27,padx);
+	
+	uint32_t config = 0x5A000000;
+	if ( slew_limited )
+		config |= 1 << 4;
+	if ( hysteresis )
+		config |= 1 << 3;
+	config |= drive & 7;
+	
+	gpio_store(padreg,config);
+	GPSTAT_END(GpstatSetDrive);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Perform small delay: GPPUD/GPUDCLK need 150 core clock cycles of
+// set-up and hold, 600 ns at the slowest (250 MHz) core clock.
+//////////////////////////////////////////////////////////////////////
+
+#define PUD_SETUP_NS	600
+
+static void
+gpio_delay() {
+	gpio_spin_for(PUD_SETUP_NS);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Clock a pull setting into every pin of mask0 (GPIOs 0-31) and
+// mask1 (GPIOs 32-53): one GPPUD/GPUDCLKn sequence for all of them
+//////////////////////////////////////////////////////////////////////
+
+static uint32_t
+pud_bits(Pull pull) {
+
+	switch ( pull ) {
+	case Up :
+		return 0b10;                // Pullup resistor
+	case Down :
+		return 0b01;                // Pulldown resistor
+	case None :
+	default:
+		return 0;                   // No pullup/down
+	};
+}
+
+static void
+pud_cycle(uint32_t pmask,uint32_t mask0,uint32_t mask1) {
+	uint32_v *GPPUD = GPIOREG(GPIO_GPPUD);
+	uint32_v *GPUDCLK0 = GPIOREG(GPIO_GPUDCLK0);
+	uint32_v *GPUDCLK1 = GPIOREG(GPIO_GPUDCLK1);
+
+	gpio_store(GPPUD,pmask);         // Select pullup setting
+	gpio_delay();
+	if ( mask0 )
+		gpio_store(GPUDCLK0,mask0); // Clock the GPIOs of interest
+	if ( mask1 )
+		gpio_store(GPUDCLK1,mask1);
+	gpio_delay();
+	gpio_store(GPPUD,0);             // Reset pmask
+	gpio_delay();
+	if ( mask0 )
+		gpio_store(GPUDCLK0,0);     // Remove the clock
+	if ( mask1 )
+		gpio_store(GPUDCLK1,0);
+	gpio_delay();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Configure a GPIO pin to have None/Pullup/Pulldown resistor
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_configure_pullup(int gpio,Pull pull) {
+    
+	if ( gpio < 0 || gpio >= 32 )
+		return EINVAL;              // Invalid parameter
+
+	GPSTAT_BEGIN();
+	uint32_t mask = 1 << gpio;      // GPIOs 0 to 31 only
+
+	pud_cycle(pud_bits(pull),mask,0);
+	GPSTAT_PIN(gpio,GpstatPinPull);
+	GPSTAT_END(GpstatConfigurePullup);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Configuration transactions: collect function select, pull and pad
+// changes for many pins, then apply them with one store per touched
+// GPFSELn, one pull sequence per distinct pull setting and one store
+// per touched pad group. Later changes to a pin replace earlier ones.
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_config_begin(gpio_config_t *cfg) {
+	memset(cfg,0,sizeof *cfg);
+}
+
+int
+gpio_config_io(gpio_config_t *cfg,int gpio,IO io) {
+
+	if ( gpio < 0 || gpio > 53 )
+		return EINVAL;
+
+	int reg = gpio / 10, shift = gpio % 10 * 3;
+
+	cfg->fsel_mask[reg] |= 7u << shift;
+	cfg->fsel_bits[reg] = (cfg->fsel_bits[reg] & ~(7u << shift)) | (((uint32_t)io & 7) << shift);
+	return 0;
+}
+
+int
+gpio_config_pull(gpio_config_t *cfg,int gpio,Pull pull) {
+
+	if ( gpio < 0 || gpio > 53 )
+		return EINVAL;
+
+	int bank = gpio / 32;
+	uint32_t bit = 1u << gpio % 32;
+
+	for ( int x=0; x<3; ++x )
+		cfg->pull[x][bank] &= ~bit;
+	cfg->pull[pud_bits(pull)][bank] |= bit;
+	return 0;
+}
+
+int
+gpio_config_drive(gpio_config_t *cfg,int gpio,bool slew_limited,bool hysteresis,int drive) {
+
+	if ( gpio < 0 || gpio > 53 )
+		return EINVAL;
+
+	int padx = gpio / 28;
+
+	cfg->pads[padx] = 0x5A000000 | (slew_limited ? 1 << 4 : 0)
+		| (hysteresis ? 1 << 3 : 0) | (drive & 7);
+	cfg->pads_touched |= 1u << padx;
+	return 0;
+}
+
+int
+gpio_config_commit(gpio_config_t *cfg) {
+	GPSTAT_BEGIN();
+
+	for ( int x=0; x<3; ++x )
+		if ( cfg->pads_touched & (1u << x) )
+			gpio_store(PADSREG(GPIO_PADS00_27,x),cfg->pads[x]);
+
+	for ( int x=0; x<3; ++x )	// Pulls before outputs are enabled
+		if ( cfg->pull[x][0] | cfg->pull[x][1] )
+			pud_cycle(x,cfg->pull[x][0],cfg->pull[x][1]);
+
+	for ( int x=0; x<6; ++x ) {
+		uint32_t mask = cfg->fsel_mask[x];
+
+		if ( mask ) {
+			uint32_v *gpiosel = GPIOREG2(GPIO_GPFSEL0,x);
+
+			if ( mask == 0x3FFFFFFF )
+				gpio_store(gpiosel,cfg->fsel_bits[x]);
+			else	gpio_store(gpiosel,(*gpiosel & ~mask) | cfg->fsel_bits[x]);
+		}
+	}
+
+#ifdef LIBGP_STATS
+	for ( int x=0; x<3; ++x ) {
+		GPSTAT_PINS_MASK(cfg->pull[x][0],0,GpstatPinPull);
+		GPSTAT_PINS_MASK(cfg->pull[x][1],1,GpstatPinPull);
+	}
+	for ( int gpio=0; gpio<GPSTAT_PINS; ++gpio )
+		if ( cfg->fsel_mask[gpio / 10] & (7u << gpio % 10 * 3) )
+			GPSTAT_PIN(gpio,GpstatPinMode);
+#endif
+	GPSTAT_END(GpstatConfigCommit);
+	gpio_config_begin(cfg);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read a GPIO port (single bit)
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_read(int gpio) {
+    int shift;
+    
+    if ( gpio < 0 || gpio > 31 )
+        return EINVAL;
+
+    GPSTAT_BEGIN();
+    uint32_v *gpiolev = set_gpio32(gpio,&shift,GPIO_GPLEV0);
+    int bit = !!(*gpiolev & (1<<shift));
+
+    GPSTAT_PIN(gpio,GpstatPinRead);
+    GPSTAT_END(GpstatRead);
+    return bit;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write a GPIO bit
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_write(int gpio,int bit) {
+	int shift;
+    
+	if ( gpio < 0 || gpio > 31 )
+		return EINVAL;
+
+	GPSTAT_BEGIN();
+	if ( bit ) {
+		uint32_v *gpiop = set_gpio32(gpio,&shift,GPIO_GPSET0);
+	        gpio_store(gpiop,1u << shift);
+	} else	{
+		uint32_v *gpiop = set_gpio32(gpio,&shift,GPIO_GPCLR0);
+		gpio_store(gpiop,1u << shift);
+	}
+	GPSTAT_PIN(gpio,GpstatPinWrite);
+	GPSTAT_END(GpstatWrite);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read/Write all GPIO bits at once
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_read32() {
+	GPSTAT_BEGIN();
+	uint32_v *gpiolev = GPIOREG(GPIO_GPLEV0);
+	uint32_t lev = *gpiolev;
+
+	GPSTAT_END(GpstatRead32);
+	return lev;
+}
+
+//////////////////////////////////////////////////////////////////////
+// System timer fallbacks, when the timer page is not mapped
+//////////////////////////////////////////////////////////////////////
+
+uint64_t
+gpio_timestamp64_slow() {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return (uint64_t)t.tv_sec * 1000000ull + t.tv_nsec / 1000;
+}
+
+uint32_t
+gpio_timestamp_slow() {
+	return (uint32_t)gpio_timestamp64_slow();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Cross-calibrate the system timer against CLOCK_MONOTONIC over ms
+// milliseconds. Returns the timer rate error in ppm; afterwards
+// gpio_timestamp_ns() converts gpio_timestamp64() values.
+//////////////////////////////////////////////////////////////////////
+
+static struct {
+	uint64_t	ts0;		// Timer reference
+	uint64_t	ns0;		// CLOCK_MONOTONIC at ts0
+	double		ns_per_tick;	// Measured tick length
+} tscal = { 0, 0, 1000.0 };
+
+/*
+ * Pair a timer reading with the clock, taking the tightest bracket
+ * out of several tries:
+ */
+static void
+ts_pair(uint64_t *ts,uint64_t *ns) {
+	uint64_t best = ~0ull;
+
+	for ( int x=0; x<16; ++x ) {
+		struct timespec t0, t1;
+		uint64_t a, b, tick;
+
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		tick = gpio_timestamp64();
+		clock_gettime(CLOCK_MONOTONIC,&t1);
+		a = (uint64_t)t0.tv_sec * 1000000000ull + t0.tv_nsec;
+		b = (uint64_t)t1.tv_sec * 1000000000ull + t1.tv_nsec;
+		if ( b - a < best ) {
+			best = b - a;
+			*ts = tick;
+			*ns = a + (b - a) / 2;
+		}
+	}
+}
+
+int32_t
+gpio_timestamp_calibrate(unsigned ms) {
+	uint64_t ts1, ns1;
+
+	ts_pair(&tscal.ts0,&tscal.ns0);
+	usleep(ms * 1000);
+	ts_pair(&ts1,&ns1);
+
+	if ( ts1 <= tscal.ts0 )
+		return 0;		// Timer not running
+	tscal.ns_per_tick = (double)(ns1 - tscal.ns0) / (ts1 - tscal.ts0);
+	return (int32_t)((1000.0 / tscal.ns_per_tick - 1.0) * 1e6);
+}
+
+uint64_t
+gpio_timestamp_ns(uint64_t ts) {
+	return tscal.ns0 + (int64_t)((int64_t)(ts - tscal.ts0) * tscal.ns_per_tick);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write many bank 0 GPIOs at once: one GPSET0 store followed by one
+// GPCLR0 store (a pin in both masks ends up cleared). Empty masks
+// are not written.
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_port_write(uint32_t set,uint32_t clear) {
+	GPSTAT_BEGIN();
+
+	if ( set )
+		gpio_store(GPIOREG(GPIO_GPSET0),set);
+	if ( clear )
+		gpio_store(GPIOREG(GPIO_GPCLR0),clear);
+	GPSTAT_PINS_MASK(set | clear,0,GpstatPinWrite);
+	GPSTAT_END(GpstatPortWrite);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write value to the bank 0 GPIOs selected by mask
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_port_put(uint32_t value,uint32_t mask) {
+
+	return gpio_port_write(value & mask,~value & mask);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compile a pin group: value bit x is carried by gpio pins[x]
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_group_init(gpio_group_t *grp,const int *pins,int npins) {
+
+	if ( npins < 1 || npins > 32 )
+		return EINVAL;
+
+	memset(grp,0,sizeof *grp);
+	grp->npins = npins;
+	grp->shift = pins[0];
+
+	for ( int x=0; x<npins; ++x ) {
+		if ( pins[x] < 0 || pins[x] > 31 )
+			return EINVAL;		// Bank 0 only
+		if ( grp->mask & (1u << pins[x]) )
+			return EINVAL;		// Duplicate pin
+		grp->bits[x] = 1u << pins[x];
+		grp->mask |= grp->bits[x];
+		if ( pins[x] != pins[0] + x )
+			grp->shift = -1;	// Not contiguous
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Configure all pins of a group for the same mode
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_group_configure_io(const gpio_group_t *grp,IO io) {
+
+	for ( int x=0; x<grp->npins; ++x ) {
+		int gpio = __builtin_ctz(grp->bits[x]);
+		int rc = gpio_configure_io(gpio,io);
+
+		if ( rc )
+			return rc;
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write the low npins bits of value to the group
+//////////////////////////////////////////////////////////////////////
+
+int
+gpio_group_write(const gpio_group_t *grp,uint32_t value) {
+	uint32_t set = 0;
+	int rc;
+	GPSTAT_BEGIN();
+
+	if ( grp->shift >= 0 ) {
+		set = (value << grp->shift) & grp->mask;
+	} else	{
+		for ( int x=0; x<grp->npins; ++x, value >>= 1 )
+			if ( value & 1 )
+				set |= grp->bits[x];
+	}
+	rc = gpio_port_write(set,grp->mask & ~set);
+	GPSTAT_END(GpstatGroupWrite);
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read the group pins back as a value (one GPLEV0 load)
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+gpio_group_read(const gpio_group_t *grp) {
+	GPSTAT_BEGIN();
+	uint32_t lev = *GPIOREG(GPIO_GPLEV0) & grp->mask;
+	uint32_t value = 0;
+
+	if ( grp->shift >= 0 ) {
+		value = lev >> grp->shift;
+	} else	{
+		for ( int x=0; x<grp->npins; ++x )
+			if ( lev & grp->bits[x] )
+				value |= 1u << x;
+	}
+	GPSTAT_END(GpstatGroupRead);
+	return value;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Map memory for peripheral register access
+//////////////////////////////////////////////////////////////////////
+
+static void *
+mailbox_map(off_t offset,size_t bytes) {
+	int fd;
+
+	fd = open("/dev/mem",O_RDWR|O_SYNC);
+	if ( fd < 0 )
+		return 0;		// Failed (see errno)
+	
+	void *map = (char *) mmap(
+		NULL,               	// Any address
+		bytes,              	// # of bytes
+		PROT_READ|PROT_WRITE,
+		MAP_SHARED,         	// Shared
+		fd,                 	// /dev/mem
+		offset
+	);
+	
+	if ( (long)map == -1L ) {
+		int er = errno;		// Save errno
+		close(fd);
+		errno = er;		// Restore errno
+		return 0;
+	}
+	
+	close(fd);
+	return map;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Unmap memory
+//////////////////////////////////////////////////////////////////////
+
+static int
+mailbox_unmap(uint32_v *addr,size_t bytes) {
+	return munmap((caddr_t)addr,bytes);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Determine peripheral base address
+//////////////////////////////////////////////////////////////////////
+
+static uint32_t
+peripheral_base() {
+	static uint32_t pbase = 0;
+	int fd, rc;
+	unsigned char buf[8];
+	
+	fd = open("/proc/device-tree/soc/ranges",O_RDONLY);
+	if ( fd >= 0 ) {
+		rc = read(fd,buf,sizeof buf);
+		assert(rc==sizeof buf);
+		close(fd);
+		pbase = buf[4] << 24 | buf[5] << 16 | buf[6] << 8 | buf[7] << 0;
+	} else	{
+		// Punt: Assume RPi2
+		pbase = BCM2708_PERI_BASE;
+	}
+	
+	return pbase;
+}
+
+//////////////////////////////////////////////////////////////////////
+// The /dev/mem backend: real BCM283x peripherals
+//////////////////////////////////////////////////////////////////////
+
+static void *
+mem_map(uint32_t offset,size_t bytes) {
+	return mailbox_map(peripheral_base()+offset,bytes);
+}
+
+static void
+mem_unmap(void *addr,size_t bytes) {
+	mailbox_unmap((uint32_v *)addr,bytes);
+}
+
+const gpio_backend_t gpio_backend_mem = {
+	"mem",
+	0,			// open
+	0,			// close
+	mem_map,
+	mem_unmap,
+	0			// Plain stores
+};
+
+//////////////////////////////////////////////////////////////////////
+// Select the register backend (before gpio_open())
+//////////////////////////////////////////////////////////////////////
+
+void
+gpio_set_backend(const gpio_backend_t *be) {
+	backend = be;
+}
+
+const gpio_backend_t *
+gpio_get_backend() {
+	return backend;
+}
+
+/*
+ * Pick a backend by name, else the LIBGP_BACKEND environment
+ * variable, defaulting to /dev/mem. The variable is ignored in
+ * setuid programs, so callers can't swap root's registers:
+ */
+static const gpio_backend_t *
+choose_backend() {
+	static const gpio_backend_t *backends[] = {
+		&gpio_backend_mem, &gpio_backend_sim, 0
+	};
+	const char *name = secure_getenv("LIBGP_BACKEND");
+
+	if ( backend )
+		return backend;
+	if ( !name || !*name )
+		return &gpio_backend_mem;
+
+	for ( int x=0; backends[x]; ++x )
+		if ( !strcmp(backends[x]->name,name) )
+			return backends[x];
+	return 0;
+}
+
+/*
+ * Return the peripheral base address in use:
+ */
+uint32_t
+gpio_peri_base() {
+	return peripheral_base();
+}
+
+/*
+ * Returns true, if the direct GPIO registers are opened:
+ */
+bool
+gpio_open() {
+	uint32_t page_size = sysconf(_SC_PAGESIZE);
+
+	backend = choose_backend();
+	if ( !backend ) {
+		errno = ENOENT;		// Unknown LIBGP_BACKEND
+		return false;
+	}
+
+	if ( backend->open && !backend->open() )
+		return false;
+
+        ugpio = (uint32_v *)backend->map(GPIO_BASE_OFFSET,page_size);
+	upads = (uint32_v *)backend->map(PADS_BASE_OFFSET,page_size);
+	usystimer = (uint32_v *)backend->map(ST_BASE_OFFSET,page_size);	// Optional
+	ucm = (uint32_v *)backend->map(CM_BASE_OFFSET,page_size);		// Optional
+	upwm = (uint32_v *)backend->map(PWM_BASE_OFFSET,page_size);		// Optional
+	upcm = (uint32_v *)backend->map(PCM_BASE_OFFSET,page_size);		// Optional
+	gpio_store_hook = backend->store;
+
+	if ( ugpio == NULL || upads == NULL ) {
+		int er = errno;
+
+		gpio_close();		// Unmap what did map
+		errno = er;
+		return false;
+	}
+#ifdef LIBGP_STATS
+	gpstat_open();			// Best effort: counting stays off on failure
+#endif
+	return true;
+}
+
+/*
+ * Close (unmap) direct access to GPIO:
+ */
+void
+gpio_close() {
+	uint32_t page_size = sysconf(_SC_PAGESIZE);
+
+	/* Unmap memory */
+	if ( !backend )
+		return;
+
+#ifdef LIBGP_STATS
+	gpstat_close();
+#endif
+	if ( ugpio ) {
+		backend->unmap((void *)ugpio,page_size);
+		ugpio = NULL;
+	}
+	if ( upads ) {
+		backend->unmap((void *)upads,page_size);
+		upads = NULL;
+	}
+	if ( usystimer ) {
+		backend->unmap((void *)usystimer,page_size);
+		usystimer = NULL;
+	}
+	if ( ucm ) {
+		backend->unmap((void *)ucm,page_size);
+		ucm = NULL;
+	}
+	if ( upwm ) {
+		backend->unmap((void *)upwm,page_size);
+		upwm = NULL;
+	}
+	if ( upcm ) {
+		backend->unmap((void *)upcm,page_size);
+		upcm = NULL;
+	}
+	if ( backend->close )
+		backend->close();
+	gpio_store_hook = 0;
+}
+
+/* end libgp.c */
@@ -0,0 +1,152 @@
+//////////////////////////////////////////////////////////////////////
+// libgp.h -- Direct access GPIO functions
+// Date: Sun Jul 22 04:50:53 2018   (C) ve3wwg@gmail.com
+///////////////////////////////////////////////////////////////////////
+
+#ifndef LIBGP_H
+#define LIBGP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t volatile uint32_v;
+
+typedef enum IO {   // GPIO Input or Output:
+	Input=0,    // GPIO is to become an input pin
+	Output=1,   // GPIO is to become an output pin
+	Alt0=4,
+	Alt1=5,
+	Alt2=6,
+	Alt3=7,
+	Alt4=3,
+	Alt5=2
+} IO;
+
+typedef enum Pull { // GPIO Input Pullup resistor:
+	None,       // No pull up or down resistor
+	Up,         // Activate pullup resistor
+	Down        // Activate pulldown resistor
+} Pull;
+
+//////////////////////////////////////////////////////////////////////
+// Register backends: where ugpio/upads point. "mem" maps the real
+// peripherals from /dev/mem; "sim" attaches to the simulated register
+// block of the gpsim process. gpio_open() uses the backend selected by
+// gpio_set_backend(), else $LIBGP_BACKEND (ignored when setuid), else
+// "mem".
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	const char	*name;
+	bool		(*open)(void);
+	void		(*close)(void);
+	void		*(*map)(uint32_t offset,size_t bytes);	// Offset from peripheral base
+	void		(*unmap)(void *addr,size_t bytes);
+	void		(*store)(uint32_v *reg,uint32_t v);	// Null: plain stores
+} gpio_backend_t;
+
+extern const gpio_backend_t gpio_backend_mem;
+extern const gpio_backend_t gpio_backend_sim;
+
+void gpio_set_backend(const gpio_backend_t *be);
+const gpio_backend_t *gpio_get_backend();
+
+bool gpio_open();
+void gpio_close();
+
+int gpio_configure_io(int gpio,IO io);
+int gpio_alt_function(int gpio,IO *io);
+int gpio_get_drive_strength(int gpio,bool *slew_limited,bool *hysteresis,int *drive);
+int gpio_set_drive_strength(int gpio,bool slew_limited,bool hysteresis,int drive);
+int gpio_configure_pullup(int gpio,Pull pull);
+
+//////////////////////////////////////////////////////////////////////
+// Configuration transaction: batch pin setup for a whole board
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	uint32_t	fsel_mask[6];	// Fields touched per GPFSELn
+	uint32_t	fsel_bits[6];	// New field values per GPFSELn
+	uint32_t	pull[3][2];	// [GPPUD value][bank] pins to clock
+	uint32_t	pads[3];	// New PADS value per pad group
+	uint32_t	pads_touched;	// Bit x: pads[x] is to be written
+} gpio_config_t;
+
+void gpio_config_begin(gpio_config_t *cfg);
+int gpio_config_io(gpio_config_t *cfg,int gpio,IO io);
+int gpio_config_pull(gpio_config_t *cfg,int gpio,Pull pull);
+int gpio_config_drive(gpio_config_t *cfg,int gpio,bool slew_limited,bool hysteresis,int drive);
+int gpio_config_commit(gpio_config_t *cfg);
+
+int gpio_read(int gpio);
+int gpio_write(int gpio,int bit);
+
+uint32_t gpio_read32();
+uint32_t gpio_peri_base();
+
+//////////////////////////////////////////////////////////////////////
+// 1 MHz free-running system timer (CLO/CHI). gpio_timestamp() is one
+// MMIO load of CLO (microseconds, wraps every 71.6 minutes: subtract
+// as uint32_t). Without the timer page (e.g. the sim backend) both
+// fall back to CLOCK_MONOTONIC.
+//////////////////////////////////////////////////////////////////////
+
+extern uint32_v *usystimer;
+
+uint32_t gpio_timestamp_slow();
+uint64_t gpio_timestamp64_slow();
+
+static inline uint32_t
+gpio_timestamp() {
+	if ( __builtin_expect(usystimer != 0,1) )
+		return usystimer[1];		// CLO
+	return gpio_timestamp_slow();
+}
+
+static inline uint64_t
+gpio_timestamp64() {
+	uint32_t hi, lo;
+
+	if ( __builtin_expect(usystimer == 0,0) )
+		return gpio_timestamp64_slow();
+	do	{
+		hi = usystimer[2];		// CHI
+		lo = usystimer[1];		// CLO
+	} while ( hi != usystimer[2] );		// CLO wrapped
+	return (uint64_t)hi << 32 | lo;
+}
+
+int32_t gpio_timestamp_calibrate(unsigned ms);
+uint64_t gpio_timestamp_ns(uint64_t ts);
+
+//////////////////////////////////////////////////////////////////////
+// Port (bank 0) access: many pins per GPSET0/GPCLR0 store
+//////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	int		npins;		// Number of pins in group
+	int		shift;		// >= 0 when pins are contiguous ascending
+	uint32_t	mask;		// GPIO mask of all pins in group
+	uint32_t	bits[32];	// bits[x] is GPIO mask for value bit x
+} gpio_group_t;
+
+int gpio_port_write(uint32_t set,uint32_t clear);
+int gpio_port_put(uint32_t value,uint32_t mask);
+
+int gpio_group_init(gpio_group_t *grp,const int *pins,int npins);
+int gpio_group_configure_io(const gpio_group_t *grp,IO io);
+int gpio_group_write(const gpio_group_t *grp,uint32_t value);
+uint32_t gpio_group_read(const gpio_group_t *grp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBGP_H
+
+// End libgp.h
@@ -0,0 +1,152 @@
+//////////////////////////////////////////////////////////////////////
+// libgp.hpp -- Header-only C++ pin handles over libgp
+///////////////////////////////////////////////////////////////////////
+//
+// Pin<N> and PinGroup<N...> fold the register word and mask at compile
+// time, so read() is one volatile load of GPLEVn and set()/clear() one
+// volatile store to GPSETn/GPCLRn. PinHandle does the same arithmetic
+// once at construction for pins only known at run time.
+//
+// All register pointers are taken from ugpio, so gpio_open() must have
+// succeeded first (PinHandle objects must also be created after it).
+// Stores go through gpio_store(), which costs one predicted branch on
+// an ordinary variable so that the sim backend still sees them.
+
+#ifndef LIBGP_HPP
+#define LIBGP_HPP
+
+#include "libgp.h"
+#include "gpioreg.h"
+
+namespace gp {
+
+constexpr unsigned reg_set = GPIOOFF(GPIO_GPSET0);
+constexpr unsigned reg_clr = GPIOOFF(GPIO_GPCLR0);
+constexpr unsigned reg_lev = GPIOOFF(GPIO_GPLEV0);
+
+//////////////////////////////////////////////////////////////////////
+// A single pin fixed at compile time
+//////////////////////////////////////////////////////////////////////
+
+template <unsigned N>
+struct Pin {
+	static_assert(N < 54,"BCM283x has GPIO 0 to 53");
+
+	static constexpr unsigned gpio = N;
+	static constexpr unsigned bank = N / 32;
+	static constexpr uint32_t mask = 1u << (N % 32);
+
+	static inline void set() {
+		gpio_store(ugpio + reg_set + bank,mask);
+	}
+	static inline void clear() {
+		gpio_store(ugpio + reg_clr + bank,mask);
+	}
+	static inline void write(bool v) {
+		gpio_store(ugpio + (v ? reg_set : reg_clr) + bank,mask);
+	}
+	static inline bool read() {
+		return (ugpio[reg_lev + bank] & mask) != 0;
+	}
+	static inline int configure(IO io) {
+		return gpio_configure_io(N,io);
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+// Several pins of one bank fixed at compile time. Value bit x maps to
+// the x'th pin listed.
+//////////////////////////////////////////////////////////////////////
+
+template <unsigned... Ns>
+struct PinGroup {
+	static_assert(sizeof...(Ns) > 0 && sizeof...(Ns) <= 32,"1 to 32 pins");
+
+	static constexpr unsigned npins = sizeof...(Ns);
+	static constexpr unsigned pins[npins] = { Ns... };
+	static constexpr unsigned bank = pins[0] / 32;
+	static constexpr uint32_t mask = ((1u << (Ns % 32)) | ...);
+
+	static constexpr bool same_bank() {
+		for ( unsigned x=0; x<npins; ++x )
+			if ( pins[x] / 32 != bank )
+				return false;
+		return true;
+	}
+	static_assert(same_bank(),"PinGroup pins must share a bank");
+	static_assert(__builtin_popcount(mask) == npins,"PinGroup has duplicate pins");
+
+	// Spread value bits onto the GPIO positions
+	static constexpr uint32_t scatter(uint32_t value) {
+		uint32_t r = 0;
+
+		for ( unsigned x=0; x<npins; ++x )
+			r |= ((value >> x) & 1u) << (pins[x] % 32);
+		return r;
+	}
+
+	static inline void set_all() {
+		gpio_store(ugpio + reg_set + bank,mask);
+	}
+	static inline void clear_all() {
+		gpio_store(ugpio + reg_clr + bank,mask);
+	}
+	static inline void write(uint32_t value) {
+		uint32_t s = scatter(value);
+
+		gpio_store(ugpio + reg_set + bank,s);
+		gpio_store(ugpio + reg_clr + bank,mask & ~s);
+	}
+	static inline uint32_t read() {
+		uint32_t lev = ugpio[reg_lev + bank], r = 0;
+
+		for ( unsigned x=0; x<npins; ++x )
+			r |= ((lev >> (pins[x] % 32)) & 1u) << x;
+		return r;
+	}
+	static inline int configure(IO io) {
+		for ( unsigned x=0; x<npins; ++x )
+			if ( int rc = gpio_configure_io(pins[x],io) )
+				return rc;
+		return 0;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+// A pin chosen at run time: pointers and mask precomputed on open
+//////////////////////////////////////////////////////////////////////
+
+class PinHandle {
+	uint32_v	*setp = nullptr;
+	uint32_v	*clrp = nullptr;
+	uint32_v	*levp = nullptr;
+	uint32_t	mask = 0;
+	int		gpio = -1;
+public:	PinHandle() = default;
+	explicit PinHandle(int gpio) { open(gpio); }
+
+	bool open(int pin) {
+		if ( pin < 0 || pin > 53 || !ugpio )
+			return false;
+		gpio = pin;
+		mask = 1u << (pin % 32);
+		setp = ugpio + reg_set + pin / 32;
+		clrp = ugpio + reg_clr + pin / 32;
+		levp = ugpio + reg_lev + pin / 32;
+		return true;
+	}
+	bool is_open() const { return gpio >= 0; }
+	int pin() const { return gpio; }
+
+	inline void set() const { gpio_store(setp,mask); }
+	inline void clear() const { gpio_store(clrp,mask); }
+	inline void write(bool v) const { gpio_store(v ? setp : clrp,mask); }
+	inline bool read() const { return (*levp & mask) != 0; }
+	int configure(IO io) const { return gpio_configure_io(gpio,io); }
+};
+
+} // namespace gp
+
+#endif // LIBGP_HPP
+
+// End libgp.hpp